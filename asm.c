@@ -3,6 +3,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include "simimage.h"
 
 /*Constants*/
 
@@ -19,43 +20,89 @@ typedef struct Label
     struct Label *next;
 } Label;
 
+/*Program struct: the instructions and the initial data memory of the assembled program*/
+typedef struct Program
+{
+    uint64_t instructions[MEM_DEPTH];    /*The 12 hex digits of each instruction of imemin.txt*/
+    int instruction_count;
+    int dmemin[MEM_DEPTH];
+    int dmemin_depth;
+} Program;
+
 /*Function Prototypes*/
 
 void strip_newline(char *s);
 int open_files(int argc, char *argv[], FILE **asm_fp, FILE **imemin_fp, FILE **dmemin_fp);
 void first_pass(FILE *fp, Label **labels);
-void second_pass(FILE *asm_fp, FILE *imemin_fp, FILE *dmemin_fp, Label *labels);
-void parse_line_imemin(char *tokens[], FILE *imemin_fp, Label *labels);
+int second_pass(FILE *asm_fp, Program *program, Label *labels);
+uint64_t parse_line_imemin(char *tokens[], Label *labels);
 void set_memory(char *tokens[], int dmemin[], int *dmemin_depth);
+void imemin_write(FILE *imemin_fp, const uint64_t instructions[], int instruction_count);
 void dmemin_write(FILE *dmemin_fp, int dmemin[], int dmemin_depth);
 int line_status(char *token);
 int parse_opcode(char *opcode);
 int parse_reg(char *reg);
 int parse_imm(char *imm, Label *labels);
 int parse_label(char *label, Label *labels);
+int write_symbols(const char *symbols_file, Label *labels);
+int write_image(const char *image_file, const Program *program, Label *labels);
 
 int main(int argc, char *argv[])
 {
     FILE *asm_fp = NULL, *imemin_fp = NULL, *dmemin_fp = NULL;
     Label *labels = NULL;
+    Program *program = calloc(1, sizeof(Program));
+    int binary = (argc == 4 && strcmp(argv[1], "-b") == 0), result;
 
-    /*Open files.*/
-    if (open_files(argc, argv, &asm_fp, &imemin_fp, &dmemin_fp))
+    /*Open files, with -b only the program, the image is written at the end.*/
+    if (binary)
+    {
+        strip_newline(argv[2]);
+        strip_newline(argv[3]);
+        asm_fp = fopen(argv[2], "r");
+    }
+    if (!program || (binary ? !asm_fp : open_files(argc, argv, &asm_fp, &imemin_fp, &dmemin_fp)))
     {
+        free(program);
         return 1;
     }
 
     /*First pass.*/
     first_pass(asm_fp, &labels);
 
+    /*Write the addresses of the labels if a symbol file is given.*/
+    result = !binary && argc == 5 && write_symbols(argv[4], labels);
+
     /*Second pass.*/
-    second_pass(asm_fp, imemin_fp, dmemin_fp, labels);
+    if (!result)
+    {
+        result = second_pass(asm_fp, program, labels);
+        if (result)
+        {
+            fprintf(stderr, "%s: more instructions than the instruction memory holds\n", argv[binary ? 2 : 1]);
+        }
+    }
+
+    /*Write the instructions and the data memory, as text or as a binary image.*/
+    if (!result && binary)
+    {
+        result = write_image(argv[3], program, labels);
+    }
+    else if (!result)
+    {
+        imemin_write(imemin_fp, program->instructions, program->instruction_count);
+        dmemin_write(dmemin_fp, program->dmemin, program->dmemin_depth);
+    }
 
     /*Close files.*/
     fclose(asm_fp);
-    fclose(imemin_fp);
-    fclose(dmemin_fp);
-    return 0;
+    if (!binary)
+    {
+        fclose(imemin_fp);
+        fclose(dmemin_fp);
+    }
+    free(program);
+    return result;
 }
 
 /**
@@ -90,8 +137,8 @@ void strip_newline(char *s)
 int open_files(int argc, char *argv[], FILE **asm_fp, FILE **imemin_fp, FILE **dmemin_fp)
 {
     int i;
-    /*Check for valid number of command line arguments.*/
-    if (argc != 4)
+    /*Check for valid number of command line arguments, the symbol file is optional.*/
+    if (argc != 4 && argc != 5)
     {
         return 1;
     }
@@ -196,16 +243,16 @@ void first_pass(FILE *fp, Label **labels)
 }
 
 /**
- * @brief Parses an input .asm file and writes the results to two output .txt files.
+ * @brief Parses an input .asm file into the instructions and the initial data memory of the program.
  *
  * @param asm_fp A pointer to the input .asm file.
- * @param imemin_fp A pointer to  instruction memory output .txt file.
- * @param dmemin_fp A pointer to data memory output .txt file.
+ * @param program The program, which starts empty.
  * @param labels List of labels, containing all labels in the .asm file and their addresses.
+ * @return 0 on success, 1 if there are more instructions than the instruction memory holds.
  */
-void second_pass(FILE *asm_fp, FILE *imemin_fp, FILE *dmemin_fp, Label *labels)
+int second_pass(FILE *asm_fp, Program *program, Label *labels)
 {
-    int word_count, status, dmemin_depth = 0, dmemin[MEM_DEPTH] = {0};
+    int word_count, status;
     char line[MAX_LINE], *word, *words[MAX_WORDS];
 
     /*parse the assembly file.*/
@@ -241,20 +288,23 @@ void second_pass(FILE *asm_fp, FILE *imemin_fp, FILE *dmemin_fp, Label *labels)
             continue;
         }
 
-        /*Write to imemin.*/
+        /*Parse an instruction.*/
         else if (status == 1)
         {
-            parse_line_imemin(words, imemin_fp, labels);
+            if (program->instruction_count >= MEM_DEPTH)
+            {
+                return 1;
+            }
+            program->instructions[program->instruction_count++] = parse_line_imemin(words, labels);
         }
 
         /*Parse initial data memory image.*/
         else if (status == 2)
         {
-            set_memory(words, dmemin, &dmemin_depth);
+            set_memory(words, program->dmemin, &program->dmemin_depth);
         }
     }
-    /*Write to dmemin.*/
-    dmemin_write(dmemin_fp, dmemin, dmemin_depth);
+    return 0;
 }
 
 /**
@@ -297,13 +347,14 @@ int line_status(char *token)
 }
 
 /**
- * @brief Parses an instruction line and writes the result to the output file.
+ * @brief Parses an instruction line into the 12 hex digits of its line of imemin.txt.
  *
  * @param tokens An array of strings representing the 7 parts of the instruction.
- * @param imemin_fp A pointer to the output imemin.txt file to write the result of the parsing.
  * @param labels List of labels, containing all labels in the .asm file and their addresses.
+ * @return The instruction, with the opcode in bits 40-47, rd, rs, rt and rm in the next 4 bits each,
+ * and imm1 and imm2 in the low 24 bits.
  */
-void parse_line_imemin(char *tokens[], FILE *imemin_fp, Label *labels)
+uint64_t parse_line_imemin(char *tokens[], Label *labels)
 {
     int opcode, rd, rs, rt, rm, imm1, imm2;
 
@@ -316,8 +367,10 @@ void parse_line_imemin(char *tokens[], FILE *imemin_fp, Label *labels)
     imm1 = parse_imm(tokens[5], labels);
     imm2 = parse_imm(tokens[6], labels);
 
-    /*Write to imemin.*/
-    fprintf(imemin_fp, "%02X%01X%01X%01X%01X%03X%03X\n", opcode, rd, rs, rt, rm, imm1 & 0xFFF, imm2 & 0xFFF);
+    /*Pack the fields as they are written to imemin.*/
+    return ((uint64_t)(opcode & 0xFF) << 40) | ((uint64_t)(rd & 0xF) << 36) | ((uint64_t)(rs & 0xF) << 32) |
+           ((uint64_t)(rt & 0xF) << 28) | ((uint64_t)(rm & 0xF) << 24) | ((uint64_t)(imm1 & 0xFFF) << 12) |
+           (uint64_t)(imm2 & 0xFFF);
 }
 
 /**
@@ -341,6 +394,24 @@ void set_memory(char *tokens[], int dmemin[], int *dmemin_depth)
     *dmemin_depth = (*dmemin_depth > address + 1) ? *dmemin_depth : address + 1;
 }
 
+/**
+ * @brief Function to write the instructions to the imemin.txt output file.
+ *
+ * @param imemin_fp A pointer to the output imemin.txt file.
+ * @param instructions The instructions.
+ * @param instruction_count The number of instructions.
+ */
+void imemin_write(FILE *imemin_fp, const uint64_t instructions[], int instruction_count)
+{
+    int i;
+
+    /*Write to imemin.*/
+    for (i = 0; i < instruction_count; i++)
+    {
+        fprintf(imemin_fp, "%06X%06X\n", (unsigned int)(instructions[i] >> 24), (unsigned int)(instructions[i] & 0xFFFFFF));
+    }
+}
+
 /**
  * @brief Function to write the initial memory image to the dmemin.txt output file.
  *
@@ -584,4 +655,66 @@ int parse_label(char *label, Label *labels)
         curr = curr->next;
     }
     return -1;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Function for writing the labels and their addresses to a symbol file.
+ * Each line holds the address of a label as 3 hex digits, like the PC in trace.txt, and its name.
+ *
+ * @param symbols_file The name of the symbol file.
+ * @param labels List of labels, containing all labels in the .asm file and their addresses.
+ * @return 0 on successful writing to file, 1 on failure.
+ */
+int write_symbols(const char *symbols_file, Label *labels)
+{
+    FILE *fp = fopen(symbols_file, "w");
+    if (!fp)
+    {
+        return 1;
+    }
+    for (; labels; labels = labels->next)
+    {
+        fprintf(fp, "%03X %s\n", labels->address & 0xFFF, labels->name);
+    }
+    fclose(fp);
+    return 0;
+}
+
+/**
+ * @brief Function for writing the program as a binary image, which sim loads in place of imemin.txt and dmemin.txt,
+ * and which holds the labels of the symbol file.
+ *
+ * @param image_file The name of the image.
+ * @param program The instructions and the initial data memory of the program.
+ * @param labels List of labels, containing all labels in the .asm file and their addresses.
+ * @return 0 on successful writing to file, 1 on failure.
+ */
+int write_image(const char *image_file, const Program *program, Label *labels)
+{
+    ImageSymbol *symbols;
+    Label *curr;
+    FILE *fp;
+    int count = 0, result;
+
+    for (curr = labels; curr; curr = curr->next)
+    {
+        count++;
+    }
+    symbols = calloc(count ? (size_t)count : 1, sizeof(ImageSymbol));
+    fp = symbols ? fopen(image_file, "wb") : NULL;
+    if (!fp)
+    {
+        free(symbols);
+        return 1;
+    }
+    for (count = 0, curr = labels; curr; curr = curr->next, count++)
+    {
+        symbols[count].address = curr->address & 0xFFF;
+        strncpy(symbols[count].name, curr->name, IMAGE_SYMBOL_LEN - 1);
+    }
+    result = image_write(fp, program->instructions, program->instruction_count, program->dmemin, program->dmemin_depth,
+                         symbols, count);
+    result |= fclose(fp) != 0;
+    free(symbols);
+    return result;
+}
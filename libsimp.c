@@ -0,0 +1,4354 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "libsimp.h"
+
+#if defined(__x86_64__) && !defined(_WIN32)
+#define SIM_JIT_SUPPORTED
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define SIM_HEX_SSE2
+#include <emmintrin.h>
+#endif
+
+/*Constants*/
+
+#define MEM_DEPTH SIM_MEM_DEPTH
+#define MEM_MASK (MEM_DEPTH - 1)                /*Addresses of the memory and the program counter are 12 bits wide*/
+#define CPU_REG_NUM SIM_CPU_REG_NUM
+#define IO_REG_NUM SIM_IO_REG_NUM
+#define TRUE 1
+#define FALSE 0
+#define READ "READ"
+#define WRITE "WRITE"
+#define PIXELS SIM_PIXELS
+#define MONITOR_MASK (PIXELS * PIXELS - 1)      /*monitoraddr is 16 bits wide*/
+#define DISK_CYCLES 1024
+#define DISK_SECTORS SIM_DISK_SECTORS
+#define SECTOR_WORDS SIM_DISK_SECTOR_WORDS
+#define MAX_DISK_WORDS 0x7FFFFFFF    /*Words of the largest disk, so that an offset of the disk fits an int*/
+#define INSTRUCTION_LEN 12
+#define OPCODE_NUM 22
+#define JIT_THRESHOLD 16
+#define JIT_CODE_SIZE (4 * 1024 * 1024)
+#define JIT_MAX_INSTRUCTION_BYTES 80
+#define JIT_CACHED_REGISTERS 8      /*Host registers that hold registers of the program for a whole block*/
+#define JIT_SAVED_REGISTERS 2       /*The first of them, which calls do not change*/
+#define SPIN_MAX_LEN 8
+#define SPIN_MISS_LIMIT 8
+#define TRACE_LINE_LEN 168   /*A line of trace.txt is 162 characters long*/
+#define TRACE_MASK_SHIFT 12
+#define PC_INCLUDED 1
+#define PC_EXCLUDED 2
+#define SPIN_BUFFER_SIZE (64 * 1024)
+#define CHECKPOINT_MAGIC "SIMPCKPT"
+#define CHECKPOINT_VERSION 6
+#define CHECKPOINT_BYTE_ORDER 0x01020304
+#define PROGRAM_MAGIC "SIMPPROG"
+#define PROGRAM_VERSION 1
+#define CLOCK_PERIOD 0xFFFFFFFFULL   /*The clock counts from 0 to 0xFFFFFFFE and wraps around to 0*/
+#define IRQ2_WINDOW 4096             /*Entries of a streamed irq 2 schedule held at a time*/
+#define IRQ2_CHUNK (16 * 1024)       /*Bytes read from a streamed irq 2 schedule at a time*/
+#define MAX_CYCLE_DIGITS 20          /*Digits of the largest cycle number, UINT64_MAX*/
+
+/*The words of a sector that was never written and has no base image, the largest sector fills the memory*/
+static const int32_t zero_sector[MEM_DEPTH];
+
+/*The two hex digits of each byte value, used to format hex without printf*/
+static const char hex_pairs[] =
+    "000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F"
+    "202122232425262728292A2B2C2D2E2F303132333435363738393A3B3C3D3E3F"
+    "404142434445464748494A4B4C4D4E4F505152535455565758595A5B5C5D5E5F"
+    "606162636465666768696A6B6C6D6E6F707172737475767778797A7B7C7D7E7F"
+    "808182838485868788898A8B8C8D8E8F909192939495969798999A9B9C9D9E9F"
+    "A0A1A2A3A4A5A6A7A8A9AAABACADAEAFB0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+    "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECFD0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+    "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF";
+
+typedef struct Instruction Instruction;
+typedef struct Irq2Stream Irq2Stream;
+typedef struct JitState JitState;
+
+/*Handler that executes one instruction, selected when the instruction is loaded*/
+typedef void (*Handler)(SimMachine *m, const Instruction *inst);
+
+/*Decoded instruction struct*/
+struct Instruction
+{
+    Handler execute;                 /*Handler of the opcode*/
+    const int *rd_val;               /*Operand sources: the immediate field for $imm1/$imm2, the register otherwise*/
+    const int *rs_val;
+    const int *rt_val;
+    const int *rm_val;
+    int opcode;
+    int rd;
+    int rs;
+    int rt;
+    int rm;
+    int imm1;                        /*Sign extended value of the first immediate*/
+    int imm2;                        /*Sign extended value of the second immediate*/
+    char text[INSTRUCTION_LEN + 1];  /*The instruction as written in imemin.txt, used for trace.txt*/
+};
+
+/*Basic block struct*/
+typedef struct Block
+{
+    int translated;              /*TRUE once the block has been discovered*/
+    int start;                   /*Address of the first instruction of the block*/
+    int body_len;                /*Number of straight-line instructions before the terminator*/
+    int has_terminator;          /*FALSE if the block runs into the end of the instruction memory*/
+    int taken_pc;                /*Target of the terminator when it is known at translation time, -1 otherwise*/
+    struct Block *fallthrough;   /*Linked block at the address after the terminator*/
+    struct Block *taken;         /*Linked block at taken_pc*/
+    int hits;                    /*Number of times the whole body ran, up to JIT_THRESHOLD, used to find hot blocks*/
+    int spin_len;                /*Length of the loop when the block heads a candidate spin loop, 0 otherwise*/
+    int spin_misses;             /*Number of iterations of the loop that were found not to spin*/
+    void (*native)(JitState *jit); /*Native code of the body when the block was translated by the jit, for cycles
+                                     in which trace.txt is not written*/
+    void (*traced)(JitState *jit); /*Native code of the body that writes its lines of trace.txt as well*/
+} Block;
+
+/*State shared between the simulator and the native code of the jit*/
+struct JitState
+{
+    int *registers;                            /*Pinned base of cpu_registers*/
+    int *memory;                               /*Pinned base of memory*/
+    int *depth;                                /*Maximum depth of used memory, updated by sw*/
+    void (*trace)(JitState *jit, int address); /*Called before every traced instruction to write trace.txt*/
+    SimMachine *machine;                       /*The machine the native code runs on*/
+    unsigned char *code;                       /*Executable region holding the native code*/
+    size_t code_used;                          /*Number of bytes of code emitted so far*/
+};
+
+/*JitRegisters struct: where the registers of the program are while the native code of a block is emitted*/
+typedef struct JitRegisters
+{
+    int host[CPU_REG_NUM];                     /*Host register that holds the register for the whole block, -1 for none*/
+    int dirty[CPU_REG_NUM];                    /*TRUE if the host register was written since cpu_registers was*/
+} JitRegisters;
+
+/*State of one simulated machine, so that several machines can run in one process.
+  The core state used by every instruction comes first and shares the first cache lines,
+  the disk and the 256 KB monitor, which only disk transfers and monitor writes touch, come last.
+  The disk is sparse: a sector is read from the base image, or is 0 without one, until it is loaded from diskin.txt
+  or written by the program, and only then gets a copy of its own. The base image is never written, so runs of
+  several machines and processes share one mapped image.*/
+struct SimMachine
+{
+    /*Core state.*/
+    int pc;                                  /*Program counter*/
+    int cont;                                /*The program continues running as long as cont is TRUE (1)*/
+    int irq;                                 /*The program jumps to interrupt service if irq is TRUE (1)*/
+    int in_isr;                              /*Flag that indicates if the program is currently in interupt service*/
+    int cpu_registers[CPU_REG_NUM];          /*Cpu registers and their contents*/
+    int io_registers[IO_REG_NUM];            /*IO registers and their contents, io_registers[8] is the clock*/
+
+    /*Peripheral events.*/
+    int schedule_valid;                      /*TRUE while next_event is up to date*/
+    unsigned int next_event;                 /*Clock cycle in which the next peripheral event can occur*/
+    int disk_cycles;                         /*Number of disk cycles the disk has performed*/
+    uint32_t clock_wraps;                    /*Number of times the clock wrapped around, which extends it to 64 bits*/
+    size_t interrupt_pos;                    /*Index in interrupts of the next entry of irq 2*/
+    size_t interrupt_count;                  /*Number of entries in interrupts*/
+    uint64_t *interrupts;                    /*Cycles of the irq 2 schedule in increasing order, all of them or a window*/
+
+    /*Program and memory.*/
+    int instruction_count;                   /*Number of instructions loaded from imemin.txt*/
+    int depth;                               /*The maximum depth of used memory*/
+    int memory[MEM_DEPTH];                   /*Memory of the program*/
+    Instruction instructions[MEM_DEPTH];     /*Decoded instruction memory, indexed by the program counter*/
+    Block blocks[MEM_DEPTH];                 /*Basic block cache, indexed by the address of the first instruction*/
+    Block *block;                            /*The block that ran last, NULL before the first step*/
+    int completed;                           /*TRUE if the block that ran last ran all of its instructions including the terminator*/
+    uint64_t cycles_run;                     /*Number of cycles the program has run, which unlike the clock it cannot change*/
+    int jit_enabled;                         /*Hot blocks are translated to native code if jit_enabled is TRUE (1)*/
+    JitState jit;                            /*State of the jit*/
+
+    /*Output streams written during the run.*/
+    SimSink sinks[SIM_STREAM_NUM];           /*Receivers of trace.txt, hwregtrace.txt, leds.txt and display7seg.txt, NULL to discard*/
+    void *sink_users[SIM_STREAM_NUM];        /*Argument passed to each receiver*/
+    uint64_t stream_bytes[SIM_STREAM_NUM];   /*Number of bytes written to each stream, the position in its output file*/
+    int formats[SIM_STREAM_NUM];             /*SIM_FORMAT_TEXT or SIM_FORMAT_BINARY for each stream*/
+    int trace_registers[CPU_REG_NUM];        /*Registers in the last record of a binary trace, the base of the next one*/
+    char spin_lines[SPIN_BUFFER_SIZE];       /*Trace lines of a spin loop, repeated when it is skipped*/
+
+    /*Filters of trace.txt and hwregtrace.txt.*/
+    unsigned char pc_marks[MEM_DEPTH];       /*PC_INCLUDED and PC_EXCLUDED marks of the filtered address ranges*/
+    unsigned char traced_pcs[MEM_DEPTH];     /*TRUE for the addresses whose instructions are traced, from pc_marks*/
+    uint64_t trace_start;                    /*First cycle of the window in which lines are written, by cycles_run*/
+    uint64_t trace_stop;                     /*Cycle after the window*/
+    unsigned int trace_every;                /*Only one of every trace_every traced instructions is written, 1 for all*/
+    unsigned int trace_sample;               /*Traced instructions to skip before the next one is written*/
+    int trigger;                             /*Interrupt whose first request starts tracing, SIM_TRIGGER_NONE for none*/
+    int triggered;                           /*TRUE once the trigger fired, always TRUE without a trigger*/
+    int in_window;                           /*TRUE while the current cycle is inside the window*/
+    int trace_on;                            /*TRUE while in_window and triggered, the filters that depend on time*/
+
+    /*Loading.*/
+    int load_line;                           /*Line of the image the last loader failed on, 0 if not on a line*/
+    const char *load_error;                  /*Why the last loader failed, NULL if it did not*/
+
+    /*Irq 2 schedule.*/
+    uint64_t interrupt_base;                 /*Number of entries of the schedule before interrupts[0]*/
+    uint32_t interrupt_hash;                 /*Hash of the entries that were triggered*/
+    Irq2Stream *irq2_stream;                 /*Source of the rest of a streamed schedule, NULL once it is all read*/
+
+    /*Disk and monitor.*/
+    int disk_offset;                         /*Maximum offset of disk*/
+    int max_monitor_offset;                  /*The maximum offset in which a pixel was written to the monitor*/
+    int disk_sectors;                        /*Number of sectors of the disk*/
+    int sector_words;                        /*Number of words of a sector, moved by each transfer*/
+    const int32_t *disk_base;                /*Base image of the disk, its sectors one after another, NULL for 0*/
+    void (*release_base)(void *user);        /*Called once the base image is no longer used, or NULL*/
+    void *base_user;                         /*Argument passed to release_base*/
+    int32_t **sector_copies;                 /*Copy of each sector, NULL while the sector is read from the base*/
+    uint32_t *dirty_sectors;                 /*Bitmap of the sectors written by the program*/
+    int *copy_order;                         /*Sectors that have a copy, in the order they were copied*/
+    int copy_count;                          /*Number of entries in copy_order*/
+    int copy_capacity;                       /*Number of entries copy_order can hold*/
+    int lost_writes;                         /*Number of sector writes dropped for lack of memory*/
+    int monitor[PIXELS][PIXELS];             /*Monitor and the pixel values of each pixel*/
+};
+
+/*Irq2Stream struct: a schedule of irq 2 read while the program runs, a window of IRQ2_WINDOW entries at a time*/
+struct Irq2Stream
+{
+    SimReader read;                          /*Reads the next bytes of irq2in.txt*/
+    void (*close)(void *user);               /*Called once the schedule is no longer read, or NULL*/
+    void *user;                              /*Argument passed to read and close*/
+    char text[IRQ2_CHUNK + MAX_CYCLE_DIGITS]; /*Text read but not parsed yet, after it a number cut by a read*/
+    size_t text_len;
+    int line;                                /*Line of irq2in.txt at the start of text*/
+    int ended;                               /*TRUE once read returned 0*/
+    int started;                             /*TRUE once an entry was parsed*/
+    uint64_t last;                           /*The last entry parsed*/
+};
+
+/*Checkpoint struct: the layout of a checkpoint, which is the same in memory and in a file.
+  Every field is at a fixed offset and naturally aligned, so a checkpoint that is mapped from a file is used in place.
+  It is followed by a CheckpointSector and the words of each sector that has a copy, in the order they were copied,
+  so a checkpoint grows with the sectors the run loaded and wrote, not with the disk, and a sector copied later
+  does not move the ones before it.*/
+typedef struct Checkpoint
+{
+    char magic[8];                           /*CHECKPOINT_MAGIC, without the terminating '\0'*/
+    uint32_t version;                        /*CHECKPOINT_VERSION*/
+    uint32_t byte_order;                     /*CHECKPOINT_BYTE_ORDER as written by the host that saved the checkpoint*/
+    uint32_t size;                           /*Size of the checkpoint in bytes*/
+    uint32_t program_hash;                   /*Hash of the loaded instructions, which are not saved*/
+    uint32_t irq2_hash;                      /*Hash of the entries of irq 2 triggered, the schedule is not saved*/
+    int32_t pc;
+    int32_t cont;
+    int32_t irq;
+    int32_t in_isr;
+    int32_t cpu_registers[CPU_REG_NUM];
+    int32_t io_registers[IO_REG_NUM];
+    int32_t disk_cycles;
+    uint32_t clock_wraps;
+    int32_t depth;
+    int32_t disk_offset;
+    int32_t max_monitor_offset;
+    int32_t disk_sectors;
+    int32_t sector_words;
+    int32_t disk_attached;                   /*TRUE if the sectors without a copy are read from a base image*/
+    uint32_t copy_count;                     /*Number of sectors that follow the checkpoint*/
+    int32_t reserved;                        /*Aligns stream_bytes, always 0*/
+    uint64_t stream_bytes[SIM_STREAM_NUM];
+    uint64_t cycles_run;
+    uint64_t interrupt_index;                /*Number of entries of irq 2 triggered*/
+    int32_t trace_registers[CPU_REG_NUM];
+    int32_t triggered;
+    uint32_t trace_sample;
+    int32_t memory[MEM_DEPTH];
+    int32_t monitor[PIXELS][PIXELS];
+} Checkpoint;
+
+/*CheckpointSector struct: the start of a sector of a checkpoint, followed by its words*/
+typedef struct CheckpointSector
+{
+    int32_t sector;
+    int32_t dirty;                           /*TRUE if the program wrote the sector*/
+} CheckpointSector;
+
+/*ProgramHeader struct: the start of a predecoded program, followed by a ProgramInstruction and then a ProgramBlock
+  for each instruction. Like a checkpoint it is only read when restored, so it can be used in place from a file.*/
+typedef struct ProgramHeader
+{
+    char magic[8];                           /*PROGRAM_MAGIC, without the terminating '\0'*/
+    uint32_t version;                        /*PROGRAM_VERSION*/
+    uint32_t byte_order;                     /*CHECKPOINT_BYTE_ORDER as written by the host that saved the program*/
+    uint32_t size;                           /*Size of the predecoded program in bytes*/
+    int32_t instruction_count;
+} ProgramHeader;
+
+/*ProgramInstruction struct: the decoded fields of an instruction*/
+typedef struct ProgramInstruction
+{
+    int32_t opcode;
+    int32_t rd;
+    int32_t rs;
+    int32_t rt;
+    int32_t rm;
+    int32_t imm1;
+    int32_t imm2;
+    char text[INSTRUCTION_LEN + 4];          /*The instruction as written in imemin.txt, padded with '\0'*/
+} ProgramInstruction;
+
+/*ProgramBlock struct: the basic block that starts at an instruction, as translate_block finds it*/
+typedef struct ProgramBlock
+{
+    int32_t body_len;
+    int32_t has_terminator;
+    int32_t taken_pc;
+    int32_t spin_len;
+} ProgramBlock;
+
+/*Function Prototypes*/
+
+/*Functions that identify the program and the irq 2 schedule of a checkpoint.*/
+
+static uint32_t hash_bytes(uint32_t hash, const void *data, size_t len);
+static uint32_t program_hash(const SimMachine *m);
+
+/*Functions that read the images given to the loaders.*/
+
+static int next_word(const char **text, const char *end, int *line, const char **word, int *len);
+static int get_hex(const char *digits, int len, unsigned int *value);
+static int get_hex8(const char *digits, unsigned int *value);
+static void clear_program(SimMachine *m);
+static int load_error(SimMachine *m, int line, const char *error);
+static int next_cycle(const char **text, const char *end, int final, int *line, uint64_t *value);
+
+/*Functions that hold the irq 2 schedule, all of it or a window of a streamed one.*/
+
+static void clear_irq2(SimMachine *m);
+static void end_irq2_stream(SimMachine *m);
+static int fill_irq2(SimMachine *m);
+static int seek_irq2(SimMachine *m, uint64_t index, uint32_t hash);
+static uint64_t irq2_clock(const SimMachine *m);
+static int compare_cycles(const void *a, const void *b);
+
+/*Functions preformed in each cycle.*/
+
+static unsigned int update_trace_window(SimMachine *m, unsigned int cycles);
+static unsigned int run_cycles(SimMachine *m, unsigned int cycles);
+
+/*Functions that discover and run basic blocks.*/
+
+static int ends_block(int opcode);
+static void find_block(const SimMachine *m, int start, Block *block);
+static Block *translate_block(SimMachine *m, int start);
+static Block *lookup_block(SimMachine *m, int address);
+static Block *next_block(SimMachine *m, Block *block, int completed);
+static void run_block_body(SimMachine *m, Block *block, int count);
+static void execute_cycle(SimMachine *m);
+static int quiet_cycles(SimMachine *m);
+static int cycles_until_event(SimMachine *m);
+static void advance_cycles(SimMachine *m, int count);
+static void end_cycle(SimMachine *m);
+
+/*Functions that detect spin loops and skip them to the next event.*/
+
+static int spin_length(const SimMachine *m, int start);
+static unsigned int fast_forward_spin(SimMachine *m, Block *block, unsigned int limit);
+
+/*Functions of the x86-64 jit that translates hot block bodies to native code.*/
+
+static int jit_init(SimMachine *m);
+static int jit_protect(SimMachine *m, size_t start, size_t end, int writable);
+static void jit_trace(JitState *state, int address);
+static void jit_emit(SimMachine *m, const unsigned char *bytes, int len);
+static void jit_emit_u32(SimMachine *m, unsigned int value);
+static void jit_emit_modrm(SimMachine *m, unsigned char opcode, int reg, int rm, int memory);
+static void jit_flush(SimMachine *m);
+static void jit_allocate(SimMachine *m, const Block *block, int traced, JitRegisters *regs);
+static void jit_write_back(SimMachine *m, JitRegisters *regs);
+static void jit_load_operand(SimMachine *m, int host_reg, int reg, const Instruction *inst, const JitRegisters *regs);
+static void jit_compile_instruction(SimMachine *m, const Instruction *inst, int address, int traced, JitRegisters *regs);
+static int jit_compile_block(SimMachine *m, Block *block, int traced);
+
+/*Functions that are part of the fetch-decode-execute process.*/
+
+static void decode_instruction(unsigned int high, unsigned int low, int *opcode, int *rd, int *rs, int *rt, int *rm,
+                               int *imm1, int *imm2);
+static void bind_instruction(SimMachine *m, Instruction *inst);
+static const int *resolve_operand(SimMachine *m, Instruction *inst, int reg);
+
+/*Functions that are responsible for writing to output file during the fetch-decode-execute process.*/
+
+static void emit(SimMachine *m, int stream, const char *text, size_t len);
+static void emit_header(SimMachine *m, int stream);
+static int put_word(char *buf, unsigned int value);
+static char *put_hex8(char *buf, unsigned int value);
+static void write_to_trace(SimMachine *m, const char *instruction, int imm1, int imm2);
+static int format_trace(SimMachine *m, char *buf, int address, const char *instruction, int imm1, int imm2);
+static void write_to_hwregtrace(SimMachine *m, int cycle, char *action, int reg_num, int data);
+static void emit_hwregtrace(SimMachine *m, int cycle, char *action, int reg_num, int data);
+static void write_to_leds_and_display(SimMachine *m, int stream, int cycle, int status);
+static char *find_io_reg(int reg_num);
+
+/*Functions that are responsible for handling interrupts in the program.*/
+
+static int handle_interrupts(SimMachine *m);
+static void check_interrupts(SimMachine *m);
+static void handle_clock_cycles(SimMachine *m);
+static void update_timer(SimMachine *m);
+static void check_irq2in(SimMachine *m);
+static void fire_trigger(SimMachine *m, int irq);
+
+/*Functions that are responsible for handling the disk.*/
+
+static void handle_disk(SimMachine *m);
+static void read_sector(SimMachine *m);
+static void write_sector(SimMachine *m);
+static void clear_disk(SimMachine *m);
+static const int32_t *disk_sector(const SimMachine *m, int sector);
+static int32_t *copy_sector(SimMachine *m, int sector);
+static int check_geometry(int sectors, int sector_words);
+
+/*Function implemetaions of the cpu registers.*/
+
+static void add(SimMachine *m, const Instruction *inst);
+static void sub(SimMachine *m, const Instruction *inst);
+static void mac(SimMachine *m, const Instruction *inst);
+static void and_func(SimMachine *m, const Instruction *inst);
+static void or_func(SimMachine *m, const Instruction *inst);
+static void xor_func(SimMachine *m, const Instruction *inst);
+static void sll(SimMachine *m, const Instruction *inst);
+static void sra(SimMachine *m, const Instruction *inst);
+static void srl(SimMachine *m, const Instruction *inst);
+static void beq(SimMachine *m, const Instruction *inst);
+static void bne(SimMachine *m, const Instruction *inst);
+static void blt(SimMachine *m, const Instruction *inst);
+static void bgt(SimMachine *m, const Instruction *inst);
+static void ble(SimMachine *m, const Instruction *inst);
+static void bge(SimMachine *m, const Instruction *inst);
+static void jal(SimMachine *m, const Instruction *inst);
+static void lw(SimMachine *m, const Instruction *inst);
+static void sw(SimMachine *m, const Instruction *inst);
+static void reti(SimMachine *m, const Instruction *inst);
+static void in(SimMachine *m, const Instruction *inst);
+static void out(SimMachine *m, const Instruction *inst);
+static void halt(SimMachine *m, const Instruction *inst);
+static void invalid_opcode(SimMachine *m, const Instruction *inst);
+
+/**
+ * @brief Function that allocates a machine in its initial state: every register, memory word, disk word
+ * and pixel is 0, no program is loaded, the output streams are discarded and the program is running.
+ *
+ * @return A pointer to the machine, or NULL if it cannot be allocated.
+ */
+SimMachine *sim_create(void)
+{
+    SimMachine *m = calloc(1, sizeof(SimMachine));
+    if (!m)
+    {
+        return NULL;
+    }
+    m->cont = TRUE;
+    m->irq = FALSE;
+    m->in_isr = FALSE;
+    m->schedule_valid = FALSE;
+    m->block = NULL;
+    m->completed = FALSE;
+    m->jit_enabled = FALSE;
+    memset(m->traced_pcs, TRUE, sizeof(m->traced_pcs));
+    m->trace_start = 0;
+    m->trace_stop = UINT64_MAX;
+    m->trace_every = 1;
+    m->trigger = SIM_TRIGGER_NONE;
+    m->triggered = TRUE;
+    m->interrupt_hash = 2166136261U;
+    m->disk_sectors = DISK_SECTORS;
+    m->sector_words = SECTOR_WORDS;
+    return m;
+}
+
+/**
+ * @brief Function that frees a machine, its irq 2 schedule, its disk and the native code of its jit.
+ *
+ * @param m The simulated machine, or NULL.
+ */
+void sim_destroy(SimMachine *m)
+{
+    if (!m)
+    {
+        return;
+    }
+#ifdef SIM_JIT_SUPPORTED
+    if (m->jit.code)
+    {
+        munmap(m->jit.code, JIT_CODE_SIZE);
+    }
+#endif
+    clear_irq2(m);
+    clear_disk(m);
+    free(m);
+}
+
+/**
+ * @brief Function that loads the instruction memory and decodes every instruction into the instructions array.
+ * Every line that is not blank holds an instruction of 12 hex digits, lines may end with LF or CRLF,
+ * and the program counter indexes the array directly.
+ * Blocks discovered and translated for a previously loaded program are dropped.
+ *
+ * @param m The simulated machine.
+ * @param text The contents of imemin.txt.
+ * @param len The length of the contents.
+ * @return 0 on succesful initialization, 1 on failure, with the line given by sim_load_error.
+ */
+int sim_load_imem(SimMachine *m, const char *text, size_t len)
+{
+    const char *end = text + len, *word;
+    Instruction *inst;
+    unsigned int high, low;
+    int line = 0, word_len;
+
+    clear_program(m);
+    while (next_word(&text, end, &line, &word, &word_len))
+    {
+        /*The first 8 digits and the last 8 digits overlap, the last 4 are the low half of the instruction.*/
+        if (word_len != INSTRUCTION_LEN || get_hex8(word, &high) || get_hex8(word + 4, &low))
+        {
+            return load_error(m, line, "expected an instruction of 12 hex digits");
+        }
+        if (m->instruction_count >= MEM_DEPTH)
+        {
+            return load_error(m, line, "more instructions than the instruction memory holds");
+        }
+        inst = &m->instructions[m->instruction_count];
+        memcpy(inst->text, word, INSTRUCTION_LEN);
+        inst->text[INSTRUCTION_LEN] = '\0';
+        decode_instruction(high, low & 0xFFFF, &inst->opcode, &inst->rd, &inst->rs, &inst->rt, &inst->rm, &inst->imm1,
+                           &inst->imm2);
+        bind_instruction(m, inst);
+        m->instruction_count++;
+    }
+    return 0;
+}
+
+/**
+ * @brief Function that loads the instruction memory from instruction words, like the binary image written by asm -b,
+ * instead of the text of imemin.txt. The text of each instruction in trace.txt is the word in uppercase hex,
+ * as the assembler writes it to imemin.txt.
+ *
+ * @param m The simulated machine.
+ * @param words The instructions, the 12 hex digits of each one in the low 48 bits of a word.
+ * @param count The number of instructions.
+ * @return 0 on succesful initialization, 1 on failure, with the reason given by sim_load_error.
+ */
+int sim_load_instructions(SimMachine *m, const uint64_t *words, int count)
+{
+    Instruction *inst;
+    unsigned int high, low;
+    int i;
+
+    clear_program(m);
+    if (count < 0 || count > MEM_DEPTH)
+    {
+        return load_error(m, 0, "more instructions than the instruction memory holds");
+    }
+    for (i = 0; i < count; i++)
+    {
+        if (words[i] >> 48)
+        {
+            return load_error(m, 0, "an instruction has more than 12 hex digits");
+        }
+        high = (unsigned int)(words[i] >> 16);
+        low = (unsigned int)(words[i] & 0xFFFF);
+        inst = &m->instructions[i];
+        sim_format_hex(sim_format_hex(inst->text, high, 8), low, 4);
+        inst->text[INSTRUCTION_LEN] = '\0';
+        decode_instruction(high, low, &inst->opcode, &inst->rd, &inst->rs, &inst->rt, &inst->rm, &inst->imm1, &inst->imm2);
+        bind_instruction(m, inst);
+        m->instruction_count++;
+    }
+    return 0;
+}
+
+/**
+ * @brief Function that loads the initial memory of the program, the rest of the memory is 0.
+ * Every line that is not blank holds a word of 1 to 8 hex digits.
+ *
+ * @param m The simulated machine.
+ * @param text The contents of dmemin.txt.
+ * @param len The length of the contents.
+ * @return 0 on succesful initialization, 1 on failure, with the line given by sim_load_error.
+ */
+int sim_load_dmem(SimMachine *m, const char *text, size_t len)
+{
+    const char *end = text + len, *word;
+    unsigned int value;
+    int i = 0, line = 0, word_len;
+
+    memset(m->memory, 0, sizeof(m->memory));
+    m->depth = 0;
+    m->load_error = NULL;
+    m->load_line = 0;
+    while (next_word(&text, end, &line, &word, &word_len))
+    {
+        if (get_hex(word, word_len, &value))
+        {
+            return load_error(m, line, "expected a word of 1 to 8 hex digits");
+        }
+        if (i >= MEM_DEPTH)
+        {
+            return load_error(m, line, "more words than the data memory holds");
+        }
+        m->memory[i++] = (int)value;
+    }
+    m->depth = i;
+    return 0;
+}
+
+/**
+ * @brief Function that loads the initial state of the disk, the rest of the disk is 0.
+ * Every line that is not blank holds a word of 1 to 8 hex digits. Only the sectors that hold a word that is not 0
+ * take memory, so the disk may be far larger than the words loaded.
+ *
+ * @param m The simulated machine.
+ * @param text The contents of diskin.txt.
+ * @param len The length of the contents.
+ * @return 0 on succesful initialization, 1 on failure, with the line given by sim_load_error.
+ */
+int sim_load_disk(SimMachine *m, const char *text, size_t len)
+{
+    const char *end = text + len, *word;
+    unsigned int value;
+    int32_t *copy;
+    int i = 0, line = 0, word_len;
+
+    clear_disk(m);
+    m->load_error = NULL;
+    m->load_line = 0;
+    while (next_word(&text, end, &line, &word, &word_len))
+    {
+        if (get_hex(word, word_len, &value))
+        {
+            return load_error(m, line, "expected a word of 1 to 8 hex digits");
+        }
+        if (i >= m->disk_sectors * m->sector_words)
+        {
+            return load_error(m, line, "more words than the disk holds");
+        }
+        if (value != 0)
+        {
+            if (!(copy = copy_sector(m, i / m->sector_words)))
+            {
+                return load_error(m, line, "not enough memory for the disk");
+            }
+            copy[i % m->sector_words] = (int32_t)value;
+        }
+        i++;
+    }
+    m->disk_offset = i;
+    return 0;
+}
+
+/**
+ * @brief Function that sets the number of sectors of the disk and the number of words of each one, which a disk
+ * transfer moves between the disk and the memory. The disk is cleared, so the geometry is set before the disk is
+ * loaded. Without it the disk has SIM_DISK_SECTORS sectors of SIM_DISK_SECTOR_WORDS words.
+ *
+ * @param m The simulated machine.
+ * @param sectors The number of sectors.
+ * @param sector_words The number of words of a sector, at most SIM_MEM_DEPTH.
+ * @return 0 on success, 1 if the disk would hold more than 0x7FFFFFFF words, in which case nothing is changed.
+ */
+int sim_set_disk_geometry(SimMachine *m, int sectors, int sector_words)
+{
+    if (check_geometry(sectors, sector_words))
+    {
+        return 1;
+    }
+    clear_disk(m);
+    m->disk_sectors = sectors;
+    m->sector_words = sector_words;
+    return 0;
+}
+
+/**
+ * @brief Function that uses an image of the whole disk, such as a mapped file, as the initial state of the disk.
+ * The image is only read: a sector the program writes is copied first, and the copy is written, so machines in any
+ * number of threads and processes share one image and a run only takes memory for the sectors it wrote.
+ * Attaching an image is constant time, whatever the size of the disk, which takes the geometry of the image.
+ *
+ * @param m The simulated machine.
+ * @param words The sectors of the image one after another, as 32 bit words. Kept until release is called.
+ * @param sectors The number of sectors of the image.
+ * @param sector_words The number of words of a sector of the image, at most SIM_MEM_DEPTH.
+ * @param release Called once the image is no longer used: when the disk is loaded again, when the machine is
+ * destroyed or when this call fails. NULL if there is nothing to release.
+ * @param user The argument passed to release.
+ * @return 0 on success, 1 if the geometry is not valid as for sim_set_disk_geometry.
+ */
+int sim_attach_disk(SimMachine *m, const int32_t *words, int sectors, int sector_words, void (*release)(void *user),
+                    void *user)
+{
+    if (check_geometry(sectors, sector_words))
+    {
+        if (release)
+        {
+            release(user);
+        }
+        return 1;
+    }
+    clear_disk(m);
+    m->disk_sectors = sectors;
+    m->sector_words = sector_words;
+    m->disk_base = words;
+    m->release_base = release;
+    m->base_user = user;
+    /*Every word of an image is part of the disk, so all of it is written back.*/
+    m->disk_offset = sectors * sector_words;
+    return 0;
+}
+
+/**
+ * @brief Function that tells why the last call to sim_load_imem, sim_load_instructions, sim_load_dmem or
+ * sim_load_disk failed.
+ *
+ * @param m The simulated machine.
+ * @param line The line of the image the loader failed on, 0 if the failure was not on a line. May be NULL.
+ * @return The reason, or NULL if the loader did not fail.
+ */
+const char *sim_load_error(const SimMachine *m, int *line)
+{
+    if (line)
+    {
+        *line = m->load_line;
+    }
+    return m->load_error;
+}
+
+/**
+ * @brief Function that loads the clock cycles in which irq 2 is triggered.
+ * The numbers are decimal cycle numbers of up to 64 bits separated by white space, in any order: they are sorted,
+ * and a cycle given more than once triggers irq 2 once. A cycle after 0xFFFFFFFE is reached once the clock has
+ * wrapped around as many times as it takes.
+ *
+ * @param m The simulated machine.
+ * @param text The contents of irq2in.txt.
+ * @param len The length of the contents.
+ * @return 0 on successful initialization, 1 on failure
+ */
+int sim_load_irq2(SimMachine *m, const char *text, size_t len)
+{
+    const char *end = text + len, *p = text;
+    uint64_t value, *entries;
+    size_t count = 0, i = 0, j;
+    int line = 1, found, sorted = TRUE;
+
+    clear_irq2(m);
+    m->load_error = NULL;
+    m->load_line = 0;
+    while ((found = next_cycle(&p, end, TRUE, &line, &value)) == 1)
+    {
+        count++;
+    }
+    if (found < 0)
+    {
+        return load_error(m, line, "expected a cycle number");
+    }
+    if (count == 0)
+    {
+        return 0;
+    }
+    entries = malloc(count * sizeof(uint64_t));
+    if (!entries)
+    {
+        return 1;
+    }
+    for (p = text; i < count && next_cycle(&p, end, TRUE, &line, &value) == 1; i++)
+    {
+        entries[i] = value;
+        sorted &= (i == 0 || entries[i - 1] <= value);
+    }
+    if (!sorted)
+    {
+        qsort(entries, count, sizeof(uint64_t), compare_cycles);
+    }
+    for (i = 1, j = 1; i < count; i++)
+    {
+        if (entries[i] != entries[j - 1])
+        {
+            entries[j++] = entries[i];
+        }
+    }
+    m->interrupts = entries;
+    m->interrupt_count = j;
+    return 0;
+}
+
+/**
+ * @brief Function that streams the clock cycles in which irq 2 is triggered, for schedules too large to load.
+ * The schedule is read as the program runs, IRQ2_WINDOW entries at a time, so it may come from a pipe.
+ * The numbers are as for sim_load_irq2 but must be in increasing order, since they cannot be sorted.
+ * The first window is read here. A later window that is not valid ends the schedule, and sim_load_error tells why
+ * once the run is over.
+ *
+ * @param m The simulated machine.
+ * @param read Reads up to size bytes of irq2in.txt into buf and returns how many, 0 at its end or on an error.
+ * @param close Called once the schedule is no longer read: at its end, when it is replaced, when the machine is
+ * destroyed or when this call fails. NULL if there is nothing to close.
+ * @param user The argument passed to read and close.
+ * @return 0 on success, 1 if the memory cannot be allocated or the first window is not valid.
+ */
+int sim_stream_irq2(SimMachine *m, SimReader read, void (*close)(void *user), void *user)
+{
+    Irq2Stream *s = calloc(1, sizeof(Irq2Stream));
+
+    clear_irq2(m);
+    m->load_error = NULL;
+    m->load_line = 0;
+    m->interrupts = malloc(IRQ2_WINDOW * sizeof(uint64_t));
+    if (!s || !m->interrupts)
+    {
+        free(s);
+        if (close)
+        {
+            close(user);
+        }
+        return 1;
+    }
+    s->read = read;
+    s->close = close;
+    s->user = user;
+    s->line = 1;
+    m->irq2_stream = s;
+    return fill_irq2(m);
+}
+
+/**
+ * @brief Function that replaces the irq 2 schedule of a running program, for the rest of the run.
+ * The new schedule must start with the entries that were already triggered, and its next entry
+ * must not be before the current clock cycle, so the run is the same as if the new schedule had been loaded
+ * at the start. The schedule that is replaced may have been streamed.
+ *
+ * @param m The simulated machine.
+ * @param text The contents of the new irq2in.txt.
+ * @param len The length of the contents.
+ * @return 0 on success, 1 if the schedule cannot be loaded or differs from the triggered entries,
+ * in which case the previous schedule is kept.
+ */
+int sim_switch_irq2(SimMachine *m, const char *text, size_t len)
+{
+    uint64_t *previous = m->interrupts, index = m->interrupt_base + m->interrupt_pos;
+    size_t previous_pos = m->interrupt_pos, previous_count = m->interrupt_count;
+    uint64_t previous_base = m->interrupt_base;
+    uint32_t hash = m->interrupt_hash;
+    Irq2Stream *stream = m->irq2_stream;
+    int valid;
+
+    /*Detach the previous schedule so that loading the new one does not drop it.*/
+    m->interrupts = NULL;
+    m->irq2_stream = NULL;
+    valid = (sim_load_irq2(m, text, len) == 0 && seek_irq2(m, index, hash) == 0);
+    if (valid && m->interrupt_pos < m->interrupt_count)
+    {
+        valid = (m->interrupts[m->interrupt_pos] >= irq2_clock(m));
+    }
+    if (!valid)
+    {
+        free(m->interrupts);
+        m->interrupts = previous;
+        m->interrupt_pos = previous_pos;
+        m->interrupt_count = previous_count;
+        m->interrupt_base = previous_base;
+        m->interrupt_hash = hash;
+        m->irq2_stream = stream;
+        m->schedule_valid = FALSE;
+        return 1;
+    }
+    free(previous);
+    m->irq2_stream = stream;
+    end_irq2_stream(m);
+    return 0;
+}
+
+/**
+ * @brief Function that sets the receiver of an output stream.
+ * A stream without a receiver is discarded, and a trace that is discarded is not formatted at all.
+ *
+ * @param m The simulated machine.
+ * @param stream SIM_TRACE, SIM_HWREGTRACE, SIM_LEDS or SIM_DISPLAY7SEG.
+ * @param sink The receiver, or NULL to discard the stream.
+ * @param user The argument passed to the receiver.
+ * @return 0 on success, 1 for an unknown stream.
+ */
+int sim_set_sink(SimMachine *m, int stream, SimSink sink, void *user)
+{
+    if (stream < 0 || stream >= SIM_STREAM_NUM)
+    {
+        return 1;
+    }
+    m->sinks[stream] = sink;
+    m->sink_users[stream] = user;
+    return 0;
+}
+
+/**
+ * @brief Function that sets the format of an output stream, text by default.
+ * The format should be set before the stream is first written, as a binary stream starts with a header.
+ *
+ * @param m The simulated machine.
+ * @param stream SIM_TRACE, SIM_HWREGTRACE, SIM_LEDS or SIM_DISPLAY7SEG.
+ * @param format SIM_FORMAT_TEXT or SIM_FORMAT_BINARY.
+ * @return 0 on success, 1 for an unknown stream or format.
+ */
+int sim_set_format(SimMachine *m, int stream, int format)
+{
+    if (stream < 0 || stream >= SIM_STREAM_NUM || (format != SIM_FORMAT_TEXT && format != SIM_FORMAT_BINARY))
+    {
+        return 1;
+    }
+    m->formats[stream] = format;
+    return 0;
+}
+
+/**
+ * @brief Function that returns the format of an output stream.
+ *
+ * @param m The simulated machine.
+ * @param stream SIM_TRACE, SIM_HWREGTRACE, SIM_LEDS or SIM_DISPLAY7SEG.
+ * @return SIM_FORMAT_TEXT or SIM_FORMAT_BINARY, SIM_FORMAT_TEXT for an unknown stream.
+ */
+int sim_get_format(const SimMachine *m, int stream)
+{
+    return (stream >= 0 && stream < SIM_STREAM_NUM) ? m->formats[stream] : SIM_FORMAT_TEXT;
+}
+
+/**
+ * @brief Function that adds a range of addresses to the filter of trace.txt and hwregtrace.txt.
+ * Once a range is included, only the instructions in included ranges are traced, and the instructions
+ * in excluded ranges are never traced.
+ *
+ * @param m The simulated machine.
+ * @param first The first address of the range.
+ * @param last The last address of the range.
+ * @param include TRUE (1) to include the range, FALSE (0) to exclude it.
+ * @return 0 on success, 1 if the range is empty or outside the instruction memory.
+ */
+int sim_trace_pc_range(SimMachine *m, int first, int last, int include)
+{
+    int i, any_included = FALSE;
+    if (first < 0 || last >= MEM_DEPTH || first > last)
+    {
+        return 1;
+    }
+    for (i = first; i <= last; i++)
+    {
+        m->pc_marks[i] |= include ? PC_INCLUDED : PC_EXCLUDED;
+    }
+    for (i = 0; i < MEM_DEPTH; i++)
+    {
+        any_included |= m->pc_marks[i] & PC_INCLUDED;
+    }
+    for (i = 0; i < MEM_DEPTH; i++)
+    {
+        m->traced_pcs[i] = (!any_included || (m->pc_marks[i] & PC_INCLUDED)) && !(m->pc_marks[i] & PC_EXCLUDED);
+    }
+    /*Native code only calls the trace at the addresses that were traced when it was emitted.*/
+    jit_flush(m);
+    return 0;
+}
+
+/**
+ * @brief Function that limits trace.txt and hwregtrace.txt to a window of cycles.
+ * Cycles are counted by sim_cycles_run, so the window does not move when the program writes the clock.
+ *
+ * @param m The simulated machine.
+ * @param start The first cycle of the window.
+ * @param stop The cycle after the window, UINT64_MAX for a window that never closes.
+ * @return 0 on success, 1 if the window is empty.
+ */
+int sim_trace_cycles(SimMachine *m, uint64_t start, uint64_t stop)
+{
+    if (start >= stop)
+    {
+        return 1;
+    }
+    m->trace_start = start;
+    m->trace_stop = stop;
+    return 0;
+}
+
+/**
+ * @brief Function that samples trace.txt: of the instructions that pass the other filters,
+ * the first one and then one of every few are written.
+ *
+ * @param m The simulated machine.
+ * @param every The number of traced instructions per line written, 1 to write all of them.
+ * @return 0 on success, 1 if every is 0.
+ */
+int sim_trace_sample(SimMachine *m, unsigned int every)
+{
+    if (every == 0)
+    {
+        return 1;
+    }
+    m->trace_every = every;
+    m->trace_sample = 0;
+    return 0;
+}
+
+/**
+ * @brief Function that holds back trace.txt and hwregtrace.txt until an interrupt is first requested.
+ * Tracing starts with the cycle after the one in which the timer, the disk or the irq 2 schedule raises
+ * irq0status, irq1status or irq2status.
+ *
+ * @param m The simulated machine.
+ * @param irq 0, 1 or 2, or SIM_TRIGGER_NONE to trace from the start.
+ * @return 0 on success, 1 for an unknown interrupt.
+ */
+int sim_trace_trigger(SimMachine *m, int irq)
+{
+    if (irq != SIM_TRIGGER_NONE && (irq < 0 || irq > 2))
+    {
+        return 1;
+    }
+    m->trigger = irq;
+    m->triggered = irq == SIM_TRIGGER_NONE;
+    return 0;
+}
+
+/**
+ * @brief Function that enables or disables the x86-64 jit that translates hot basic blocks to native code.
+ * The output of the machine is the same either way.
+ *
+ * @param m The simulated machine.
+ * @param enabled TRUE to enable the jit, FALSE to use the interpreter.
+ * @return 0 on success, 1 if the jit is not available, in which case the interpreter is used.
+ */
+int sim_set_jit(SimMachine *m, int enabled)
+{
+    if (enabled && !m->jit.code && jit_init(m))
+    {
+        m->jit_enabled = FALSE;
+        return 1;
+    }
+    m->jit_enabled = enabled ? TRUE : FALSE;
+    return 0;
+}
+
+/**
+ * @brief Function that runs the program for up to a number of clock cycles.
+ * The program runs block by block and handles the peripherals exactly as a whole run does,
+ * so splitting a run into steps of any size does not change its output. The program halts
+ * when it runs halt or when the program counter leaves the loaded instructions.
+ *
+ * @param m The simulated machine.
+ * @param cycles The maximum number of clock cycles to run.
+ * @return SIM_HALTED if the program has halted, SIM_RUNNING otherwise.
+ */
+int sim_step(SimMachine *m, unsigned int cycles)
+{
+    unsigned int left = cycles, count;
+
+    /*The window of the trace only opens or closes between two pieces of the step.*/
+    while (m->cont && left > 0)
+    {
+        count = update_trace_window(m, left);
+        left -= run_cycles(m, count);
+    }
+    return m->cont ? SIM_RUNNING : SIM_HALTED;
+}
+
+/**
+ * @brief Function that decides whether the current cycle is inside the window of the trace.
+ *
+ * @param m The simulated machine.
+ * @param cycles The maximum number of clock cycles to run.
+ * @return The number of cycles, at most cycles, before the window opens or closes.
+ */
+static unsigned int update_trace_window(SimMachine *m, unsigned int cycles)
+{
+    uint64_t now = m->cycles_run;
+    m->in_window = now >= m->trace_start && now < m->trace_stop;
+    m->trace_on = m->in_window && m->triggered;
+    if (now < m->trace_start && m->trace_start - now < cycles)
+    {
+        return (unsigned int)(m->trace_start - now);
+    }
+    if (now < m->trace_stop && m->trace_stop - now < cycles)
+    {
+        return (unsigned int)(m->trace_stop - now);
+    }
+    return cycles;
+}
+
+/**
+ * @brief Function that runs the program for a number of clock cycles, or until it halts.
+ *
+ * @param m The simulated machine.
+ * @param cycles The maximum number of clock cycles to run.
+ * @return The number of clock cycles that ran.
+ */
+static unsigned int run_cycles(SimMachine *m, unsigned int cycles)
+{
+    Block *block;
+    unsigned int left = cycles, skipped;
+    int count;
+
+    while (m->cont && left > 0)
+    {
+        /*Fetch the basic block at the program counter.*/
+        if (m->pc < 0 || m->pc >= m->instruction_count)
+        {
+            m->cont = FALSE;
+            break;
+        }
+        block = next_block(m, m->block, m->completed);
+        m->block = block;
+
+        /*A loop that spins until the next event skips ahead to it.*/
+        if (block->spin_len)
+        {
+            skipped = fast_forward_spin(m, block, left);
+            if (skipped)
+            {
+                left -= skipped;
+                m->completed = FALSE;
+                continue;
+            }
+        }
+
+        /*Run the straight-line body in bulk for as many cycles as no peripheral event can occur.*/
+        count = cycles_until_event(m);
+        if (count > block->body_len)
+        {
+            count = block->body_len;
+        }
+        if ((unsigned int)count > left)
+        {
+            count = (int)left;
+        }
+        run_block_body(m, block, count);
+        advance_cycles(m, count);
+        left -= count;
+
+        /*Run the terminator, or the instruction in whose cycle an event occurs, as a single cycle.*/
+        m->completed = (count == block->body_len && block->has_terminator && left > 0);
+        if (left > 0 && (count < block->body_len || block->has_terminator))
+        {
+            execute_cycle(m);
+            left--;
+        }
+    }
+    m->cycles_run += cycles - left;
+    return cycles - left;
+}
+
+/**
+ * @brief Function that runs the program until it halts or until a condition is met.
+ * SIM_UNTIL_CYCLE stops when the clock equals value, SIM_UNTIL_PC stops at the end of the first cycle
+ * after which the program counter equals value, and SIM_UNTIL_HALT only stops when the program halts.
+ *
+ * @param m The simulated machine.
+ * @param condition SIM_UNTIL_HALT, SIM_UNTIL_CYCLE or SIM_UNTIL_PC.
+ * @param value The clock cycle or the address of the condition.
+ * @return SIM_HALTED if the program has halted, SIM_RUNNING if the condition was met, SIM_ERROR for an unknown condition.
+ */
+int sim_run_until(SimMachine *m, int condition, unsigned int value)
+{
+    unsigned int clk, distance;
+
+    if (condition == SIM_UNTIL_HALT)
+    {
+        while (sim_step(m, 0xFFFFFFFF) == SIM_RUNNING)
+        {
+        }
+    }
+    else if (condition == SIM_UNTIL_CYCLE)
+    {
+        while (m->cont && (clk = (unsigned int)m->io_registers[8]) != value)
+        {
+            /*The clock skips 0xFFFFFFFF when it wraps around.*/
+            distance = value - clk;
+            if (value < clk)
+            {
+                distance--;
+            }
+            sim_step(m, distance);
+        }
+    }
+    else if (condition == SIM_UNTIL_PC)
+    {
+        while (sim_step(m, 1) == SIM_RUNNING && (unsigned int)m->pc != value)
+        {
+        }
+    }
+    else
+    {
+        return SIM_ERROR;
+    }
+    return m->cont ? SIM_RUNNING : SIM_HALTED;
+}
+
+/**
+ * @brief Function that checks if the program has halted.
+ *
+ * @param m The simulated machine.
+ * @return TRUE if the program has halted, FALSE otherwise.
+ */
+int sim_halted(const SimMachine *m)
+{
+    return !m->cont;
+}
+
+/**
+ * @brief Function that returns the program counter.
+ *
+ * @param m The simulated machine.
+ * @return The address of the next instruction.
+ */
+int sim_get_pc(const SimMachine *m)
+{
+    return m->pc;
+}
+
+/**
+ * @brief Function that returns the clock, which is the number of cycles run so far until it wraps around.
+ *
+ * @param m The simulated machine.
+ * @return The value of the clks register.
+ */
+unsigned int sim_get_cycles(const SimMachine *m)
+{
+    return (unsigned int)m->io_registers[8];
+}
+
+/**
+ * @brief Function that returns the number of cycles the program has run.
+ * Unlike the clock, which the program can write and which wraps around, it only grows, one for every cycle.
+ *
+ * @param m The simulated machine.
+ * @return The number of cycles run since the program was loaded.
+ */
+uint64_t sim_cycles_run(const SimMachine *m)
+{
+    return m->cycles_run;
+}
+
+/**
+ * @brief Function that returns the value of a cpu register.
+ *
+ * @param m The simulated machine.
+ * @param reg The number of the register.
+ * @return The value of the register, or 0 if there is no such register.
+ */
+int sim_get_register(const SimMachine *m, int reg)
+{
+    return (reg >= 0 && reg < CPU_REG_NUM) ? m->cpu_registers[reg] : 0;
+}
+
+/**
+ * @brief Function that changes the value of a cpu register.
+ *
+ * @param m The simulated machine.
+ * @param reg The number of the register.
+ * @param value The new value.
+ * @return 0 on success, 1 if there is no such register.
+ */
+int sim_set_register(SimMachine *m, int reg, int value)
+{
+    if (reg < 0 || reg >= CPU_REG_NUM)
+    {
+        return 1;
+    }
+    m->cpu_registers[reg] = value;
+    return 0;
+}
+
+/**
+ * @brief Function that returns the value of an io register.
+ *
+ * @param m The simulated machine.
+ * @param reg The number of the io register.
+ * @return The value of the io register, or 0 if there is no such register.
+ */
+int sim_get_io_register(const SimMachine *m, int reg)
+{
+    return (reg >= 0 && reg < IO_REG_NUM) ? m->io_registers[reg] : 0;
+}
+
+/**
+ * @brief Function that changes the value of an io register, without writing it to hwregtrace.txt.
+ * The next peripheral event is computed again from the new value.
+ *
+ * @param m The simulated machine.
+ * @param reg The number of the io register.
+ * @param value The new value.
+ * @return 0 on success, 1 if there is no such register.
+ */
+int sim_set_io_register(SimMachine *m, int reg, int value)
+{
+    if (reg < 0 || reg >= IO_REG_NUM)
+    {
+        return 1;
+    }
+    m->io_registers[reg] = value;
+    m->schedule_valid = FALSE;
+    return 0;
+}
+
+/**
+ * @brief Function that returns a word of the data memory.
+ *
+ * @param m The simulated machine.
+ * @param address The address of the word.
+ * @return The word, or 0 if the address is out of the memory.
+ */
+int sim_read_memory(const SimMachine *m, int address)
+{
+    return (address >= 0 && address < MEM_DEPTH) ? m->memory[address] : 0;
+}
+
+/**
+ * @brief Function that changes a word of the data memory and extends the used depth of memory like sw does.
+ *
+ * @param m The simulated machine.
+ * @param address The address of the word.
+ * @param value The new value.
+ * @return 0 on success, 1 if the address is out of the memory.
+ */
+int sim_write_memory(SimMachine *m, int address, int value)
+{
+    if (address < 0 || address >= MEM_DEPTH)
+    {
+        return 1;
+    }
+    m->memory[address] = value;
+    if (address + 1 > m->depth)
+    {
+        m->depth = address + 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Function that returns the used depth of memory, which is the number of words written to dmemout.txt.
+ *
+ * @param m The simulated machine.
+ * @return The maximum depth of used memory.
+ */
+int sim_memory_depth(const SimMachine *m)
+{
+    return m->depth;
+}
+
+/**
+ * @brief Function that returns a word of the disk.
+ *
+ * @param m The simulated machine.
+ * @param sector The sector of the word.
+ * @param offset The offset of the word in the sector.
+ * @return The word, or 0 if it is out of the disk.
+ */
+int sim_read_disk(const SimMachine *m, int sector, int offset)
+{
+    if (sector < 0 || sector >= m->disk_sectors || offset < 0 || offset >= m->sector_words)
+    {
+        return 0;
+    }
+    return disk_sector(m, sector)[offset];
+}
+
+/**
+ * @brief Function that copies the words of a sector of the disk.
+ *
+ * @param m The simulated machine.
+ * @param sector The sector.
+ * @param words Receives sim_disk_sector_words words.
+ * @return 0 on success, 1 if the sector is out of the disk.
+ */
+int sim_read_sector(const SimMachine *m, int sector, int32_t *words)
+{
+    if (sector < 0 || sector >= m->disk_sectors)
+    {
+        return 1;
+    }
+    memcpy(words, disk_sector(m, sector), (size_t)m->sector_words * sizeof(int32_t));
+    return 0;
+}
+
+/**
+ * @brief Function that returns the number of sectors of the disk.
+ *
+ * @param m The simulated machine.
+ * @return The number of sectors.
+ */
+int sim_disk_sectors(const SimMachine *m)
+{
+    return m->disk_sectors;
+}
+
+/**
+ * @brief Function that returns the number of words of a sector of the disk.
+ *
+ * @param m The simulated machine.
+ * @return The number of words.
+ */
+int sim_disk_sector_words(const SimMachine *m)
+{
+    return m->sector_words;
+}
+
+/**
+ * @brief Function that tells whether the disk is an image attached with sim_attach_disk.
+ *
+ * @param m The simulated machine.
+ * @return TRUE (1) if the disk is an image, FALSE (0) if it was loaded from text.
+ */
+int sim_disk_attached(const SimMachine *m)
+{
+    return m->disk_base != NULL;
+}
+
+/**
+ * @brief Function that tells whether the program wrote a sector of the disk, which then differs from diskin.txt
+ * or from the image. Only these sectors need to be written back to the image.
+ *
+ * @param m The simulated machine.
+ * @param sector The sector.
+ * @return TRUE (1) if the program wrote the sector, FALSE (0) if it did not or the sector is out of the disk.
+ */
+int sim_disk_dirty(const SimMachine *m, int sector)
+{
+    if (sector < 0 || sector >= m->disk_sectors || !m->dirty_sectors)
+    {
+        return FALSE;
+    }
+    return (m->dirty_sectors[sector / 32] >> (sector % 32)) & 1;
+}
+
+/**
+ * @brief Function that returns the number of sector writes the disk dropped because the copy of the sector could
+ * not be allocated, after which the disk no longer holds what the program wrote.
+ *
+ * @param m The simulated machine.
+ * @return The number of writes dropped, 0 if every write was done.
+ */
+int sim_disk_lost_writes(const SimMachine *m)
+{
+    return m->lost_writes;
+}
+
+/**
+ * @brief Function that returns the used extent of the disk, which is the number of words written to diskout.txt.
+ *
+ * @param m The simulated machine.
+ * @return The maximum offset of the disk.
+ */
+int sim_disk_extent(const SimMachine *m)
+{
+    return m->disk_offset;
+}
+
+/**
+ * @brief Function that returns the number of cycles the disk still needs to finish its current command.
+ *
+ * @param m The simulated machine.
+ * @return The remaining disk cycles, or 0 if the disk is not busy.
+ */
+int sim_disk_cycles_left(const SimMachine *m)
+{
+    return m->io_registers[17] ? DISK_CYCLES - m->disk_cycles : 0;
+}
+
+/**
+ * @brief Function that returns a pixel of the monitor.
+ *
+ * @param m The simulated machine.
+ * @param row The row of the pixel.
+ * @param col The column of the pixel.
+ * @return The value of the pixel, or 0 if it is out of the monitor.
+ */
+int sim_read_pixel(const SimMachine *m, int row, int col)
+{
+    if (row < 0 || row >= PIXELS || col < 0 || col >= PIXELS)
+    {
+        return 0;
+    }
+    return m->monitor[row][col];
+}
+
+/**
+ * @brief Function that returns the used extent of the monitor, which is the number of pixels written to monitor.txt.
+ *
+ * @param m The simulated machine.
+ * @return The maximum offset in which a pixel was written to the monitor, plus one.
+ */
+int sim_monitor_extent(const SimMachine *m)
+{
+    return m->max_monitor_offset + 1;
+}
+
+/**
+ * @brief Function that returns the number of bytes written to an output stream since the program started,
+ * which is the position of the stream in its output file.
+ *
+ * @param m The simulated machine.
+ * @param stream SIM_TRACE, SIM_HWREGTRACE, SIM_LEDS or SIM_DISPLAY7SEG.
+ * @return The position of the stream, or 0 for an unknown stream.
+ */
+uint64_t sim_stream_bytes(const SimMachine *m, int stream)
+{
+    return (stream >= 0 && stream < SIM_STREAM_NUM) ? m->stream_bytes[stream] : 0;
+}
+
+/**
+ * @brief Function that returns the size of the predecoded form of the loaded program.
+ *
+ * @param m The simulated machine.
+ * @return The size in bytes.
+ */
+size_t sim_program_size(const SimMachine *m)
+{
+    return sizeof(ProgramHeader) + (size_t)m->instruction_count * (sizeof(ProgramInstruction) + sizeof(ProgramBlock));
+}
+
+/**
+ * @brief Function that saves the loaded program in predecoded form: the decoded fields of every instruction
+ * and the basic block that starts at each of them, with its extent, branch target and spin loop.
+ * sim_restore_program loads it again without parsing imemin.txt or discovering the blocks.
+ *
+ * @param m The simulated machine.
+ * @param buf The predecoded program, at least sim_program_size() bytes and aligned like a uint32_t.
+ * @param size The size of the buffer.
+ * @return 0 on success, 1 if the buffer is too small.
+ */
+int sim_save_program(const SimMachine *m, void *buf, size_t size)
+{
+    ProgramHeader *header = buf;
+    ProgramInstruction *insts = (ProgramInstruction *)(header + 1);
+    ProgramBlock *blocks = (ProgramBlock *)(insts + m->instruction_count);
+    const Instruction *inst;
+    Block block;
+    int i;
+
+    if (size < sim_program_size(m))
+    {
+        return 1;
+    }
+    memset(buf, 0, sim_program_size(m));
+    memcpy(header->magic, PROGRAM_MAGIC, sizeof(header->magic));
+    header->version = PROGRAM_VERSION;
+    header->byte_order = CHECKPOINT_BYTE_ORDER;
+    header->size = (uint32_t)sim_program_size(m);
+    header->instruction_count = m->instruction_count;
+    for (i = 0; i < m->instruction_count; i++)
+    {
+        inst = &m->instructions[i];
+        insts[i].opcode = inst->opcode;
+        insts[i].rd = inst->rd;
+        insts[i].rs = inst->rs;
+        insts[i].rt = inst->rt;
+        insts[i].rm = inst->rm;
+        insts[i].imm1 = inst->imm1;
+        insts[i].imm2 = inst->imm2;
+        memcpy(insts[i].text, inst->text, INSTRUCTION_LEN);
+        find_block(m, i, &block);
+        blocks[i].body_len = block.body_len;
+        blocks[i].has_terminator = block.has_terminator;
+        blocks[i].taken_pc = block.taken_pc;
+        blocks[i].spin_len = block.spin_len;
+    }
+    return 0;
+}
+
+/**
+ * @brief Function that loads a program saved by sim_save_program, in place of sim_load_imem.
+ * The blocks start out translated, and are linked to each other as the program runs.
+ * The predecoded program is only read, so it can be used in place where a file is mapped.
+ *
+ * @param m The simulated machine.
+ * @param buf The predecoded program, aligned like a uint32_t.
+ * @param size The size of the predecoded program.
+ * @return 0 on success, 1 if the predecoded program is not valid or has another version or byte order,
+ * in which case no program is loaded.
+ */
+int sim_restore_program(SimMachine *m, const void *buf, size_t size)
+{
+    const ProgramHeader *header = buf;
+    const ProgramInstruction *insts = (const ProgramInstruction *)(header + 1);
+    const ProgramBlock *blocks;
+    Instruction *inst;
+    Block *block;
+    int i, count;
+
+    clear_program(m);
+    if (size < sizeof(ProgramHeader) || memcmp(header->magic, PROGRAM_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != PROGRAM_VERSION || header->byte_order != CHECKPOINT_BYTE_ORDER ||
+        header->instruction_count < 0 || header->instruction_count > MEM_DEPTH || header->size != size ||
+        size != sizeof(ProgramHeader) + (size_t)header->instruction_count * (sizeof(ProgramInstruction) + sizeof(ProgramBlock)))
+    {
+        return 1;
+    }
+    count = header->instruction_count;
+    blocks = (const ProgramBlock *)(insts + count);
+    /*Every field indexes a table or an instruction, so each one is checked before any is used.*/
+    for (i = 0; i < count; i++)
+    {
+        if (insts[i].rd < 0 || insts[i].rd >= CPU_REG_NUM || insts[i].rs < 0 || insts[i].rs >= CPU_REG_NUM ||
+            insts[i].rt < 0 || insts[i].rt >= CPU_REG_NUM || insts[i].rm < 0 || insts[i].rm >= CPU_REG_NUM ||
+            blocks[i].body_len < 0 || blocks[i].body_len > count - i || blocks[i].taken_pc < -1 ||
+            blocks[i].taken_pc >= MEM_DEPTH || blocks[i].spin_len < 0 || blocks[i].spin_len > SPIN_MAX_LEN ||
+            blocks[i].has_terminator != (i + blocks[i].body_len < count))
+        {
+            return 1;
+        }
+    }
+    for (i = 0; i < count; i++)
+    {
+        inst = &m->instructions[i];
+        inst->opcode = insts[i].opcode;
+        inst->rd = insts[i].rd;
+        inst->rs = insts[i].rs;
+        inst->rt = insts[i].rt;
+        inst->rm = insts[i].rm;
+        inst->imm1 = insts[i].imm1;
+        inst->imm2 = insts[i].imm2;
+        memcpy(inst->text, insts[i].text, INSTRUCTION_LEN);
+        inst->text[INSTRUCTION_LEN] = '\0';
+        bind_instruction(m, inst);
+        block = &m->blocks[i];
+        block->start = i;
+        block->body_len = blocks[i].body_len;
+        block->has_terminator = blocks[i].has_terminator;
+        block->taken_pc = blocks[i].taken_pc;
+        block->spin_len = blocks[i].spin_len;
+        block->translated = TRUE;
+    }
+    m->instruction_count = count;
+    return 0;
+}
+
+/**
+ * @brief Function that returns the size of a checkpoint of a machine, which grows as the program writes sectors
+ * of the disk that it did not write before.
+ *
+ * @param m The simulated machine.
+ * @return The size of a checkpoint saved now, in bytes.
+ */
+size_t sim_checkpoint_size(const SimMachine *m)
+{
+    return sizeof(Checkpoint) +
+           (size_t)m->copy_count * (sizeof(CheckpointSector) + (size_t)m->sector_words * sizeof(int32_t));
+}
+
+/**
+ * @brief Function that saves the complete state of a running program to a checkpoint.
+ * The checkpoint holds the registers, the memory, the sectors of the disk that were loaded or written, the monitor,
+ * the state of the peripherals and the position of every output stream. The instructions and the entries of irq 2
+ * triggered so far are only identified by a hash, so they must be loaded again before the checkpoint is restored,
+ * and so must the image of the disk if one is attached.
+ *
+ * @param m The simulated machine.
+ * @param buf The checkpoint, at least sim_checkpoint_size(m) bytes and aligned like a uint64_t.
+ * @param size The size of the buffer.
+ * @return 0 on success, 1 if the buffer is too small or the checkpoint would be larger than 4 GB.
+ */
+int sim_save_checkpoint(const SimMachine *m, void *buf, size_t size)
+{
+    Checkpoint *cp = buf;
+    CheckpointSector *record;
+    size_t total = sim_checkpoint_size(m);
+    char *next = (char *)buf + sizeof(Checkpoint);
+    int i, j;
+    if (size < total || total > 0xFFFFFFFFU)
+    {
+        return 1;
+    }
+    memset(cp, 0, sizeof(Checkpoint));
+    memcpy(cp->magic, CHECKPOINT_MAGIC, sizeof(cp->magic));
+    cp->version = CHECKPOINT_VERSION;
+    cp->byte_order = CHECKPOINT_BYTE_ORDER;
+    cp->size = (uint32_t)total;
+    cp->program_hash = program_hash(m);
+    cp->irq2_hash = m->interrupt_hash;
+    cp->pc = m->pc;
+    cp->cont = m->cont;
+    cp->irq = m->irq;
+    cp->in_isr = m->in_isr;
+    for (i = 0; i < CPU_REG_NUM; i++)
+    {
+        cp->cpu_registers[i] = m->cpu_registers[i];
+    }
+    for (i = 0; i < IO_REG_NUM; i++)
+    {
+        cp->io_registers[i] = m->io_registers[i];
+    }
+    cp->disk_cycles = m->disk_cycles;
+    cp->clock_wraps = m->clock_wraps;
+    cp->depth = m->depth;
+    cp->disk_offset = m->disk_offset;
+    cp->max_monitor_offset = m->max_monitor_offset;
+    cp->disk_sectors = m->disk_sectors;
+    cp->sector_words = m->sector_words;
+    cp->disk_attached = m->disk_base != NULL;
+    cp->copy_count = (uint32_t)m->copy_count;
+    for (i = 0; i < SIM_STREAM_NUM; i++)
+    {
+        cp->stream_bytes[i] = m->stream_bytes[i];
+    }
+    cp->cycles_run = m->cycles_run;
+    cp->interrupt_index = m->interrupt_base + m->interrupt_pos;
+    for (i = 0; i < CPU_REG_NUM; i++)
+    {
+        cp->trace_registers[i] = m->trace_registers[i];
+    }
+    cp->triggered = m->triggered;
+    cp->trace_sample = m->trace_sample;
+    for (i = 0; i < MEM_DEPTH; i++)
+    {
+        cp->memory[i] = m->memory[i];
+    }
+    for (i = 0; i < PIXELS; i++)
+    {
+        for (j = 0; j < PIXELS; j++)
+        {
+            cp->monitor[i][j] = m->monitor[i][j];
+        }
+    }
+    for (i = 0; i < m->copy_count; i++)
+    {
+        record = (CheckpointSector *)next;
+        record->sector = m->copy_order[i];
+        record->dirty = sim_disk_dirty(m, record->sector);
+        memcpy(record + 1, m->sector_copies[record->sector], (size_t)m->sector_words * sizeof(int32_t));
+        next += sizeof(CheckpointSector) + (size_t)m->sector_words * sizeof(int32_t);
+    }
+    return 0;
+}
+
+/**
+ * @brief Function that restores the state of a program from a checkpoint.
+ * The same instructions as when the checkpoint was saved must already be loaded, and an irq 2 schedule that starts
+ * with the entries triggered before it, which the run then follows. A streamed schedule is read forward to the
+ * checkpoint, so it can only be restored once, ahead of the entries already read. The disk must have the same
+ * geometry, and if the checkpoint was saved over an image, the same image must be attached.
+ * The checkpoint is only read, so it can be used in place where a checkpoint file is mapped.
+ *
+ * @param m The simulated machine.
+ * @param buf The checkpoint, aligned like a uint64_t.
+ * @param size The size of the checkpoint.
+ * @return 0 on success, 1 if the checkpoint is not valid, has another version or byte order,
+ * was saved from another program, irq 2 schedule or disk geometry, or its sectors cannot be allocated,
+ * in which case the machine is not changed, except for how far a streamed schedule was read.
+ */
+int sim_restore_checkpoint(SimMachine *m, const void *buf, size_t size)
+{
+    const Checkpoint *cp = buf;
+    const CheckpointSector *record;
+    const char *next = (const char *)buf + sizeof(Checkpoint);
+    size_t record_size = sizeof(CheckpointSector) + (size_t)m->sector_words * sizeof(int32_t);
+    int32_t **copies = NULL;
+    uint32_t *dirty = NULL;
+    int *order = NULL, count = 0, i, j;
+
+    if (size < sizeof(Checkpoint) || memcmp(cp->magic, CHECKPOINT_MAGIC, sizeof(cp->magic)) != 0 ||
+        cp->version != CHECKPOINT_VERSION || cp->byte_order != CHECKPOINT_BYTE_ORDER || cp->size > size ||
+        cp->disk_sectors != m->disk_sectors || cp->sector_words != m->sector_words ||
+        cp->disk_attached != (m->disk_base != NULL) || cp->copy_count > (uint32_t)m->disk_sectors ||
+        cp->size != sizeof(Checkpoint) + (uint64_t)cp->copy_count * record_size)
+    {
+        return 1;
+    }
+    if (cp->program_hash != program_hash(m))
+    {
+        return 1;
+    }
+    /*The sectors are copied before anything is changed, so a checkpoint that fails leaves the disk as it is.*/
+    if (cp->copy_count > 0)
+    {
+        copies = calloc((size_t)m->disk_sectors, sizeof(int32_t *));
+        dirty = calloc(((size_t)m->disk_sectors + 31) / 32, sizeof(uint32_t));
+        order = malloc(cp->copy_count * sizeof(int));
+        for (; copies && dirty && order && count < (int)cp->copy_count; count++, next += record_size)
+        {
+            record = (const CheckpointSector *)next;
+            if (record->sector < 0 || record->sector >= m->disk_sectors || copies[record->sector] ||
+                !(copies[record->sector] = malloc((size_t)m->sector_words * sizeof(int32_t))))
+            {
+                break;
+            }
+            memcpy(copies[record->sector], record + 1, (size_t)m->sector_words * sizeof(int32_t));
+            dirty[record->sector / 32] |= (uint32_t)(record->dirty != 0) << (record->sector % 32);
+            order[count] = record->sector;
+        }
+    }
+    if (count < (int)cp->copy_count || seek_irq2(m, cp->interrupt_index, cp->irq2_hash))
+    {
+        for (i = 0; i < count; i++)
+        {
+            free(copies[order[i]]);
+        }
+        free(copies);
+        free(dirty);
+        free(order);
+        return 1;
+    }
+    for (i = 0; i < m->copy_count; i++)
+    {
+        free(m->sector_copies[m->copy_order[i]]);
+    }
+    free(m->sector_copies);
+    free(m->dirty_sectors);
+    free(m->copy_order);
+    m->sector_copies = copies;
+    m->dirty_sectors = dirty;
+    m->copy_order = order;
+    m->copy_count = count;
+    m->copy_capacity = count;
+    m->lost_writes = 0;
+    m->pc = cp->pc;
+    m->cont = cp->cont;
+    m->irq = cp->irq;
+    m->in_isr = cp->in_isr;
+    for (i = 0; i < CPU_REG_NUM; i++)
+    {
+        m->cpu_registers[i] = cp->cpu_registers[i];
+    }
+    for (i = 0; i < IO_REG_NUM; i++)
+    {
+        m->io_registers[i] = cp->io_registers[i];
+    }
+    m->disk_cycles = cp->disk_cycles;
+    m->clock_wraps = cp->clock_wraps;
+    m->depth = cp->depth;
+    m->disk_offset = cp->disk_offset;
+    m->max_monitor_offset = cp->max_monitor_offset;
+    for (i = 0; i < SIM_STREAM_NUM; i++)
+    {
+        m->stream_bytes[i] = cp->stream_bytes[i];
+    }
+    m->cycles_run = cp->cycles_run;
+    for (i = 0; i < CPU_REG_NUM; i++)
+    {
+        m->trace_registers[i] = cp->trace_registers[i];
+    }
+    m->triggered = m->trigger == SIM_TRIGGER_NONE || cp->triggered;
+    m->trace_sample = cp->trace_sample < m->trace_every ? cp->trace_sample : 0;
+    for (i = 0; i < MEM_DEPTH; i++)
+    {
+        m->memory[i] = cp->memory[i];
+    }
+    for (i = 0; i < PIXELS; i++)
+    {
+        for (j = 0; j < PIXELS; j++)
+        {
+            m->monitor[i][j] = cp->monitor[i][j];
+        }
+    }
+    /*The next block and the next event are found again from the restored state.*/
+    m->block = NULL;
+    m->completed = FALSE;
+    m->schedule_valid = FALSE;
+    return 0;
+}
+
+/**
+ * @brief Function that adds bytes to an FNV-1a hash.
+ *
+ * @param hash The hash of the previous bytes, 2166136261 for the first bytes.
+ * @param data The bytes.
+ * @param len The number of bytes.
+ * @return The hash.
+ */
+static uint32_t hash_bytes(uint32_t hash, const void *data, size_t len)
+{
+    const unsigned char *p = data;
+    size_t i;
+    for (i = 0; i < len; i++)
+    {
+        hash = (hash ^ p[i]) * 16777619U;
+    }
+    return hash;
+}
+
+/**
+ * @brief Function that computes the hash of the loaded instructions, as written in imemin.txt.
+ *
+ * @param m The simulated machine.
+ * @return The hash.
+ */
+static uint32_t program_hash(const SimMachine *m)
+{
+    uint32_t hash = hash_bytes(2166136261U, &m->instruction_count, sizeof(m->instruction_count));
+    int i;
+    for (i = 0; i < m->instruction_count; i++)
+    {
+        hash = hash_bytes(hash, m->instructions[i].text, sizeof(m->instructions[i].text));
+    }
+    return hash;
+}
+
+/**
+ * @brief Function that checks if an opcode ends a basic block.
+ * Branches, jal, reti, in, out, halt and unknown opcodes end a block,
+ * arithmetic, logic, shift, lw and sw instructions are straight-line.
+ *
+ * @param opcode The opcode of the instruction.
+ * @return TRUE if the instruction ends a basic block, FALSE otherwise.
+ */
+static int ends_block(int opcode)
+{
+    return !((opcode >= 0 && opcode <= 8) || opcode == 16 || opcode == 17);
+}
+
+/**
+ * @brief Function that finds the extent of the basic block starting at an address and,
+ * when the terminator is a branch or jal to an immediate address, its target.
+ *
+ * @param m The simulated machine.
+ * @param start The address of the first instruction of the block.
+ * @param block The block, of which start, body_len, has_terminator, taken_pc and spin_len are set.
+ */
+static void find_block(const SimMachine *m, int start, Block *block)
+{
+    const Instruction *terminator;
+    int end = start;
+
+    while (end < m->instruction_count && !ends_block(m->instructions[end].opcode))
+    {
+        end++;
+    }
+    block->start = start;
+    block->body_len = end - start;
+    block->has_terminator = (end < m->instruction_count);
+    block->taken_pc = -1;
+    block->spin_len = spin_length(m, start);
+    if (block->has_terminator)
+    {
+        terminator = &m->instructions[end];
+        if (terminator->opcode >= 9 && terminator->opcode <= 15 && (terminator->rm == 1 || terminator->rm == 2))
+        {
+            block->taken_pc = *terminator->rm_val & 0xfff;
+        }
+    }
+}
+
+/**
+ * @brief Function that discovers the basic block starting at an address and stores it in the block cache.
+ * The instructions of the block are already decoded and bound, so translation only records its extent and target.
+ *
+ * @param m The simulated machine.
+ * @param start The address of the first instruction of the block.
+ * @return A pointer to the translated block.
+ */
+static Block *translate_block(SimMachine *m, int start)
+{
+    Block *block = &m->blocks[start];
+
+    find_block(m, start, block);
+    block->fallthrough = NULL;
+    block->taken = NULL;
+    block->spin_misses = 0;
+    block->translated = TRUE;
+    return block;
+}
+
+/**
+ * @brief Function that returns the cached basic block starting at an address, translating it on first use.
+ *
+ * @param m The simulated machine.
+ * @param address The address of the first instruction of the block.
+ * @return A pointer to the block.
+ */
+static Block *lookup_block(SimMachine *m, int address)
+{
+    if (m->blocks[address].translated)
+    {
+        return &m->blocks[address];
+    }
+    return translate_block(m, address);
+}
+
+/**
+ * @brief Function that finds the block to run at the program counter.
+ * When the previous block ran to its terminator, the successor is taken from the links of that block,
+ * which are filled in the first time each edge is followed.
+ *
+ * @param m The simulated machine.
+ * @param block The block that ran last, or NULL.
+ * @param completed TRUE if the previous block ran all of its instructions including the terminator.
+ * @return A pointer to the block starting at the program counter.
+ */
+static Block *next_block(SimMachine *m, Block *block, int completed)
+{
+    if (block == NULL || !completed)
+    {
+        return lookup_block(m, m->pc);
+    }
+    if (m->pc == block->start + block->body_len + 1)
+    {
+        if (!block->fallthrough)
+        {
+            block->fallthrough = lookup_block(m, m->pc);
+        }
+        return block->fallthrough;
+    }
+    if (m->pc == block->taken_pc)
+    {
+        if (!block->taken)
+        {
+            block->taken = lookup_block(m, m->pc);
+        }
+        return block->taken;
+    }
+    return lookup_block(m, m->pc);
+}
+
+/**
+ * @brief Function that runs the first instructions of a block body without per-cycle handling.
+ * The caller guarantees that no peripheral event occurs during these cycles, and accounts for them with advance_cycles.
+ *
+ * @param m The simulated machine.
+ * @param block The block to run.
+ * @param count The number of body instructions to run.
+ */
+static void run_block_body(SimMachine *m, Block *block, int count)
+{
+    const Instruction *inst = &m->instructions[block->start];
+    const Instruction *last = inst + count;
+    void (*native)(JitState *jit);
+    int traced;
+
+    /*Whole bodies of hot blocks run as native code when the jit is enabled. The trace can only start or stop
+      between two pieces of a step, so a body either writes trace.txt all along or not at all.*/
+    if (m->jit_enabled && count == block->body_len && count > 0)
+    {
+        traced = m->sinks[SIM_TRACE] && m->trace_on;
+        native = traced ? block->traced : block->native;
+        if (!native && (block->hits >= JIT_THRESHOLD || ++block->hits == JIT_THRESHOLD) &&
+            !jit_compile_block(m, block, traced))
+        {
+            native = traced ? block->traced : block->native;
+        }
+        if (native)
+        {
+            native(&m->jit);
+            m->pc = block->start + count;
+            return;
+        }
+    }
+    for (; inst < last; inst++)
+    {
+        write_to_trace(m, inst->text, inst->imm1, inst->imm2);
+        inst->execute(m, inst);
+    }
+}
+
+/**
+ * @brief Function that runs the instruction at the program counter for one clock cycle.
+ * The disk, the interrupts and the clock are handled one by one only if the cycle has a scheduled event,
+ * otherwise the cycle is accounted for like a cycle of a block body.
+ *
+ * @param m The simulated machine.
+ */
+static void execute_cycle(SimMachine *m)
+{
+    const Instruction *inst = &m->instructions[m->pc];
+
+    /*Write instruction to trace.*/
+    write_to_trace(m, inst->text, inst->imm1, inst->imm2);
+
+    /*Execute instruction.*/
+    inst->execute(m, inst);
+
+    if (cycles_until_event(m) > 0)
+    {
+        advance_cycles(m, 1);
+    }
+    else
+    {
+        end_cycle(m);
+    }
+}
+
+/**
+ * @brief Function that ends a clock cycle in which a peripheral event can occur.
+ * The disk, the timer, irq 2 and the interrupts are handled as in every cycle before events were scheduled,
+ * and the schedule is computed again from the new state in the next cycle.
+ *
+ * @param m The simulated machine.
+ */
+static void end_cycle(SimMachine *m)
+{
+    /*Handle disk.*/
+    if (m->io_registers[17])
+    {
+        handle_disk(m);
+    }
+
+    /*Handle interrupts.*/
+    handle_interrupts(m);
+
+    /*Increment clock.*/
+    handle_clock_cycles(m);
+
+    m->schedule_valid = FALSE;
+}
+
+/**
+ * @brief Function that returns the number of clock cycles left before the next scheduled event.
+ * The next event is the earliest of the timer reaching timermax, the disk reaching DISK_CYCLES,
+ * the next entry of irq 2 and a pending interrupt. It is computed once and kept until an event occurs,
+ * or until out or reti change the registers it depends on.
+ *
+ * @param m The simulated machine.
+ * @return The number of cycles that can run without per-cycle peripheral handling.
+ */
+static int cycles_until_event(SimMachine *m)
+{
+    if (!m->schedule_valid)
+    {
+        m->next_event = (unsigned int)m->io_registers[8] + (unsigned int)quiet_cycles(m);
+        m->schedule_valid = TRUE;
+    }
+    return (int)(m->next_event - (unsigned int)m->io_registers[8]);
+}
+
+/**
+ * @brief Function that computes how many of the upcoming clock cycles can pass without a peripheral event.
+ * In such a cycle the disk and the timer only count, irq 2 is not triggered, no interrupt is taken
+ * and the clock does not wrap around.
+ *
+ * @param m The simulated machine.
+ * @return The number of quiet clock cycles.
+ */
+static int quiet_cycles(SimMachine *m)
+{
+    unsigned int clk = (unsigned int)m->io_registers[8], distance, limit;
+    uint64_t clock, next;
+
+    /*A pending interrupt is taken in the next cycle.*/
+    if (!m->in_isr && (((m->io_registers[0] & m->io_registers[3]) | (m->io_registers[1] & m->io_registers[4]) | (m->io_registers[2] & m->io_registers[5])) & 1))
+    {
+        return 0;
+    }
+    /*The clock must not reach 0xFFFFFFFF, where it wraps around.*/
+    if (clk >= 0xFFFFFFFE)
+    {
+        return 0;
+    }
+    limit = 0xFFFFFFFE - clk;
+    /*The disk finishes in the cycle in which disk_cycles equals DISK_CYCLES.*/
+    if (m->io_registers[17])
+    {
+        distance = (m->disk_cycles < DISK_CYCLES) ? (unsigned int)(DISK_CYCLES - m->disk_cycles) : 0;
+        limit = (distance < limit) ? distance : limit;
+    }
+    /*A running timer fires in the cycle in which it reaches timermax.*/
+    if (m->io_registers[11] & 1)
+    {
+        distance = (unsigned int)m->io_registers[13] - (unsigned int)m->io_registers[12];
+        if (distance != 0)
+        {
+            limit = (distance - 1 < limit) ? distance - 1 : limit;
+        }
+    }
+    /*A stopped timer that equals timermax sets irq0status, which changes nothing once it is 0 and irq0status is set.*/
+    else if (m->io_registers[12] == m->io_registers[13] && !(m->io_registers[12] == 0 && m->io_registers[3] == TRUE))
+    {
+        return 0;
+    }
+    /*Irq 2 is triggered in the cycle in which the extended clock equals the next entry.*/
+    if (m->interrupt_pos < m->interrupt_count)
+    {
+        clock = irq2_clock(m);
+        next = m->interrupts[m->interrupt_pos];
+        if (next >= clock && next - clock < limit)
+        {
+            limit = (unsigned int)(next - clock);
+        }
+    }
+    return (limit > 0x7FFFFFFF) ? 0x7FFFFFFF : (int)limit;
+}
+
+/**
+ * @brief Function that accounts for quiet clock cycles in bulk.
+ * It leaves the disk, the timer and the clock in the same state as running handle_disk,
+ * handle_interrupts and handle_clock_cycles once per cycle.
+ *
+ * @param m The simulated machine.
+ * @param count The number of quiet cycles, as allowed by quiet_cycles.
+ */
+static void advance_cycles(SimMachine *m, int count)
+{
+    if (count <= 0)
+    {
+        return;
+    }
+    if (m->io_registers[17])
+    {
+        m->disk_cycles += count;
+    }
+    if (m->io_registers[11] & 1)
+    {
+        m->io_registers[12] = (int)((unsigned int)m->io_registers[12] + (unsigned int)count);
+    }
+    m->irq = ((m->io_registers[0] & m->io_registers[3]) | (m->io_registers[1] & m->io_registers[4]) | (m->io_registers[2] & m->io_registers[5])) & 1;
+    m->io_registers[8] = (int)((unsigned int)m->io_registers[8] + (unsigned int)count);
+}
+
+/**
+ * @brief Function that checks if a loop that can spin while waiting for an event starts at an address.
+ * The loop is a run of arithmetic, logic, shift, lw and in instructions closed by a conditional branch
+ * back to its first instruction. None of them write memory or an io register, so when an iteration leaves
+ * the registers unchanged every following iteration until the next event is the same.
+ *
+ * @param m The simulated machine.
+ * @param start The address of the first instruction of the loop.
+ * @return The number of instructions in the loop, or 0 if no such loop starts at the address.
+ */
+static int spin_length(const SimMachine *m, int start)
+{
+    const Instruction *inst;
+    int end;
+
+    for (end = start; end < m->instruction_count && end - start < SPIN_MAX_LEN; end++)
+    {
+        inst = &m->instructions[end];
+        if (inst->opcode >= 9 && inst->opcode <= 14)
+        {
+            return ((inst->rm == 1 || inst->rm == 2) && (*inst->rm_val & 0xfff) == start) ? end - start + 1 : 0;
+        }
+        if (!((inst->opcode >= 0 && inst->opcode <= 8) || inst->opcode == 16 || inst->opcode == 19))
+        {
+            return 0;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Function that runs a candidate spin loop and skips it to the next event if it spins.
+ * One iteration runs as a probe. If it branches back with the registers unchanged, and its in instructions
+ * read registers that do not count during quiet cycles, the remaining whole iterations before the next event
+ * are not executed: their trace.txt lines are repeated in bulk from the probe, the reads are written to
+ * hwregtrace.txt with their cycles, and the cycles are accounted for with advance_cycles.
+ *
+ * @param m The simulated machine.
+ * @param block The block at the start of the loop.
+ * @param limit The maximum number of clock cycles to run.
+ * @return The number of clock cycles that ran, 0 if the loop was not entered.
+ */
+static unsigned int fast_forward_spin(SimMachine *m, Block *block, unsigned int limit)
+{
+    char *lines = m->spin_lines, first[TRACE_LINE_LEN];
+    const Instruction *inst;
+    int before[CPU_REG_NUM], read_offsets[SPIN_MAX_LEN], read_regs[SPIN_MAX_LEN];
+    int n = block->spin_len, len = 0, line_len, first_len = 0, first_pc = block->start, read_count = 0, stable = TRUE;
+    int reg, iterations, copies, chunk, i, j;
+    unsigned int clk;
+
+    /*The probe and at least one more iteration must fit before the next event and within the limit.
+      A sampled trace writes different lines in each iteration, so the loop is not skipped while it is sampled.*/
+    if (block->spin_misses >= SPIN_MISS_LIMIT || cycles_until_event(m) < 2 * n || limit < 2 * (unsigned int)n ||
+        (m->sinks[SIM_TRACE] && m->trace_on && m->trace_every > 1))
+    {
+        return 0;
+    }
+
+    /*Run one iteration, keeping the trace.txt lines and the reads that pass the filters.
+      The filters that depend on time do not change before the next event.*/
+    memcpy(before, m->cpu_registers, sizeof(before));
+    for (i = 0; i < n; i++)
+    {
+        inst = &m->instructions[m->pc];
+        if (m->sinks[SIM_TRACE] && m->trace_on && m->traced_pcs[m->pc])
+        {
+            line_len = format_trace(m, lines + len, m->pc, inst->text, inst->imm1, inst->imm2);
+            emit(m, SIM_TRACE, lines + len, line_len);
+            first_pc = len == 0 ? m->pc : first_pc;
+            first_len = len == 0 ? line_len : first_len;
+            len += line_len;
+        }
+        if (inst->opcode == 19)
+        {
+            /*The clock and the timer count during quiet cycles, so reading them never spins.*/
+            reg = *inst->rs_val + *inst->rt_val;
+            if (reg < 0 || reg >= IO_REG_NUM || reg == 8 || reg == 12)
+            {
+                stable = FALSE;
+            }
+            if (m->trace_on && m->traced_pcs[m->pc])
+            {
+                read_offsets[read_count] = i;
+                read_regs[read_count++] = reg;
+            }
+        }
+        inst->execute(m, inst);
+        advance_cycles(m, 1);
+    }
+    if (!stable || m->pc != block->start || memcmp(before, m->cpu_registers, sizeof(before)) != 0)
+    {
+        block->spin_misses++;
+        return n;
+    }
+    block->spin_misses = 0;
+
+    /*A binary record only holds the registers that changed since the record before, so the first record
+      of the probe, which follows the code before the loop, differs from that of the repeated iterations.*/
+    if (len > 0 && m->formats[SIM_TRACE] == SIM_FORMAT_BINARY)
+    {
+        inst = &m->instructions[first_pc];
+        line_len = format_trace(m, first, first_pc, inst->text, inst->imm1, inst->imm2);
+        memmove(lines + line_len, lines + first_len, len - first_len);
+        memcpy(lines, first, line_len);
+        len += line_len - first_len;
+    }
+
+    /*Every remaining whole iteration before the next event is the same as the probe.*/
+    iterations = cycles_until_event(m) / n;
+    if ((unsigned int)iterations > (limit - n) / n)
+    {
+        iterations = (int)((limit - n) / n);
+    }
+    clk = (unsigned int)m->io_registers[8];
+    if (len == 0 && (read_count == 0 || !m->sinks[SIM_HWREGTRACE]))
+    {
+        /*Neither the lines nor the reads are kept.*/
+    }
+    else if (read_count == 0)
+    {
+        copies = SPIN_BUFFER_SIZE / len;
+        for (j = 1; j < copies && j < iterations; j++)
+        {
+            memcpy(lines + j * len, lines, len);
+        }
+        for (i = 0; i < iterations; i += chunk)
+        {
+            chunk = (iterations - i < copies) ? iterations - i : copies;
+            emit(m, SIM_TRACE, lines, (size_t)len * chunk);
+        }
+    }
+    else
+    {
+        for (i = 0; i < iterations; i++)
+        {
+            emit(m, SIM_TRACE, lines, len);
+            for (j = 0; j < read_count; j++)
+            {
+                emit_hwregtrace(m, (int)(clk + (unsigned int)(i * n + read_offsets[j])), READ, read_regs[j],
+                                m->io_registers[read_regs[j]]);
+            }
+        }
+    }
+    advance_cycles(m, iterations * n);
+    return n + (unsigned int)(iterations * n);
+}
+
+/**
+ * @brief Function that sets up the jit: it maps the code region and pins the machine state.
+ * The region is mapped writable and not executable; jit_protect makes the code of each block executable once it has
+ * been written, so no page is ever writable and executable at once.
+ *
+ * @param m The simulated machine.
+ * @return 0 on success, 1 if the jit is not available, in which case the interpreter is used.
+ */
+static int jit_init(SimMachine *m)
+{
+#ifdef SIM_JIT_SUPPORTED
+    void *code = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED)
+    {
+        return 1;
+    }
+    m->jit.code = code;
+    m->jit.code_used = 0;
+    m->jit.registers = m->cpu_registers;
+    m->jit.memory = m->memory;
+    m->jit.depth = &m->depth;
+    m->jit.trace = jit_trace;
+    m->jit.machine = m;
+    return 0;
+#else
+    return 1;
+#endif
+}
+
+/**
+ * @brief Function that switches the pages of the code region that hold a range of bytes between writable, while the
+ * jit writes code into them, and executable, while that code runs.
+ *
+ * @param m The simulated machine.
+ * @param start The offset of the first byte in the code region.
+ * @param end The offset after the last byte.
+ * @param writable TRUE (1) to make the pages readable and writable, FALSE (0) to make them readable and executable.
+ * @return 0 on success, 1 on failure.
+ */
+static int jit_protect(SimMachine *m, size_t start, size_t end, int writable)
+{
+#ifdef SIM_JIT_SUPPORTED
+    size_t first = start & ~((size_t)sysconf(_SC_PAGESIZE) - 1);
+    return mprotect(m->jit.code + first, end - first, writable ? PROT_READ | PROT_WRITE : PROT_READ | PROT_EXEC) != 0;
+#else
+    return 1;
+#endif
+}
+
+/**
+ * @brief Function called by native code before every traced instruction to write it to trace.txt.
+ *
+ * @param state The state of the jit.
+ * @param address The address of the instruction.
+ */
+static void jit_trace(JitState *state, int address)
+{
+    SimMachine *m = state->machine;
+    const Instruction *inst = &m->instructions[address];
+    m->pc = address;
+    write_to_trace(m, inst->text, inst->imm1, inst->imm2);
+}
+
+/**
+ * @brief Function that appends machine code bytes to the code region.
+ *
+ * @param m The simulated machine.
+ * @param bytes The bytes to append.
+ * @param len The number of bytes.
+ */
+static void jit_emit(SimMachine *m, const unsigned char *bytes, int len)
+{
+    memcpy(m->jit.code + m->jit.code_used, bytes, len);
+    m->jit.code_used += len;
+}
+
+/**
+ * @brief Function that appends a 32 bit little endian constant to the code region.
+ *
+ * @param m The simulated machine.
+ * @param value The constant.
+ */
+static void jit_emit_u32(SimMachine *m, unsigned int value)
+{
+    unsigned char bytes[4];
+    bytes[0] = value & 0xFF;
+    bytes[1] = (value >> 8) & 0xFF;
+    bytes[2] = (value >> 16) & 0xFF;
+    bytes[3] = (value >> 24) & 0xFF;
+    jit_emit(m, bytes, 4);
+}
+
+/**
+ * @brief Function that appends an instruction whose operands are a host register and a second host register or a
+ * register of the program in cpu_registers, with the REX prefix that r8d to r15d need.
+ *
+ * @param m The simulated machine.
+ * @param opcode The opcode of the instruction.
+ * @param reg The host register of the reg field.
+ * @param rm The host register of the rm field, or the register of the program at [rbx + 4 * rm] if memory is TRUE.
+ * @param memory TRUE (1) if rm is a register of the program, FALSE (0) if it is a host register.
+ */
+static void jit_emit_modrm(SimMachine *m, unsigned char opcode, int reg, int rm, int memory)
+{
+    unsigned char bytes[4];
+    int len = 0;
+    if (reg >= 8 || (!memory && rm >= 8))
+    {
+        bytes[len++] = (unsigned char)(0x40 | ((reg >> 3) << 2) | (memory ? 0 : rm >> 3));
+    }
+    bytes[len++] = opcode;
+    if (memory)
+    {
+        bytes[len++] = (unsigned char)(0x43 | ((reg & 7) << 3));
+        bytes[len++] = (unsigned char)(4 * rm);
+    }
+    else
+    {
+        bytes[len++] = (unsigned char)(0xC0 | ((reg & 7) << 3) | (rm & 7));
+    }
+    jit_emit(m, bytes, len);
+}
+
+/**
+ * @brief Function that drops the native code of every block, which is translated again once it runs.
+ *
+ * @param m The simulated machine.
+ */
+static void jit_flush(SimMachine *m)
+{
+    int i;
+    for (i = 0; i < MEM_DEPTH; i++)
+    {
+        m->blocks[i].native = NULL;
+        m->blocks[i].traced = NULL;
+    }
+    m->jit.code_used = 0;
+}
+
+/**
+ * @brief Function that chooses the registers a block keeps in host registers, the ones it uses most, and emits the
+ * code that loads them. Code that calls the trace only keeps them in r14d and r15d, which calls do not change.
+ *
+ * @param m The simulated machine.
+ * @param block The block.
+ * @param traced TRUE (1) if the code calls the trace.
+ * @param regs Where the registers are, set for the start of the block.
+ */
+static void jit_allocate(SimMachine *m, const Block *block, int traced, JitRegisters *regs)
+{
+    static const int slots[JIT_CACHED_REGISTERS] = {14, 15, 6, 7, 8, 9, 10, 11};
+    const Instruction *inst = &m->instructions[block->start];
+    int uses[CPU_REG_NUM], count = traced ? JIT_SAVED_REGISTERS : JIT_CACHED_REGISTERS, best, reg, i;
+
+    memset(uses, 0, sizeof(uses));
+    for (i = 0; i < block->body_len; i++, inst++)
+    {
+        uses[inst->rd]++;
+        uses[inst->rs]++;
+        uses[inst->rt]++;
+        uses[inst->rm]++;
+    }
+    /*$imm1 and $imm2 are read as constants.*/
+    uses[1] = 0;
+    uses[2] = 0;
+    for (reg = 0; reg < CPU_REG_NUM; reg++)
+    {
+        regs->host[reg] = -1;
+        regs->dirty[reg] = FALSE;
+    }
+    for (i = 0; i < count; i++)
+    {
+        best = -1;
+        for (reg = 0; reg < CPU_REG_NUM; reg++)
+        {
+            if (regs->host[reg] < 0 && uses[reg] > 1 && (best < 0 || uses[reg] > uses[best]))
+            {
+                best = reg;
+            }
+        }
+        if (best < 0)
+        {
+            break;
+        }
+        /*mov slot, [rbx + 4 * best]*/
+        regs->host[best] = slots[i];
+        jit_emit_modrm(m, 0x8B, slots[i], best, TRUE);
+    }
+}
+
+/**
+ * @brief Function that emits the code that stores the host registers written since their last store to
+ * cpu_registers, before a call that reads them and at the end of the block.
+ *
+ * @param m The simulated machine.
+ * @param regs Where the registers are.
+ */
+static void jit_write_back(SimMachine *m, JitRegisters *regs)
+{
+    int reg;
+    for (reg = 0; reg < CPU_REG_NUM; reg++)
+    {
+        if (regs->dirty[reg])
+        {
+            /*mov [rbx + 4 * reg], host*/
+            jit_emit_modrm(m, 0x89, regs->host[reg], reg, TRUE);
+            regs->dirty[reg] = FALSE;
+        }
+    }
+}
+
+/**
+ * @brief Function that emits code loading an operand into a host register.
+ * $imm1 and $imm2 become instruction constants, other registers are moved from the host register that holds them
+ * or loaded from the pinned cpu_registers (rbx).
+ *
+ * @param m The simulated machine.
+ * @param host_reg The host register: 0 for eax, 1 for ecx, 2 for edx.
+ * @param reg The register number of the operand.
+ * @param inst The decoded instruction.
+ * @param regs Where the registers are.
+ */
+static void jit_load_operand(SimMachine *m, int host_reg, int reg, const Instruction *inst, const JitRegisters *regs)
+{
+    unsigned char mov_imm = (unsigned char)(0xB8 + host_reg);
+    if (reg == 1 || reg == 2)
+    {
+        jit_emit(m, &mov_imm, 1);
+        jit_emit_u32(m, (unsigned int)(reg == 1 ? inst->imm1 : inst->imm2));
+    }
+    else if (regs->host[reg] >= 0)
+    {
+        /*mov host_reg, cached*/
+        jit_emit_modrm(m, 0x89, regs->host[reg], host_reg, FALSE);
+    }
+    else
+    {
+        /*mov host_reg, [rbx + 4 * reg]*/
+        jit_emit_modrm(m, 0x8B, host_reg, reg, TRUE);
+    }
+}
+
+/**
+ * @brief Function that emits the native code of one straight-line instruction.
+ * Registers are held in the pinned context: rbx points to cpu_registers, r12 to memory and r13 to the jit state,
+ * and the registers the block uses most stay in host registers.
+ *
+ * @param m The simulated machine.
+ * @param inst The decoded instruction.
+ * @param address The address of the instruction.
+ * @param traced TRUE (1) if the instruction is written to trace.txt when its address is traced.
+ * @param regs Where the registers are.
+ */
+static void jit_compile_instruction(SimMachine *m, const Instruction *inst, int address, int traced, JitRegisters *regs)
+{
+    static const unsigned char trace_call[] = {0x4C, 0x89, 0xEF, 0x41, 0xFF, 0x55, (unsigned char)offsetof(JitState, trace)};
+    static const unsigned char add_ecx[] = {0x01, 0xC8}, add_edx[] = {0x01, 0xD0};
+    static const unsigned char sub_ecx[] = {0x29, 0xC8}, sub_edx[] = {0x29, 0xD0};
+    static const unsigned char imul_ecx[] = {0x0F, 0xAF, 0xC1};
+    static const unsigned char and_ecx[] = {0x21, 0xC8}, and_edx[] = {0x21, 0xD0};
+    static const unsigned char or_ecx[] = {0x09, 0xC8}, or_edx[] = {0x09, 0xD0};
+    static const unsigned char xor_ecx[] = {0x31, 0xC8}, xor_edx[] = {0x31, 0xD0};
+    static const unsigned char shl_cl[] = {0xD3, 0xE0}, sar_cl[] = {0xD3, 0xF8}, shr_cl[] = {0xD3, 0xE8};
+    static const unsigned char and_eax_imm = 0x25;
+    static const unsigned char load_word[] = {0x48, 0x63, 0xC0, 0x41, 0x8B, 0x04, 0x84};
+    static const unsigned char store_word[] = {0x01, 0xD1, 0x48, 0x63, 0xD0, 0x41, 0x89, 0x0C, 0x94};
+    static const unsigned char update_depth[] = {0x83, 0xC0, 0x01, 0x49, 0x8B, 0x55, (unsigned char)offsetof(JitState, depth),
+                                                 0x3B, 0x02, 0x7E, 0x02, 0x89, 0x02};
+    unsigned char mov_esi = 0xBE;
+
+    /*Write the instruction to trace.txt: jit_trace(r13, address), which reads the registers from cpu_registers.*/
+    if (traced && m->traced_pcs[address])
+    {
+        jit_write_back(m, regs);
+        jit_emit(m, &mov_esi, 1);
+        jit_emit_u32(m, (unsigned int)address);
+        jit_emit(m, trace_call, sizeof(trace_call));
+    }
+
+    jit_load_operand(m, 0, inst->rs, inst, regs);
+    jit_load_operand(m, 1, inst->rt, inst, regs);
+    if (inst->opcode == 17)
+    {
+        /*sw: memory[(rs + rt) & MEM_MASK] = rm + rd, then update the depth of memory.*/
+        jit_emit(m, add_ecx, sizeof(add_ecx));
+        jit_emit(m, &and_eax_imm, 1);
+        jit_emit_u32(m, MEM_MASK);
+        jit_load_operand(m, 1, inst->rm, inst, regs);
+        jit_load_operand(m, 2, inst->rd, inst, regs);
+        jit_emit(m, store_word, sizeof(store_word));
+        jit_emit(m, update_depth, sizeof(update_depth));
+        return;
+    }
+    if (inst->opcode <= 5 || inst->opcode == 16)
+    {
+        jit_load_operand(m, 2, inst->rm, inst, regs);
+    }
+    switch (inst->opcode)
+    {
+    case 0:
+        jit_emit(m, add_ecx, sizeof(add_ecx));
+        jit_emit(m, add_edx, sizeof(add_edx));
+        break;
+    case 1:
+        jit_emit(m, sub_ecx, sizeof(sub_ecx));
+        jit_emit(m, sub_edx, sizeof(sub_edx));
+        break;
+    case 2:
+        jit_emit(m, imul_ecx, sizeof(imul_ecx));
+        jit_emit(m, add_edx, sizeof(add_edx));
+        break;
+    case 3:
+        jit_emit(m, and_ecx, sizeof(and_ecx));
+        jit_emit(m, and_edx, sizeof(and_edx));
+        break;
+    case 4:
+        jit_emit(m, or_ecx, sizeof(or_ecx));
+        jit_emit(m, or_edx, sizeof(or_edx));
+        break;
+    case 5:
+        jit_emit(m, xor_ecx, sizeof(xor_ecx));
+        jit_emit(m, xor_edx, sizeof(xor_edx));
+        break;
+    case 6:
+        jit_emit(m, shl_cl, sizeof(shl_cl));
+        break;
+    case 7:
+        jit_emit(m, sar_cl, sizeof(sar_cl));
+        break;
+    case 8:
+        jit_emit(m, shr_cl, sizeof(shr_cl));
+        break;
+    case 16:
+        /*lw: rd = memory[(rs + rt) & MEM_MASK] + rm.*/
+        jit_emit(m, add_ecx, sizeof(add_ecx));
+        jit_emit(m, &and_eax_imm, 1);
+        jit_emit_u32(m, MEM_MASK);
+        jit_emit(m, load_word, sizeof(load_word));
+        jit_emit(m, add_edx, sizeof(add_edx));
+        break;
+    }
+    if (regs->host[inst->rd] >= 0)
+    {
+        /*mov cached, eax*/
+        jit_emit_modrm(m, 0x89, 0, regs->host[inst->rd], FALSE);
+        regs->dirty[inst->rd] = TRUE;
+    }
+    else
+    {
+        /*mov [rbx + 4 * rd], eax*/
+        jit_emit_modrm(m, 0x89, 0, inst->rd, TRUE);
+    }
+}
+
+/**
+ * @brief Function that translates the body of a hot block to native code.
+ * The terminator is not translated, in, out, reti and halt always run in the interpreter,
+ * and the body only runs natively when no interrupt can be taken before it ends.
+ * A block has code for the cycles in which trace.txt is written, which calls the trace at the traced addresses,
+ * and code for the others, which makes no calls at all. Each is translated the first time it is needed.
+ *
+ * @param m The simulated machine.
+ * @param block The block to translate.
+ * @param traced TRUE (1) for the code that writes trace.txt, FALSE (0) for the other.
+ * @return 0 on success, 1 if the code region is full or cannot be protected, in which case the block stays interpreted.
+ */
+static int jit_compile_block(SimMachine *m, Block *block, int traced)
+{
+    static const unsigned char prologue[] = {0x53, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57, 0x49, 0x89, 0xFD,
+                                             0x48, 0x8B, 0x5F, (unsigned char)offsetof(JitState, registers),
+                                             0x4C, 0x8B, 0x67, (unsigned char)offsetof(JitState, memory)};
+    static const unsigned char epilogue[] = {0x41, 0x5F, 0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5B, 0xC3};
+    size_t start = m->jit.code_used, size = (size_t)(block->body_len + 2) * JIT_MAX_INSTRUCTION_BYTES;
+    unsigned char *entry = m->jit.code + start;
+    JitRegisters regs;
+    int i;
+
+    if (start + size > JIT_CODE_SIZE || jit_protect(m, start, start + size, TRUE))
+    {
+        return 1;
+    }
+    /*push rbx, r12, r13, r14 and r15 (keeps the stack aligned for calls), mov r13, rdi and load the pinned bases.*/
+    jit_emit(m, prologue, sizeof(prologue));
+    jit_allocate(m, block, traced, &regs);
+    for (i = 0; i < block->body_len; i++)
+    {
+        jit_compile_instruction(m, &m->instructions[block->start + i], block->start + i, traced, &regs);
+    }
+    jit_write_back(m, &regs);
+    jit_emit(m, epilogue, sizeof(epilogue));
+    /*The pages are only executable once the code is written; on failure the block stays interpreted.*/
+    if (jit_protect(m, start, m->jit.code_used, FALSE))
+    {
+        return 1;
+    }
+    if (traced)
+    {
+        block->traced = (void (*)(JitState *))entry;
+    }
+    else
+    {
+        block->native = (void (*)(JitState *))entry;
+    }
+    return 0;
+}
+
+/**
+ * @brief Function that finds the next line of an image that is not blank, without the spaces and tabs around it
+ * and its LF or CRLF.
+ *
+ * @param text The position in the image, advanced past the line.
+ * @param end The end of the image.
+ * @param line The number of the last line that was read, advanced to the number of the line that was found.
+ * @param word The first character of the line that is not a space or a tab.
+ * @param len The number of characters of the line from word up to the spaces, tabs and end of line after it.
+ * @return TRUE if a line was found, FALSE at the end of the image.
+ */
+static int next_word(const char **text, const char *end, int *line, const char **word, int *len)
+{
+    const char *p = *text, *stop;
+    while (p < end)
+    {
+        stop = memchr(p, '\n', (size_t)(end - p));
+        *text = stop ? stop + 1 : end;
+        stop = stop ? stop : end;
+        (*line)++;
+        while (p < stop && (*p == ' ' || *p == '\t'))
+        {
+            p++;
+        }
+        while (stop > p && (stop[-1] == ' ' || stop[-1] == '\t' || stop[-1] == '\r'))
+        {
+            stop--;
+        }
+        if (stop > p)
+        {
+            *word = p;
+            *len = (int)(stop - p);
+            return TRUE;
+        }
+        p = *text;
+    }
+    *text = end;
+    return FALSE;
+}
+
+/**
+ * @brief Function that reads a number of 1 to 8 hex digits, in upper or lower case.
+ * With SSE2 exactly 8 digits, which the assembler always writes, are read by get_hex8.
+ *
+ * @param digits The digits, not terminated.
+ * @param len The number of digits.
+ * @param value The number.
+ * @return 0 on success, 1 if there are more than 8 digits or a character is not a hex digit.
+ */
+static int get_hex(const char *digits, int len, unsigned int *value)
+{
+    unsigned int result = 0, c;
+    int i;
+#ifdef SIM_HEX_SSE2
+    if (len == 8)
+    {
+        return get_hex8(digits, value);
+    }
+#endif
+    if (len < 1 || len > 8)
+    {
+        return 1;
+    }
+    for (i = 0; i < len; i++)
+    {
+        c = (unsigned char)digits[i];
+        if (c - '0' < 10)
+        {
+            c -= '0';
+        }
+        else if ((c | 0x20) - 'a' < 6)
+        {
+            c = (c | 0x20) - 'a' + 10;
+        }
+        else
+        {
+            return 1;
+        }
+        result = (result << 4) | c;
+    }
+    *value = result;
+    return 0;
+}
+
+/**
+ * @brief Function that reads a number of exactly 8 hex digits, in upper or lower case.
+ * With SSE2 the 8 digits are checked and turned to nibbles together and the nibbles are packed by two
+ * multiply-adds, otherwise they are read by get_hex one at a time.
+ *
+ * @param digits The digits, at least 8 characters, not terminated.
+ * @param value The number.
+ * @return 0 on success, 1 if a character is not a hex digit.
+ */
+static int get_hex8(const char *digits, unsigned int *value)
+{
+#ifdef SIM_HEX_SSE2
+    __m128i chars = _mm_loadl_epi64((const __m128i *)digits), lower, is_digit, is_letter, nibbles, pairs, words;
+    /*Bytes of 0x80 and above compare as negative, so they are neither digits nor letters.*/
+    lower = _mm_or_si128(chars, _mm_set1_epi8(0x20));
+    is_digit = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(chars, _mm_set1_epi8('9' + 1)));
+    is_letter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+    if ((_mm_movemask_epi8(_mm_or_si128(is_digit, is_letter)) & 0xFF) != 0xFF)
+    {
+        return 1;
+    }
+    /*The low nibble of '0' to '9' is the digit, and that of 'A' to 'F' is 9 less than the digit.*/
+    nibbles = _mm_add_epi8(_mm_and_si128(chars, _mm_set1_epi8(0x0F)), _mm_and_si128(is_letter, _mm_set1_epi8(9)));
+    /*Each pair of digits becomes a byte in a 16 bit lane, then each pair of bytes a 16 bit number in a 32 bit lane.*/
+    pairs = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(nibbles, _mm_set1_epi16(0x00FF)), 4), _mm_srli_epi16(nibbles, 8));
+    words = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00010100));
+    *value = ((unsigned int)_mm_cvtsi128_si32(words) << 16) | (unsigned int)_mm_cvtsi128_si32(_mm_srli_si128(words, 4));
+    return 0;
+#else
+    return get_hex(digits, 8, value);
+#endif
+}
+
+/**
+ * @brief Function that drops the loaded program before new instructions are loaded,
+ * with the blocks discovered and translated for it.
+ *
+ * @param m The simulated machine.
+ */
+static void clear_program(SimMachine *m)
+{
+    memset(m->blocks, 0, sizeof(m->blocks));
+    m->block = NULL;
+    m->completed = FALSE;
+    m->jit.code_used = 0;
+    m->instruction_count = 0;
+    m->load_error = NULL;
+    m->load_line = 0;
+}
+
+/**
+ * @brief Function that records why a loader failed, for sim_load_error.
+ *
+ * @param m The simulated machine.
+ * @param line The line of the image the loader failed on.
+ * @param error Why the loader failed.
+ * @return 1, the result of the failed loader.
+ */
+static int load_error(SimMachine *m, int line, const char *error)
+{
+    m->load_line = line;
+    m->load_error = error;
+    return 1;
+}
+
+/**
+ * @brief Function that reads the next cycle number of irq2in.txt, a decimal number of up to 64 bits.
+ * The text may be a piece of the file: a number that reaches the end of the piece is only read if it is the last one.
+ *
+ * @param text The position in the text, advanced past the white space and the number that were read.
+ * @param end The end of the text.
+ * @param final TRUE if the text ends where the file ends, FALSE if more of it follows.
+ * @param line The line of the position, advanced past the lines that were read.
+ * @param value The number that was read.
+ * @return 1 if a number was read, 0 at the end of the text, -1 at text that is not a cycle number.
+ */
+static int next_cycle(const char **text, const char *end, int final, int *line, uint64_t *value)
+{
+    const char *p = *text, *start;
+    uint64_t result = 0;
+    unsigned int digit;
+
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r' || *p == '\v' || *p == '\f'))
+    {
+        *line += (*p == '\n');
+        p++;
+    }
+    *text = p;
+    for (start = p; p < end && *p >= '0' && *p <= '9'; p++)
+    {
+        digit = (unsigned int)(*p - '0');
+        if (result > (UINT64_MAX - digit) / 10)
+        {
+            return -1;
+        }
+        result = result * 10 + digit;
+    }
+    if (p == end && (!final || p == start))
+    {
+        return 0;
+    }
+    if (p == start || (p < end && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r' && *p != '\v' && *p != '\f'))
+    {
+        return -1;
+    }
+    *value = result;
+    *text = p;
+    return 1;
+}
+
+/**
+ * @brief Function that drops the irq 2 schedule, and closes the source of a streamed one.
+ *
+ * @param m The simulated machine.
+ */
+static void clear_irq2(SimMachine *m)
+{
+    end_irq2_stream(m);
+    free(m->interrupts);
+    m->interrupts = NULL;
+    m->interrupt_pos = 0;
+    m->interrupt_count = 0;
+    m->interrupt_base = 0;
+    m->interrupt_hash = 2166136261U;
+    m->schedule_valid = FALSE;
+}
+
+/**
+ * @brief Function that stops reading a streamed irq 2 schedule. The entries already in the window are kept.
+ *
+ * @param m The simulated machine.
+ */
+static void end_irq2_stream(SimMachine *m)
+{
+    Irq2Stream *s = m->irq2_stream;
+    if (!s)
+    {
+        return;
+    }
+    if (s->close)
+    {
+        s->close(s->user);
+    }
+    free(s);
+    m->irq2_stream = NULL;
+}
+
+/**
+ * @brief Function that reads the next window of a streamed irq 2 schedule, once every entry of the window ran.
+ * Equal entries trigger irq 2 once, as in a loaded schedule. An entry before the one it follows, or text that is
+ * not a cycle number, ends the schedule and is recorded for sim_load_error: a streamed schedule cannot be sorted.
+ *
+ * @param m The simulated machine.
+ * @return 0 on success, including at the end of the schedule, 1 if the schedule is not valid.
+ */
+static int fill_irq2(SimMachine *m)
+{
+    Irq2Stream *s = m->irq2_stream;
+    const char *p, *end;
+    uint64_t value;
+    size_t got;
+    int found, line;
+
+    m->interrupt_base += m->interrupt_count;
+    m->interrupt_pos = 0;
+    m->interrupt_count = 0;
+    m->schedule_valid = FALSE;
+    while (s && m->interrupt_count < IRQ2_WINDOW)
+    {
+        p = s->text;
+        end = s->text + s->text_len;
+        found = 0;
+        while (m->interrupt_count < IRQ2_WINDOW && (found = next_cycle(&p, end, s->ended, &s->line, &value)) == 1)
+        {
+            if (s->started && value < s->last)
+            {
+                found = -2;
+                break;
+            }
+            if (!s->started || value != s->last)
+            {
+                m->interrupts[m->interrupt_count++] = value;
+            }
+            s->started = TRUE;
+            s->last = value;
+        }
+        /*Keep the text that was not parsed, a number cut by the end of the last read.*/
+        s->text_len = (size_t)(end - p);
+        memmove(s->text, p, s->text_len);
+        if (m->interrupt_count == IRQ2_WINDOW && found >= 0)
+        {
+            break;
+        }
+        if (found < 0 || s->text_len > MAX_CYCLE_DIGITS)
+        {
+            line = s->line;
+            end_irq2_stream(m);
+            return load_error(m, line, found == -2 ? "irq 2 entries must be in increasing order"
+                                                   : "expected a cycle number");
+        }
+        if (s->ended)
+        {
+            end_irq2_stream(m);
+            break;
+        }
+        got = s->read(s->user, s->text + s->text_len, IRQ2_CHUNK);
+        s->text_len += got;
+        s->ended = (got == 0);
+    }
+    return 0;
+}
+
+/**
+ * @brief Function that moves the irq 2 schedule to the entry after a number of triggered entries,
+ * after checking that those entries are the ones a run triggered. The entries held in memory are checked without
+ * moving the schedule, so a failed check leaves it as it was, unless a streamed schedule had to be read further.
+ * A streamed schedule only moves forward, its entries before the window are gone.
+ *
+ * @param m The simulated machine.
+ * @param index The number of triggered entries.
+ * @param hash The hash of the triggered entries.
+ * @return 0 on success, 1 if the schedule does not start with those entries.
+ */
+static int seek_irq2(SimMachine *m, uint64_t index, uint32_t hash)
+{
+    uint64_t at = m->interrupt_base + m->interrupt_pos;
+    uint32_t h = m->interrupt_hash;
+    size_t pos = m->interrupt_pos;
+
+    if (index < at)
+    {
+        if (m->interrupt_base != 0)
+        {
+            return 1;
+        }
+        at = 0;
+        h = 2166136261U;
+        pos = 0;
+    }
+    for (;;)
+    {
+        for (; at < index && pos < m->interrupt_count; at++, pos++)
+        {
+            h = hash_bytes(h, &m->interrupts[pos], sizeof(uint64_t));
+        }
+        if (at == index || !m->irq2_stream)
+        {
+            break;
+        }
+        m->interrupt_pos = pos;
+        m->interrupt_hash = h;
+        if (fill_irq2(m) || m->interrupt_count == 0)
+        {
+            return 1;
+        }
+        pos = 0;
+    }
+    if (at != index || h != hash)
+    {
+        return 1;
+    }
+    m->interrupt_pos = pos;
+    m->interrupt_hash = h;
+    m->schedule_valid = FALSE;
+    /*A streamed schedule that fails later is recorded for sim_load_error, like the failure of any later window.*/
+    if (m->interrupt_pos == m->interrupt_count && m->irq2_stream)
+    {
+        fill_irq2(m);
+    }
+    return 0;
+}
+
+/**
+ * @brief Function that returns the clock extended to 64 bits by the number of times it wrapped around,
+ * which the entries of irq 2 are compared with.
+ *
+ * @param m The simulated machine.
+ * @return The extended clock.
+ */
+static uint64_t irq2_clock(const SimMachine *m)
+{
+    return (uint64_t)m->clock_wraps * CLOCK_PERIOD + (unsigned int)m->io_registers[8];
+}
+
+/**
+ * @brief Function that compares two entries of irq 2, for qsort.
+ *
+ * @param a The first entry.
+ * @param b The second entry.
+ * @return A negative number, 0 or a positive number as a is before, at or after b.
+ */
+static int compare_cycles(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Function for checking the irq2status register.
+ * The function sets the irq2status register to 1 when irq 2 is triggered.
+ *
+ * @param m The simulated machine.
+ */
+static void check_irq2in(SimMachine *m)
+{
+    if (m->interrupt_pos < m->interrupt_count && m->interrupts[m->interrupt_pos] == irq2_clock(m))
+    {
+        m->io_registers[5] = TRUE;
+        m->interrupt_hash = hash_bytes(m->interrupt_hash, &m->interrupts[m->interrupt_pos], sizeof(uint64_t));
+        m->interrupt_pos++;
+        if (m->interrupt_pos == m->interrupt_count && m->irq2_stream)
+        {
+            fill_irq2(m);
+        }
+        fire_trigger(m, 2);
+    }
+}
+
+/**
+ * @brief Function that starts tracing when the interrupt of the trigger is requested for the first time.
+ *
+ * @param m The simulated machine.
+ * @param irq The interrupt that was requested: 0, 1 or 2.
+ */
+static void fire_trigger(SimMachine *m, int irq)
+{
+    if (!m->triggered && m->trigger == irq)
+    {
+        m->triggered = TRUE;
+        m->trace_on = m->in_window;
+    }
+}
+
+/**
+ * @brief Function for updating the timer of the processor. timer is updated iff register timeranable==1.
+ * In the clock cycle in which timercurrent==timermax, timercurrent=0 and irq0 is triggered.
+ * A stopped timer equals timermax from reset on, which sets irq0status without raising a timer interrupt,
+ * so only a running timer fires the irq 0 trace trigger.
+ *
+ * @param m The simulated machine.
+ */
+static void update_timer(SimMachine *m)
+{
+    /*iterate timer*/
+    if (m->io_registers[11] & 1)
+    {
+        m->io_registers[12]++;
+    }
+
+    /*Check if timer is equal to the value in the timer limit register.*/
+    if (m->io_registers[12] == m->io_registers[13])
+    {
+        m->io_registers[12] = 0;
+        m->io_registers[3] = TRUE;
+        if (m->io_registers[11] & 1)
+        {
+            fire_trigger(m, 0);
+        }
+    }
+}
+
+/**
+ * @brief Function for handling clock cycles.
+ * The function increments the clck register each time,
+ * and resets it when reaching the max value of 0XFFFFFFFF.
+ *
+ * @param m The simulated machine.
+ */
+static void handle_clock_cycles(SimMachine *m)
+{
+    m->io_registers[8]++;
+    if ((unsigned int)m->io_registers[8] == 0XFFFFFFFF)
+    {
+        m->io_registers[8] = 0;
+        m->clock_wraps++;
+    }
+}
+
+/**
+ * @brief Function for handling interrupts in the system.
+ * The function stores the current program counter in irqreturn register,
+ * and changes the program counter to be the address in irqhandler.
+ * finally it sets in_isr=TRUE, indicating that the processor is in interrupt.
+ *
+ * @param m The simulated machine.
+ * @return 1 if an interrupt occurred, 0 otherwise.
+ */
+static int handle_interrupts(SimMachine *m)
+{
+    /*check for interrupts*/
+    check_interrupts(m);
+
+    /*the clock cycle in which the interrupt is received*/
+    if (m->irq && !m->in_isr)
+    {
+        m->io_registers[7] = m->pc;
+        m->pc = m->io_registers[6] & MEM_MASK;
+        m->in_isr = TRUE;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Function for checking if an interrupt is triggered.
+ * The function sets irq=1 iff an interrupt is triggered, and irq=0 otherwise.
+ *
+ * @param m The simulated machine.
+ */
+static void check_interrupts(SimMachine *m)
+{
+    int irq0enable, irq1enable, irq2enable, irq0status, irq1status, irq2status;
+
+    /*Update the timer and check if timer == timermax*/
+    update_timer(m);
+    /*Check an interrupt should be triggerd in the current clock cycle.*/
+    check_irq2in(m);
+    irq0enable = m->io_registers[0] & 1;
+    irq1enable = m->io_registers[1] & 1;
+    irq2enable = m->io_registers[2] & 1;
+    irq0status = m->io_registers[3] & 1;
+    irq1status = m->io_registers[4] & 1;
+    irq2status = m->io_registers[5] & 1;
+
+    m->irq = (irq0enable & irq0status) | (irq1enable & irq1status) | (irq2enable & irq2status);
+}
+
+/**
+ * @brief Function for handling the disk.
+ * The function is called only when the disk is busy with reading from or writing to the disk.
+ * The function increases the disk cycle counter by 1 each cycle where the disk is busy,
+ * and when reaching 1024 disk cycles performs the operation.
+ *
+ * @param m The simulated machine.
+ */
+static void handle_disk(SimMachine *m)
+{
+    if (m->disk_cycles == DISK_CYCLES)
+    {
+        m->disk_cycles = 0;
+        if (m->io_registers[14] == 1)
+        {
+            read_sector(m);
+        }
+        else if (m->io_registers[14] == 2)
+        {
+            write_sector(m);
+        }
+        m->io_registers[14] = 0;
+        m->io_registers[17] = 0;
+        m->io_registers[4] = TRUE;
+        fire_trigger(m, 1);
+    }
+    else
+    {
+        m->disk_cycles++;
+    }
+}
+
+/**
+ * @brief Function for reading a sector from the disk to the specified location in memory.
+ * The function reads sector based on disksector register
+ * and writes it to the location in memory based on diskbuffer register.
+ * A sector out of the disk reads as 0, and the words that fall outside the memory are dropped.
+ *
+ * @param m The simulated machine.
+ */
+static void read_sector(SimMachine *m)
+{
+    int i, sector = m->io_registers[15], buffer = m->io_registers[16];
+    const int32_t *words = (sector >= 0 && sector < m->disk_sectors) ? disk_sector(m, sector) : zero_sector;
+    for (i = 0; i < m->sector_words; i++)
+    {
+        if (buffer + i >= 0 && buffer + i < MEM_DEPTH)
+        {
+            m->memory[buffer + i] = words[i];
+        }
+    }
+    if (buffer + i + 1 > m->depth)
+    {
+        m->depth = buffer + i + 1 > MEM_DEPTH ? MEM_DEPTH : buffer + i + 1;
+    }
+}
+
+/**
+ * @brief Function for writing a sector to disk from the specified location in memory.
+ * The function reads data from memory based on diskbuffer register
+ * and writes it to disk the sector specified on disksector register.
+ * The sector is copied from the base image first and marked dirty. A sector out of the disk is not written,
+ * and the words that fall outside the memory are written as 0.
+ *
+ * @param m The simulated machine.
+ */
+static void write_sector(SimMachine *m)
+{
+    int i, sector = m->io_registers[15], buffer = m->io_registers[16], current_offset;
+    int32_t *copy;
+
+    if (sector < 0 || sector >= m->disk_sectors)
+    {
+        return;
+    }
+    if (!(copy = copy_sector(m, sector)))
+    {
+        m->lost_writes++;
+        return;
+    }
+    for (i = 0; i < m->sector_words; i++)
+    {
+        copy[i] = (buffer + i >= 0 && buffer + i < MEM_DEPTH) ? m->memory[buffer + i] : 0;
+        current_offset = sector * m->sector_words + i;
+        if (current_offset > m->disk_offset)
+        {
+            m->disk_offset = current_offset + 1;
+        }
+    }
+    m->dirty_sectors[sector / 32] |= 1U << (sector % 32);
+}
+
+/**
+ * @brief Function that frees the copies of the sectors and releases the base image, leaving a disk of 0
+ * with the same geometry.
+ *
+ * @param m The simulated machine.
+ */
+static void clear_disk(SimMachine *m)
+{
+    int i;
+    for (i = 0; i < m->copy_count; i++)
+    {
+        free(m->sector_copies[m->copy_order[i]]);
+    }
+    free(m->sector_copies);
+    free(m->dirty_sectors);
+    free(m->copy_order);
+    if (m->release_base)
+    {
+        m->release_base(m->base_user);
+    }
+    m->disk_base = NULL;
+    m->release_base = NULL;
+    m->base_user = NULL;
+    m->sector_copies = NULL;
+    m->dirty_sectors = NULL;
+    m->copy_order = NULL;
+    m->copy_count = 0;
+    m->copy_capacity = 0;
+    m->lost_writes = 0;
+    m->disk_offset = 0;
+}
+
+/**
+ * @brief Function that returns the words of a sector: its copy if it has one, otherwise its words in the base image.
+ *
+ * @param m The simulated machine.
+ * @param sector The sector, inside the disk.
+ * @return The sim_disk_sector_words words of the sector.
+ */
+static const int32_t *disk_sector(const SimMachine *m, int sector)
+{
+    if (m->sector_copies && m->sector_copies[sector])
+    {
+        return m->sector_copies[sector];
+    }
+    return m->disk_base ? m->disk_base + (size_t)sector * m->sector_words : zero_sector;
+}
+
+/**
+ * @brief Function that gives a sector a copy of its own, which can be written. The table of the copies and the
+ * bitmap of the dirty sectors are allocated with the first copy, zeroed and only touched where sectors are copied.
+ *
+ * @param m The simulated machine.
+ * @param sector The sector, inside the disk.
+ * @return The words of the copy, or NULL if there is not enough memory.
+ */
+static int32_t *copy_sector(SimMachine *m, int sector)
+{
+    int32_t *copy;
+    int *order, capacity;
+
+    if (!m->sector_copies)
+    {
+        m->sector_copies = calloc((size_t)m->disk_sectors, sizeof(int32_t *));
+        m->dirty_sectors = calloc(((size_t)m->disk_sectors + 31) / 32, sizeof(uint32_t));
+        if (!m->sector_copies || !m->dirty_sectors)
+        {
+            free(m->sector_copies);
+            free(m->dirty_sectors);
+            m->sector_copies = NULL;
+            m->dirty_sectors = NULL;
+            return NULL;
+        }
+    }
+    if (m->sector_copies[sector])
+    {
+        return m->sector_copies[sector];
+    }
+    if (m->copy_count == m->copy_capacity)
+    {
+        capacity = m->copy_capacity ? 2 * m->copy_capacity : 64;
+        order = realloc(m->copy_order, (size_t)capacity * sizeof(int));
+        if (!order)
+        {
+            return NULL;
+        }
+        m->copy_order = order;
+        m->copy_capacity = capacity;
+    }
+    copy = malloc((size_t)m->sector_words * sizeof(int32_t));
+    if (!copy)
+    {
+        return NULL;
+    }
+    memcpy(copy, disk_sector(m, sector), (size_t)m->sector_words * sizeof(int32_t));
+    m->sector_copies[sector] = copy;
+    m->copy_order[m->copy_count++] = sector;
+    return copy;
+}
+
+/**
+ * @brief Function that checks the geometry of a disk.
+ *
+ * @param sectors The number of sectors.
+ * @param sector_words The number of words of a sector.
+ * @return 0 if both are positive, a sector fits the memory and the disk holds at most MAX_DISK_WORDS words,
+ * 1 otherwise.
+ */
+static int check_geometry(int sectors, int sector_words)
+{
+    return sectors <= 0 || sector_words <= 0 || sector_words > MEM_DEPTH ||
+           (int64_t)sectors * sector_words > MAX_DISK_WORDS;
+}
+
+/**
+ * @brief Function that decodes an instruction acording to the instuction format.
+ *
+ * @param high The first 8 hex digits of the instruction: opcode, rd, rs, rt, rm and the high 8 bits of imm1.
+ * @param low The last 4 hex digits of the instruction: the low 4 bits of imm1 and imm2.
+ * @param opcode A pointer to the opcode. At the end of the run contains the value of the opcode.
+ * @param rd A pointer to the rd register. At the end of the run contains the value of rd.
+ * @param rs A pointer to the rs register. At the end of the run contains the value of rs.
+ * @param rt A pointer to the rt register. At the end of the run contains the value of rt.
+ * @param rm A pointer to the rm register. At the end of the run contains the value of rm.
+ * @param imm1 A pointer to the imm1 register. At the end of the run contains the value of imm1.
+ * @param imm2 A pointer to the imm2 register. At the end of the run contains the value of imm2.
+ */
+static void decode_instruction(unsigned int high, unsigned int low, int *opcode, int *rd, int *rs, int *rt, int *rm,
+                               int *imm1, int *imm2)
+{
+    /* Split the instruction into fields*/
+    *opcode = (int)(high >> 24);
+    *rd = (int)((high >> 20) & 0xF);
+    *rs = (int)((high >> 16) & 0xF);
+    *rt = (int)((high >> 12) & 0xF);
+    *rm = (int)((high >> 8) & 0xF);
+    *imm1 = (int)(((high & 0xFF) << 4) | (low >> 12));
+    if (*imm1 >= 0x800)
+    {
+        *imm1 -= 0x1000;
+    }
+
+    *imm2 = (int)(low & 0xFFF);
+    if (*imm2 >= 0x800)
+    {
+        *imm2 -= 0x1000;
+    }
+}
+
+/**
+ * @brief Function that returns the source an operand reads from.
+ * $imm1 and $imm2 resolve to the immediate fields of the instruction, every other register to cpu_registers.
+ *
+ * @param m The simulated machine.
+ * @param inst The decoded instruction that holds the immediate fields.
+ * @param reg The register number of the operand.
+ * @return A pointer to the value of the operand.
+ */
+static const int *resolve_operand(SimMachine *m, Instruction *inst, int reg)
+{
+    if (reg == 1)
+    {
+        return &inst->imm1;
+    }
+    else if (reg == 2)
+    {
+        return &inst->imm2;
+    }
+    else
+    {
+        return &m->cpu_registers[reg];
+    }
+}
+
+/**
+ * @brief Function that selects the handler of a decoded instruction and binds its operands.
+ * It runs once per instruction when imemin.txt is loaded, so the fetch-decode-execute loop calls
+ * the handler directly and never tests the opcode or whether an operand is an immediate again.
+ *
+ * @param m The simulated machine.
+ * @param inst The decoded instruction.
+ */
+static void bind_instruction(SimMachine *m, Instruction *inst)
+{
+    static const Handler handlers[OPCODE_NUM] = {add, sub, mac, and_func, or_func, xor_func, sll, sra, srl,
+                                                 beq, bne, blt, bgt, ble, bge, jal, lw, sw, reti, in, out, halt};
+
+    inst->execute = (inst->opcode >= 0 && inst->opcode < OPCODE_NUM) ? handlers[inst->opcode] : invalid_opcode;
+    inst->rd_val = resolve_operand(m, inst, inst->rd);
+    inst->rs_val = resolve_operand(m, inst, inst->rs);
+    inst->rt_val = resolve_operand(m, inst, inst->rt);
+    inst->rm_val = resolve_operand(m, inst, inst->rm);
+}
+
+/**
+ * @brief Function performing add instruction. The function increases the program counter by one.
+ *
+ * @param m The simulated machine.
+ * @param inst The decoded instruction.
+ */
+static void add(SimMachine *m, const Instruction *inst)
+{
+    int rs_val = *inst->rs_val;
+    int rt_val = *inst->rt_val;
+    int rm_val = *inst->rm_val;
+    m->cpu_registers[inst->rd] = rs_val + rt_val + rm_val;
+    m->pc++;
+}
+/**
+ * @brief Function performing sub instruction. The function increases the program counter by one.
+ *
+ * @param m The simulated machine.
+ * @param inst The decoded instruction.
+ */
+static void sub(SimMachine *m, const Instruction *inst)
+{
+    int rs_val = *inst->rs_val;
+    int rt_val = *inst->rt_val;
+    int rm_val = *inst->rm_val;
+    m->cpu_registers[inst->rd] = rs_val - rt_val - rm_val;
+    m->pc++;
+}
+/**
+ * @brief Function performing mac instruction. The function increases the program counter by one.
+ *
+ * @param m The simulated machine.
+ * @param inst The decoded instruction.
+ */
+static void mac(SimMachine *m, const Instruction *inst)
+{
+    int rs_val = *inst->rs_val;
+    int rt_val = *inst->rt_val;
+    int rm_val = *inst->rm_val;
+    m->cpu_registers[inst->rd] = (rs_val * rt_val) + rm_val;
+    m->pc++;
+}
+/**
+ * @brief Function performing and instruction. The function increases the program counter by one.
+ *
+ * @param m The simulated machine.
+ * @param inst The decoded instruction.
+ */
+static void and_func(SimMachine *m, const Instruction *inst)
+{
+    int rs_val = *inst->rs_val;
+    int rt_val = *inst->rt_val;
+    int rm_val = *inst->rm_val;
+    m->cpu_registers[inst->rd] = rs_val & rt_val & rm_val;
+    m->pc++;
+}
+/**
+ * @brief Function performing or instruction. The function increases the program counter by one.
+ *
+ * @param m The simulated machine.
+ * @param inst The decoded instruction.
+ */
+static void or_func(SimMachine *m, const Instruction *inst)
+{
+    int rs_val = *inst->rs_val;
+    int rt_val = *inst->rt_val;
+    int rm_val = *inst->rm_val;
+    m->cpu_registers[inst->rd] = rs_val | rt_val | rm_val;
+    m->pc++;
+}
+/**
+ * @brief Function performing xor instruction. The function increases the program counter by one.
+ *
+ * @param m The simulated machine.
+ * @param inst The decoded instruction.
+ */
+static void xor_func(SimMachine *m, const Instruction *inst)
+{
+    int rs_val = *inst->rs_val;
+    int rt_val = *inst->rt_val;
+    int rm_val = *inst->rm_val;
+    m->cpu_registers[inst->rd] = rs_val ^ rt_val ^ rm_val;
+    m->pc++;
+}
+/**
+ * @brief Function performing sll instruction. The function increases the program counter by one.
+ *
+ * @param m The simulated machine.
+ * @param inst The decoded instruction.
+ */
+static void sll(SimMachine *m, const Instruction *inst)
+{
+    int rs_val = *inst->rs_val;
+    int rt_val = *inst->rt_val;
+    m->cpu_registers[inst->rd] = rs_val << rt_val;
+    m->pc++;
+}
+/**
+ * @brief Function performing sra instruction. The function increases the program counter by one.
+ *
+ * @param m The simulated machine.
+ * @param inst The decoded instruction.
+ */
+static void sra(SimMachine *m, const Instruction *inst)
+{
+    int rs_val = *inst->rs_val;
+    int rt_val = *inst->rt_val;
+    m->cpu_registers[inst->rd] = rs_val >> rt_val;
+    m->pc++;
+}
+/**
+ * @brief Function performing srl instruction. The function increases the program counter by one.
+ *
+ * @param m The simulated machine.
+ * @param inst The decoded instruction.
+ */
+static void srl(SimMachine *m, const Instruction *inst)
+{
+    int rs_val = *inst->rs_val;
+    int rt_val = *inst->rt_val;
+    m->cpu_registers[inst->rd] = (unsigned int)rs_val >> rt_val;
+    m->pc++;
+}
+/**
+ * @brief Function performing beq instruction.
+ * The function changes the program counter to the correct address if the condition is met,
+ * and increases the program counter by one if not.
+ *
+ * @param m The simulated machine.
+ * @param inst The decoded instruction.
+ */
+static void beq(SimMachine *m, const Instruction *inst)
+{
+    if (*inst->rs_val == *inst->rt_val)
+    {
+        m->pc = *inst->rm_val & 0xfff;
+    }
+    else
+    {
+        m->pc++;
+    }
+}
+/**
+ * @brief Function performing bne instruction.
+ * The function changes the program counter to the correct address if the condition is met,
+ * and increases the program counter by one if not.
+ *
+ * @param m The simulated machine.
+ * @param inst The decoded instruction.
+ */
+static void bne(SimMachine *m, const Instruction *inst)
+{
+    if (*inst->rs_val != *inst->rt_val)
+    {
+        m->pc = *inst->rm_val & 0xfff;
+    }
+    else
+    {
+        m->pc++;
+    }
+}
+/**
+ * @brief Function performing blt instruction.
+ * The function changes the program counter to the correct address if the condition is met,
+ * and increases the program counter by one if not.
+ *
+ * @param m The simulated machine.
+ * @param inst The decoded instruction.
+ */
+static void blt(SimMachine *m, const Instruction *inst)
+{
+    if (*inst->rs_val < *inst->rt_val)
+    {
+        m->pc = *inst->rm_val & 0xfff;
+    }
+    else
+    {
+        m->pc++;
+    }
+}
+/**
+ * @brief Function performing bgt instruction.
+ * The function changes the program counter to the correct address if the condition is met,
+ * and increases the program counter by one if not.
+ *
+ * @param m The simulated machine.
+ * @param inst The decoded instruction.
+ */
+static void bgt(SimMachine *m, const Instruction *inst)
+{
+    if (*inst->rs_val > *inst->rt_val)
+    {
+        m->pc = *inst->rm_val & 0xfff;
+    }
+    else
+    {
+        m->pc++;
+    }
+}
+/**
+ * @brief Function performing ble instruction.
+ * The function changes the program counter to the correct address if the condition is met,
+ * and increases the program counter by one if not.
+ *
+ * @param m The simulated machine.
+ * @param inst The decoded instruction.
+ */
+static void ble(SimMachine *m, const Instruction *inst)
+{
+    if (*inst->rs_val <= *inst->rt_val)
+    {
+        m->pc = *inst->rm_val & 0xfff;
+    }
+    else
+    {
+        m->pc++;
+    }
+}
+/**
+ * @brief Function performing bge instruction.
+ * The function changes the program counter to the correct address if the condition is met,
+ * and increases the program counter by one if not.
+ *
+ * @param m The simulated machine.
+ * @param inst The decoded instruction.
+ */
+static void bge(SimMachine *m, const Instruction *inst)
+{
+    if (*inst->rs_val >= *inst->rt_val)
+    {
+        m->pc = *inst->rm_val & 0xfff;
+    }
+    else
+    {
+        m->pc++;
+    }
+}
+/**
+ * @brief Function performing jal instruction.
+ * The function saves the next instruction address in registers[rd],
+ * and updates the program counter to be the 12 lower bits of rm.
+ *
+ * @param m The simulated machine.
+ * @param inst The decoded instruction.
+ */
+static void jal(SimMachine *m, const Instruction *inst)
+{
+    int rm_val = *inst->rm_val;
+    m->cpu_registers[inst->rd] = m->pc + 1;
+    m->pc = rm_val & 0xfff;
+}
+
+/**
+ * @brief Function performing lw instruction.
+ * The function loads a word from the memory and stores it in registers[rd].
+ * The address is taken modulo the depth of the memory, so it cannot reach the rest of the machine.
+ * The function increases the program counter by one.
+ *
+ * @param m The simulated machine.
+ * @param inst The decoded instruction.
+ */
+static void lw(SimMachine *m, const Instruction *inst)
+{
+    m->cpu_registers[inst->rd] = m->memory[(unsigned int)(*inst->rs_val + *inst->rt_val) & MEM_MASK] + *inst->rm_val;
+    m->pc++;
+}
+
+/**
+ * @brief Function performing sw instruction.
+ * The function stores a word to the memory at location rm+rd.
+ * The address is taken modulo the depth of the memory, so it cannot reach the rest of the machine.
+ * The function increases the program counter by one.
+ *
+ * @param m The simulated machine.
+ * @param inst The decoded instruction.
+ */
+static void sw(SimMachine *m, const Instruction *inst)
+{
+    int i = (int)((unsigned int)(*inst->rs_val + *inst->rt_val) & MEM_MASK);
+    m->memory[i] = *inst->rm_val + *inst->rd_val;
+    /*Updtae maximum depth of memory.*/
+    if (i + 1 > m->depth)
+    {
+        m->depth = i + 1;
+    }
+    m->pc++;
+}
+
+/**
+ * @brief Function performing reti instruction. The function updates the program counter to be io_registers[7],
+ * and sets in_isr=FALSE, indicating the processor finished handling the interrupt.
+ *
+ * @param m The simulated machine.
+ * @param inst The decoded instruction.
+ */
+static void reti(SimMachine *m, const Instruction *inst)
+{
+    (void)inst;
+    m->pc = m->io_registers[7] & MEM_MASK;
+    m->in_isr = FALSE;
+    /*A pending interrupt can be taken again.*/
+    m->schedule_valid = FALSE;
+}
+
+/**
+ * @brief Function performing in instruction.
+ * The function writes to the hwregtrace.txt output file the operation that was performed.
+ * The function increases the program counter by one.
+ *
+ * @param m The simulated machine.
+ * @param inst The decoded instruction.
+ */
+static void in(SimMachine *m, const Instruction *inst)
+{
+    int reg = *inst->rs_val + *inst->rt_val;
+    int data = (reg >= 0 && reg < IO_REG_NUM) ? m->io_registers[reg] : 0;
+
+    /*A register number outside the io registers reads 0.*/
+    m->cpu_registers[inst->rd] = (reg == 22) ? 0 : data;
+    /*Write to hwregtrace.txt output file.*/
+    write_to_hwregtrace(m, m->io_registers[8], READ, reg, data);
+    m->pc++;
+}
+
+/**
+ * @brief Function performing out instruction.
+ * The function writes to the hwregtrace.txt output file the operation that was performed.
+ * The function also writes to the monitor/disk in the clock cycle in which the monitor/disk was updated.
+ * The function increases the program counter by one.
+ *
+ * @param m The simulated machine.
+ * @param inst The decoded instruction.
+ */
+static void out(SimMachine *m, const Instruction *inst)
+{
+    int rm_val = *inst->rm_val;
+    int reg = *inst->rs_val + *inst->rt_val;
+    int pixel_offset = m->io_registers[20] & MONITOR_MASK;
+    int pixel_row = pixel_offset / PIXELS, pixel_col = pixel_offset % PIXELS;
+
+    /*A register number outside the io registers is not written, so it cannot reach the rest of the machine.*/
+    if (reg >= 0 && reg < IO_REG_NUM)
+    {
+        m->io_registers[reg] = rm_val;
+    }
+    /*Write to hwregtrace.txt output file.*/
+    write_to_hwregtrace(m, m->io_registers[8], WRITE, reg, rm_val);
+
+    /*Interrupt, clock, timer and disk registers change the next scheduled event.*/
+    if (reg <= 8 || (reg >= 11 && reg <= 14) || reg == 17)
+    {
+        m->schedule_valid = FALSE;
+    }
+
+    /*Write to monitor.*/
+    if (reg == 22 && rm_val == 1)
+    {
+        m->monitor[pixel_row][pixel_col] = m->io_registers[21];
+        m->io_registers[reg] = 0;
+        m->max_monitor_offset = (m->max_monitor_offset < pixel_offset) ? pixel_offset : m->max_monitor_offset;
+    }
+    /*Disk operations.*/
+    if (reg == 14 && (rm_val == 1 || rm_val == 2))
+    {
+        m->io_registers[17] = 1;
+        m->disk_cycles = 0;
+    }
+
+    m->pc++;
+}
+
+/**
+ * @brief Function performing halt instruction.
+ * The function changes the cont flag of the machine to be FALSE (=0), indicating that the program has been stopped.
+ *
+ * @param m The simulated machine.
+ * @param inst The decoded instruction.
+ */
+static void halt(SimMachine *m, const Instruction *inst)
+{
+    (void)inst;
+    m->cont = FALSE;
+}
+
+/**
+ * @brief Function for an opcode that is not part of the instruction set.
+ * The instruction has no effect and the program counter is not changed.
+ *
+ * @param m The simulated machine.
+ * @param inst The decoded instruction.
+ */
+static void invalid_opcode(SimMachine *m, const Instruction *inst)
+{
+    (void)m;
+    (void)inst;
+}
+
+/**
+ * @brief Function that passes text to the receiver of an output stream, if it has one,
+ * and counts it in the position of the stream.
+ *
+ * @param m The simulated machine.
+ * @param stream The output stream.
+ * @param text The text, one or more complete lines.
+ * @param len The length of the text.
+ */
+static void emit(SimMachine *m, int stream, const char *text, size_t len)
+{
+    if (m->formats[stream] == SIM_FORMAT_BINARY && m->stream_bytes[stream] == 0)
+    {
+        emit_header(m, stream);
+    }
+    m->stream_bytes[stream] += len;
+    if (m->sinks[stream])
+    {
+        m->sinks[stream](m->sink_users[stream], text, len);
+    }
+}
+
+/**
+ * @brief Function that writes the header of a binary output stream, before its first record.
+ * The header of trace.txt holds the text and the immediates of every instruction, so that a record only needs the pc.
+ *
+ * @param m The simulated machine.
+ * @param stream The output stream.
+ */
+static void emit_header(SimMachine *m, int stream)
+{
+    char *header;
+    const Instruction *inst;
+    int len = 0, i, count = stream == SIM_TRACE ? m->instruction_count : 0;
+
+    header = malloc(20 + (size_t)count * (INSTRUCTION_LEN + 8));
+    if (!header)
+    {
+        return;
+    }
+    memcpy(header, SIM_BINARY_MAGIC, 8);
+    len = 8;
+    len += put_word(header + len, SIM_BINARY_VERSION);
+    len += put_word(header + len, (unsigned int)stream);
+    if (stream == SIM_TRACE)
+    {
+        len += put_word(header + len, (unsigned int)count);
+        for (i = 0; i < count; i++)
+        {
+            inst = &m->instructions[i];
+            memset(header + len, 0, INSTRUCTION_LEN);
+            memcpy(header + len, inst->text, strlen(inst->text));
+            len += INSTRUCTION_LEN;
+            len += put_word(header + len, (unsigned int)inst->imm1);
+            len += put_word(header + len, (unsigned int)inst->imm2);
+        }
+    }
+    m->stream_bytes[stream] += len;
+    if (m->sinks[stream])
+    {
+        m->sinks[stream](m->sink_users[stream], header, len);
+    }
+    free(header);
+}
+
+/**
+ * @brief Function that writes a 32 bit word of a binary record in little-endian order.
+ *
+ * @param buf The buffer.
+ * @param value The word.
+ * @return The number of bytes written, 4.
+ */
+static int put_word(char *buf, unsigned int value)
+{
+    buf[0] = (char)(value & 0xFF);
+    buf[1] = (char)((value >> 8) & 0xFF);
+    buf[2] = (char)((value >> 16) & 0xFF);
+    buf[3] = (char)((value >> 24) & 0xFF);
+    return 4;
+}
+
+/**
+ * @brief Function that formats a value as uppercase hex padded with zeros to a number of digits,
+ * like printf("%0*X"). The buffer is not terminated.
+ *
+ * @param buf The buffer, at least 8 characters long.
+ * @param value The value.
+ * @param digits The minimum number of digits, up to 8. A value that needs more digits gets all of them.
+ * @return The end of the digits in the buffer.
+ */
+char *sim_format_hex(char *buf, unsigned int value, int digits)
+{
+    int i;
+    if (digits < 1)
+    {
+        digits = 1;
+    }
+    while (digits < 8 && (value >> (4 * digits)) != 0)
+    {
+        digits++;
+    }
+    if (digits >= 8)
+    {
+        return put_hex8(buf, value);
+    }
+    for (i = digits - 1; i >= 0; i--)
+    {
+        buf[i] = hex_pairs[2 * (value & 0xF) + 1];
+        value >>= 4;
+    }
+    return buf + digits;
+}
+
+/**
+ * @brief Function that formats a 32 bit value as 8 uppercase hex digits.
+ * With SSE2 the 8 nibbles are spread to one byte each and turned to digits together,
+ * otherwise each byte is looked up in hex_pairs.
+ *
+ * @param buf The buffer, at least 8 characters long.
+ * @param value The value.
+ * @return The end of the digits in the buffer.
+ */
+static char *put_hex8(char *buf, unsigned int value)
+{
+#ifdef SIM_HEX_SSE2
+    /*Reverse the bytes so the highest one comes first, then interleave the high and low nibble of each byte.*/
+    unsigned int swapped = (value >> 24) | ((value >> 8) & 0xFF00) | ((value << 8) & 0xFF0000) | (value << 24);
+    __m128i bytes = _mm_cvtsi32_si128((int)swapped), low_nibble = _mm_set1_epi8(0x0F), nibbles, digits;
+    nibbles = _mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi16(bytes, 4), low_nibble), _mm_and_si128(bytes, low_nibble));
+    /*'0' + n for 0 to 9, and 7 more to reach 'A' for 10 to 15.*/
+    digits = _mm_add_epi8(nibbles, _mm_set1_epi8('0'));
+    digits = _mm_add_epi8(digits, _mm_and_si128(_mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9)), _mm_set1_epi8(7)));
+    _mm_storel_epi64((__m128i *)buf, digits);
+#else
+    memcpy(buf, hex_pairs + 2 * (value >> 24), 2);
+    memcpy(buf + 2, hex_pairs + 2 * ((value >> 16) & 0xFF), 2);
+    memcpy(buf + 4, hex_pairs + 2 * ((value >> 8) & 0xFF), 2);
+    memcpy(buf + 6, hex_pairs + 2 * (value & 0xFF), 2);
+#endif
+    return buf + 8;
+}
+
+/**
+ * @brief Function that writes to the trace.txt output stream.
+ * The line is not formatted when the stream is discarded or the instruction is filtered out,
+ * which only costs a few tests of the state of the filters.
+ *
+ * @param m The simulated machine.
+ * @param instruction The current instruction.
+ * @param imm1 The value of the first immediate value.
+ * @param imm2 The value of the second immediate value.
+ */
+static void write_to_trace(SimMachine *m, const char *instruction, int imm1, int imm2)
+{
+    char line[TRACE_LINE_LEN];
+    int len;
+    if (!m->sinks[SIM_TRACE] || !m->trace_on || !m->traced_pcs[m->pc])
+    {
+        return;
+    }
+    if (m->trace_sample > 0)
+    {
+        m->trace_sample--;
+        return;
+    }
+    m->trace_sample = m->trace_every - 1;
+    len = format_trace(m, line, m->pc, instruction, imm1, imm2);
+    emit(m, SIM_TRACE, line, len);
+}
+
+/**
+ * @brief Function that formats a line of trace.txt into a buffer.
+ * In a binary trace the line is a record that holds the address and only the registers that changed
+ * since the record before, the instruction and its immediates are found from the address in the header.
+ *
+ * @param m The simulated machine.
+ * @param buf The buffer, at least TRACE_LINE_LEN characters long.
+ * @param address The address of the instruction.
+ * @param instruction The current instruction.
+ * @param imm1 The value of the first immediate value.
+ * @param imm2 The value of the second immediate value.
+ * @return The length of the line.
+ */
+static int format_trace(SimMachine *m, char *buf, int address, const char *instruction, int imm1, int imm2)
+{
+    unsigned int mask = 0;
+    char *p;
+    int i, len;
+    if (m->formats[SIM_TRACE] == SIM_FORMAT_BINARY)
+    {
+        len = 4;
+        for (i = 3; i < CPU_REG_NUM; i++)
+        {
+            if (m->cpu_registers[i] != m->trace_registers[i])
+            {
+                mask |= 1U << (i - 3);
+                m->trace_registers[i] = m->cpu_registers[i];
+                len += put_word(buf + len, (unsigned int)m->cpu_registers[i]);
+            }
+        }
+        put_word(buf, (unsigned int)address | (mask << TRACE_MASK_SHIFT));
+        return len;
+    }
+    /*The line is "%03X %s 00000000 %08X %08X " followed by "%08X " for each of $v0 to $ra, built without printf.*/
+    p = sim_format_hex(buf, (unsigned int)address, 3);
+    *p++ = ' ';
+    len = (int)strlen(instruction);
+    memcpy(p, instruction, len);
+    p += len;
+    memcpy(p, " 00000000 ", 10);
+    p = put_hex8(p + 10, (unsigned int)imm1);
+    *p++ = ' ';
+    p = put_hex8(p, (unsigned int)imm2);
+    *p++ = ' ';
+    for (i = 3; i < CPU_REG_NUM; i++)
+    {
+        p = put_hex8(p, (unsigned int)m->cpu_registers[i]);
+        *p++ = ' ';
+    }
+    *p++ = '\n';
+    return (int)(p - buf);
+}
+
+/**
+ * @brief Function that writes to the hwregtrace.txt output stream, unless the instruction at the program counter
+ * is filtered out of the trace.
+ * The function also writes to leds.txt and display7seg.txt output streams during the clock cycle
+ * in which a write has changed the corresponding registers, which are never filtered.
+ *
+ * @param m The simulated machine.
+ * @param cycle The clock cycle in which the operation is performed.
+ * @param action The action that is performed (READ or WRITE).
+ * @param reg_num The number of the hardware register.
+ * @param data The data that was read from or written to the register.
+ */
+static void write_to_hwregtrace(SimMachine *m, int cycle, char *action, int reg_num, int data)
+{
+    if (m->trace_on && m->traced_pcs[m->pc])
+    {
+        emit_hwregtrace(m, cycle, action, reg_num, data);
+    }
+    if (strcmp(action, WRITE) == 0)
+    {
+        if (reg_num == 9)
+        {
+            /*Write to leds.txt output stream.*/
+            write_to_leds_and_display(m, SIM_LEDS, cycle, data);
+        }
+        if (reg_num == 10)
+        {
+            /*Write to display7seg.txt output stream.*/
+            write_to_leds_and_display(m, SIM_DISPLAY7SEG, cycle, data);
+        }
+    }
+}
+
+/**
+ * @brief Function that formats a line of hwregtrace.txt and writes it to the stream.
+ *
+ * @param m The simulated machine.
+ * @param cycle The clock cycle in which the operation is performed.
+ * @param action The action that is performed (READ or WRITE).
+ * @param reg_num The number of the hardware register.
+ * @param data The data that was read from or written to the register.
+ */
+static void emit_hwregtrace(SimMachine *m, int cycle, char *action, int reg_num, int data)
+{
+    char line[64];
+    int len;
+    if (m->sinks[SIM_HWREGTRACE] && m->formats[SIM_HWREGTRACE] == SIM_FORMAT_BINARY)
+    {
+        len = put_word(line, (unsigned int)cycle);
+        line[len] = (char)(reg_num >= 0 && reg_num < IO_REG_NUM ? reg_num : 0x7F);
+        line[len++] |= (char)(strcmp(action, WRITE) == 0 ? 0x80 : 0);
+        len += put_word(line + len, (unsigned int)data);
+        emit(m, SIM_HWREGTRACE, line, len);
+    }
+    else if (m->sinks[SIM_HWREGTRACE])
+    {
+        len = sprintf(line, "%d %s %s %08X\n", cycle, action, find_io_reg(reg_num), data & 0xFFFFFFFF);
+        emit(m, SIM_HWREGTRACE, line, len);
+    }
+}
+
+/**
+ * @brief Function that finds the name of the io register based on the number of the register.
+ * @param reg_num The number of the io register.
+ * @return The name of the io register.
+ */
+static char *find_io_reg(int reg_num)
+{
+    char *name = "";
+    if (reg_num == 0)
+    {
+        name = "irq0enable";
+    }
+    else if (reg_num == 1)
+    {
+        name = "irq1enable";
+    }
+    else if (reg_num == 2)
+    {
+        name = "irq2enable";
+    }
+    else if (reg_num == 3)
+    {
+        name = "irq0status";
+    }
+    else if (reg_num == 4)
+    {
+        name = "irq1status";
+    }
+    else if (reg_num == 5)
+    {
+        name = "irq2status";
+    }
+    else if (reg_num == 6)
+    {
+        name = "irqhandler";
+    }
+    else if (reg_num == 7)
+    {
+        name = "irqreturn";
+    }
+    else if (reg_num == 8)
+    {
+        name = "clks";
+    }
+    else if (reg_num == 9)
+    {
+        name = "leds";
+    }
+    else if (reg_num == 10)
+    {
+        name = "display7seg";
+    }
+    else if (reg_num == 11)
+    {
+        name = "timerenable";
+    }
+    else if (reg_num == 12)
+    {
+        name = "timercurrent";
+    }
+    else if (reg_num == 13)
+    {
+        name = "timermax";
+    }
+    else if (reg_num == 14)
+    {
+        name = "diskcmd";
+    }
+    else if (reg_num == 15)
+    {
+        name = "disksector";
+    }
+    else if (reg_num == 16)
+    {
+        name = "diskbuffer";
+    }
+    else if (reg_num == 17)
+    {
+        name = "diskstatus";
+    }
+    else if (reg_num == 20)
+    {
+        name = "monitoraddr";
+    }
+    else if (reg_num == 21)
+    {
+        name = "monitordata";
+    }
+    else if (reg_num == 22)
+    {
+        name = "monitorcmd";
+    }
+
+    return name;
+}
+
+/**
+ * @brief Function for writing to leds.txt or display7seg.txt output streams.
+ * The function writes to one of the streams based on the register that was changed during the current clock cycle.
+ *
+ * @param m The simulated machine.
+ * @param stream One of the output streams: SIM_LEDS or SIM_DISPLAY7SEG.
+ * @param cycle The clock cycle in which the change has occurred.
+ * @param status The status of the register (leds register or dispay7seg register).
+ */
+static void write_to_leds_and_display(SimMachine *m, int stream, int cycle, int status)
+{
+    char line[32];
+    int len;
+    if (m->sinks[stream] && m->formats[stream] == SIM_FORMAT_BINARY)
+    {
+        len = put_word(line, (unsigned int)cycle);
+        len += put_word(line + len, (unsigned int)status);
+        emit(m, stream, line, len);
+    }
+    else if (m->sinks[stream])
+    {
+        len = sprintf(line, "%d %08X\n", cycle, status & 0xFFFFFFFF);
+        emit(m, stream, line, len);
+    }
+}
@@ -0,0 +1,162 @@
+#ifndef LIBSIMP_H
+#define LIBSIMP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*Constants of the SIMP machine*/
+
+#define SIM_MEM_DEPTH 4096
+#define SIM_CPU_REG_NUM 16
+#define SIM_IO_REG_NUM 23
+#define SIM_PIXELS 256
+#define SIM_DISK_SECTORS 128              /*Default geometry of the disk, set with sim_set_disk_geometry*/
+#define SIM_DISK_SECTOR_WORDS 128
+
+/*Output streams written while the program runs, each one is the text of the matching output file.*/
+
+#define SIM_TRACE 0
+#define SIM_HWREGTRACE 1
+#define SIM_LEDS 2
+#define SIM_DISPLAY7SEG 3
+#define SIM_STREAM_NUM 4
+
+/*Formats of the output streams, set with sim_set_format.
+  A binary stream starts with a header: the 8 bytes of SIM_BINARY_MAGIC, then SIM_BINARY_VERSION and the stream
+  as 32 bit words, and for trace.txt the number of instructions followed by the text of each one, 12 bytes padded
+  with '\0', and its two sign extended immediates. Records follow the header, every number in little-endian order:
+  - trace.txt: a 32 bit word with the pc in bits 0-11 and in bits 12-24 a mask of the registers $v0 to $ra
+    whose values changed since the record before, followed by the new value of each of them.
+  - hwregtrace.txt: the cycle, a byte with the io register in bits 0-6 (127 for a number outside the io registers)
+    and bit 7 set for WRITE, and the data.
+  - leds.txt and display7seg.txt: the cycle and the value.
+  simtrace2txt converts a binary stream back to the text of the output file.*/
+
+#define SIM_FORMAT_TEXT 0
+#define SIM_FORMAT_BINARY 1
+#define SIM_BINARY_MAGIC "SIMPBTRC"
+#define SIM_BINARY_VERSION 1
+
+/*Filters of trace.txt and hwregtrace.txt. An instruction is traced if its address passes the address ranges,
+  its cycle is inside the window and the trigger has fired, and of the traced instructions trace.txt may only
+  keep a sample. leds.txt and display7seg.txt are never filtered.*/
+
+#define SIM_TRIGGER_NONE -1
+
+/*Conditions of sim_run_until.*/
+
+#define SIM_UNTIL_HALT 0
+#define SIM_UNTIL_CYCLE 1
+#define SIM_UNTIL_PC 2
+
+/*Status returned by sim_step and sim_run_until.*/
+
+#define SIM_RUNNING 0
+#define SIM_HALTED 1
+#define SIM_ERROR -1
+
+/*A simulated machine. Every machine is independent, so several of them can run in one process or thread.*/
+typedef struct SimMachine SimMachine;
+
+/*Receives the text of an output stream: one or more complete lines, not terminated by '\0',
+  or one or more complete records of a binary stream.*/
+typedef void (*SimSink)(void *user, const char *text, size_t len);
+
+/*Reads up to size bytes of an input file into buf, returning how many, or 0 at its end or on an error.*/
+typedef size_t (*SimReader)(void *user, char *buf, size_t size);
+
+/*Creating and destroying machines.*/
+
+SimMachine *sim_create(void);
+void sim_destroy(SimMachine *m);
+
+/*Loading the images. Each one is the text of the matching input file and may end lines with LF or CRLF.
+  imemin.txt holds an instruction of 12 hex digits per line, dmemin.txt and diskin.txt a word of 1 to 8 hex digits,
+  blank lines are skipped, and a loader fails on any other line, which sim_load_error then tells.
+  irq2in.txt holds decimal cycle numbers of up to 64 bits separated by white space. sim_load_irq2 sorts them,
+  sim_stream_irq2 reads them while the program runs, a few thousand at a time, and needs them in increasing order.
+  The disk is sparse: only the sectors that were loaded or written take memory. In place of diskin.txt it may be an
+  image of the whole disk attached with sim_attach_disk, which is never written, so one image is shared by many runs,
+  and the sectors the program wrote are the dirty ones, which sim_disk_dirty tells.*/
+
+int sim_load_imem(SimMachine *m, const char *text, size_t len);
+int sim_load_instructions(SimMachine *m, const uint64_t *words, int count);
+int sim_load_dmem(SimMachine *m, const char *text, size_t len);
+int sim_load_disk(SimMachine *m, const char *text, size_t len);
+int sim_set_disk_geometry(SimMachine *m, int sectors, int sector_words);
+int sim_attach_disk(SimMachine *m, const int32_t *words, int sectors, int sector_words, void (*release)(void *user),
+                    void *user);
+int sim_load_irq2(SimMachine *m, const char *text, size_t len);
+int sim_stream_irq2(SimMachine *m, SimReader read, void (*close)(void *user), void *user);
+int sim_switch_irq2(SimMachine *m, const char *text, size_t len);
+const char *sim_load_error(const SimMachine *m, int *line);
+
+/*Configuring the run.*/
+
+int sim_set_sink(SimMachine *m, int stream, SimSink sink, void *user);
+int sim_set_format(SimMachine *m, int stream, int format);
+int sim_get_format(const SimMachine *m, int stream);
+int sim_set_jit(SimMachine *m, int enabled);
+int sim_trace_pc_range(SimMachine *m, int first, int last, int include);
+int sim_trace_cycles(SimMachine *m, uint64_t start, uint64_t stop);
+int sim_trace_sample(SimMachine *m, unsigned int every);
+int sim_trace_trigger(SimMachine *m, int irq);
+
+/*Running.*/
+
+int sim_step(SimMachine *m, unsigned int cycles);
+int sim_run_until(SimMachine *m, int condition, unsigned int value);
+int sim_halted(const SimMachine *m);
+
+/*Inspecting and changing the machine.*/
+
+int sim_get_pc(const SimMachine *m);
+unsigned int sim_get_cycles(const SimMachine *m);
+uint64_t sim_cycles_run(const SimMachine *m);
+int sim_get_register(const SimMachine *m, int reg);
+int sim_set_register(SimMachine *m, int reg, int value);
+int sim_get_io_register(const SimMachine *m, int reg);
+int sim_set_io_register(SimMachine *m, int reg, int value);
+int sim_read_memory(const SimMachine *m, int address);
+int sim_write_memory(SimMachine *m, int address, int value);
+int sim_memory_depth(const SimMachine *m);
+int sim_read_disk(const SimMachine *m, int sector, int offset);
+int sim_read_sector(const SimMachine *m, int sector, int32_t *words);
+int sim_disk_sectors(const SimMachine *m);
+int sim_disk_sector_words(const SimMachine *m);
+int sim_disk_attached(const SimMachine *m);
+int sim_disk_dirty(const SimMachine *m, int sector);
+int sim_disk_lost_writes(const SimMachine *m);
+int sim_disk_extent(const SimMachine *m);
+int sim_disk_cycles_left(const SimMachine *m);
+int sim_read_pixel(const SimMachine *m, int row, int col);
+int sim_monitor_extent(const SimMachine *m);
+uint64_t sim_stream_bytes(const SimMachine *m, int stream);
+
+/*Programs in predecoded form, with their basic blocks, loaded again without parsing or analysis.*/
+
+size_t sim_program_size(const SimMachine *m);
+int sim_save_program(const SimMachine *m, void *buf, size_t size);
+int sim_restore_program(SimMachine *m, const void *buf, size_t size);
+
+/*Checkpoints of the complete state of a program, restored on a machine with the same instructions, disk geometry and
+  disk image, and an irq 2 schedule that starts with the entries triggered before the checkpoint. A checkpoint holds
+  the sectors of the disk that were loaded or written, so its size grows as the program writes new sectors.*/
+
+size_t sim_checkpoint_size(const SimMachine *m);
+int sim_save_checkpoint(const SimMachine *m, void *buf, size_t size);
+int sim_restore_checkpoint(SimMachine *m, const void *buf, size_t size);
+
+/*Formatting values as in the output files.*/
+
+char *sim_format_hex(char *buf, unsigned int value, int digits);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,203 @@
+#ifndef LIBSIMP_HPP
+#define LIBSIMP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <new>
+#include <string>
+#include <vector>
+#include "libsimp.h"
+
+namespace simp
+{
+
+/*Receives the text of an output stream.*/
+typedef std::function<void(const char *text, std::size_t len)> Sink;
+
+/*A simulated machine that is freed with its owner. Machines can be moved but not copied.*/
+class Machine
+{
+public:
+    /**
+     * @brief Constructor that creates a machine in its initial state.
+     * Throws std::bad_alloc if the machine cannot be allocated.
+     */
+    Machine() : m_(sim_create())
+    {
+        if (!m_)
+        {
+            throw std::bad_alloc();
+        }
+    }
+
+    ~Machine()
+    {
+        sim_destroy(m_);
+    }
+
+    Machine(Machine &&other) noexcept : m_(other.m_)
+    {
+        other.m_ = nullptr;
+        for (int i = 0; i < SIM_STREAM_NUM; i++)
+        {
+            sinks_[i] = std::move(other.sinks_[i]);
+            rebind(i);
+        }
+    }
+
+    Machine &operator=(Machine &&other) noexcept
+    {
+        if (this != &other)
+        {
+            sim_destroy(m_);
+            m_ = other.m_;
+            other.m_ = nullptr;
+            for (int i = 0; i < SIM_STREAM_NUM; i++)
+            {
+                sinks_[i] = std::move(other.sinks_[i]);
+                rebind(i);
+            }
+        }
+        return *this;
+    }
+
+    Machine(const Machine &) = delete;
+    Machine &operator=(const Machine &) = delete;
+
+    /*Loading the images, each one is the text of the matching input file. Return 0 on success, 1 on failure.*/
+
+    int load_imem(const std::string &text) { return sim_load_imem(m_, text.data(), text.size()); }
+    int load_instructions(const std::uint64_t *words, int count) { return sim_load_instructions(m_, words, count); }
+    int load_dmem(const std::string &text) { return sim_load_dmem(m_, text.data(), text.size()); }
+    int load_disk(const std::string &text) { return sim_load_disk(m_, text.data(), text.size()); }
+    int set_disk_geometry(int sectors, int sector_words) { return sim_set_disk_geometry(m_, sectors, sector_words); }
+    /*The image is only read, and must outlive the machine or the next load_disk.*/
+    int attach_disk(const std::int32_t *words, int sectors, int sector_words)
+    {
+        return sim_attach_disk(m_, words, sectors, sector_words, nullptr, nullptr);
+    }
+    int load_irq2(const std::string &text) { return sim_load_irq2(m_, text.data(), text.size()); }
+    int switch_irq2(const std::string &text) { return sim_switch_irq2(m_, text.data(), text.size()); }
+    /*The stream is read while the program runs, so it must outlive the run or the next load_irq2.*/
+    int stream_irq2(std::istream &in) { return sim_stream_irq2(m_, read_stream, nullptr, &in); }
+    const char *load_error(int *line = nullptr) const { return sim_load_error(m_, line); }
+
+    /**
+     * @brief Function that sets the receiver of an output stream, an empty receiver discards the stream.
+     *
+     * @param stream SIM_TRACE, SIM_HWREGTRACE, SIM_LEDS or SIM_DISPLAY7SEG.
+     * @param sink The receiver.
+     * @return 0 on success, 1 for an unknown stream.
+     */
+    int set_sink(int stream, Sink sink)
+    {
+        if (stream < 0 || stream >= SIM_STREAM_NUM)
+        {
+            return 1;
+        }
+        sinks_[stream] = std::move(sink);
+        rebind(stream);
+        return 0;
+    }
+
+    int set_format(int stream, int format) { return sim_set_format(m_, stream, format); }
+    int set_jit(bool enabled) { return sim_set_jit(m_, enabled ? 1 : 0); }
+    int trace_pc_range(int first, int last, bool include = true) { return sim_trace_pc_range(m_, first, last, include ? 1 : 0); }
+    int trace_cycles(std::uint64_t start, std::uint64_t stop = UINT64_MAX) { return sim_trace_cycles(m_, start, stop); }
+    int trace_sample(unsigned int every) { return sim_trace_sample(m_, every); }
+    int trace_trigger(int irq) { return sim_trace_trigger(m_, irq); }
+
+    /*Running, see sim_step and sim_run_until.*/
+
+    int step(unsigned int cycles) { return sim_step(m_, cycles); }
+    int run_until(int condition, unsigned int value = 0) { return sim_run_until(m_, condition, value); }
+    int run() { return sim_run_until(m_, SIM_UNTIL_HALT, 0); }
+    bool halted() const { return sim_halted(m_) != 0; }
+
+    /*Inspecting and changing the machine.*/
+
+    int pc() const { return sim_get_pc(m_); }
+    unsigned int cycles() const { return sim_get_cycles(m_); }
+    std::uint64_t cycles_run() const { return sim_cycles_run(m_); }
+    int reg(int r) const { return sim_get_register(m_, r); }
+    int set_reg(int r, int value) { return sim_set_register(m_, r, value); }
+    int io_reg(int r) const { return sim_get_io_register(m_, r); }
+    int set_io_reg(int r, int value) { return sim_set_io_register(m_, r, value); }
+    int read_memory(int address) const { return sim_read_memory(m_, address); }
+    int write_memory(int address, int value) { return sim_write_memory(m_, address, value); }
+    int memory_depth() const { return sim_memory_depth(m_); }
+    int read_disk(int sector, int offset) const { return sim_read_disk(m_, sector, offset); }
+    int read_sector(int sector, std::int32_t *words) const { return sim_read_sector(m_, sector, words); }
+    int disk_sectors() const { return sim_disk_sectors(m_); }
+    int disk_sector_words() const { return sim_disk_sector_words(m_); }
+    bool disk_attached() const { return sim_disk_attached(m_) != 0; }
+    bool disk_dirty(int sector) const { return sim_disk_dirty(m_, sector) != 0; }
+    int disk_lost_writes() const { return sim_disk_lost_writes(m_); }
+    int disk_extent() const { return sim_disk_extent(m_); }
+    int disk_cycles_left() const { return sim_disk_cycles_left(m_); }
+    int read_pixel(int row, int col) const { return sim_read_pixel(m_, row, col); }
+    int monitor_extent() const { return sim_monitor_extent(m_); }
+    std::uint64_t stream_bytes(int stream) const { return sim_stream_bytes(m_, stream); }
+
+    /*Checkpoints, held in 64 bit words to keep them aligned.*/
+
+    std::vector<std::uint64_t> save_checkpoint() const
+    {
+        std::vector<std::uint64_t> checkpoint((sim_checkpoint_size(m_) + 7) / 8);
+        sim_save_checkpoint(m_, checkpoint.data(), checkpoint.size() * 8);
+        return checkpoint;
+    }
+
+    int restore_checkpoint(const std::vector<std::uint64_t> &checkpoint)
+    {
+        return sim_restore_checkpoint(m_, checkpoint.data(), checkpoint.size() * 8);
+    }
+
+    /*Predecoded programs, held in 32 bit words, of which their size is a multiple.*/
+
+    std::vector<std::uint32_t> save_program() const
+    {
+        std::vector<std::uint32_t> program(sim_program_size(m_) / 4);
+        sim_save_program(m_, program.data(), program.size() * 4);
+        return program;
+    }
+
+    int restore_program(const std::vector<std::uint32_t> &program)
+    {
+        return sim_restore_program(m_, program.data(), program.size() * 4);
+    }
+
+    /*The underlying machine, for calls to the C api.*/
+    SimMachine *get() const { return m_; }
+
+private:
+    static void trampoline(void *user, const char *text, std::size_t len)
+    {
+        (*static_cast<Sink *>(user))(text, len);
+    }
+
+    static std::size_t read_stream(void *user, char *buf, std::size_t size)
+    {
+        std::istream &in = *static_cast<std::istream *>(user);
+        in.read(buf, static_cast<std::streamsize>(size));
+        return static_cast<std::size_t>(in.gcount());
+    }
+
+    /*Points the C sink of a stream at the receiver stored in this object.*/
+    void rebind(int stream)
+    {
+        if (m_)
+        {
+            sim_set_sink(m_, stream, sinks_[stream] ? trampoline : nullptr, &sinks_[stream]);
+        }
+    }
+
+    SimMachine *m_;
+    Sink sinks_[SIM_STREAM_NUM];
+};
+
+}
+
+#endif
@@ -0,0 +1,594 @@
+#define _CRT_SECURE_NO_WARNINGS
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libsimp.h"
+#include "simfiles.h"
+
+#ifndef _WIN32
+#define SIMBATCH_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+/*Constants*/
+
+#define MAX_LINE 4096
+#define MAX_WORKERS 256
+#define MANIFEST_FIELDS 5
+
+/*Job struct: one run of the simulator and its result*/
+typedef struct Job
+{
+    char *files[RUN_FILES];  /*File names indexed like the argv of sim*/
+    char *outdir;            /*Directory of the output files*/
+    int status;              /*0 if the job ran and wrote its output files, 1 otherwise*/
+    unsigned int cycles;     /*The number of cycles written to cycles.txt*/
+    double seconds;          /*Wall time of the job, from loading the inputs to writing the outputs*/
+    int worker;              /*The worker that ran the job*/
+} Job;
+
+/*Deque of the jobs of one worker. The owner takes jobs from the bottom, other workers steal from the top.*/
+typedef struct Deque
+{
+#ifdef SIMBATCH_THREADS
+    pthread_mutex_t lock;
+#endif
+    int *jobs;               /*Indices of the jobs in the deque*/
+    int top;                 /*Index of the oldest job in the deque*/
+    int bottom;              /*Index after the newest job in the deque*/
+} Deque;
+
+/*Batch struct: the jobs and the pool of workers that runs them*/
+typedef struct Batch
+{
+    Job *jobs;
+    int job_count;
+    int worker_count;
+    int jit;                 /*Jobs run with the jit if jit is TRUE (1)*/
+    ProgramCache cache;      /*Directory of predecoded programs shared by the jobs, its dir is NULL for none*/
+    Deque *deques;           /*One deque per worker*/
+} Batch;
+
+/*Worker struct: the state of one thread of the pool*/
+typedef struct Worker
+{
+    Batch *batch;
+    int index;
+    int jobs_run;            /*Number of jobs the worker ran*/
+    int steals;              /*Number of those jobs that were stolen from other workers*/
+    unsigned int seed;       /*State of the random choice of victims*/
+} Worker;
+
+/*Function Prototypes*/
+
+/*Functions that read the command line and the manifest.*/
+
+int parse_options(int argc, char *argv[], int *worker_count, int *jit, ProgramCache *cache);
+int default_worker_count(void);
+int read_manifest(const char *manifest_file, Batch *batch);
+int add_job(Batch *batch, char *fields[]);
+void free_jobs(Batch *batch);
+
+/*Functions of the work-stealing pool.*/
+
+int init_deques(Batch *batch);
+void free_deques(Batch *batch);
+int pop_bottom(Deque *deque);
+int steal_top(Deque *deque);
+int next_job(Worker *worker);
+void *run_worker(void *arg);
+int run_pool(Batch *batch, Worker workers[]);
+void run_job(Batch *batch, Job *job);
+
+/*Function that writes the summary at the end of the batch.*/
+
+int write_summary(Batch *batch, Worker workers[], const char *summary_file, double seconds);
+
+int main(int argc, char *argv[])
+{
+    Batch batch;
+    Worker workers[MAX_WORKERS];
+    double start;
+    int count, failed, i;
+
+    memset(&batch, 0, sizeof(batch));
+    count = parse_options(argc, argv, &batch.worker_count, &batch.jit, &batch.cache);
+    if (count < 0)
+    {
+        return 1;
+    }
+    argc -= count;
+    argv += count;
+    if (argc != 3)
+    {
+        fprintf(stderr, "Usage: simbatch [--threads N] [--jit] [--program-cache DIR] manifest.txt summary.txt\n");
+        return 1;
+    }
+    strip_newline(argv[1]);
+    strip_newline(argv[2]);
+
+    /*Read the jobs of the manifest.*/
+    if (read_manifest(argv[1], &batch))
+    {
+        free_jobs(&batch);
+        return 1;
+    }
+    if (batch.worker_count > batch.job_count)
+    {
+        batch.worker_count = batch.job_count > 0 ? batch.job_count : 1;
+    }
+
+    /*Run the jobs on the pool and write the summary.*/
+    start = now_seconds();
+    if (init_deques(&batch) || run_pool(&batch, workers))
+    {
+        free_deques(&batch);
+        free_jobs(&batch);
+        return 1;
+    }
+    failed = write_summary(&batch, workers, argv[2], now_seconds() - start);
+    for (i = 0; i < batch.job_count; i++)
+    {
+        failed |= batch.jobs[i].status;
+    }
+    free_deques(&batch);
+    free_jobs(&batch);
+    return failed ? 1 : 0;
+}
+
+/**
+ * @brief Function that parses the options given before the file names.
+ * --threads N sets the number of workers, which is the number of processors by default,
+ * and --jit runs every job with the jit. --program-cache DIR loads the programs of the jobs through a directory
+ * of predecoded programs, so the jobs that run the same program decode it once, and --program-cache-mb N bounds it.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv The command line arguments.
+ * @param worker_count The number of workers.
+ * @param jit Set to TRUE if the jobs run with the jit.
+ * @param cache The directory of predecoded programs, its dir is set to NULL if there is none.
+ * @return The number of command line arguments taken by the options, or -1 for an invalid option.
+ */
+int parse_options(int argc, char *argv[], int *worker_count, int *jit, ProgramCache *cache)
+{
+    int i;
+    *worker_count = default_worker_count();
+    *jit = FALSE;
+    cache->dir = NULL;
+    cache->max_bytes = (uint64_t)CACHE_MAX_MB << 20;
+    for (i = 1; i < argc && strncmp(argv[i], "--", 2) == 0; i++)
+    {
+        if (strcmp(argv[i], "--jit") == 0)
+        {
+            *jit = TRUE;
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            *worker_count = atoi(argv[++i]);
+            if (*worker_count < 1 || *worker_count > MAX_WORKERS)
+            {
+                fprintf(stderr, "--threads: expected a number from 1 to %d\n", MAX_WORKERS);
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--program-cache") == 0 && i + 1 < argc)
+        {
+            cache->dir = argv[++i];
+        }
+        else if (strcmp(argv[i], "--program-cache-mb") == 0 && i + 1 < argc)
+        {
+            cache->max_bytes = (uint64_t)strtoul(argv[++i], NULL, 10) << 20;
+            if (cache->max_bytes == 0)
+            {
+                fprintf(stderr, "--program-cache-mb: expected a number of megabytes\n");
+                return -1;
+            }
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+#ifndef SIMBATCH_THREADS
+    *worker_count = 1;
+#endif
+    return i - 1;
+}
+
+/**
+ * @brief Function that returns the number of workers used when --threads is not given.
+ *
+ * @return The number of online processors, or 1 if it is not known or threads are not supported.
+ */
+int default_worker_count(void)
+{
+#ifdef SIMBATCH_THREADS
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (count < 1)
+    {
+        return 1;
+    }
+    return count > MAX_WORKERS ? MAX_WORKERS : (int)count;
+#else
+    return 1;
+#endif
+}
+
+/**
+ * @brief Function that reads the jobs of the manifest.
+ * Every line of the manifest is a job: imemin.txt, dmemin.txt, diskin.txt, irq2in.txt and the output directory,
+ * separated by white space. Empty lines and lines starting with # are skipped.
+ *
+ * @param manifest_file The name of the manifest.
+ * @param batch The batch the jobs are added to.
+ * @return 0 on success, 1 on failure.
+ */
+int read_manifest(const char *manifest_file, Batch *batch)
+{
+    FILE *fp = fopen(manifest_file, "r");
+    char line[MAX_LINE], *fields[MANIFEST_FIELDS], *token;
+    int line_number = 0, count;
+    if (!fp)
+    {
+        fprintf(stderr, "Cannot open manifest %s\n", manifest_file);
+        return 1;
+    }
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        line_number++;
+        line[strcspn(line, "\r\n")] = '\0';
+        count = 0;
+        for (token = strtok(line, " \t"); token && count <= MANIFEST_FIELDS; token = strtok(NULL, " \t"))
+        {
+            if (count < MANIFEST_FIELDS)
+            {
+                fields[count] = token;
+            }
+            count++;
+        }
+        if (count == 0 || fields[0][0] == '#')
+        {
+            continue;
+        }
+        if (count != MANIFEST_FIELDS)
+        {
+            fprintf(stderr, "%s:%d: expected imemin dmemin diskin irq2in outdir\n", manifest_file, line_number);
+            fclose(fp);
+            return 1;
+        }
+        if (add_job(batch, fields))
+        {
+            fclose(fp);
+            return 1;
+        }
+    }
+    fclose(fp);
+    return 0;
+}
+
+/**
+ * @brief Function that adds a job to the batch.
+ *
+ * @param batch The batch.
+ * @param fields The fields of the manifest line: the four input files and the output directory.
+ * @return 0 on success, 1 on failure.
+ */
+int add_job(Batch *batch, char *fields[])
+{
+    Job *jobs = realloc(batch->jobs, (batch->job_count + 1) * sizeof(Job)), *job;
+    if (!jobs)
+    {
+        return 1;
+    }
+    batch->jobs = jobs;
+    job = &jobs[batch->job_count++];
+    memset(job, 0, sizeof(Job));
+    job->status = 1;
+    job->outdir = join_path(fields[4], NULL);
+    if (init_run_files(job->files, fields, fields[4]))
+    {
+        return 1;
+    }
+    return job->outdir ? 0 : 1;
+}
+
+/**
+ * @brief Function that frees the jobs of the batch.
+ *
+ * @param batch The batch.
+ */
+void free_jobs(Batch *batch)
+{
+    int i;
+    for (i = 0; i < batch->job_count; i++)
+    {
+        free_run_files(batch->jobs[i].files);
+        free(batch->jobs[i].outdir);
+    }
+    free(batch->jobs);
+    batch->jobs = NULL;
+    batch->job_count = 0;
+}
+
+/**
+ * @brief Function that creates the deques of the workers and deals the jobs to them in turn.
+ * Run lengths are not known in advance, so the deal only gives every worker a start,
+ * and workers that run out of jobs steal from the others.
+ *
+ * @param batch The batch.
+ * @return 0 on success, 1 on failure.
+ */
+int init_deques(Batch *batch)
+{
+    int i;
+    Deque *deque;
+    batch->deques = calloc(batch->worker_count, sizeof(Deque));
+    if (!batch->deques)
+    {
+        return 1;
+    }
+    for (i = 0; i < batch->worker_count; i++)
+    {
+        deque = &batch->deques[i];
+        deque->jobs = malloc((batch->job_count / batch->worker_count + 1) * sizeof(int));
+        if (!deque->jobs)
+        {
+            return 1;
+        }
+#ifdef SIMBATCH_THREADS
+        pthread_mutex_init(&deque->lock, NULL);
+#endif
+    }
+    /*The newest job of a deque is taken first by its owner, so deal the jobs in reverse order.*/
+    for (i = batch->job_count - 1; i >= 0; i--)
+    {
+        deque = &batch->deques[i % batch->worker_count];
+        deque->jobs[deque->bottom++] = i;
+    }
+    return 0;
+}
+
+/**
+ * @brief Function that frees the deques of the workers.
+ *
+ * @param batch The batch.
+ */
+void free_deques(Batch *batch)
+{
+    int i;
+    if (!batch->deques)
+    {
+        return;
+    }
+    for (i = 0; i < batch->worker_count; i++)
+    {
+        if (batch->deques[i].jobs)
+        {
+#ifdef SIMBATCH_THREADS
+            pthread_mutex_destroy(&batch->deques[i].lock);
+#endif
+            free(batch->deques[i].jobs);
+        }
+    }
+    free(batch->deques);
+    batch->deques = NULL;
+}
+
+/**
+ * @brief Function that takes the newest job of a deque, used by its owner.
+ *
+ * @param deque The deque.
+ * @return The index of the job, or -1 if the deque is empty.
+ */
+int pop_bottom(Deque *deque)
+{
+    int job = -1;
+#ifdef SIMBATCH_THREADS
+    pthread_mutex_lock(&deque->lock);
+#endif
+    if (deque->bottom > deque->top)
+    {
+        job = deque->jobs[--deque->bottom];
+    }
+#ifdef SIMBATCH_THREADS
+    pthread_mutex_unlock(&deque->lock);
+#endif
+    return job;
+}
+
+/**
+ * @brief Function that takes the oldest job of a deque, used by workers that steal from it.
+ *
+ * @param deque The deque.
+ * @return The index of the job, or -1 if the deque is empty.
+ */
+int steal_top(Deque *deque)
+{
+    int job = -1;
+#ifdef SIMBATCH_THREADS
+    pthread_mutex_lock(&deque->lock);
+#endif
+    if (deque->bottom > deque->top)
+    {
+        job = deque->jobs[deque->top++];
+    }
+#ifdef SIMBATCH_THREADS
+    pthread_mutex_unlock(&deque->lock);
+#endif
+    return job;
+}
+
+/**
+ * @brief Function that finds the next job of a worker: its own newest job, or else a job stolen from
+ * another worker, starting at a random victim. Jobs are never added during the run,
+ * so once every deque is found empty the worker is done.
+ *
+ * @param worker The worker.
+ * @return The index of the job, or -1 if no job is left.
+ */
+int next_job(Worker *worker)
+{
+    Batch *batch = worker->batch;
+    int job = pop_bottom(&batch->deques[worker->index]), start, i;
+    if (job >= 0 || batch->worker_count == 1)
+    {
+        return job;
+    }
+    worker->seed = worker->seed * 1103515245 + 12345;
+    start = (int)((worker->seed >> 16) % (unsigned int)batch->worker_count);
+    for (i = 0; i < batch->worker_count; i++)
+    {
+        if ((start + i) % batch->worker_count == worker->index)
+        {
+            continue;
+        }
+        job = steal_top(&batch->deques[(start + i) % batch->worker_count]);
+        if (job >= 0)
+        {
+            worker->steals++;
+            return job;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Function that runs jobs on one worker until no job is left.
+ *
+ * @param arg A pointer to the worker.
+ * @return NULL.
+ */
+void *run_worker(void *arg)
+{
+    Worker *worker = arg;
+    int job;
+    while ((job = next_job(worker)) >= 0)
+    {
+        worker->batch->jobs[job].worker = worker->index;
+        run_job(worker->batch, &worker->batch->jobs[job]);
+        worker->jobs_run++;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Function that runs all the jobs of the batch on the pool of workers.
+ * Worker 0 runs on the main thread. Without threads the only worker runs every job in order.
+ *
+ * @param batch The batch.
+ * @param workers The workers, at least worker_count of them.
+ * @return 0 on success, 1 if the threads cannot be started.
+ */
+int run_pool(Batch *batch, Worker workers[])
+{
+#ifdef SIMBATCH_THREADS
+    pthread_t threads[MAX_WORKERS];
+    int started, i;
+#else
+    int i;
+#endif
+
+    for (i = 0; i < batch->worker_count; i++)
+    {
+        workers[i].batch = batch;
+        workers[i].index = i;
+        workers[i].jobs_run = 0;
+        workers[i].steals = 0;
+        workers[i].seed = (unsigned int)i * 2654435761U + 1;
+    }
+#ifdef SIMBATCH_THREADS
+    for (started = 1; started < batch->worker_count; started++)
+    {
+        if (pthread_create(&threads[started], NULL, run_worker, &workers[started]))
+        {
+            break;
+        }
+    }
+    run_worker(&workers[0]);
+    for (i = 1; i < started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    /*Jobs left in the deques of workers that were not started are taken by the workers that were.*/
+    return 0;
+#else
+    run_worker(&workers[0]);
+    return 0;
+#endif
+}
+
+/**
+ * @brief Function that runs one job like sim does: load the inputs, run the program until it halts
+ * and write the output files, into the output directory of the job.
+ *
+ * @param batch The batch.
+ * @param job The job.
+ */
+void run_job(Batch *batch, Job *job)
+{
+    SimMachine *m = sim_create();
+    Writer *writer = NULL;
+    double start = now_seconds();
+
+    job->status = 1;
+    if (!m)
+    {
+        return;
+    }
+    if (batch->jit)
+    {
+        sim_set_jit(m, TRUE);
+    }
+    make_dir(job->outdir);
+    if (first_init(m, RUN_FILES, job->files, &writer, NULL, COMPRESS_NONE,
+                   batch->cache.dir ? &batch->cache : NULL) == 0)
+    {
+        sim_run_until(m, SIM_UNTIL_HALT, 0);
+        job->cycles = sim_get_cycles(m) + (unsigned int)sim_disk_cycles_left(m);
+        job->status = end_of_run(m, job->files, writer);
+    }
+    job->seconds = now_seconds() - start;
+    sim_destroy(m);
+}
+
+/**
+ * @brief Function that writes the summary of the batch.
+ * Every job has a line with its index in the manifest, its status, its cycles, its wall time in seconds,
+ * the worker that ran it and its output directory. The totals and the work of each worker follow as comments.
+ *
+ * @param batch The batch.
+ * @param workers The workers.
+ * @param summary_file The name of the summary file.
+ * @param seconds The wall time of the whole batch.
+ * @return 0 on successful writing to file, 1 on failure.
+ */
+int write_summary(Batch *batch, Worker workers[], const char *summary_file, double seconds)
+{
+    FILE *fp = fopen(summary_file, "w");
+    Job *job;
+    int i, failed = 0;
+    if (!fp)
+    {
+        return 1;
+    }
+    fprintf(fp, "# job status cycles seconds worker outdir\n");
+    for (i = 0; i < batch->job_count; i++)
+    {
+        job = &batch->jobs[i];
+        failed += job->status;
+        fprintf(fp, "%d %s %u %.6f %d %s\n", i, job->status ? "failed" : "ok", job->cycles, job->seconds, job->worker,
+                job->outdir);
+    }
+    fprintf(fp, "# jobs %d failed %d workers %d seconds %.6f\n", batch->job_count, failed, batch->worker_count, seconds);
+    for (i = 0; i < batch->worker_count; i++)
+    {
+        fprintf(fp, "# worker %d jobs %d steals %d\n", i, workers[i].jobs_run, workers[i].steals);
+    }
+    fclose(fp);
+    return 0;
+}
@@ -0,0 +1,284 @@
+#define _CRT_SECURE_NO_WARNINGS
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#define _FILE_OFFSET_BITS 64
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "simcache.h"
+#include "simfiles.h"
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/stat.h>
+#endif
+
+/*CacheEntry struct: an entry of a cache directory found while evicting*/
+typedef struct CacheEntry
+{
+    char *path;
+    uint64_t size;
+    time_t used;                    /*Time the entry was written or last loaded*/
+} CacheEntry;
+
+/*Function Prototypes*/
+
+static int load_entry(SimMachine *m, const char *path, uint64_t key, size_t input_len);
+static void store_entry(SimMachine *m, const ProgramCache *cache, const char *path, uint64_t key, size_t input_len);
+static int compare_entries(const void *a, const void *b);
+
+/**
+ * @brief Function that loads imemin.txt through a cache directory. When the directory holds the predecoded form of
+ * the same instructions it is loaded in place of the file, otherwise the file is loaded and its predecoded form
+ * is added to the directory. The cache never changes the run: a missing, partial or stale entry only means the
+ * file is loaded as without a cache.
+ *
+ * @param m The simulated machine.
+ * @param cache The cache directory.
+ * @param imem_file The name of imemin.txt, or of the binary image of the program.
+ * @return 0 on successful loading, 1 on failure.
+ */
+int cache_load_imem(SimMachine *m, const ProgramCache *cache, const char *imem_file)
+{
+    size_t len;
+    char *text = map_file(imem_file, &len), *path, name[32];
+    int result, mapped = (text != NULL);
+    uint64_t key;
+
+    if (!mapped && !(text = read_file(imem_file, &len)))
+    {
+        fprintf(stderr, "Cannot open %s\n", imem_file);
+        return 1;
+    }
+    key = cache_key(text, len);
+    sprintf(name, "%016llx%s", (unsigned long long)key, CACHE_SUFFIX);
+    path = join_path(cache->dir, name);
+    result = !path || load_entry(m, path, key, len);
+    if (result)
+    {
+        result = load_contents(m, sim_load_imem, text, len, imem_file);
+        if (!result && path)
+        {
+            store_entry(m, cache, path, key, len);
+        }
+    }
+    if (mapped)
+    {
+        unmap_file(text, len);
+    }
+    else
+    {
+        free(text);
+    }
+    free(path);
+    return result;
+}
+
+/**
+ * @brief Function that computes the key of an imemin.txt, the 64 bit FNV-1a hash of its bytes.
+ *
+ * @param data The contents of the file.
+ * @param len The length of the contents.
+ * @return The key.
+ */
+uint64_t cache_key(const void *data, size_t len)
+{
+    const unsigned char *p = data;
+    uint64_t hash = 14695981039346656037ULL;
+    size_t i;
+    for (i = 0; i < len; i++)
+    {
+        hash = (hash ^ p[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * @brief Function that loads the program of an entry of the cache, and marks the entry as recently used.
+ *
+ * @param m The simulated machine.
+ * @param path The name of the entry.
+ * @param key The key of imemin.txt.
+ * @param input_len The length of imemin.txt.
+ * @return 0 on success, 1 if there is no such entry or it is not valid.
+ */
+static int load_entry(SimMachine *m, const char *path, uint64_t key, size_t input_len)
+{
+    size_t len;
+    char *entry = map_file(path, &len);
+    const CacheHeader *header;
+    int result, mapped = (entry != NULL);
+
+    if (!mapped && !(entry = read_file(path, &len)))
+    {
+        return 1;
+    }
+    header = (const CacheHeader *)entry;
+    result = len < sizeof(CacheHeader) || memcmp(header->magic, CACHE_MAGIC, sizeof(header->magic)) != 0 ||
+             header->version != CACHE_VERSION || header->key != key || header->input_len != input_len ||
+             cache_key(header + 1, len - sizeof(CacheHeader)) != header->checksum ||
+             sim_restore_program(m, header + 1, len - sizeof(CacheHeader));
+    if (mapped)
+    {
+        unmap_file(entry, len);
+    }
+    else
+    {
+        free(entry);
+    }
+#ifndef _WIN32
+    if (!result)
+    {
+        utime(path, NULL);
+    }
+#endif
+    return result;
+}
+
+/**
+ * @brief Function that adds the program loaded into a machine to the cache, then keeps the cache within its bound.
+ * The entry is written to a file of its own and renamed into place, so that another run never reads it half written.
+ * Failing to write the entry is not an error, the program was loaded.
+ *
+ * @param m The simulated machine, with the program loaded.
+ * @param cache The cache directory.
+ * @param path The name of the entry.
+ * @param key The key of imemin.txt.
+ * @param input_len The length of imemin.txt.
+ */
+static void store_entry(SimMachine *m, const ProgramCache *cache, const char *path, uint64_t key, size_t input_len)
+{
+    size_t size = sizeof(CacheHeader) + sim_program_size(m);
+    char *entry = malloc(size), *temp = malloc(strlen(path) + 64);
+    CacheHeader *header = (CacheHeader *)entry;
+    FILE *fp = NULL;
+    int result;
+
+    if (!entry || !temp || sim_save_program(m, header + 1, size - sizeof(CacheHeader)))
+    {
+        free(entry);
+        free(temp);
+        return;
+    }
+    memset(header, 0, sizeof(CacheHeader));
+    memcpy(header->magic, CACHE_MAGIC, sizeof(header->magic));
+    header->version = CACHE_VERSION;
+    header->key = key;
+    header->input_len = input_len;
+    header->checksum = cache_key(header + 1, size - sizeof(CacheHeader));
+    /*The process and the machine make the name unique among the runs that may write the same entry at once.*/
+#ifdef _WIN32
+    sprintf(temp, "%s.%p.tmp", path, (void *)m);
+#else
+    sprintf(temp, "%s.%ld.%p.tmp", path, (long)getpid(), (void *)m);
+#endif
+    make_dir(cache->dir);
+    fp = fopen(temp, "wb");
+    result = !fp || fwrite(entry, 1, size, fp) != size;
+    if (fp)
+    {
+        result |= fclose(fp) != 0;
+    }
+    if (result || rename(temp, path) != 0)
+    {
+        remove(temp);
+    }
+    free(entry);
+    free(temp);
+    cache_evict(cache);
+}
+
+/**
+ * @brief Function that removes the least recently used entries of a cache directory until their size fits the
+ * bound of the cache, and the temporary entries left by runs that stopped. Entries that another run removes at the
+ * same time are skipped. Only done where the directory can be listed, which is not the case on Windows.
+ *
+ * @param cache The cache directory.
+ */
+void cache_evict(const ProgramCache *cache)
+{
+#ifndef _WIN32
+    DIR *dir = opendir(cache->dir);
+    struct dirent *d;
+    struct stat st;
+    CacheEntry *entries = NULL, *grown;
+    uint64_t total = 0;
+    size_t name_len, suffix_len = strlen(CACHE_SUFFIX);
+    int count = 0, capacity = 0, i;
+    char *path;
+    time_t now = time(NULL);
+
+    if (!dir)
+    {
+        return;
+    }
+    while ((d = readdir(dir)) != NULL)
+    {
+        name_len = strlen(d->d_name);
+        if (!(path = join_path(cache->dir, d->d_name)) || stat(path, &st) != 0 || !S_ISREG(st.st_mode))
+        {
+            free(path);
+            continue;
+        }
+        if (name_len > 4 && strcmp(d->d_name + name_len - 4, ".tmp") == 0 && now - st.st_mtime > CACHE_STALE_SECONDS)
+        {
+            remove(path);
+        }
+        if (name_len <= suffix_len || strcmp(d->d_name + name_len - suffix_len, CACHE_SUFFIX) != 0)
+        {
+            free(path);
+            continue;
+        }
+        if (count == capacity)
+        {
+            capacity = capacity ? 2 * capacity : 64;
+            grown = realloc(entries, (size_t)capacity * sizeof(CacheEntry));
+            if (!grown)
+            {
+                free(path);
+                break;
+            }
+            entries = grown;
+        }
+        entries[count].path = path;
+        entries[count].size = (uint64_t)st.st_size;
+        entries[count].used = st.st_mtime;
+        total += entries[count].size;
+        count++;
+    }
+    closedir(dir);
+    if (total > cache->max_bytes)
+    {
+        qsort(entries, (size_t)count, sizeof(CacheEntry), compare_entries);
+        for (i = 0; i < count && total > cache->max_bytes; i++)
+        {
+            remove(entries[i].path);
+            total -= entries[i].size;
+        }
+    }
+    for (i = 0; i < count; i++)
+    {
+        free(entries[i].path);
+    }
+    free(entries);
+#else
+    (void)cache;
+#endif
+}
+
+/**
+ * @brief Function that compares two entries of a cache by the time they were last used, for qsort.
+ *
+ * @param a The first entry.
+ * @param b The second entry.
+ * @return A negative number, 0 or a positive number as a was used before, at the same time as or after b.
+ */
+static int compare_entries(const void *a, const void *b)
+{
+    time_t x = ((const CacheEntry *)a)->used, y = ((const CacheEntry *)b)->used;
+    return (x > y) - (x < y);
+}
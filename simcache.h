@@ -0,0 +1,47 @@
+#ifndef SIMCACHE_H
+#define SIMCACHE_H
+
+#include <stdint.h>
+#include "libsimp.h"
+
+/*Constants*/
+
+#define CACHE_MAGIC "SIMPCACH"
+#define CACHE_VERSION 1
+#define CACHE_SUFFIX ".simpc"                      /*An entry is named by the hash of its imemin.txt and this suffix*/
+#define CACHE_MAX_MB 256                           /*Default bound of the size of the entries of a cache directory*/
+#define CACHE_STALE_SECONDS 3600                   /*A temporary entry this old was left by a run that stopped*/
+
+/*A cache directory holds the predecoded form of the programs that ran, sim_save_program, keyed by the hash of
+  their imemin.txt, so that a later run of the same program maps it and loads it with sim_restore_program
+  instead of parsing the instructions and discovering the basic blocks. Each entry is a CacheHeader followed
+  by the predecoded program, in the byte order of the machine. An entry is written to a temporary file and
+  renamed into place, so runs that share the directory only ever see complete entries. After an entry is
+  added the least recently used entries are removed until the directory fits its bound; a run that still has
+  one of them mapped keeps reading it.*/
+
+/*CacheHeader struct: the start of an entry*/
+typedef struct CacheHeader
+{
+    char magic[8];                  /*CACHE_MAGIC*/
+    uint32_t version;               /*CACHE_VERSION*/
+    uint32_t reserved;              /*Aligns the key, always 0*/
+    uint64_t key;                   /*Hash of imemin.txt*/
+    uint64_t input_len;             /*Length of imemin.txt*/
+    uint64_t checksum;              /*cache_key of everything after the header*/
+} CacheHeader;
+
+/*ProgramCache struct: a cache directory and its bound*/
+typedef struct ProgramCache
+{
+    const char *dir;                /*The directory, created if it does not exist*/
+    uint64_t max_bytes;             /*Bound of the size of its entries*/
+} ProgramCache;
+
+/*Functions that load programs through a cache directory.*/
+
+int cache_load_imem(SimMachine *m, const ProgramCache *cache, const char *imem_file);
+uint64_t cache_key(const void *data, size_t len);
+void cache_evict(const ProgramCache *cache);
+
+#endif
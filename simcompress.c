@@ -0,0 +1,936 @@
+#define _CRT_SECURE_NO_WARNINGS
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#define _FILE_OFFSET_BITS 64
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "simcompress.h"
+
+#ifdef SIMP_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef _WIN32
+#include <io.h>
+#define seek_file _fseeki64
+#define tell_file _ftelli64
+#else
+#include <unistd.h>
+#define seek_file fseeko
+#define tell_file ftello
+#endif
+
+/*Constants*/
+
+#define TRUE 1
+#define FALSE 0
+#define FILE_HEADER 16                      /*Bytes of the header of a compressed file*/
+#define FRAME_HEADER 8                      /*Bytes of the header of a frame*/
+#define FOOTER 16                           /*Bytes of the end of a file with a seek table*/
+#define STORED 0x80000000U                  /*Bit of the size of a frame stored as it is*/
+#define MAX_FRAME ((size_t)64 << 20)        /*Largest frame a reader accepts*/
+#define LZ_HASH_BITS 14
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+#define LZ_LAST_LITERALS 8                  /*Bytes at the end of a frame that are never part of a match*/
+
+/*Compressor struct: the frame being filled and where the frames went*/
+struct Compressor
+{
+    int method;
+    FrameSink sink;                  /*Receives the bytes of the file*/
+    void *user;
+    char *text;                      /*The bytes of the stream in the frame being filled, COMPRESS_FRAME_SIZE of them*/
+    size_t len;                      /*Number of bytes in the frame being filled*/
+    char *frame;                     /*The compressed frame*/
+    uint32_t *table;                 /*Last position of each hash of 4 bytes, for the LZ method*/
+    int header_pending;              /*TRUE (1) until the header of the file is written with the first frame*/
+    uint64_t file_offset;            /*Bytes of the file written*/
+    uint64_t stream_offset;          /*Bytes of the stream in the frames written*/
+    uint64_t *frames;                /*Position of each frame in the file and in the stream, two words per frame*/
+    size_t count;                    /*Number of frames*/
+    size_t capacity;                 /*Number of frames there is room for*/
+    int table_lost;                  /*TRUE (1) if the frames outgrew the memory, so the file gets no seek table*/
+};
+
+/*Stream struct: an output file read back, and the frame last decompressed*/
+struct Stream
+{
+    FILE *fp;
+    int method;                      /*COMPRESS_NONE if the file is not compressed*/
+    uint64_t *file_offsets;          /*Position of each frame in the file*/
+    uint64_t *stream_offsets;        /*Position of each frame in the stream, and the length of the stream after them*/
+    size_t count;                    /*Number of frames*/
+    size_t current;                  /*The frame in text, count if none*/
+    char *text;                      /*The bytes of the stream in the current frame*/
+    char *data;                      /*The compressed bytes of a frame*/
+    size_t text_size;                /*Bytes allocated for text*/
+    size_t data_size;                /*Bytes allocated for data*/
+};
+
+/*Function Prototypes*/
+
+static int resume_frames(Compressor *c, FILE *fp, uint64_t position);
+static void write_frame(Compressor *c);
+static void add_frame(Compressor *c, uint64_t file_offset, uint64_t stream_offset);
+static int walk_frames(Stream *s, uint64_t offset);
+static int read_seek_table(Stream *s);
+static int load_frame(Stream *s, size_t i);
+static size_t frame_bound(size_t len);
+static size_t encode(Compressor *c, const char *src, size_t len, char *dst, size_t size);
+static int decode(int method, const char *src, size_t len, char *dst, size_t size);
+static size_t lz_compress(const unsigned char *src, size_t len, unsigned char *dst, size_t size, uint32_t *table);
+static int lz_decompress(const unsigned char *src, size_t len, unsigned char *dst, size_t size);
+static size_t put_length(unsigned char *dst, size_t size, size_t len);
+static void put_word(char *p, uint32_t value);
+static void put_dword(char *p, uint64_t value);
+static uint32_t get_word(const char *p);
+static uint64_t get_dword(const char *p);
+static uint32_t load32(const unsigned char *p);
+
+/**
+ * @brief Function that finds a compression method by its name.
+ *
+ * @param name "lz", or "zlib" if the simulator was built with zlib.
+ * @return The method, or -1 if there is no method of that name.
+ */
+int compress_method(const char *name)
+{
+    if (strcmp(name, "lz") == 0)
+    {
+        return COMPRESS_LZ;
+    }
+#ifdef SIMP_HAVE_ZLIB
+    if (strcmp(name, "zlib") == 0)
+    {
+        return COMPRESS_ZLIB;
+    }
+#endif
+    return -1;
+}
+
+/**
+ * @brief Function that starts compressing a stream into its output file.
+ * A run that resumes from a checkpoint finds the frame that holds the position of the stream in the checkpoint,
+ * cuts the file before it and keeps the part of it before the position, to be written again with what follows.
+ *
+ * @param method The compression method.
+ * @param fp The output file, empty for position 0, otherwise open for reading and writing.
+ * @param position The number of bytes of the stream already written, 0 for a run that starts.
+ * @param sink Receives the bytes of the file after its end, which the caller places there.
+ * @param user The user data of the sink.
+ * @return The compressor, or NULL if there is not enough memory or the file does not hold the stream up to the position.
+ */
+Compressor *compressor_create(int method, FILE *fp, uint64_t position, FrameSink sink, void *user)
+{
+    Compressor *c = calloc(1, sizeof(Compressor));
+    if (!c)
+    {
+        return NULL;
+    }
+    c->method = method;
+    c->sink = sink;
+    c->user = user;
+    c->text = malloc(COMPRESS_FRAME_SIZE);
+    c->frame = malloc(FRAME_HEADER + frame_bound(COMPRESS_FRAME_SIZE));
+    c->table = method == COMPRESS_LZ ? malloc(sizeof(uint32_t) << LZ_HASH_BITS) : NULL;
+    if (!c->text || !c->frame || (method == COMPRESS_LZ && !c->table) ||
+        (position > 0 && resume_frames(c, fp, position)))
+    {
+        free(c->text);
+        free(c->frame);
+        free(c->table);
+        free(c->frames);
+        free(c);
+        return NULL;
+    }
+    c->header_pending = c->file_offset == 0;
+    return c;
+}
+
+/**
+ * @brief Function that walks the frames of the file of a run that resumes, up to the frame that holds the position,
+ * and cuts the file there.
+ *
+ * @param c The compressor.
+ * @param fp The output file.
+ * @param position The number of bytes of the stream already written.
+ * @return 0 on success, 1 if the file is not a compressed file of the method or does not reach the position.
+ */
+static int resume_frames(Compressor *c, FILE *fp, uint64_t position)
+{
+    char header[FILE_HEADER];
+    uint64_t offset = FILE_HEADER, stream = 0;
+    uint32_t size, len;
+
+    if (read_at(fp, 0, header, FILE_HEADER) || memcmp(header, COMPRESS_MAGIC, 8) != 0 ||
+        get_word(header + 8) != COMPRESS_VERSION || get_word(header + 12) != (uint32_t)c->method)
+    {
+        return 1;
+    }
+    while (stream < position)
+    {
+        if (read_at(fp, offset, header, FRAME_HEADER))
+        {
+            return 1;
+        }
+        size = get_word(header) & ~STORED;
+        len = get_word(header + 4);
+        if (get_word(header) == 0 || size > frame_bound(COMPRESS_FRAME_SIZE) || len > COMPRESS_FRAME_SIZE)
+        {
+            return 1;
+        }
+        if (stream + len > position)
+        {
+            /*The frame holds the position: its part before the position is written again in the next frame.*/
+            if (read_at(fp, offset + FRAME_HEADER, c->frame, size) ||
+                ((get_word(header) & STORED) ? (memcpy(c->text, c->frame, len), 0) : decode(c->method, c->frame, size, c->text, len)))
+            {
+                return 1;
+            }
+            c->len = (size_t)(position - stream);
+            break;
+        }
+        add_frame(c, offset, stream);
+        offset += FRAME_HEADER + size;
+        stream += len;
+    }
+    c->file_offset = offset;
+    c->stream_offset = stream;
+    return truncate_file(fp, offset);
+}
+
+/**
+ * @brief Function that compresses bytes of the stream. Each full frame is written at once.
+ *
+ * @param c The compressor.
+ * @param text The bytes.
+ * @param len The number of bytes.
+ */
+void compress_text(Compressor *c, const char *text, size_t len)
+{
+    size_t n;
+    while (len > 0)
+    {
+        n = COMPRESS_FRAME_SIZE - c->len < len ? COMPRESS_FRAME_SIZE - c->len : len;
+        memcpy(c->text + c->len, text, n);
+        c->len += n;
+        text += n;
+        len -= n;
+        if (c->len == COMPRESS_FRAME_SIZE)
+        {
+            write_frame(c);
+        }
+    }
+}
+
+/**
+ * @brief Function that writes the frame being filled, so the file holds the whole stream.
+ *
+ * @param c The compressor.
+ */
+void compress_flush(Compressor *c)
+{
+    write_frame(c);
+}
+
+/**
+ * @brief Function that writes the last frame and the seek table, and frees the compressor.
+ * A stream with no bytes leaves its file empty, as a text stream would.
+ *
+ * @param c The compressor, or NULL.
+ */
+void compressor_close(Compressor *c)
+{
+    char *table;
+    size_t len, i;
+    if (!c)
+    {
+        return;
+    }
+    write_frame(c);
+    len = FRAME_HEADER + c->count * 16 + FOOTER;
+    table = c->count > 0 && !c->table_lost && c->count <= 0xFFFFFFFFU ? malloc(len) : NULL;
+    if (table)
+    {
+        put_word(table, 0);
+        put_word(table + 4, (uint32_t)c->count);
+        for (i = 0; i < c->count; i++)
+        {
+            put_dword(table + FRAME_HEADER + i * 16, c->frames[2 * i]);
+            put_dword(table + FRAME_HEADER + i * 16 + 8, c->frames[2 * i + 1]);
+        }
+        put_dword(table + len - FOOTER, c->file_offset);
+        memcpy(table + len - 8, COMPRESS_END_MAGIC, 8);
+        c->sink(c->user, table, len);
+        free(table);
+    }
+    free(c->text);
+    free(c->frame);
+    free(c->table);
+    free(c->frames);
+    free(c);
+}
+
+/**
+ * @brief Function that compresses the frame being filled and writes it, after the header of the file
+ * if it is the first one. A frame that does not get smaller is stored as it is.
+ *
+ * @param c The compressor.
+ */
+static void write_frame(Compressor *c)
+{
+    char header[FILE_HEADER];
+    size_t size;
+    if (c->len == 0)
+    {
+        return;
+    }
+    if (c->header_pending)
+    {
+        memcpy(header, COMPRESS_MAGIC, 8);
+        put_word(header + 8, COMPRESS_VERSION);
+        put_word(header + 12, (uint32_t)c->method);
+        c->sink(c->user, header, FILE_HEADER);
+        c->file_offset = FILE_HEADER;
+        c->header_pending = FALSE;
+    }
+    size = encode(c, c->text, c->len, c->frame + FRAME_HEADER, frame_bound(c->len));
+    if (size == 0 || size >= c->len)
+    {
+        memcpy(c->frame + FRAME_HEADER, c->text, c->len);
+        size = c->len;
+        put_word(c->frame, (uint32_t)size | STORED);
+    }
+    else
+    {
+        put_word(c->frame, (uint32_t)size);
+    }
+    put_word(c->frame + 4, (uint32_t)c->len);
+    c->sink(c->user, c->frame, FRAME_HEADER + size);
+    add_frame(c, c->file_offset, c->stream_offset);
+    c->file_offset += FRAME_HEADER + size;
+    c->stream_offset += c->len;
+    c->len = 0;
+}
+
+/**
+ * @brief Function that adds a frame to the frames of the seek table.
+ *
+ * @param c The compressor.
+ * @param file_offset The position of the frame in the file.
+ * @param stream_offset The position of the frame in the stream.
+ */
+static void add_frame(Compressor *c, uint64_t file_offset, uint64_t stream_offset)
+{
+    uint64_t *frames;
+    if (c->table_lost)
+    {
+        return;
+    }
+    if (c->count == c->capacity)
+    {
+        frames = realloc(c->frames, (c->capacity ? 2 * c->capacity : 1024) * 2 * sizeof(uint64_t));
+        if (!frames)
+        {
+            c->table_lost = TRUE;
+            return;
+        }
+        c->frames = frames;
+        c->capacity = c->capacity ? 2 * c->capacity : 1024;
+    }
+    c->frames[2 * c->count] = file_offset;
+    c->frames[2 * c->count + 1] = stream_offset;
+    c->count++;
+}
+
+/**
+ * @brief Function that opens an output file to read its stream. A compressed file is found by its header,
+ * any other file is read as it is.
+ *
+ * @param file_name The name of the file.
+ * @return The stream, or NULL if the file cannot be opened or its frames cannot be read.
+ */
+Stream *stream_open(const char *file_name)
+{
+    Stream *s = calloc(1, sizeof(Stream));
+    char header[FILE_HEADER];
+
+    if (!s || !(s->fp = fopen(file_name, "rb")))
+    {
+        free(s);
+        return NULL;
+    }
+    if (fread(header, 1, FILE_HEADER, s->fp) == FILE_HEADER && memcmp(header, COMPRESS_MAGIC, 8) == 0)
+    {
+        s->method = (int)get_word(header + 12);
+        if (get_word(header + 8) != COMPRESS_VERSION || (read_seek_table(s) && walk_frames(s, FILE_HEADER)))
+        {
+            stream_close(s);
+            return NULL;
+        }
+        s->current = s->count;
+    }
+    return s;
+}
+
+/**
+ * @brief Function that reads the seek table at the end of a compressed file.
+ *
+ * @param s The stream.
+ * @return 0 on success, 1 if the file has no valid table.
+ */
+static int read_seek_table(Stream *s)
+{
+    char footer[FOOTER], *table;
+    uint64_t end, offset;
+    size_t i, count;
+
+    if (seek_file(s->fp, 0, SEEK_END) || (long long)(end = (uint64_t)tell_file(s->fp)) < FILE_HEADER + FOOTER ||
+        read_at(s->fp, end - FOOTER, footer, FOOTER) || memcmp(footer + 8, COMPRESS_END_MAGIC, 8) != 0)
+    {
+        return 1;
+    }
+    offset = get_dword(footer);
+    if (offset < FILE_HEADER || offset > end - FOOTER - FRAME_HEADER || read_at(s->fp, offset, footer, FRAME_HEADER) ||
+        get_word(footer) != 0 || (count = get_word(footer + 4)) * 16 != end - FOOTER - FRAME_HEADER - offset)
+    {
+        return 1;
+    }
+    table = malloc(count * 16);
+    s->file_offsets = malloc((count + 1) * sizeof(uint64_t));
+    s->stream_offsets = malloc((count + 1) * sizeof(uint64_t));
+    if (!table || !s->file_offsets || !s->stream_offsets || read_at(s->fp, offset + FRAME_HEADER, table, count * 16))
+    {
+        free(table);
+        return 1;
+    }
+    for (i = 0; i < count; i++)
+    {
+        s->file_offsets[i] = get_dword(table + i * 16);
+        s->stream_offsets[i] = get_dword(table + i * 16 + 8);
+    }
+    free(table);
+    s->count = count;
+
+    /*The length of the stream is where the last frame ends.*/
+    s->file_offsets[count] = offset;
+    s->stream_offsets[count] = 0;
+    if (count > 0)
+    {
+        if (read_at(s->fp, s->file_offsets[count - 1], footer, FRAME_HEADER))
+        {
+            return 1;
+        }
+        s->stream_offsets[count] = s->stream_offsets[count - 1] + get_word(footer + 4);
+    }
+    return 0;
+}
+
+/**
+ * @brief Function that finds the frames of a compressed file without a seek table by walking them.
+ * A frame cut short by a run that stopped while writing it is left out.
+ *
+ * @param s The stream.
+ * @param offset The position of the first frame.
+ * @return 0 on success, 1 if there is not enough memory.
+ */
+static int walk_frames(Stream *s, uint64_t offset)
+{
+    char header[FRAME_HEADER];
+    uint64_t stream = 0, *grown, end;
+    size_t capacity = 0;
+
+    free(s->file_offsets);
+    free(s->stream_offsets);
+    s->file_offsets = s->stream_offsets = NULL;
+    s->count = 0;
+    if (seek_file(s->fp, 0, SEEK_END))
+    {
+        return 1;
+    }
+    end = (uint64_t)tell_file(s->fp);
+    for (;;)
+    {
+        if (s->count + 1 >= capacity)
+        {
+            capacity = capacity ? 2 * capacity : 1024;
+            grown = realloc(s->file_offsets, capacity * sizeof(uint64_t));
+            if (grown)
+            {
+                s->file_offsets = grown;
+                grown = realloc(s->stream_offsets, capacity * sizeof(uint64_t));
+            }
+            if (!grown)
+            {
+                return 1;
+            }
+            s->stream_offsets = grown;
+        }
+        s->file_offsets[s->count] = offset;
+        s->stream_offsets[s->count] = stream;
+        if (read_at(s->fp, offset, header, FRAME_HEADER) || get_word(header) == 0 ||
+            offset + FRAME_HEADER + (get_word(header) & ~STORED) > end)
+        {
+            return 0;
+        }
+        offset += FRAME_HEADER + (get_word(header) & ~STORED);
+        stream += get_word(header + 4);
+        s->count++;
+    }
+}
+
+/**
+ * @brief Function that reads bytes of a stream.
+ *
+ * @param s The stream.
+ * @param offset The position of the bytes in the stream.
+ * @param buf The buffer the bytes are read to.
+ * @param len The number of bytes.
+ * @return The number of bytes read, less than len if the stream ends first or a frame cannot be read.
+ */
+size_t stream_read(Stream *s, uint64_t offset, void *buf, size_t len)
+{
+    size_t low = 0, high, middle, n, done = 0;
+    if (s->method == COMPRESS_NONE)
+    {
+        return seek_file(s->fp, (long long)offset, SEEK_SET) ? 0 : fread(buf, 1, len, s->fp);
+    }
+    /*Find the last frame that starts at or before the offset.*/
+    high = s->count;
+    while (low + 1 < high)
+    {
+        middle = low + (high - low) / 2;
+        if (s->stream_offsets[middle] <= offset)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    for (; done < len && low < s->count && offset < s->stream_offsets[s->count]; low++)
+    {
+        if (load_frame(s, low))
+        {
+            break;
+        }
+        n = (size_t)(s->stream_offsets[low + 1] - offset);
+        n = n < len - done ? n : len - done;
+        memcpy((char *)buf + done, s->text + (offset - s->stream_offsets[low]), n);
+        done += n;
+        offset += n;
+    }
+    return done;
+}
+
+/**
+ * @brief Function that decompresses a frame of a stream, unless it is the one last decompressed.
+ *
+ * @param s The stream.
+ * @param i The number of the frame.
+ * @return 0 on success, 1 if the frame cannot be read.
+ */
+static int load_frame(Stream *s, size_t i)
+{
+    char header[FRAME_HEADER], *grown;
+    size_t size, len;
+
+    if (s->current == i)
+    {
+        return 0;
+    }
+    if (read_at(s->fp, s->file_offsets[i], header, FRAME_HEADER))
+    {
+        return 1;
+    }
+    size = get_word(header) & ~STORED;
+    len = get_word(header + 4);
+    if (size > MAX_FRAME || len > MAX_FRAME || len != s->stream_offsets[i + 1] - s->stream_offsets[i])
+    {
+        return 1;
+    }
+    if (len > s->text_size)
+    {
+        grown = realloc(s->text, len);
+        if (!grown)
+        {
+            return 1;
+        }
+        s->text = grown;
+        s->text_size = len;
+    }
+    if (size > s->data_size)
+    {
+        grown = realloc(s->data, size);
+        if (!grown)
+        {
+            return 1;
+        }
+        s->data = grown;
+        s->data_size = size;
+    }
+    s->current = s->count;
+    if ((get_word(header) & STORED) ? size != len || read_at(s->fp, s->file_offsets[i] + FRAME_HEADER, s->text, len)
+                                     : read_at(s->fp, s->file_offsets[i] + FRAME_HEADER, s->data, size) ||
+                                           decode(s->method, s->data, size, s->text, len))
+    {
+        return 1;
+    }
+    s->current = i;
+    return 0;
+}
+
+/**
+ * @brief Function that tells whether the file of a stream is compressed.
+ *
+ * @param s The stream.
+ * @return TRUE (1) if the file is compressed, FALSE (0) otherwise.
+ */
+int stream_compressed(const Stream *s)
+{
+    return s->method != COMPRESS_NONE;
+}
+
+/**
+ * @brief Function that closes the file of a stream and frees it.
+ *
+ * @param s The stream, or NULL.
+ */
+void stream_close(Stream *s)
+{
+    if (!s)
+    {
+        return;
+    }
+    fclose(s->fp);
+    free(s->file_offsets);
+    free(s->stream_offsets);
+    free(s->text);
+    free(s->data);
+    free(s);
+}
+
+/**
+ * @brief Function that reads bytes at a position of a file, which may be beyond 2 GB.
+ *
+ * @param fp The file.
+ * @param offset The position.
+ * @param buf The buffer the bytes are read to.
+ * @param len The number of bytes.
+ * @return 0 on success, 1 if the bytes cannot be read.
+ */
+int read_at(FILE *fp, uint64_t offset, void *buf, size_t len)
+{
+    return seek_file(fp, (long long)offset, SEEK_SET) != 0 || fread(buf, 1, len, fp) != len;
+}
+
+/**
+ * @brief Function that cuts a file after a number of bytes and moves to its end.
+ *
+ * @param fp The file, open for writing.
+ * @param len The number of bytes kept.
+ * @return 0 on success, 1 on failure.
+ */
+int truncate_file(FILE *fp, uint64_t len)
+{
+    int result;
+    fflush(fp);
+#ifdef _WIN32
+    result = _chsize_s(_fileno(fp), (__int64)len);
+#else
+    result = ftruncate(fileno(fp), (off_t)len);
+#endif
+    return result != 0 || seek_file(fp, (long long)len, SEEK_SET) != 0;
+}
+
+/**
+ * @brief Function that returns the largest size of a compressed frame.
+ *
+ * @param len The number of bytes of the stream in the frame.
+ * @return The number of bytes.
+ */
+static size_t frame_bound(size_t len)
+{
+    return len + len / 255 + 64;
+}
+
+/**
+ * @brief Function that compresses a frame with the method of a compressor.
+ *
+ * @param c The compressor.
+ * @param src The bytes of the stream.
+ * @param len The number of bytes.
+ * @param dst The buffer of the compressed frame.
+ * @param size The size of the buffer.
+ * @return The size of the compressed frame, 0 if it does not fit.
+ */
+static size_t encode(Compressor *c, const char *src, size_t len, char *dst, size_t size)
+{
+#ifdef SIMP_HAVE_ZLIB
+    uLongf n = (uLongf)size;
+    if (c->method == COMPRESS_ZLIB)
+    {
+        return compress2((Bytef *)dst, &n, (const Bytef *)src, (uLong)len, Z_BEST_SPEED) == Z_OK ? (size_t)n : 0;
+    }
+#endif
+    if (c->method == COMPRESS_LZ)
+    {
+        return lz_compress((const unsigned char *)src, len, (unsigned char *)dst, size, c->table);
+    }
+    return 0;
+}
+
+/**
+ * @brief Function that decompresses a frame.
+ *
+ * @param method The compression method.
+ * @param src The compressed frame.
+ * @param len The size of the compressed frame.
+ * @param dst The buffer of the bytes of the stream.
+ * @param size The number of bytes of the stream in the frame.
+ * @return 0 on success, 1 if the frame is not valid or the method is not available.
+ */
+static int decode(int method, const char *src, size_t len, char *dst, size_t size)
+{
+#ifdef SIMP_HAVE_ZLIB
+    uLongf n = (uLongf)size;
+    if (method == COMPRESS_ZLIB)
+    {
+        return uncompress((Bytef *)dst, &n, (const Bytef *)src, (uLong)len) != Z_OK || n != size;
+    }
+#endif
+    if (method == COMPRESS_LZ)
+    {
+        return lz_decompress((const unsigned char *)src, len, (unsigned char *)dst, size);
+    }
+    return 1;
+}
+
+/**
+ * @brief Function that compresses bytes with the LZ method, in the manner of LZ4: a sequence is a token byte with the
+ * number of literals in its high 4 bits and the length of the match less 4 in its low 4 bits, each extended by
+ * bytes of 255 and a last byte when it is 15, then the literals, then the distance back to the match as a 16 bit
+ * little-endian word. The last sequence only has literals. Matches are found through a table of the last
+ * position of each hash of 4 bytes, which suits the repeated hex of the traces.
+ *
+ * @param src The bytes.
+ * @param len The number of bytes.
+ * @param dst The buffer of the compressed bytes.
+ * @param size The size of the buffer.
+ * @param table The hash table, 1 << LZ_HASH_BITS words.
+ * @return The number of compressed bytes, 0 if they do not fit.
+ */
+static size_t lz_compress(const unsigned char *src, size_t len, unsigned char *dst, size_t size, uint32_t *table)
+{
+    size_t pos = 0, anchor = 0, out = 0, match, literals, n, limit = len > LZ_LAST_LITERALS ? len - LZ_LAST_LITERALS : 0;
+    uint32_t hash;
+
+    memset(table, 0, sizeof(uint32_t) << LZ_HASH_BITS);
+    while (pos + LZ_MIN_MATCH <= limit)
+    {
+        hash = (load32(src + pos) * 2654435761U) >> (32 - LZ_HASH_BITS);
+        match = table[hash];
+        table[hash] = (uint32_t)pos;
+        if (match >= pos || pos - match > LZ_MAX_OFFSET || load32(src + match) != load32(src + pos))
+        {
+            /*Far from the last match the search speeds up, as the bytes there do not repeat.*/
+            pos += 1 + ((pos - anchor) >> 6);
+            continue;
+        }
+        for (n = LZ_MIN_MATCH; pos + n < limit && src[match + n] == src[pos + n]; n++)
+        {
+        }
+        literals = pos - anchor;
+        if (out + 1 + literals + literals / 255 + 2 + (n - LZ_MIN_MATCH) / 255 + 2 > size)
+        {
+            return 0;
+        }
+        dst[out++] = (unsigned char)(((literals < 15 ? literals : 15) << 4) |
+                                     (n - LZ_MIN_MATCH < 15 ? n - LZ_MIN_MATCH : 15));
+        out += put_length(dst + out, size - out, literals);
+        memcpy(dst + out, src + anchor, literals);
+        out += literals;
+        dst[out++] = (unsigned char)((pos - match) & 0xFF);
+        dst[out++] = (unsigned char)((pos - match) >> 8);
+        out += put_length(dst + out, size - out, n - LZ_MIN_MATCH);
+        pos += n;
+        anchor = pos;
+    }
+    literals = len - anchor;
+    if (out + 1 + literals + literals / 255 + 1 > size)
+    {
+        return 0;
+    }
+    dst[out++] = (unsigned char)((literals < 15 ? literals : 15) << 4);
+    out += put_length(dst + out, size - out, literals);
+    memcpy(dst + out, src + anchor, literals);
+    return out + literals;
+}
+
+/**
+ * @brief Function that writes the extension of a length of a token of the LZ method.
+ *
+ * @param dst The buffer.
+ * @param size The size of the buffer, which the caller checked.
+ * @param len The length, which is only extended from 15.
+ * @return The number of bytes written.
+ */
+static size_t put_length(unsigned char *dst, size_t size, size_t len)
+{
+    size_t out = 0;
+    (void)size;
+    if (len < 15)
+    {
+        return 0;
+    }
+    for (len -= 15; len >= 255; len -= 255)
+    {
+        dst[out++] = 255;
+    }
+    dst[out++] = (unsigned char)len;
+    return out;
+}
+
+/**
+ * @brief Function that decompresses bytes of the LZ method, checking every length and distance against the buffers.
+ *
+ * @param src The compressed bytes.
+ * @param len The number of compressed bytes.
+ * @param dst The buffer of the bytes.
+ * @param size The number of bytes.
+ * @return 0 on success, 1 if the compressed bytes are not valid or do not make exactly size bytes.
+ */
+static int lz_decompress(const unsigned char *src, size_t len, unsigned char *dst, size_t size)
+{
+    size_t in = 0, out = 0, literals, match, distance, i;
+    unsigned char b;
+
+    while (in < len)
+    {
+        b = src[in++];
+        literals = b >> 4;
+        match = (b & 15) + LZ_MIN_MATCH;
+        if (literals == 15)
+        {
+            do
+            {
+                if (in >= len)
+                {
+                    return 1;
+                }
+                literals += src[in];
+            } while (src[in++] == 255);
+        }
+        if (literals > len - in || literals > size - out)
+        {
+            return 1;
+        }
+        memcpy(dst + out, src + in, literals);
+        in += literals;
+        out += literals;
+        if (in == len)
+        {
+            break;
+        }
+        if (len - in < 2)
+        {
+            return 1;
+        }
+        distance = src[in] | ((size_t)src[in + 1] << 8);
+        in += 2;
+        if (match == 15 + LZ_MIN_MATCH)
+        {
+            do
+            {
+                if (in >= len)
+                {
+                    return 1;
+                }
+                match += src[in];
+            } while (src[in++] == 255);
+        }
+        if (distance == 0 || distance > out || match > size - out)
+        {
+            return 1;
+        }
+        if (distance >= match)
+        {
+            memcpy(dst + out, dst + out - distance, match);
+        }
+        else
+        {
+            for (i = 0; i < match; i++)
+            {
+                dst[out + i] = dst[out + i - distance];
+            }
+        }
+        out += match;
+    }
+    return out != size;
+}
+
+/**
+ * @brief Function that writes a little-endian 32 bit word.
+ *
+ * @param p The bytes of the word.
+ * @param value The word.
+ */
+static void put_word(char *p, uint32_t value)
+{
+    p[0] = (char)(value & 0xFF);
+    p[1] = (char)((value >> 8) & 0xFF);
+    p[2] = (char)((value >> 16) & 0xFF);
+    p[3] = (char)(value >> 24);
+}
+
+/**
+ * @brief Function that writes a little-endian 64 bit word.
+ *
+ * @param p The bytes of the word.
+ * @param value The word.
+ */
+static void put_dword(char *p, uint64_t value)
+{
+    put_word(p, (uint32_t)value);
+    put_word(p + 4, (uint32_t)(value >> 32));
+}
+
+/**
+ * @brief Function that reads a little-endian 32 bit word.
+ *
+ * @param p The bytes of the word.
+ * @return The word.
+ */
+static uint32_t get_word(const char *p)
+{
+    const unsigned char *b = (const unsigned char *)p;
+    return (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+/**
+ * @brief Function that reads a little-endian 64 bit word.
+ *
+ * @param p The bytes of the word.
+ * @return The word.
+ */
+static uint64_t get_dword(const char *p)
+{
+    return (uint64_t)get_word(p) | ((uint64_t)get_word(p + 4) << 32);
+}
+
+/**
+ * @brief Function that reads 4 bytes as a word in the order of the machine, to compare and hash them.
+ *
+ * @param p The bytes.
+ * @return The word.
+ */
+static uint32_t load32(const unsigned char *p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
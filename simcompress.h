@@ -0,0 +1,57 @@
+#ifndef SIMCOMPRESS_H
+#define SIMCOMPRESS_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*Constants*/
+
+#define COMPRESS_NONE 0
+#define COMPRESS_LZ 1
+#define COMPRESS_ZLIB 2                            /*Only with SIMP_HAVE_ZLIB, linked with -lz*/
+#define COMPRESS_MAGIC "SIMPZSTR"
+#define COMPRESS_END_MAGIC "SIMPZEND"
+#define COMPRESS_VERSION 1
+#define COMPRESS_FRAME_SIZE ((size_t)1 << 20)      /*Bytes of the stream in a frame*/
+
+/*A compressed output file holds its stream in frames, each compressed on its own, so that any part of the stream
+  is read by decompressing only the frames that hold it. Every number is little-endian.
+  - The file starts with the 8 bytes of COMPRESS_MAGIC, then COMPRESS_VERSION and the method as 32 bit words.
+  - A frame is its size in the file, with bit 31 set if it is stored as it is, and its size in the stream, as 32 bit
+    words, followed by its bytes.
+  - A file that was closed ends with a seek table: a 32 bit 0 in place of a frame size, the number of frames as a
+    32 bit word, and for each frame its position in the file and in the stream as 64 bit words. The last 16 bytes are
+    the position of the table as a 64 bit word and the 8 bytes of COMPRESS_END_MAGIC. A file without a table, such
+    as one of a run that stopped, is read by walking its frames.*/
+
+/*Receives the bytes of a compressed file as they are made.*/
+typedef void (*FrameSink)(void *user, const char *data, size_t len);
+
+/*The compression of a stream as it is written.*/
+typedef struct Compressor Compressor;
+
+/*A stream read back from its output file, compressed or not.*/
+typedef struct Stream Stream;
+
+/*Compressing a stream.*/
+
+int compress_method(const char *name);
+Compressor *compressor_create(int method, FILE *fp, uint64_t position, FrameSink sink, void *user);
+void compress_text(Compressor *c, const char *text, size_t len);
+void compress_flush(Compressor *c);
+void compressor_close(Compressor *c);
+
+/*Reading a stream.*/
+
+Stream *stream_open(const char *file_name);
+size_t stream_read(Stream *s, uint64_t offset, void *buf, size_t len);
+int stream_compressed(const Stream *s);
+void stream_close(Stream *s);
+
+/*Files beyond 2 GB.*/
+
+int read_at(FILE *fp, uint64_t offset, void *buf, size_t len);
+int truncate_file(FILE *fp, uint64_t len);
+
+#endif
@@ -0,0 +1,724 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include "libsimp.h"
+#include "simfiles.h"
+#include "simhistory.h"
+
+/*Constants*/
+
+#define MAX_LINE 500
+#define MAX_BREAKPOINTS 64
+#define MAX_WATCHES 16
+#define MAX_ARGS 4
+
+/*Names of the cpu registers, indexed by their number*/
+static const char *register_names[SIM_CPU_REG_NUM] = {"$zero", "$imm1", "$imm2", "$v0", "$a0", "$a1", "$a2", "$t0",
+                                                      "$t1", "$t2", "$s0", "$s1", "$s2", "$gp", "$sp", "$ra"};
+
+/*Watch struct: a register or memory word whose changes stop the run*/
+typedef struct Watch
+{
+    int is_register;     /*TRUE (1) for a cpu register, FALSE (0) for a memory word*/
+    int index;           /*Number of the register or address of the word*/
+    int value;           /*Value at the cycle the run stands at*/
+} Watch;
+
+/*Stop struct: the reason the run stopped at a cycle*/
+typedef struct Stop
+{
+    uint64_t cycle;      /*Cycle the run stopped at, counted by sim_cycles_run*/
+    int pc;              /*Address of the instruction of the cycle that ended at the stop*/
+    int breakpoint;      /*TRUE (1) if the program counter reached a breakpoint*/
+    int watch;           /*Index of the watch that changed, -1 if none did*/
+    int old_value;       /*Value of the watch before the change*/
+    int new_value;       /*Value of the watch after the change*/
+} Stop;
+
+/*Debugger struct: the machine, its history, and the breakpoints and watches*/
+typedef struct Debugger
+{
+    SimMachine *machine;
+    History *history;
+    char *imem_text;                    /*Text of imemin.txt, split into lines*/
+    char **lines;                       /*The line of each instruction, shown next to the program counter*/
+    int line_count;
+    int breakpoints[MAX_BREAKPOINTS];   /*Addresses at which the run stops*/
+    int breakpoint_count;
+    Watch watches[MAX_WATCHES];
+    int watch_count;
+} Debugger;
+
+/*Set by SIGINT to stop a long run and return to the prompt*/
+static volatile sig_atomic_t interrupted = FALSE;
+
+/*Function Prototypes*/
+
+/*Functions that start the debugger.*/
+
+int parse_options(SimMachine *m, int argc, char *argv[], unsigned int *interval, size_t *max_bytes);
+int load_program(Debugger *d, char *argv[]);
+void free_debugger(Debugger *d);
+void interrupt_run(int sig);
+
+/*Functions that carry out the commands.*/
+
+int run_command(Debugger *d, char *line);
+void step_forward(Debugger *d, unsigned int cycles);
+void step_backward(Debugger *d, unsigned int cycles);
+void continue_forward(Debugger *d);
+void continue_backward(Debugger *d);
+int add_breakpoint(Debugger *d, const char *arg);
+int add_watch(Debugger *d, const char *arg);
+int parse_register(const char *name);
+
+/*Functions that check for stops and show the machine.*/
+
+void read_watches(Debugger *d);
+int check_stop(Debugger *d, int pc, Stop *stop);
+void show_stop(Debugger *d, const Stop *stop);
+void show_position(Debugger *d);
+void show_registers(Debugger *d);
+void show_memory(Debugger *d, int address, int count);
+void show_info(Debugger *d);
+void show_help(void);
+
+int main(int argc, char *argv[])
+{
+    Debugger d;
+    unsigned int interval = HISTORY_INTERVAL;
+    size_t max_bytes = HISTORY_MAX_BYTES;
+    char line[MAX_LINE];
+    int count, i;
+
+    memset(&d, 0, sizeof(d));
+    d.machine = sim_create();
+    if (!d.machine)
+    {
+        return 1;
+    }
+    count = parse_options(d.machine, argc, argv, &interval, &max_bytes);
+    if (count < 0)
+    {
+        sim_destroy(d.machine);
+        return 1;
+    }
+    argc -= count;
+    argv += count;
+    if (argc != 5)
+    {
+        fprintf(stderr, "Usage: simdbg [--interval N] [--max-snapshot-mb N] [--jit] "
+                        "imemin.txt dmemin.txt diskin.txt irq2in.txt\n");
+        sim_destroy(d.machine);
+        return 1;
+    }
+    for (i = 1; i < argc; i++)
+    {
+        strip_newline(argv[i]);
+    }
+    if (load_program(&d, argv))
+    {
+        free_debugger(&d);
+        return 1;
+    }
+
+    /*The output streams are discarded, so cycles that run again do not repeat their output.*/
+    d.history = history_create(d.machine, interval, max_bytes);
+    if (!d.history)
+    {
+        fprintf(stderr, "Cannot allocate the history\n");
+        free_debugger(&d);
+        return 1;
+    }
+    signal(SIGINT, interrupt_run);
+    show_position(&d);
+    do
+    {
+        printf("(simdbg) ");
+        fflush(stdout);
+        if (!fgets(line, sizeof(line), stdin))
+        {
+            break;
+        }
+    } while (run_command(&d, line));
+    free_debugger(&d);
+    return 0;
+}
+
+/**
+ * @brief Function that parses the options given before the file names.
+ * --interval N takes a snapshot every N cycles, --max-snapshot-mb N bounds the memory of the snapshots,
+ * beyond which every other snapshot is dropped, and --jit translates hot basic blocks to x86-64 code.
+ *
+ * @param m The simulated machine.
+ * @param argc Number of command line arguments.
+ * @param argv The command line arguments.
+ * @param interval The number of cycles between two snapshots.
+ * @param max_bytes The memory of the snapshots.
+ * @return The number of command line arguments taken by the options, or -1 for an invalid option.
+ */
+int parse_options(SimMachine *m, int argc, char *argv[], unsigned int *interval, size_t *max_bytes)
+{
+    int i;
+    for (i = 1; i < argc && strncmp(argv[i], "--", 2) == 0; i++)
+    {
+        if (strcmp(argv[i], "--jit") == 0)
+        {
+            if (sim_set_jit(m, TRUE))
+            {
+                fprintf(stderr, "--jit: not available, using the interpreter\n");
+            }
+        }
+        else if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc)
+        {
+            *interval = (unsigned int)strtoul(argv[++i], NULL, 0);
+            if (*interval == 0)
+            {
+                fprintf(stderr, "--interval: expected a number of cycles\n");
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--max-snapshot-mb") == 0 && i + 1 < argc)
+        {
+            *max_bytes = (size_t)strtoul(argv[++i], NULL, 0) << 20;
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+    return i - 1;
+}
+
+/**
+ * @brief Function that loads the input files and keeps the lines of imemin.txt to show the instructions.
+ *
+ * @param d The debugger.
+ * @param argv The command line arguments: imemin.txt, dmemin.txt, diskin.txt and irq2in.txt.
+ * @return 0 on success, 1 on failure.
+ */
+int load_program(Debugger *d, char *argv[])
+{
+    size_t len, i;
+    char *line;
+    const char *error;
+    int line_number;
+
+    d->imem_text = read_file(argv[1], &len);
+    if (!d->imem_text || sim_load_imem(d->machine, d->imem_text, len))
+    {
+        if (d->imem_text && (error = sim_load_error(d->machine, &line_number)) != NULL)
+        {
+            fprintf(stderr, "%s:%d: %s\n", argv[1], line_number, error);
+        }
+        fprintf(stderr, "Cannot load %s\n", argv[1]);
+        return 1;
+    }
+    for (i = 2; i <= 4; i++)
+    {
+        if (load_file(d->machine, i == 2 ? sim_load_dmem : i == 3 ? sim_load_disk : sim_load_irq2, argv[i]))
+        {
+            fprintf(stderr, "Cannot load %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    /*Split the instructions into lines in place, the last one may not end with a new line.*/
+    line = realloc(d->imem_text, len + 1);
+    if (!line)
+    {
+        return 1;
+    }
+    d->imem_text = line;
+    d->lines = malloc((len + 1) * sizeof(char *));
+    if (!d->lines)
+    {
+        return 1;
+    }
+    d->imem_text[len] = '\0';
+    for (i = 0; i <= len; i++)
+    {
+        if (i == len ? line < d->imem_text + len : d->imem_text[i] == '\n')
+        {
+            d->imem_text[i] = '\0';
+            strip_newline(line);
+            d->lines[d->line_count++] = line;
+            line = d->imem_text + i + 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Function that frees the debugger, its history and its machine.
+ *
+ * @param d The debugger.
+ */
+void free_debugger(Debugger *d)
+{
+    history_destroy(d->history);
+    sim_destroy(d->machine);
+    free(d->lines);
+    free(d->imem_text);
+}
+
+/**
+ * @brief Signal handler that stops the current run at the end of its step.
+ *
+ * @param sig The signal.
+ */
+void interrupt_run(int sig)
+{
+    interrupted = TRUE;
+    signal(sig, interrupt_run);
+}
+
+/**
+ * @brief Function that carries out one command.
+ *
+ * @param d The debugger.
+ * @param line The command line.
+ * @return FALSE (0) to quit, TRUE (1) otherwise.
+ */
+int run_command(Debugger *d, char *line)
+{
+    char *args[MAX_ARGS];
+    int count = 0;
+    unsigned long long number;
+
+    for (args[0] = strtok(line, " \t\r\n"); args[count] && count < MAX_ARGS - 1; args[count] = strtok(NULL, " \t\r\n"))
+    {
+        count++;
+    }
+    if (count == 0)
+    {
+        return TRUE;
+    }
+    number = count > 1 ? strtoull(args[1], NULL, 0) : 1;
+    interrupted = FALSE;
+
+    if (strcmp(args[0], "step") == 0 || strcmp(args[0], "s") == 0)
+    {
+        step_forward(d, (unsigned int)number);
+    }
+    else if (strcmp(args[0], "reverse-step") == 0 || strcmp(args[0], "rs") == 0)
+    {
+        step_backward(d, (unsigned int)number);
+    }
+    else if (strcmp(args[0], "continue") == 0 || strcmp(args[0], "c") == 0)
+    {
+        continue_forward(d);
+    }
+    else if (strcmp(args[0], "reverse-continue") == 0 || strcmp(args[0], "rc") == 0)
+    {
+        continue_backward(d);
+    }
+    else if ((strcmp(args[0], "goto") == 0 || strcmp(args[0], "g") == 0) && count > 1)
+    {
+        if (history_seek(d->history, number))
+        {
+            printf("Cycle %llu is outside the run\n", number);
+        }
+        show_position(d);
+    }
+    else if ((strcmp(args[0], "break") == 0 || strcmp(args[0], "b") == 0) && count > 1)
+    {
+        add_breakpoint(d, args[1]);
+    }
+    else if ((strcmp(args[0], "watch") == 0 || strcmp(args[0], "w") == 0) && count > 1)
+    {
+        add_watch(d, args[1]);
+    }
+    else if (strcmp(args[0], "delete") == 0 || strcmp(args[0], "d") == 0)
+    {
+        d->breakpoint_count = 0;
+        d->watch_count = 0;
+    }
+    else if (strcmp(args[0], "regs") == 0 || strcmp(args[0], "r") == 0)
+    {
+        show_registers(d);
+    }
+    else if (strcmp(args[0], "x") == 0 && count > 1)
+    {
+        show_memory(d, (int)number, count > 2 ? (int)strtol(args[2], NULL, 0) : 1);
+    }
+    else if (strcmp(args[0], "info") == 0 || strcmp(args[0], "i") == 0)
+    {
+        show_info(d);
+    }
+    else if (strcmp(args[0], "quit") == 0 || strcmp(args[0], "q") == 0)
+    {
+        return FALSE;
+    }
+    else
+    {
+        show_help();
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Function that runs the program forward by a number of cycles.
+ *
+ * @param d The debugger.
+ * @param cycles The number of cycles.
+ */
+void step_forward(Debugger *d, unsigned int cycles)
+{
+    if (history_step(d->history, cycles) == SIM_ERROR)
+    {
+        printf("Cannot take a snapshot, out of memory\n");
+    }
+    show_position(d);
+}
+
+/**
+ * @brief Function that moves the program back by a number of cycles, to the start of the history at most.
+ *
+ * @param d The debugger.
+ * @param cycles The number of cycles.
+ */
+void step_backward(Debugger *d, unsigned int cycles)
+{
+    uint64_t now = sim_cycles_run(d->machine), start = history_start(d->history);
+    history_seek(d->history, now - start > cycles ? now - cycles : start);
+    show_position(d);
+}
+
+/**
+ * @brief Function that runs the program forward until it reaches a breakpoint, a watch changes or it halts.
+ * Without breakpoints and watches the program runs in whole snapshot intervals, otherwise cycle by cycle.
+ *
+ * @param d The debugger.
+ */
+void continue_forward(Debugger *d)
+{
+    Stop stop;
+    int status = SIM_RUNNING, pc;
+
+    read_watches(d);
+    while (status == SIM_RUNNING && !interrupted)
+    {
+        if (d->breakpoint_count == 0 && d->watch_count == 0)
+        {
+            status = history_step(d->history, history_interval(d->history));
+            continue;
+        }
+        pc = sim_get_pc(d->machine);
+        status = history_step(d->history, 1);
+        if (status != SIM_ERROR && check_stop(d, pc, &stop))
+        {
+            show_stop(d, &stop);
+            break;
+        }
+    }
+    if (status == SIM_ERROR)
+    {
+        printf("Cannot take a snapshot, out of memory\n");
+    }
+    show_position(d);
+}
+
+/**
+ * @brief Function that moves the program back to the last cycle before the current one at which it reached
+ * a breakpoint or a watch changed, or to the start of the history if there is none.
+ * The intervals between snapshots are searched from the latest to the earliest: each one is run again
+ * cycle by cycle from its snapshot, and the last stop found in it is the one the program moves to.
+ *
+ * @param d The debugger.
+ */
+void continue_backward(Debugger *d)
+{
+    uint64_t now = sim_cycles_run(d->machine), start = history_start(d->history), end, snapshot;
+    Stop stop, found;
+    int pc;
+
+    found.cycle = start;
+    for (end = now; end > start && found.cycle == start && !interrupted; end = snapshot)
+    {
+        /*Only cycles before the current one are searched, each interval ends where the later one begins.*/
+        snapshot = history_snapshot_before(d->history, end - 1);
+        if (history_seek(d->history, snapshot))
+        {
+            break;
+        }
+        read_watches(d);
+        while (sim_cycles_run(d->machine) < (end == now ? now - 1 : end) && !sim_halted(d->machine))
+        {
+            pc = sim_get_pc(d->machine);
+            if (history_step(d->history, 1) == SIM_ERROR)
+            {
+                break;
+            }
+            if (check_stop(d, pc, &stop))
+            {
+                found = stop;
+            }
+        }
+    }
+    history_seek(d->history, found.cycle);
+    if (found.cycle == start)
+    {
+        printf("Reached the start of the history\n");
+    }
+    else
+    {
+        read_watches(d);
+        show_stop(d, &found);
+    }
+    show_position(d);
+}
+
+/**
+ * @brief Function that adds a breakpoint.
+ *
+ * @param d The debugger.
+ * @param arg The address of the breakpoint.
+ * @return 0 on success, 1 if there are too many breakpoints.
+ */
+int add_breakpoint(Debugger *d, const char *arg)
+{
+    if (d->breakpoint_count == MAX_BREAKPOINTS)
+    {
+        printf("Too many breakpoints\n");
+        return 1;
+    }
+    d->breakpoints[d->breakpoint_count++] = (int)strtol(arg, NULL, 0);
+    printf("Breakpoint %d at %03X\n", d->breakpoint_count, d->breakpoints[d->breakpoint_count - 1]);
+    return 0;
+}
+
+/**
+ * @brief Function that adds a watch on a cpu register, given by its name or as $N, or on a memory word.
+ *
+ * @param d The debugger.
+ * @param arg The register or the address of the word.
+ * @return 0 on success, 1 for an unknown register or address, or if there are too many watches.
+ */
+int add_watch(Debugger *d, const char *arg)
+{
+    Watch *watch = &d->watches[d->watch_count];
+    if (d->watch_count == MAX_WATCHES)
+    {
+        printf("Too many watches\n");
+        return 1;
+    }
+    watch->is_register = arg[0] == '$';
+    watch->index = watch->is_register ? parse_register(arg) : (int)strtol(arg, NULL, 0);
+    if (watch->index < 0 || (!watch->is_register && watch->index >= SIM_MEM_DEPTH))
+    {
+        printf("Cannot watch %s\n", arg);
+        return 1;
+    }
+    d->watch_count++;
+    read_watches(d);
+    if (watch->is_register)
+    {
+        printf("Watch %d on %s = %08X\n", d->watch_count, register_names[watch->index], watch->value & 0xFFFFFFFF);
+    }
+    else
+    {
+        printf("Watch %d on memory %03X = %08X\n", d->watch_count, watch->index, watch->value & 0xFFFFFFFF);
+    }
+    return 0;
+}
+
+/**
+ * @brief Function that finds the number of a cpu register.
+ *
+ * @param name The name of the register, such as $t0, or its number, such as $7.
+ * @return The number of the register, or -1 if there is no such register.
+ */
+int parse_register(const char *name)
+{
+    char *end;
+    long number;
+    int i;
+    for (i = 0; i < SIM_CPU_REG_NUM; i++)
+    {
+        if (strcmp(name, register_names[i]) == 0)
+        {
+            return i;
+        }
+    }
+    number = strtol(name + 1, &end, 10);
+    return *end == '\0' && end != name + 1 && number >= 0 && number < SIM_CPU_REG_NUM ? (int)number : -1;
+}
+
+/**
+ * @brief Function that reads the current value of every watch.
+ *
+ * @param d The debugger.
+ */
+void read_watches(Debugger *d)
+{
+    int i;
+    for (i = 0; i < d->watch_count; i++)
+    {
+        d->watches[i].value = d->watches[i].is_register ? sim_get_register(d->machine, d->watches[i].index)
+                                                        : sim_read_memory(d->machine, d->watches[i].index);
+    }
+}
+
+/**
+ * @brief Function that checks if the run stops at the current cycle, and updates the values of the watches.
+ * The run stops when the program counter is at a breakpoint or when a watch changed in the last cycle.
+ *
+ * @param d The debugger.
+ * @param pc The program counter at the beginning of the last cycle.
+ * @param stop The reason of the stop.
+ * @return TRUE (1) if the run stops, FALSE (0) otherwise.
+ */
+int check_stop(Debugger *d, int pc, Stop *stop)
+{
+    int i, value, pc_now = sim_get_pc(d->machine);
+
+    stop->cycle = sim_cycles_run(d->machine);
+    stop->pc = pc;
+    stop->breakpoint = FALSE;
+    stop->watch = -1;
+    for (i = 0; i < d->breakpoint_count; i++)
+    {
+        if (d->breakpoints[i] == pc_now)
+        {
+            stop->breakpoint = TRUE;
+        }
+    }
+    for (i = 0; i < d->watch_count; i++)
+    {
+        value = d->watches[i].is_register ? sim_get_register(d->machine, d->watches[i].index)
+                                          : sim_read_memory(d->machine, d->watches[i].index);
+        if (value != d->watches[i].value && stop->watch < 0)
+        {
+            stop->watch = i;
+            stop->old_value = d->watches[i].value;
+            stop->new_value = value;
+        }
+        d->watches[i].value = value;
+    }
+    return stop->breakpoint || stop->watch >= 0;
+}
+
+/**
+ * @brief Function that prints the reason of a stop.
+ *
+ * @param d The debugger.
+ * @param stop The reason of the stop.
+ */
+void show_stop(Debugger *d, const Stop *stop)
+{
+    const Watch *watch;
+    if (stop->breakpoint)
+    {
+        printf("Breakpoint at %03X\n", sim_get_pc(d->machine));
+    }
+    if (stop->watch >= 0)
+    {
+        watch = &d->watches[stop->watch];
+        if (watch->is_register)
+        {
+            printf("%s", register_names[watch->index]);
+        }
+        else
+        {
+            printf("Memory %03X", watch->index);
+        }
+        printf(" changed from %08X to %08X by the instruction at %03X\n", stop->old_value & 0xFFFFFFFF,
+               stop->new_value & 0xFFFFFFFF, stop->pc);
+    }
+}
+
+/**
+ * @brief Function that prints the cycle, the program counter and the next instruction.
+ *
+ * @param d The debugger.
+ */
+void show_position(Debugger *d)
+{
+    int pc = sim_get_pc(d->machine);
+    uint64_t cycle = sim_cycles_run(d->machine);
+    printf("cycle %llu pc %03X", (unsigned long long)cycle, pc & 0xFFF);
+    if (pc >= 0 && pc < d->line_count)
+    {
+        printf(" %s", d->lines[pc]);
+    }
+    if ((unsigned int)cycle != sim_get_cycles(d->machine))
+    {
+        printf(" (clock %u)", sim_get_cycles(d->machine));
+    }
+    printf("%s\n", sim_halted(d->machine) ? " (halted)" : "");
+}
+
+/**
+ * @brief Function that prints the cpu registers.
+ *
+ * @param d The debugger.
+ */
+void show_registers(Debugger *d)
+{
+    int i;
+    for (i = 0; i < SIM_CPU_REG_NUM; i++)
+    {
+        printf("%-5s %08X%s", register_names[i], sim_get_register(d->machine, i) & 0xFFFFFFFF, i % 4 == 3 ? "\n" : "  ");
+    }
+}
+
+/**
+ * @brief Function that prints memory words.
+ *
+ * @param d The debugger.
+ * @param address The address of the first word.
+ * @param count The number of words.
+ */
+void show_memory(Debugger *d, int address, int count)
+{
+    int i;
+    for (i = 0; i < count && address + i < SIM_MEM_DEPTH; i++)
+    {
+        if (address + i < 0)
+        {
+            continue;
+        }
+        printf("%s%03X: %08X", i % 4 == 0 ? "" : "  ", address + i, sim_read_memory(d->machine, address + i) & 0xFFFFFFFF);
+        if (i % 4 == 3 || i == count - 1)
+        {
+            printf("\n");
+        }
+    }
+}
+
+/**
+ * @brief Function that prints the cycles covered by the history and the memory of its snapshots.
+ *
+ * @param d The debugger.
+ */
+void show_info(Debugger *d)
+{
+    printf("history: cycles %llu to %llu, %d snapshots every %u cycles, %lu KB\n",
+           (unsigned long long)history_start(d->history), (unsigned long long)history_end(d->history),
+           history_snapshot_count(d->history), history_interval(d->history),
+           (unsigned long)(history_bytes(d->history) >> 10));
+    printf("breakpoints: %d, watches: %d\n", d->breakpoint_count, d->watch_count);
+}
+
+/**
+ * @brief Function that prints the commands.
+ */
+void show_help(void)
+{
+    printf("step|s [N]              run N cycles, 1 by default\n"
+           "reverse-step|rs [N]     go back N cycles, 1 by default\n"
+           "continue|c              run to a breakpoint, a watched change or halt\n"
+           "reverse-continue|rc     go back to the last breakpoint or watched change\n"
+           "goto|g CYCLE            go to a clock cycle\n"
+           "break|b ADDR            stop when the program counter reaches ADDR\n"
+           "watch|w $REG|ADDR       stop when a register or a memory word changes\n"
+           "delete|d                remove all breakpoints and watches\n"
+           "regs|r                  print the registers\n"
+           "x ADDR [N]              print N memory words\n"
+           "info|i                  print the history\n"
+           "quit|q                  quit\n");
+}
@@ -0,0 +1,89 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libsimp.h"
+#include "simfiles.h"
+
+/*Function Prototypes*/
+
+void usage(void);
+
+int main(int argc, char *argv[])
+{
+    SimMachine *m = sim_create();
+    int i, text = FALSE, sectors, sector_words, extent, result;
+
+    if (!m)
+    {
+        return 1;
+    }
+    for (i = 1; i < argc && strncmp(argv[i], "--", 2) == 0; i++)
+    {
+        if (strcmp(argv[i], "--text") == 0)
+        {
+            text = TRUE;
+        }
+        else if (strcmp(argv[i], "--geometry") == 0 && i + 1 < argc)
+        {
+            if (parse_geometry(argv[++i], &sectors, &sector_words) || sim_set_disk_geometry(m, sectors, sector_words))
+            {
+                fprintf(stderr, "--geometry: expected SECTORSxWORDS with at most %d words a sector\n", SIM_MEM_DEPTH);
+                sim_destroy(m);
+                return 1;
+            }
+        }
+        else
+        {
+            usage();
+            sim_destroy(m);
+            return 1;
+        }
+    }
+    if (argc - i != 2)
+    {
+        usage();
+        sim_destroy(m);
+        return 1;
+    }
+    /*The input stays mapped while the output is written, so the output cannot replace it.*/
+    if (same_file(argv[i], argv[i + 1]))
+    {
+        fprintf(stderr, "%s: the output must be another file\n", argv[i + 1]);
+        sim_destroy(m);
+        return 1;
+    }
+    if (load_file(m, sim_load_disk, argv[i]))
+    {
+        sim_destroy(m);
+        return 1;
+    }
+    if (text)
+    {
+        /*A disk image has no extent, so its text ends at the last word that is not 0, like diskout.txt.*/
+        extent = sim_disk_attached(m) ? disk_last_word(m) : sim_disk_extent(m);
+        result = extent < 0 || write_disk_text(m, argv[i + 1], extent);
+    }
+    else
+    {
+        result = write_disk_image(m, argv[i + 1], NULL);
+    }
+    if (result)
+    {
+        fprintf(stderr, "Cannot write %s\n", argv[i + 1]);
+    }
+    sim_destroy(m);
+    return result;
+}
+
+/**
+ * @brief Function that prints how simdisk is used.
+ * A diskin.txt is converted to a disk image with the geometry given by --geometry, 128x128 by default,
+ * and --text converts a disk image, or a diskin.txt, back to text. The text of an image stops at its last word that
+ * is not 0, as diskout.txt stops at the last word written.
+ */
+void usage(void)
+{
+    fprintf(stderr, "Usage: simdisk [--geometry SECTORSxWORDS] diskin.txt disk.img\n"
+                    "       simdisk --text disk.img diskout.txt\n");
+}
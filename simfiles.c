@@ -0,0 +1,1347 @@
+#define _CRT_SECURE_NO_WARNINGS
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#define _FILE_OFFSET_BITS 64
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libsimp.h"
+#include "simfiles.h"
+#include "simimage.h"
+
+#include <time.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <direct.h>
+#define seek_file _fseeki64
+#define tell_file _ftelli64
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define seek_file fseeko
+#define tell_file ftello
+#endif
+
+/*Streams of the output files written during a run, and the index of each file name.*/
+static const int output_streams[OUTPUT_FILES] = {SIM_TRACE, SIM_HWREGTRACE, SIM_LEDS, SIM_DISPLAY7SEG};
+static const int output_files[OUTPUT_FILES] = {7, 8, 10, 11};
+
+/*DiskFile struct: a disk image attached to a machine as the base of its disk, released with the disk*/
+typedef struct DiskFile
+{
+    char *data;
+    size_t len;
+    int mapped;                 /*TRUE (1) if data is mapped by map_file, FALSE (0) if it is allocated*/
+} DiskFile;
+
+/**
+ * @brief Function to strip new line characters from the end of a command line argument.
+ *
+ * @param s A string representing the command line argument.
+ */
+void strip_newline(char *s)
+{
+    size_t len;
+    if (!s)
+    {
+        return;
+    }
+    len = strlen(s);
+    if (len > 0 && (s[len - 1] == '\n' || s[len - 1] == '\r'))
+    {
+        s[len - 1] = '\0';
+    }
+}
+
+/**
+ * @brief Function that reads a whole input file into memory.
+ *
+ * @param file_name The name of the file.
+ * @param len The length of the contents.
+ * @return The contents of the file, to be freed by the caller, or NULL on failure.
+ */
+char *read_file(const char *file_name, size_t *len)
+{
+    FILE *fp = fopen(file_name, "rb");
+    char *text = NULL, *grown;
+    size_t size = 0, n;
+
+    *len = 0;
+    if (!fp)
+    {
+        return NULL;
+    }
+    do
+    {
+        size = size ? 2 * size : 64 * 1024;
+        grown = realloc(text, size);
+        if (!grown)
+        {
+            free(text);
+            fclose(fp);
+            return NULL;
+        }
+        text = grown;
+        n = fread(text + *len, 1, size - *len, fp);
+        *len += n;
+    } while (*len == size);
+    fclose(fp);
+    return text;
+}
+
+/**
+ * @brief Function that maps a whole input file into memory, read only, where mmap is available.
+ *
+ * @param file_name The name of the file.
+ * @param len The length of the contents.
+ * @return The contents of the file, to be released with unmap_file, or NULL if the file cannot be mapped,
+ * which is always the case on Windows and for empty files and pipes.
+ */
+char *map_file(const char *file_name, size_t *len)
+{
+#ifdef _WIN32
+    (void)file_name;
+    *len = 0;
+    return NULL;
+#else
+    struct stat st;
+    void *data;
+    int fd = open(file_name, O_RDONLY);
+
+    *len = 0;
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode) || st.st_size <= 0)
+    {
+        close(fd);
+        return NULL;
+    }
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return NULL;
+    }
+    *len = (size_t)st.st_size;
+    return data;
+#endif
+}
+
+/**
+ * @brief Function that releases the contents of a file mapped by map_file.
+ *
+ * @param text The contents of the file.
+ * @param len The length of the contents.
+ */
+void unmap_file(char *text, size_t len)
+{
+#ifdef _WIN32
+    (void)text;
+    (void)len;
+#else
+    munmap(text, len);
+#endif
+}
+
+/**
+ * @brief Function that releases a disk image once the machine it is attached to no longer uses it.
+ *
+ * @param user The DiskFile of the image.
+ */
+static void release_disk_file(void *user)
+{
+    DiskFile *file = user;
+    if (file->mapped)
+    {
+        unmap_file(file->data, file->len);
+    }
+    else
+    {
+        free(file->data);
+    }
+    free(file);
+}
+
+/**
+ * @brief Function that attaches a disk image to a machine as the base of its disk. The machine owns the image from
+ * then on, and releases it with its disk, also when attaching fails.
+ *
+ * @param m The simulated machine.
+ * @param data The contents of the image, aligned to 8 bytes.
+ * @param len The length of the contents.
+ * @param mapped TRUE (1) if the contents are mapped by map_file, FALSE (0) if they are allocated.
+ * @param file_name The name of the image, used in the messages, or NULL to attach it without messages.
+ * @return 0 on success, 1 if the image is not valid or there is not enough memory.
+ */
+static int attach_disk_image(SimMachine *m, char *data, size_t len, int mapped, const char *file_name)
+{
+    const DiskImageHeader *header = disk_image_check(data, len);
+    DiskFile *file = header ? malloc(sizeof(DiskFile)) : NULL;
+    if (!file)
+    {
+        if (file_name)
+        {
+            fprintf(stderr, "%s: %s\n", file_name, header ? "not enough memory" : "not a valid disk image");
+        }
+        if (mapped)
+        {
+            unmap_file(data, len);
+        }
+        else
+        {
+            free(data);
+        }
+        return 1;
+    }
+    file->data = data;
+    file->len = len;
+    file->mapped = mapped;
+    return sim_attach_disk(m, disk_image_words(header), (int)header->sectors, (int)header->sector_words,
+                           release_disk_file, file);
+}
+
+/**
+ * @brief Function that reads an input file and loads it into the machine.
+ * The file is mapped and parsed in place where mmap is available, otherwise it is read.
+ * A disk image in place of diskin.txt stays mapped, and is attached as the base of the disk without reading it.
+ *
+ * @param m The simulated machine.
+ * @param load The loader of the image: sim_load_imem, sim_load_dmem, sim_load_disk or sim_load_irq2.
+ * @param file_name The name of the file.
+ * @return 0 on successful loading, 1 on failure.
+ */
+int load_file(SimMachine *m, int (*load)(SimMachine *, const char *, size_t), const char *file_name)
+{
+    size_t len;
+    char *text = map_file(file_name, &len);
+    int result, mapped = (text != NULL);
+    if (!mapped && !(text = read_file(file_name, &len)))
+    {
+        fprintf(stderr, "Cannot open %s\n", file_name);
+        return 1;
+    }
+    if (load == sim_load_disk && disk_image_is(text, len))
+    {
+        return attach_disk_image(m, text, len, mapped, file_name);
+    }
+    result = load_contents(m, load, text, len, file_name);
+    if (mapped)
+    {
+        unmap_file(text, len);
+    }
+    else
+    {
+        free(text);
+    }
+    return result;
+}
+
+/**
+ * @brief Function that loads the contents of an input file into the machine. In place of imemin.txt and dmemin.txt
+ * the file may be the binary image of a program written by asm -b, whose instructions and data memory are then
+ * loaded from the words of the image without parsing any text. In place of diskin.txt it may be a disk image,
+ * of which the machine keeps a copy as the base of its disk, since the contents are only valid during the call.
+ * A file that is not a valid image is reported with the line the loader failed on.
+ *
+ * @param m The simulated machine.
+ * @param load The loader of the image: sim_load_imem, sim_load_dmem, sim_load_disk or sim_load_irq2.
+ * @param text The contents of the file, aligned to 8 bytes.
+ * @param len The length of the contents.
+ * @param file_name The name of the file, used in the messages, or NULL to load it without messages.
+ * @return 0 on successful loading, 1 on failure.
+ */
+int load_contents(SimMachine *m, int (*load)(SimMachine *, const char *, size_t), const char *text, size_t len,
+                  const char *file_name)
+{
+    const ImageHeader *header;
+    const ImageRun *run;
+    const uint32_t *words;
+    uint32_t i, j;
+    int result;
+    char *copy;
+
+    if (load == sim_load_disk && disk_image_is(text, len))
+    {
+        if (!(copy = malloc(len)))
+        {
+            return 1;
+        }
+        memcpy(copy, text, len);
+        return attach_disk_image(m, copy, len, FALSE, file_name);
+    }
+    if (!image_is(text, len))
+    {
+        result = load(m, text, len);
+    }
+    else if (!(header = image_check(text, len)) || (load != sim_load_imem && load != sim_load_dmem))
+    {
+        if (file_name)
+        {
+            fprintf(stderr, "%s: %s\n", file_name, header ? "a program image holds only instructions and data memory"
+                                                         : "not a valid program image");
+        }
+        return 1;
+    }
+    else if (load == sim_load_imem)
+    {
+        result = sim_load_instructions(m, image_instructions(header), (int)header->instruction_count);
+    }
+    else
+    {
+        /*Clear the data memory, then write the runs, which extend the depth up to the end of the last one.*/
+        result = sim_load_dmem(m, "", 0);
+        for (i = 0, run = image_runs(header); i < header->run_count; i++, run = image_next_run(run))
+        {
+            words = (const uint32_t *)(run + 1);
+            for (j = 0; j < run->count; j++)
+            {
+                sim_write_memory(m, (int)(run->address + j), (int)words[j]);
+            }
+        }
+    }
+    if (result && file_name)
+    {
+        report_load_error(m, file_name);
+    }
+    return result;
+}
+
+/**
+ * @brief Function that prints why the last loader of an input file failed, with the line it failed on.
+ *
+ * @param m The simulated machine.
+ * @param file_name The name of the file.
+ * @return 1 if a loader failed, 0 otherwise.
+ */
+int report_load_error(const SimMachine *m, const char *file_name)
+{
+    int line;
+    const char *error = sim_load_error(m, &line);
+    if (!error)
+    {
+        return 0;
+    }
+    if (line > 0)
+    {
+        fprintf(stderr, "%s:%d: %s\n", file_name, line, error);
+    }
+    else
+    {
+        fprintf(stderr, "%s: %s\n", file_name, error);
+    }
+    return 1;
+}
+
+/**
+ * @brief Function that reads the next bytes of an input file that is streamed, for sim_stream_irq2.
+ *
+ * @param user The file.
+ * @param buf The buffer the bytes are read into.
+ * @param size The size of the buffer.
+ * @return The number of bytes read, 0 at the end of the file or on an error.
+ */
+static size_t read_stream(void *user, char *buf, size_t size)
+{
+    return fread(buf, 1, size, (FILE *)user);
+}
+
+/**
+ * @brief Function that closes an input file that was streamed, unless it is the standard input.
+ *
+ * @param user The file.
+ */
+static void close_stream(void *user)
+{
+    if ((FILE *)user != stdin)
+    {
+        fclose((FILE *)user);
+    }
+}
+
+/**
+ * @brief Function that streams irq2in.txt into the machine, which reads it as the program runs, so that a schedule
+ * of any size takes a few kilobytes. The file may be a pipe, and - reads the standard input.
+ *
+ * @param m The simulated machine.
+ * @param file_name The name of the file.
+ * @return 0 on success, 1 on failure.
+ */
+int stream_irq2_file(SimMachine *m, const char *file_name)
+{
+    FILE *fp = strcmp(file_name, "-") == 0 ? stdin : fopen(file_name, "rb");
+    if (!fp)
+    {
+        fprintf(stderr, "Cannot open %s\n", file_name);
+        return 1;
+    }
+    if (sim_stream_irq2(m, read_stream, close_stream, fp))
+    {
+        if (!report_load_error(m, file_name))
+        {
+            fprintf(stderr, "Cannot read %s\n", file_name);
+        }
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Function that compares two symbols by their addresses, for qsort.
+ *
+ * @param a The first symbol.
+ * @param b The second symbol.
+ * @return A negative number, 0 or a positive number as the address of a is lower than, equal to or higher than b's.
+ */
+static int compare_symbols(const void *a, const void *b)
+{
+    return ((const Symbol *)a)->address - ((const Symbol *)b)->address;
+}
+
+/**
+ * @brief Function that reads the labels of the binary image of a program written by asm -b, in place of the symbol file.
+ * The symbols are sorted by address.
+ *
+ * @param symbols_file The name of the image.
+ * @param text The contents of the image, freed by the function.
+ * @param len The length of the contents.
+ * @param symbols The symbols, to be freed by the caller.
+ * @param count The number of symbols.
+ * @return 0 on success, 1 if the image is not valid.
+ */
+static int image_symbols_of(const char *symbols_file, char *text, size_t len, Symbol **symbols, int *count)
+{
+    const ImageHeader *header = image_check(text, len);
+    const ImageSymbol *entries = header ? image_symbols(header) : NULL;
+    uint32_t i;
+    int valid = (header != NULL);
+
+    for (i = 0; valid && i < header->symbol_count; i++)
+    {
+        valid = entries[i].address >= 0 && entries[i].address < SIM_MEM_DEPTH && memchr(entries[i].name, '\0', MAX_SYMBOL);
+    }
+    if (!valid)
+    {
+        fprintf(stderr, "%s: not a valid program image\n", symbols_file);
+        free(text);
+        return 1;
+    }
+    if (header->symbol_count > 0 && !(*symbols = malloc(header->symbol_count * sizeof(Symbol))))
+    {
+        free(text);
+        return 1;
+    }
+    for (i = 0; i < header->symbol_count; i++)
+    {
+        strcpy((*symbols)[i].name, entries[i].name);
+        (*symbols)[i].address = entries[i].address;
+    }
+    *count = (int)header->symbol_count;
+    free(text);
+    if (*count > 1)
+    {
+        qsort(*symbols, (size_t)*count, sizeof(Symbol), compare_symbols);
+    }
+    return 0;
+}
+
+/**
+ * @brief Function that reads the symbol file written by the assembler, a line per label with its address
+ * in hex and its name, or the labels of the binary image of a program written by asm -b.
+ * The symbols are sorted by address.
+ *
+ * @param symbols_file The name of the symbol file.
+ * @param symbols The symbols, to be freed by the caller.
+ * @param count The number of symbols.
+ * @return 0 on success, 1 if the file cannot be read or a line is not a symbol.
+ */
+int load_symbols(const char *symbols_file, Symbol **symbols, int *count)
+{
+    size_t len;
+    char *text = read_file(symbols_file, &len), *line, *next, name[MAX_SYMBOL];
+    unsigned int address;
+    int capacity = 0, line_number = 0;
+    Symbol *grown;
+
+    *symbols = NULL;
+    *count = 0;
+    if (!text)
+    {
+        fprintf(stderr, "Cannot open symbol file %s\n", symbols_file);
+        return 1;
+    }
+    if (image_is(text, len))
+    {
+        return image_symbols_of(symbols_file, text, len, symbols, count);
+    }
+    for (line = text; line < text + len; line = next)
+    {
+        next = memchr(line, '\n', (size_t)(text + len - line));
+        next = next ? next + 1 : text + len;
+        line_number++;
+        if (strspn(line, " \t\r\n") >= (size_t)(next - line))
+        {
+            continue;
+        }
+        if (sscanf(line, "%x %49s", &address, name) != 2 || address >= SIM_MEM_DEPTH)
+        {
+            fprintf(stderr, "%s:%d: expected an address and a label\n", symbols_file, line_number);
+            free(text);
+            free(*symbols);
+            *symbols = NULL;
+            *count = 0;
+            return 1;
+        }
+        if (*count == capacity)
+        {
+            capacity = capacity ? 2 * capacity : 64;
+            grown = realloc(*symbols, (size_t)capacity * sizeof(Symbol));
+            if (!grown)
+            {
+                free(text);
+                free(*symbols);
+                *symbols = NULL;
+                *count = 0;
+                return 1;
+            }
+            *symbols = grown;
+        }
+        strcpy((*symbols)[*count].name, name);
+        (*symbols)[*count].address = (int)address;
+        (*count)++;
+    }
+    free(text);
+    if (*count > 1)
+    {
+        qsort(*symbols, (size_t)*count, sizeof(Symbol), compare_symbols);
+    }
+    return 0;
+}
+
+/**
+ * @brief Function that reads an address given as a number, decimal or 0x hex, or as a label.
+ *
+ * @param text The address.
+ * @param symbols The symbols of the program.
+ * @param count The number of symbols.
+ * @param address The address.
+ * @return 0 on success, 1 if the text is neither a number nor a known label.
+ */
+int parse_address(const char *text, const Symbol *symbols, int count, int *address)
+{
+    char *end;
+    long value;
+    int i;
+    if (text[0] >= '0' && text[0] <= '9')
+    {
+        value = strtol(text, &end, 0);
+        if (*end != '\0' || value < 0 || value >= SIM_MEM_DEPTH)
+        {
+            return 1;
+        }
+        *address = (int)value;
+        return 0;
+    }
+    for (i = 0; i < count; i++)
+    {
+        if (strcmp(symbols[i].name, text) == 0)
+        {
+            *address = symbols[i].address;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Function that reads a range of addresses: FIRST-LAST, a single address, or a label alone,
+ * which is the code from the label up to the next label, such as an interrupt handler.
+ *
+ * @param text The range.
+ * @param symbols The symbols of the program, sorted by address.
+ * @param count The number of symbols.
+ * @param first The first address of the range.
+ * @param last The last address of the range.
+ * @return 0 on success, 1 if the range is not valid.
+ */
+int parse_pc_range(const char *text, const Symbol *symbols, int count, int *first, int *last)
+{
+    char part[2 * MAX_SYMBOL + 2];
+    const char *dash = strchr(text, '-');
+    int i;
+
+    if (strlen(text) >= sizeof(part))
+    {
+        return 1;
+    }
+    if (dash)
+    {
+        memcpy(part, text, (size_t)(dash - text));
+        part[dash - text] = '\0';
+        return parse_address(part, symbols, count, first) || parse_address(dash + 1, symbols, count, last) ||
+               *first > *last;
+    }
+    if (parse_address(text, symbols, count, first))
+    {
+        return 1;
+    }
+    *last = *first;
+    if (text[0] < '0' || text[0] > '9')
+    {
+        *last = SIM_MEM_DEPTH - 1;
+        for (i = 0; i < count; i++)
+        {
+            if (symbols[i].address > *first)
+            {
+                *last = symbols[i].address - 1;
+                break;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Function that reads the geometry of a disk given as SECTORSxWORDS, such as 128x128.
+ *
+ * @param text The geometry.
+ * @param sectors The number of sectors.
+ * @param sector_words The number of words of a sector.
+ * @return 0 on success, 1 if the geometry is not two positive numbers separated by x.
+ */
+int parse_geometry(const char *text, int *sectors, int *sector_words)
+{
+    char *end;
+    long a = strtol(text, &end, 10), b;
+    if (end == text || *end != 'x' || a <= 0 || a > 0x7FFFFFFF)
+    {
+        return 1;
+    }
+    text = end + 1;
+    b = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || b <= 0 || b > 0x7FFFFFFF)
+    {
+        return 1;
+    }
+    *sectors = (int)a;
+    *sector_words = (int)b;
+    return 0;
+}
+
+/**
+ * @brief Function that sends trace.txt, hwregtrace.txt, leds.txt and display7seg.txt to their output files
+ * through a writer, whose thread writes the files while the machine runs.
+ *
+ * @param m The simulated machine.
+ * @param fps The output files of the streams, in the order of output_streams.
+ * @return The writer, to be passed to end_of_run, or NULL on failure, in which case the files are closed.
+ */
+Writer *attach_writer(SimMachine *m, FILE *fps[])
+{
+    Writer *writer = writer_create(fps, OUTPUT_FILES);
+    int i;
+    for (i = 0; i < OUTPUT_FILES; i++)
+    {
+        if (writer)
+        {
+            sim_set_sink(m, output_streams[i], write_to_writer, writer_file(writer, i));
+        }
+        else
+        {
+            fclose(fps[i]);
+        }
+    }
+    return writer;
+}
+
+/**
+ * @brief Function that indexes trace.txt as the writer writes it, in trace.txt.idx.
+ * A run that resumes from a checkpoint goes on with the index up to the position of the trace in the checkpoint.
+ *
+ * @param m The simulated machine, with the writer attached.
+ * @param writer The writer of the output files.
+ * @param trace_file The name of trace.txt.
+ * @param dense TRUE (1) if every cycle writes one line of the trace, FALSE (0) if the trace is filtered.
+ * @return The index, or NULL if it cannot be written.
+ */
+TraceIndex *attach_index(SimMachine *m, Writer *writer, const char *trace_file, int dense)
+{
+    TraceIndex *idx = index_create(trace_file, sim_get_format(m, SIM_TRACE), dense, sim_stream_bytes(m, SIM_TRACE),
+                                   write_to_writer, writer_file(writer, 0));
+    if (idx)
+    {
+        sim_set_sink(m, SIM_TRACE, write_to_index, idx);
+    }
+    return idx;
+}
+
+/**
+ * @brief Function for initializing everything needed in the beginning of the program.
+ *
+ * @param m The simulated machine.
+ * @param argc Number of command line arguments.
+ * @param argv The command line arguments which contains all file names.
+ * @param writer The writer of the output files written during the run: trace.txt, hwregtrace.txt, leds.txt
+ * and display7seg.txt.
+ * @param checkpoint_file A checkpoint to resume the run from, or NULL to start the run.
+ * When the run resumes, the output files are cut at the positions saved in the checkpoint and appended to.
+ * @param compression The compression method of trace.txt and hwregtrace.txt, COMPRESS_NONE to write them as they are.
+ * A run that resumes must compress them as the run that saved the checkpoint did.
+ * @param cache A directory of predecoded programs to load imemin.txt through, or NULL to load it as it is.
+ * @return 0 on successful initialization, 1 on failure.
+ */
+int first_init(SimMachine *m, int argc, char *argv[], Writer **writer, const char *checkpoint_file, int compression,
+               const ProgramCache *cache)
+{
+    FILE *fps[OUTPUT_FILES];
+    int i;
+    /*Check for valid number of command line arguments.*/
+    if (argc != RUN_FILES)
+    {
+        return 1;
+    }
+    /*Stripping new line characters from all command line arguments.*/
+    for (i = 0; i < argc; i++)
+    {
+        strip_newline(argv[i]);
+    }
+    /*Load the input files into the machine.*/
+    if (cache ? cache_load_imem(m, cache, argv[1]) : load_file(m, sim_load_imem, argv[1]))
+    {
+        return 1;
+    }
+    if (load_file(m, sim_load_dmem, argv[2]))
+    {
+        return 1;
+    }
+    if (load_file(m, sim_load_disk, argv[3]))
+    {
+        return 1;
+    }
+    if (stream_irq2_file(m, argv[4]))
+    {
+        return 1;
+    }
+    if (checkpoint_file && restore_checkpoint(m, checkpoint_file))
+    {
+        return 1;
+    }
+    /*Open output files used during fetch-decode-execute loop.*/
+    for (i = 0; i < OUTPUT_FILES; i++)
+    {
+        if (compression != COMPRESS_NONE && i < COMPRESSED_FILES)
+        {
+            /*The compressor cuts a compressed file, inside the frame that holds the position.*/
+            fps[i] = fopen(argv[output_files[i]],
+                           checkpoint_file && sim_stream_bytes(m, output_streams[i]) > 0 ? "r+b" : "wb");
+        }
+        else if (checkpoint_file)
+        {
+            fps[i] = open_at(argv[output_files[i]], sim_stream_bytes(m, output_streams[i]));
+        }
+        else
+        {
+            fps[i] = fopen(argv[output_files[i]], sim_get_format(m, output_streams[i]) == SIM_FORMAT_BINARY ? "wb" : "w");
+        }
+        if (!fps[i])
+        {
+            while (i-- > 0)
+            {
+                fclose(fps[i]);
+            }
+            return 1;
+        }
+    }
+    *writer = attach_writer(m, fps);
+    if (!*writer)
+    {
+        return 1;
+    }
+    for (i = 0; i < COMPRESSED_FILES && compression != COMPRESS_NONE; i++)
+    {
+        if (writer_compress(*writer, i, compression, checkpoint_file ? sim_stream_bytes(m, output_streams[i]) : 0))
+        {
+            fprintf(stderr, "Cannot compress %s\n", argv[output_files[i]]);
+            writer_destroy(*writer);
+            *writer = NULL;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Function that opens an output file of a run that resumes from a checkpoint.
+ * The file is cut at the position of its stream in the checkpoint, and the run appends to it from there.
+ *
+ * @param file_name The name of the file.
+ * @param position The number of bytes of the file written before the checkpoint.
+ * @return A pointer to the file, or NULL if it cannot be opened or is shorter than the position.
+ */
+FILE *open_at(const char *file_name, uint64_t position)
+{
+    FILE *fp = fopen(file_name, "r+b");
+    if (!fp)
+    {
+        return NULL;
+    }
+    if (seek_file(fp, 0, SEEK_END) || (uint64_t)tell_file(fp) < position)
+    {
+        fclose(fp);
+        return NULL;
+    }
+    if (truncate_file(fp, position))
+    {
+        fclose(fp);
+        return NULL;
+    }
+    return fp;
+}
+
+/**
+ * @brief Function that saves a checkpoint of the run to a file.
+ * The writer is flushed first, so the output files hold everything up to the positions in the checkpoint.
+ * The checkpoint is written to a temporary file that then replaces the previous checkpoint,
+ * so a run that stops while saving keeps the previous checkpoint.
+ *
+ * @param m The simulated machine.
+ * @param writer The writer of the output files written during the run.
+ * @param checkpoint_file The name of the checkpoint file.
+ * @return 0 on success, 1 on failure.
+ */
+int save_checkpoint(SimMachine *m, Writer *writer, const char *checkpoint_file)
+{
+    size_t size = sim_checkpoint_size(m);
+    char *buf = malloc(size), *temp_file = malloc(strlen(checkpoint_file) + 5);
+    FILE *fp;
+    int result = 1;
+
+    if (!buf || !temp_file || writer_flush(writer))
+    {
+        free(buf);
+        free(temp_file);
+        return 1;
+    }
+    strcpy(temp_file, checkpoint_file);
+    strcat(temp_file, ".tmp");
+    sim_save_checkpoint(m, buf, size);
+    fp = fopen(temp_file, "wb");
+    if (fp)
+    {
+        result = fwrite(buf, 1, size, fp) != size;
+        result |= fclose(fp) != 0;
+#ifdef _WIN32
+        remove(checkpoint_file);
+#endif
+        result = result || rename(temp_file, checkpoint_file) != 0;
+    }
+    free(buf);
+    free(temp_file);
+    return result;
+}
+
+/**
+ * @brief Function that restores a run from a checkpoint file.
+ * The file is mapped and restored in place where mmap is available, otherwise it is read.
+ *
+ * @param m The simulated machine, with the instructions and the irq 2 schedule of the run already loaded.
+ * @param checkpoint_file The name of the checkpoint file.
+ * @return 0 on success, 1 on failure.
+ */
+int restore_checkpoint(SimMachine *m, const char *checkpoint_file)
+{
+    size_t len;
+    char *data = map_file(checkpoint_file, &len);
+    int result, mapped = (data != NULL);
+    if (!mapped && !(data = read_file(checkpoint_file, &len)))
+    {
+        fprintf(stderr, "Cannot open checkpoint %s\n", checkpoint_file);
+        return 1;
+    }
+    result = sim_restore_checkpoint(m, data, len);
+    if (mapped)
+    {
+        unmap_file(data, len);
+    }
+    else
+    {
+        free(data);
+    }
+    if (result)
+    {
+        fprintf(stderr, "%s: not a checkpoint of this program\n", checkpoint_file);
+    }
+    return result;
+}
+
+/**
+ * @brief Function that names the files of a run whose output files are in a directory.
+ * The output files are named as in the examples of sim, and the names are indexed like the argv of sim.
+ *
+ * @param files The file names of the run, RUN_FILES entries freed with free_run_files.
+ * @param inputs The four input files: imemin.txt, dmemin.txt, diskin.txt and irq2in.txt.
+ * @param outdir The directory of the output files.
+ * @return 0 on success, 1 on failure.
+ */
+int init_run_files(char *files[], char *inputs[], const char *outdir)
+{
+    static const char *outputs[] = {"dmemout.txt", "regout.txt", "trace.txt", "hwregtrace.txt", "cycles.txt",
+                                    "leds.txt", "display7seg.txt", "diskout.txt", "monitor.txt", "monitor.yuv"};
+    int i, result = 0;
+    files[0] = join_path("sim", NULL);
+    for (i = 1; i <= 4; i++)
+    {
+        files[i] = join_path(inputs[i - 1], NULL);
+    }
+    for (i = 5; i < RUN_FILES; i++)
+    {
+        files[i] = join_path(outdir, outputs[i - 5]);
+    }
+    for (i = 0; i < RUN_FILES; i++)
+    {
+        result |= !files[i];
+    }
+    return result;
+}
+
+/**
+ * @brief Function that frees the file names of a run.
+ *
+ * @param files The file names of the run.
+ */
+void free_run_files(char *files[])
+{
+    int i;
+    for (i = 0; i < RUN_FILES; i++)
+    {
+        free(files[i]);
+        files[i] = NULL;
+    }
+}
+
+/**
+ * @brief Function that joins a directory and a file name into a new string.
+ *
+ * @param dir The directory.
+ * @param name The file name, or NULL to copy the directory.
+ * @return The path, to be freed by the caller, or NULL on failure.
+ */
+char *join_path(const char *dir, const char *name)
+{
+    size_t len = strlen(dir) + (name ? strlen(name) + 1 : 0) + 1;
+    char *path = malloc(len);
+    if (!path)
+    {
+        return NULL;
+    }
+    strcpy(path, dir);
+    if (name)
+    {
+        strcat(path, "/");
+        strcat(path, name);
+    }
+    return path;
+}
+
+/**
+ * @brief Function that creates an output directory if it does not exist.
+ *
+ * @param dir The directory.
+ */
+void make_dir(const char *dir)
+{
+#ifdef _WIN32
+    _mkdir(dir);
+#else
+    mkdir(dir, 0777);
+#endif
+}
+
+/**
+ * @brief Function that returns the wall time in seconds from an arbitrary start.
+ *
+ * @return The time in seconds.
+ */
+double now_seconds(void)
+{
+#ifndef _WIN32
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+#else
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/**
+ * @brief Function for writing to the output files at the end of the program.
+ * The function writes to dmemout.txt, regout.txt, cycles.txt, diskout.txt, monitor.txt and monitor.yuv output files.
+ *
+ * @param m The simulated machine.
+ * @param argv The command line arguments which contains all file names.
+ * @return 0 on successful writing to all files, 1 on failure.
+ */
+int write_output_files(SimMachine *m, char *argv[])
+{
+    /*Write to dmemout.txt output file.*/
+    if (write_to_dmemout(m, argv[5]))
+    {
+        return 1;
+    }
+    /*Write to regout.txt output file.*/
+    if (write_to_regout(m, argv[6]))
+    {
+        return 1;
+    }
+    /*Write to cycles.txt output file.*/
+    if (write_to_cycles(m, argv[9]))
+    {
+        return 1;
+    }
+    /*Write to diskout.txt output file.*/
+    if (write_to_diskout(m, argv[12], argv[3]))
+    {
+        return 1;
+    }
+    /*Write to monitor.txt and monitor.yuv output files.*/
+    if (write_to_monitor(m, argv[13], argv[14]))
+    {
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Function that writes values to a file as uppercase hex padded with zeros to a number of digits, one per line.
+ * The lines are formatted into one buffer without printf and written at once.
+ *
+ * @param fp The file.
+ * @param values The values.
+ * @param count The number of values.
+ * @param digits The minimum number of digits of each value, up to 8.
+ * @return 0 on success, 1 on failure.
+ */
+int write_hex_lines(FILE *fp, const unsigned int *values, int count, int digits)
+{
+    char *buf = malloc((size_t)count * 9 + 1), *p = buf;
+    size_t len;
+    int i;
+    if (!buf)
+    {
+        return 1;
+    }
+    for (i = 0; i < count; i++)
+    {
+        p = sim_format_hex(p, values[i], digits);
+        *p++ = '\n';
+    }
+    len = (size_t)(p - buf);
+    i = fwrite(buf, 1, len, fp) != len;
+    free(buf);
+    return i;
+}
+
+/**
+ * @brief Function for writing to dmemout.txt output file.
+ *
+ * @param m The simulated machine.
+ * @param dmem_out_file The name of the file.
+ * @return 0 on successful writing to file, 1 on failure.
+ */
+int write_to_dmemout(SimMachine *m, const char *dmemout_file)
+{
+    FILE *fp = fopen(dmemout_file, "w");
+    unsigned int words[SIM_MEM_DEPTH];
+    int i, result, depth = sim_memory_depth(m);
+    if (!fp)
+    {
+        return 1;
+    }
+    /*Write up to maximum depth of memory.*/
+    for (i = 0; i < depth; i++)
+    {
+        words[i] = (unsigned int)sim_read_memory(m, i);
+    }
+    result = write_hex_lines(fp, words, depth, 8);
+
+    result |= fclose(fp) != 0;
+    return result;
+}
+
+/**
+ * @brief Function for writing to regout.txt output file.
+ *
+ * @param m The simulated machine.
+ * @param regout_file The name of the file.
+ * @return 0 on successful writing to file, 1 on failure.
+ */
+int write_to_regout(SimMachine *m, const char *regout_file)
+{
+    FILE *fp = fopen(regout_file, "w");
+    unsigned int registers[SIM_CPU_REG_NUM];
+    int i, result;
+    if (!fp)
+    {
+        return 1;
+    }
+    for (i = 3; i < SIM_CPU_REG_NUM; i++)
+    {
+        registers[i - 3] = (unsigned int)sim_get_register(m, i);
+    }
+    result = write_hex_lines(fp, registers, SIM_CPU_REG_NUM - 3, 8);
+    result |= fclose(fp) != 0;
+    return result;
+}
+
+/**
+ * @brief Function for writing to cycles.txt output file.
+ * The remaining disk cycles are added if the program halted before the disk finished.
+ *
+ * @param m The simulated machine.
+ * @param cycles_file The name of the file.
+ * @return 0 on successful writing to file, 1 on failure.
+ */
+int write_to_cycles(SimMachine *m, const char *cycles_file)
+{
+    FILE *fp = fopen(cycles_file, "w");
+    if (!fp)
+    {
+        return 1;
+    }
+    fprintf(fp, "%d", (int)sim_get_cycles(m) + sim_disk_cycles_left(m));
+    fclose(fp);
+    return 0;
+}
+
+/**
+ * @brief Function for writing to diskout.txt output file, in the format of diskin.txt: text for a disk loaded from
+ * text, a disk image for a disk image.
+ *
+ * @param m The simulated machine.
+ * @param diskout_file The name of the file.
+ * @param diskin_file The name of diskin.txt. When diskout.txt names the same disk image, only the sectors the program
+ * wrote are written back into it.
+ * @return 0 on successful writing to file, 1 on failure or if the disk lost writes for lack of memory.
+ */
+int write_to_diskout(SimMachine *m, const char *diskout_file, const char *diskin_file)
+{
+    int result = sim_disk_attached(m) ? write_disk_image(m, diskout_file, diskin_file)
+                                      : write_disk_text(m, diskout_file, sim_disk_extent(m));
+    if (sim_disk_lost_writes(m) > 0)
+    {
+        fprintf(stderr, "%s: %d sector writes were lost for lack of memory\n", diskout_file, sim_disk_lost_writes(m));
+        result = 1;
+    }
+    return result;
+}
+
+/**
+ * @brief Function that writes the disk as text, a word per line up to an extent of the disk.
+ *
+ * @param m The simulated machine.
+ * @param diskout_file The name of the file.
+ * @param extent The number of words to write: sim_disk_extent as sim writes diskout.txt, or disk_last_word for a disk
+ * image, which has no extent of its own.
+ * @return 0 on successful writing to file, 1 on failure.
+ */
+int write_disk_text(SimMachine *m, const char *diskout_file, int extent)
+{
+    FILE *fp = fopen(diskout_file, "w");
+    unsigned int *words;
+    int i, result, sector_words = sim_disk_sector_words(m);
+    if (!fp)
+    {
+        return 1;
+    }
+    words = malloc((size_t)(extent > 0 ? extent : 1) * sizeof(unsigned int));
+    if (!words)
+    {
+        fclose(fp);
+        return 1;
+    }
+    /*Write up to maximum disk offset.*/
+    for (i = 0; i < extent; i++)
+    {
+        words[i] = (unsigned int)sim_read_disk(m, i / sector_words, i % sector_words);
+    }
+    result = write_hex_lines(fp, words, extent, 8);
+    free(words);
+    result |= fclose(fp) != 0;
+    return result;
+}
+
+/**
+ * @brief Function that finds the end of the words of the disk that are not 0, so that text written up to it leaves
+ * out the trailing 0 words, as diskout.txt does. The sectors are read from the last one back.
+ *
+ * @param m The simulated machine.
+ * @return The number of words up to and including the last word that is not 0, -1 if there is not enough memory.
+ */
+int disk_last_word(const SimMachine *m)
+{
+    int sector_words = sim_disk_sector_words(m), sector = sim_disk_sectors(m), i;
+    int32_t *words = malloc((size_t)sector_words * sizeof(int32_t));
+    if (!words)
+    {
+        return -1;
+    }
+    while (sector-- > 0)
+    {
+        sim_read_sector(m, sector, words);
+        for (i = sector_words; i > 0 && words[i - 1] == 0; i--)
+        {
+        }
+        if (i > 0)
+        {
+            free(words);
+            return sector * sector_words + i;
+        }
+    }
+    free(words);
+    return 0;
+}
+
+/**
+ * @brief Function that writes the disk as a disk image. Written over the image the disk was attached from, only the
+ * dirty sectors are written, each at its place in the file; any other file receives every sector.
+ *
+ * @param m The simulated machine.
+ * @param diskout_file The name of the file.
+ * @param base_file The name of the image the disk was attached from, or NULL.
+ * @return 0 on successful writing to file, 1 on failure.
+ */
+int write_disk_image(SimMachine *m, const char *diskout_file, const char *base_file)
+{
+    int sectors = sim_disk_sectors(m), sector_words = sim_disk_sector_words(m), i, result = 0;
+    size_t sector_size = (size_t)sector_words * sizeof(int32_t);
+    int write_back = sim_disk_attached(m) && base_file && same_file(diskout_file, base_file);
+    int32_t *words = malloc(sector_size);
+    FILE *fp = words ? fopen(diskout_file, write_back ? "r+b" : "wb") : NULL;
+
+    if (!fp)
+    {
+        free(words);
+        return 1;
+    }
+    if (!write_back)
+    {
+        result = disk_image_write_header(fp, sectors, sector_words);
+    }
+    for (i = 0; i < sectors && !result; i++)
+    {
+        if (write_back && !sim_disk_dirty(m, i))
+        {
+            continue;
+        }
+        if (write_back)
+        {
+            result = seek_file(fp, (int64_t)(sizeof(DiskImageHeader) + (uint64_t)i * sector_size), SEEK_SET) != 0;
+        }
+        result = result || sim_read_sector(m, i, words) || fwrite(words, 1, sector_size, fp) != sector_size;
+    }
+    free(words);
+    result |= fclose(fp) != 0;
+    return result;
+}
+
+/**
+ * @brief Function that tells whether two names are of the same file.
+ *
+ * @param a The first name.
+ * @param b The second name.
+ * @return TRUE (1) if both name one existing file, FALSE (0) otherwise.
+ */
+int same_file(const char *a, const char *b)
+{
+#ifdef _WIN32
+    return strcmp(a, b) == 0;
+#else
+    struct stat x, y;
+    return stat(a, &x) == 0 && stat(b, &y) == 0 && x.st_dev == y.st_dev && x.st_ino == y.st_ino;
+#endif
+}
+
+/**
+ * @brief Function for writing to the monitor.txt ad monitor.yuv output files.
+ *
+ * @param m The simulated machine.
+ * @param monitor_txt_file The name of the monitor.txt file.
+ * @param monitor_yuv_file The name of the monitor.yuv file
+ * @return 0 on successful writing to file, 1 on failure.
+ */
+int write_to_monitor(SimMachine *m, const char *monitor_txt_file, const char *monitor_yuv_file)
+{
+    FILE *fp_txt, *fp_yuv;
+    unsigned int *pixels;
+    unsigned char *bytes;
+    int i, j, result, count = 0, extent = sim_monitor_extent(m);
+
+    fp_txt = fopen(monitor_txt_file, "w");
+    if (!fp_txt)
+    {
+        return 1;
+    }
+    fp_yuv = fopen(monitor_yuv_file, "w");
+    pixels = malloc(SIM_PIXELS * SIM_PIXELS * sizeof(unsigned int));
+    bytes = malloc(SIM_PIXELS * SIM_PIXELS);
+    if (!fp_yuv || !pixels || !bytes)
+    {
+        if (fp_yuv)
+        {
+            fclose(fp_yuv);
+        }
+        free(pixels);
+        free(bytes);
+        fclose(fp_txt);
+        return 1;
+    }
+
+    for (i = 0; i < SIM_PIXELS; i++)
+    {
+        for (j = 0; j < SIM_PIXELS; j++)
+        {
+            pixels[count] = (unsigned int)sim_read_pixel(m, i, j);
+            bytes[count] = (unsigned char)pixels[count];
+            count++;
+        }
+    }
+    /*Write to monitor.txt up to maximum monitor offset.*/
+    result = write_hex_lines(fp_txt, pixels, extent < count ? extent : count, 2);
+    result |= fwrite(bytes, 1, (size_t)count, fp_yuv) != (size_t)count;
+
+    free(pixels);
+    free(bytes);
+    result |= fclose(fp_txt) != 0;
+    result |= fclose(fp_yuv) != 0;
+    return result;
+}
+
+/**
+ * @brief Function for handling everything that happens at the end of the run.
+ * The function writes what is left of the output files written during the run, closes them
+ * and writes the remaining output files.
+ *
+ * @param m The simulated machine.
+ * @param argv The command line arguments which contains all file names.
+ * @param writer The writer of the output files written during the run.
+ * @return 0 on success, 1 on failure.
+ */
+int end_of_run(SimMachine *m, char *argv[], Writer *writer)
+{
+    int i, result;
+    /*Close all open files.*/
+    for (i = 0; i < OUTPUT_FILES; i++)
+    {
+        sim_set_sink(m, output_streams[i], NULL, NULL);
+    }
+    result = writer_destroy(writer);
+    /*A streamed irq 2 schedule is only checked as it is read, so an entry out of order is found during the run.*/
+    result |= report_load_error(m, argv[4]);
+
+    return write_output_files(m, argv) | result;
+}
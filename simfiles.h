@@ -0,0 +1,84 @@
+#ifndef SIMFILES_H
+#define SIMFILES_H
+
+#include <stdio.h>
+#include "libsimp.h"
+#include "simwriter.h"
+#include "simindex.h"
+#include "simcache.h"
+
+/*Constants*/
+
+#define TRUE 1
+#define FALSE 0
+#define RUN_FILES 15     /*Number of entries of the file names of a run, argv[1] to argv[14] as given to sim*/
+#define OUTPUT_FILES 4   /*Number of output files written during a run*/
+#define COMPRESSED_FILES 2   /*trace.txt and hwregtrace.txt, the first output files, may be compressed*/
+#define MAX_SYMBOL 50    /*Maximum length of a label, as in the assembler*/
+
+/*Symbol struct: a label of the program and its address, read from the symbol file written by the assembler*/
+typedef struct Symbol
+{
+    char name[MAX_SYMBOL];
+    int address;
+} Symbol;
+
+/*Functions that run a machine on the input and output files of the command line of sim.
+  The file names are indexed like argv: 1 to 4 are the inputs, 5 to 14 the outputs.*/
+
+/*Functions that initialize the machine at the beginning of the run.*/
+
+void strip_newline(char *s);
+int first_init(SimMachine *m, int argc, char *argv[], Writer **writer, const char *checkpoint_file, int compression,
+               const ProgramCache *cache);
+char *read_file(const char *file_name, size_t *len);
+char *map_file(const char *file_name, size_t *len);
+void unmap_file(char *text, size_t len);
+int load_file(SimMachine *m, int (*load)(SimMachine *, const char *, size_t), const char *file_name);
+int load_contents(SimMachine *m, int (*load)(SimMachine *, const char *, size_t), const char *text, size_t len,
+                  const char *file_name);
+int report_load_error(const SimMachine *m, const char *file_name);
+int stream_irq2_file(SimMachine *m, const char *file_name);
+
+/*Functions that read the symbol file of the assembler, resolve addresses given by label and read disk geometries.*/
+
+int load_symbols(const char *symbols_file, Symbol **symbols, int *count);
+int parse_address(const char *text, const Symbol *symbols, int count, int *address);
+int parse_pc_range(const char *text, const Symbol *symbols, int count, int *first, int *last);
+int parse_geometry(const char *text, int *sectors, int *sector_words);
+
+/*Functions that send the output streams to the output files during the run.*/
+
+Writer *attach_writer(SimMachine *m, FILE *fps[]);
+TraceIndex *attach_index(SimMachine *m, Writer *writer, const char *trace_file, int dense);
+
+/*Functions that save a run to a checkpoint and resume it.*/
+
+FILE *open_at(const char *file_name, uint64_t position);
+int save_checkpoint(SimMachine *m, Writer *writer, const char *checkpoint_file);
+int restore_checkpoint(SimMachine *m, const char *checkpoint_file);
+
+/*Functions that name and place the files of runs that write to an output directory.*/
+
+int init_run_files(char *files[], char *inputs[], const char *outdir);
+void free_run_files(char *files[]);
+char *join_path(const char *dir, const char *name);
+void make_dir(const char *dir);
+double now_seconds(void);
+
+/*Functions that write to the output files at the end of the run.*/
+
+int end_of_run(SimMachine *m, char *argv[], Writer *writer);
+int write_output_files(SimMachine *m, char *argv[]);
+int write_hex_lines(FILE *fp, const unsigned int *values, int count, int digits);
+int write_to_regout(SimMachine *m, const char *regout_file);
+int write_to_dmemout(SimMachine *m, const char *dmemout_file);
+int write_to_cycles(SimMachine *m, const char *cycles_file);
+int write_to_diskout(SimMachine *m, const char *diskout_file, const char *diskin_file);
+int write_disk_text(SimMachine *m, const char *diskout_file, int extent);
+int disk_last_word(const SimMachine *m);
+int write_disk_image(SimMachine *m, const char *diskout_file, const char *base_file);
+int same_file(const char *a, const char *b);
+int write_to_monitor(SimMachine *m, const char *monitor_txt_file, const char *monitor_yuv_file);
+
+#endif
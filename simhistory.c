@@ -0,0 +1,451 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdlib.h>
+#include <string.h>
+#include "libsimp.h"
+#include "simhistory.h"
+
+/*Constants*/
+
+#define PAGE_SIZE 1024
+
+/*Page struct: a piece of a checkpoint, shared by every snapshot in which it holds the same bytes*/
+typedef struct Page
+{
+    int refs;                        /*Number of snapshots that use the page*/
+    unsigned char data[PAGE_SIZE];
+} Page;
+
+/*Snapshot struct: the checkpoint of a snapshot, split into pages. Checkpoints grow as the program writes new
+  sectors of the disk, so each snapshot has its own size.*/
+typedef struct Snapshot
+{
+    size_t size;                     /*Size of the checkpoint*/
+    int page_count;                  /*Number of pages, the last one may be partly used*/
+    Page **pages;
+} Snapshot;
+
+/*History struct: the snapshots of a run, each one a checkpoint that is split into pages.
+  A page that did not change since the snapshot before is not copied but shared with it,
+  so a snapshot only adds the pages of memory, disk and monitor that were written in its interval.*/
+struct History
+{
+    SimMachine *machine;             /*The machine whose run is recorded*/
+    uint64_t start;                  /*Cycles run when the history was created, the cycle of the first snapshot*/
+    unsigned int interval;           /*Number of cycles between two snapshots*/
+    uint64_t end;                    /*Number of cycles from start to the furthest cycle reached*/
+    size_t max_bytes;                /*Memory of the snapshots beyond which every other one is dropped, 0 for no limit*/
+    size_t page_bytes;               /*Memory of the pages of all snapshots*/
+    size_t table_bytes;              /*Memory of the page tables of all snapshots*/
+    Snapshot *snapshots;             /*Snapshot i is at start + i * interval*/
+    int count;                       /*Number of snapshots*/
+    int capacity;                    /*Number of snapshots the snapshots array can hold*/
+    uint64_t *checkpoint;            /*A whole checkpoint, assembled from the pages of a snapshot to restore it*/
+    size_t checkpoint_capacity;      /*Bytes checkpoint can hold*/
+};
+
+/*Function Prototypes*/
+
+static uint64_t position(const History *h);
+static size_t page_len(size_t size, int page);
+static int reserve_checkpoint(History *h, size_t size);
+static void drop_snapshot(History *h, int index);
+static int take_snapshot(History *h);
+static int restore_snapshot(History *h, int index);
+static void thin_snapshots(History *h);
+
+/**
+ * @brief Function that creates the history of a run and takes its first snapshot at the current cycle.
+ * The history only restores the machine, it does not silence it, so the output streams should be discarded
+ * while it is used: a cycle that is reached again writes its output again.
+ *
+ * @param m The simulated machine, with its images already loaded.
+ * @param interval The number of cycles between two snapshots, 0 for HISTORY_INTERVAL.
+ * @param max_bytes The memory of the snapshots beyond which every other snapshot is dropped and the interval doubled,
+ * 0 for no limit.
+ * @return The history, or NULL if there is not enough memory.
+ */
+History *history_create(SimMachine *m, unsigned int interval, size_t max_bytes)
+{
+    History *h = calloc(1, sizeof(History));
+    if (!h)
+    {
+        return NULL;
+    }
+    h->machine = m;
+    h->start = sim_cycles_run(m);
+    h->interval = interval ? interval : HISTORY_INTERVAL;
+    h->max_bytes = max_bytes;
+    if (take_snapshot(h))
+    {
+        history_destroy(h);
+        return NULL;
+    }
+    return h;
+}
+
+/**
+ * @brief Function that frees a history and all of its snapshots. The machine is not freed.
+ *
+ * @param h The history, or NULL.
+ */
+void history_destroy(History *h)
+{
+    if (!h)
+    {
+        return;
+    }
+    while (h->count > 0)
+    {
+        drop_snapshot(h, --h->count);
+    }
+    free(h->snapshots);
+    free(h->checkpoint);
+    free(h);
+}
+
+/**
+ * @brief Function that runs the machine forward and takes a snapshot whenever it first reaches a snapshot cycle.
+ *
+ * @param h The history.
+ * @param cycles The maximum number of clock cycles to run.
+ * @return SIM_HALTED if the program has halted, SIM_RUNNING otherwise, SIM_ERROR if a snapshot could not be taken.
+ */
+int history_step(History *h, unsigned int cycles)
+{
+    unsigned int left = cycles, count;
+    uint64_t now;
+
+    while (left > 0 && !sim_halted(h->machine))
+    {
+        /*Stop at the next snapshot cycle.*/
+        now = position(h);
+        count = h->interval - (unsigned int)(now % h->interval);
+        if (count > left)
+        {
+            count = left;
+        }
+        sim_step(h->machine, count);
+        left -= count;
+
+        now = position(h);
+        if (now > h->end)
+        {
+            h->end = now;
+        }
+        if (now % h->interval == 0 && now / h->interval == (uint64_t)h->count && take_snapshot(h))
+        {
+            return SIM_ERROR;
+        }
+    }
+    return sim_halted(h->machine) ? SIM_HALTED : SIM_RUNNING;
+}
+
+/**
+ * @brief Function that moves the machine to a clock cycle, backwards or forwards.
+ * A cycle behind the machine is reached by restoring the last snapshot before it and running forward,
+ * a cycle ahead of it by running forward, taking snapshots on the way.
+ *
+ * @param h The history.
+ * @param cycle The cycle, counted by sim_cycles_run.
+ * @return 0 on success, 1 if the cycle is before the start of the history or after the program halts,
+ * in which case the machine is left where it halted, or if a snapshot could not be taken or restored.
+ */
+int history_seek(History *h, uint64_t cycle)
+{
+    uint64_t target = cycle - h->start, now = position(h), snapshot;
+    int index;
+
+    if (cycle < h->start)
+    {
+        return 1;
+    }
+    index = target / h->interval < (uint64_t)h->count ? (int)(target / h->interval) : h->count - 1;
+    snapshot = (uint64_t)index * h->interval;
+
+    /*Run forward from the machine when it is between the snapshot and the target, from the snapshot otherwise.*/
+    if (now < snapshot || now > target)
+    {
+        if (restore_snapshot(h, index))
+        {
+            return 1;
+        }
+        now = snapshot;
+    }
+    while (now < target && !sim_halted(h->machine))
+    {
+        if (history_step(h, target - now < 0xFFFFFFFF ? (unsigned int)(target - now) : 0xFFFFFFFF) == SIM_ERROR)
+        {
+            return 1;
+        }
+        now = position(h);
+    }
+    return now == target ? 0 : 1;
+}
+
+/**
+ * @brief Function that returns the first cycle of the history.
+ *
+ * @param h The history.
+ * @return The cycles run when the history was created.
+ */
+uint64_t history_start(const History *h)
+{
+    return h->start;
+}
+
+/**
+ * @brief Function that returns the furthest cycle the machine has reached.
+ *
+ * @param h The history.
+ * @return The cycle, counted by sim_cycles_run.
+ */
+uint64_t history_end(const History *h)
+{
+    return h->start + h->end;
+}
+
+/**
+ * @brief Function that finds the snapshot from which a cycle is reached.
+ *
+ * @param h The history.
+ * @param cycle The cycle, counted by sim_cycles_run.
+ * @return The cycle of the last snapshot at or before cycle, or the start of the history if cycle is before it.
+ */
+uint64_t history_snapshot_before(const History *h, uint64_t cycle)
+{
+    uint64_t index;
+    if (cycle < h->start)
+    {
+        return h->start;
+    }
+    index = (cycle - h->start) / h->interval;
+    if (index >= (uint64_t)h->count)
+    {
+        index = (uint64_t)h->count - 1;
+    }
+    return h->start + index * h->interval;
+}
+
+/**
+ * @brief Function that returns the number of cycles between two snapshots, which doubles when snapshots are dropped.
+ *
+ * @param h The history.
+ * @return The number of cycles.
+ */
+unsigned int history_interval(const History *h)
+{
+    return h->interval;
+}
+
+/**
+ * @brief Function that returns the number of snapshots.
+ *
+ * @param h The history.
+ * @return The number of snapshots.
+ */
+int history_snapshot_count(const History *h)
+{
+    return h->count;
+}
+
+/**
+ * @brief Function that returns the memory used by the snapshots.
+ *
+ * @param h The history.
+ * @return The number of bytes of the pages and of the page tables.
+ */
+size_t history_bytes(const History *h)
+{
+    return h->page_bytes + h->table_bytes;
+}
+
+/**
+ * @brief Function that returns the number of cycles from the start of the history to the machine.
+ *
+ * @param h The history.
+ * @return The number of cycles.
+ */
+static uint64_t position(const History *h)
+{
+    return sim_cycles_run(h->machine) - h->start;
+}
+
+/**
+ * @brief Function that returns the number of bytes of a checkpoint held by a page.
+ *
+ * @param size The size of the checkpoint.
+ * @param page The index of the page.
+ * @return PAGE_SIZE, or less for the last page.
+ */
+static size_t page_len(size_t size, int page)
+{
+    size_t offset = (size_t)page * PAGE_SIZE;
+    return size - offset < PAGE_SIZE ? size - offset : PAGE_SIZE;
+}
+
+/**
+ * @brief Function that grows the buffer in which checkpoints are saved and assembled.
+ *
+ * @param h The history.
+ * @param size The size of a checkpoint.
+ * @return 0 on success, 1 if there is not enough memory, in which case the buffer is kept.
+ */
+static int reserve_checkpoint(History *h, size_t size)
+{
+    uint64_t *grown;
+    size = (size + 7) / 8 * 8;
+    if (size <= h->checkpoint_capacity)
+    {
+        return 0;
+    }
+    grown = realloc(h->checkpoint, size);
+    if (!grown)
+    {
+        return 1;
+    }
+    h->checkpoint = grown;
+    h->checkpoint_capacity = size;
+    return 0;
+}
+
+/**
+ * @brief Function that releases the pages of a snapshot, freeing the ones no other snapshot uses.
+ *
+ * @param h The history.
+ * @param index The index of the snapshot.
+ */
+static void drop_snapshot(History *h, int index)
+{
+    Snapshot *s = &h->snapshots[index];
+    int i;
+    for (i = 0; i < s->page_count; i++)
+    {
+        if (s->pages[i] && --s->pages[i]->refs == 0)
+        {
+            free(s->pages[i]);
+            h->page_bytes -= sizeof(Page);
+        }
+    }
+    free(s->pages);
+    h->table_bytes -= (size_t)s->page_count * sizeof(Page *);
+    s->pages = NULL;
+    s->page_count = 0;
+}
+
+/**
+ * @brief Function that adds a snapshot of the machine after the last one.
+ * Each page of the checkpoint is compared with the same page of the last snapshot and only copied if it changed.
+ * The sectors of the disk come last in the order they were first written, so a new sector only adds pages.
+ *
+ * @param h The history.
+ * @return 0 on success, 1 if there is not enough memory, in which case no snapshot is added.
+ */
+static int take_snapshot(History *h)
+{
+    const unsigned char *data;
+    Snapshot *s, *last, *grown;
+    size_t len, size = sim_checkpoint_size(h->machine);
+    int i, capacity;
+
+    if (h->count == h->capacity)
+    {
+        capacity = h->capacity ? 2 * h->capacity : 64;
+        grown = realloc(h->snapshots, (size_t)capacity * sizeof(Snapshot));
+        if (!grown)
+        {
+            return 1;
+        }
+        h->snapshots = grown;
+        h->capacity = capacity;
+    }
+    if (reserve_checkpoint(h, size))
+    {
+        return 1;
+    }
+    sim_save_checkpoint(h->machine, h->checkpoint, size);
+    data = (const unsigned char *)h->checkpoint;
+    s = &h->snapshots[h->count];
+    last = h->count ? s - 1 : NULL;
+    s->size = size;
+    s->page_count = (int)((size + PAGE_SIZE - 1) / PAGE_SIZE);
+    s->pages = calloc((size_t)s->page_count, sizeof(Page *));
+    if (!s->pages)
+    {
+        s->page_count = 0;
+        return 1;
+    }
+    h->table_bytes += (size_t)s->page_count * sizeof(Page *);
+    for (i = 0; i < s->page_count; i++)
+    {
+        len = page_len(size, i);
+        if (last && i < last->page_count && page_len(last->size, i) == len &&
+            memcmp(last->pages[i]->data, data + (size_t)i * PAGE_SIZE, len) == 0)
+        {
+            s->pages[i] = last->pages[i];
+            s->pages[i]->refs++;
+            continue;
+        }
+        s->pages[i] = malloc(sizeof(Page));
+        if (!s->pages[i])
+        {
+            drop_snapshot(h, h->count);
+            return 1;
+        }
+        s->pages[i]->refs = 1;
+        memcpy(s->pages[i]->data, data + (size_t)i * PAGE_SIZE, len);
+        h->page_bytes += sizeof(Page);
+    }
+    h->count++;
+
+    /*Keep the snapshots within their memory by spacing them further apart.*/
+    while (h->max_bytes && history_bytes(h) > h->max_bytes && h->count > 2 && h->interval <= 0x7FFFFFFF)
+    {
+        thin_snapshots(h);
+    }
+    return 0;
+}
+
+/**
+ * @brief Function that restores the machine to a snapshot.
+ *
+ * @param h The history.
+ * @param index The index of the snapshot.
+ * @return 0 on success, 1 if the machine no longer holds the program of the snapshot or there is not enough memory.
+ */
+static int restore_snapshot(History *h, int index)
+{
+    const Snapshot *s = &h->snapshots[index];
+    unsigned char *data;
+    int i;
+    if (reserve_checkpoint(h, s->size))
+    {
+        return 1;
+    }
+    data = (unsigned char *)h->checkpoint;
+    for (i = 0; i < s->page_count; i++)
+    {
+        memcpy(data + (size_t)i * PAGE_SIZE, s->pages[i]->data, page_len(s->size, i));
+    }
+    return sim_restore_checkpoint(h->machine, h->checkpoint, s->size);
+}
+
+/**
+ * @brief Function that drops every other snapshot and doubles the interval.
+ * The snapshots at even indexes are kept, so snapshot i is still at start + i * interval.
+ *
+ * @param h The history.
+ */
+static void thin_snapshots(History *h)
+{
+    int i;
+    for (i = 1; i < h->count; i += 2)
+    {
+        drop_snapshot(h, i);
+    }
+    for (i = 2; i < h->count; i += 2)
+    {
+        h->snapshots[i / 2] = h->snapshots[i];
+    }
+    h->count = (h->count + 1) / 2;
+    h->interval *= 2;
+}
@@ -0,0 +1,37 @@
+#ifndef SIMHISTORY_H
+#define SIMHISTORY_H
+
+#include <stddef.h>
+#include "libsimp.h"
+
+/*Constants*/
+
+#define HISTORY_INTERVAL (1U << 20)              /*Default number of cycles between two snapshots*/
+#define HISTORY_MAX_BYTES ((size_t)256 << 20)    /*Default memory of the snapshots, beyond which every other one is dropped*/
+
+/*The history of a run: snapshots of the machine taken every interval cycles as it runs forward,
+  from which any earlier cycle is reached again by restoring the snapshot before it and running forward.
+  The irq 2 schedule is the only input of a run, so running from a snapshot repeats the run exactly.
+  Cycles are counted by sim_cycles_run, since the program may write the clock.*/
+typedef struct History History;
+
+/*Creating and destroying histories.*/
+
+History *history_create(SimMachine *m, unsigned int interval, size_t max_bytes);
+void history_destroy(History *h);
+
+/*Moving through the run.*/
+
+int history_step(History *h, unsigned int cycles);
+int history_seek(History *h, uint64_t cycle);
+
+/*Inspecting the history.*/
+
+uint64_t history_start(const History *h);
+uint64_t history_end(const History *h);
+uint64_t history_snapshot_before(const History *h, uint64_t cycle);
+unsigned int history_interval(const History *h);
+int history_snapshot_count(const History *h);
+size_t history_bytes(const History *h);
+
+#endif
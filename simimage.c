@@ -0,0 +1,257 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "simimage.h"
+
+/**
+ * @brief Function that computes the checksum of an image, the FNV-1a hash of its bytes.
+ *
+ * @param data The bytes.
+ * @param len The number of bytes.
+ * @return The checksum.
+ */
+uint32_t image_checksum(const void *data, size_t len)
+{
+    const unsigned char *p = data;
+    uint32_t hash = 2166136261U;
+    size_t i;
+    for (i = 0; i < len; i++)
+    {
+        hash = (hash ^ p[i]) * 16777619U;
+    }
+    return hash;
+}
+
+/**
+ * @brief Function that writes the image of a program.
+ * The data memory is split into runs of words that are not 0, and the last word is always kept so the depth is known.
+ *
+ * @param fp The file of the image, opened for binary writing.
+ * @param instructions The instructions, the 12 hex digits of each one in the low 48 bits.
+ * @param instruction_count The number of instructions, at most IMAGE_DEPTH.
+ * @param data The data memory.
+ * @param depth The depth of the data memory, the number of lines of dmemin.txt, at most IMAGE_DEPTH.
+ * @param symbols The labels of the program.
+ * @param symbol_count The number of labels.
+ * @return 0 on success, 1 on failure.
+ */
+int image_write(FILE *fp, const uint64_t *instructions, int instruction_count, const int *data, int depth,
+                const ImageSymbol *symbols, int symbol_count)
+{
+    ImageHeader header;
+    ImageRun run;
+    size_t size, used;
+    char *payload;
+    int start, stop, result;
+
+    if (instruction_count < 0 || instruction_count > IMAGE_DEPTH || depth < 0 || depth > IMAGE_DEPTH || symbol_count < 0)
+    {
+        return 1;
+    }
+    /*At worst every other word starts a run.*/
+    size = (size_t)instruction_count * sizeof(uint64_t) + (size_t)depth * (sizeof(ImageRun) + sizeof(uint32_t)) +
+           (size_t)symbol_count * sizeof(ImageSymbol);
+    payload = malloc(size ? size : 1);
+    if (!payload)
+    {
+        return 1;
+    }
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, IMAGE_MAGIC, sizeof(header.magic));
+    header.version = IMAGE_VERSION;
+    header.byte_order = IMAGE_BYTE_ORDER;
+    header.instruction_count = (uint32_t)instruction_count;
+    header.symbol_count = (uint32_t)symbol_count;
+    used = (size_t)instruction_count * sizeof(uint64_t);
+    memcpy(payload, instructions, used);
+    for (stop = 0; stop < depth;)
+    {
+        /*Skip the zeros before the run, except the last word.*/
+        start = stop;
+        while (start < depth - 1 && data[start] == 0)
+        {
+            start++;
+        }
+        stop = start + 1;
+        while (stop < depth && (data[stop] != 0 || stop == depth - 1))
+        {
+            stop++;
+        }
+        run.address = (uint32_t)start;
+        run.count = (uint32_t)(stop - start);
+        memcpy(payload + used, &run, sizeof(run));
+        used += sizeof(run);
+        memcpy(payload + used, data + start, run.count * sizeof(uint32_t));
+        used += run.count * sizeof(uint32_t);
+        header.run_count++;
+        header.data_words += run.count;
+    }
+    memcpy(payload + used, symbols, (size_t)symbol_count * sizeof(ImageSymbol));
+    used += (size_t)symbol_count * sizeof(ImageSymbol);
+    header.checksum = image_checksum(payload, used);
+    result = fwrite(&header, sizeof(header), 1, fp) != 1 || fwrite(payload, 1, used, fp) != used;
+    free(payload);
+    return result;
+}
+
+/**
+ * @brief Function that tells whether the contents of an input file are an image rather than text.
+ *
+ * @param text The contents of the file.
+ * @param len The length of the contents.
+ * @return 1 if the file starts like an image, 0 otherwise.
+ */
+int image_is(const void *text, size_t len)
+{
+    return len >= sizeof(ImageHeader) && memcmp(text, IMAGE_MAGIC, 8) == 0;
+}
+
+/**
+ * @brief Function that checks that an image is complete and was written by this version for this byte order.
+ *
+ * @param image The image, aligned to 8 bytes, as it is when mapped or allocated.
+ * @param len The length of the image.
+ * @return The header of the image, or NULL if it is not valid.
+ */
+const ImageHeader *image_check(const void *image, size_t len)
+{
+    const ImageHeader *header = image;
+    const ImageRun *run;
+    uint64_t size;
+    uint32_t i, words = 0, next = 0;
+
+    if (!image_is(image, len) || header->version != IMAGE_VERSION || header->byte_order != IMAGE_BYTE_ORDER ||
+        header->instruction_count > IMAGE_DEPTH || header->data_words > IMAGE_DEPTH || header->run_count > IMAGE_DEPTH)
+    {
+        return NULL;
+    }
+    size = sizeof(ImageHeader) + (uint64_t)header->instruction_count * sizeof(uint64_t) +
+           (uint64_t)header->run_count * sizeof(ImageRun) + (uint64_t)header->data_words * sizeof(uint32_t) +
+           (uint64_t)header->symbol_count * sizeof(ImageSymbol);
+    if (size != len || image_checksum(header + 1, len - sizeof(ImageHeader)) != header->checksum)
+    {
+        return NULL;
+    }
+    /*The runs must stay inside the data memory and follow each other.*/
+    for (i = 0, run = image_runs(header); i < header->run_count; i++, run = image_next_run(run))
+    {
+        if (run->address < next || run->address > IMAGE_DEPTH || run->count > IMAGE_DEPTH - run->address ||
+            run->count > header->data_words - words)
+        {
+            return NULL;
+        }
+        words += run->count;
+        next = run->address + run->count;
+    }
+    return words == header->data_words ? header : NULL;
+}
+
+/**
+ * @brief Function that returns the instructions of an image.
+ *
+ * @param header The header of an image checked by image_check.
+ * @return The instructions.
+ */
+const uint64_t *image_instructions(const ImageHeader *header)
+{
+    return (const uint64_t *)(header + 1);
+}
+
+/**
+ * @brief Function that returns the first run of the data memory of an image.
+ *
+ * @param header The header of an image checked by image_check.
+ * @return The first run, its words follow it.
+ */
+const ImageRun *image_runs(const ImageHeader *header)
+{
+    return (const ImageRun *)(image_instructions(header) + header->instruction_count);
+}
+
+/**
+ * @brief Function that returns the run of the data memory after a run.
+ *
+ * @param run The run.
+ * @return The next run, which is past the last run after it.
+ */
+const ImageRun *image_next_run(const ImageRun *run)
+{
+    return (const ImageRun *)((const uint32_t *)(run + 1) + run->count);
+}
+
+/**
+ * @brief Function that returns the symbols of an image.
+ *
+ * @param header The header of an image checked by image_check.
+ * @return The symbols.
+ */
+const ImageSymbol *image_symbols(const ImageHeader *header)
+{
+    return (const ImageSymbol *)((const char *)image_runs(header) + header->run_count * sizeof(ImageRun) +
+                                 header->data_words * sizeof(uint32_t));
+}
+
+/**
+ * @brief Function that writes the header of a disk image, which the words of every sector then follow.
+ *
+ * @param fp The file of the image, opened for binary writing.
+ * @param sectors The number of sectors.
+ * @param sector_words The number of words of a sector.
+ * @return 0 on success, 1 on failure.
+ */
+int disk_image_write_header(FILE *fp, int sectors, int sector_words)
+{
+    DiskImageHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DISK_IMAGE_MAGIC, sizeof(header.magic));
+    header.version = DISK_IMAGE_VERSION;
+    header.byte_order = IMAGE_BYTE_ORDER;
+    header.sectors = (uint32_t)sectors;
+    header.sector_words = (uint32_t)sector_words;
+    return fwrite(&header, sizeof(header), 1, fp) != 1;
+}
+
+/**
+ * @brief Function that tells whether the contents of an input file are a disk image rather than text.
+ *
+ * @param data The contents of the file.
+ * @param len The length of the contents.
+ * @return 1 if the file starts like a disk image, 0 otherwise.
+ */
+int disk_image_is(const void *data, size_t len)
+{
+    return len >= sizeof(DiskImageHeader) && memcmp(data, DISK_IMAGE_MAGIC, 8) == 0;
+}
+
+/**
+ * @brief Function that checks that a disk image holds all of its sectors and was written by this version for this
+ * byte order. Only the header and the length are read, so checking a large image is as fast as a small one.
+ *
+ * @param image The image, aligned to 8 bytes, as it is when mapped or allocated.
+ * @param len The length of the image.
+ * @return The header of the image, or NULL if it is not valid.
+ */
+const DiskImageHeader *disk_image_check(const void *image, size_t len)
+{
+    const DiskImageHeader *header = image;
+    if (!disk_image_is(image, len) || header->version != DISK_IMAGE_VERSION || header->byte_order != IMAGE_BYTE_ORDER ||
+        header->sectors == 0 || header->sector_words == 0 || header->sector_words > IMAGE_DEPTH ||
+        header->sectors > 0x7FFFFFFFU / header->sector_words ||
+        (uint64_t)len != sizeof(DiskImageHeader) + (uint64_t)header->sectors * header->sector_words * sizeof(int32_t))
+    {
+        return NULL;
+    }
+    return header;
+}
+
+/**
+ * @brief Function that returns the words of the sectors of a disk image.
+ *
+ * @param header The header of an image checked by disk_image_check.
+ * @return The words, sector after sector.
+ */
+const int32_t *disk_image_words(const DiskImageHeader *header)
+{
+    return (const int32_t *)(header + 1);
+}
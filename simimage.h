@@ -0,0 +1,88 @@
+#ifndef SIMIMAGE_H
+#define SIMIMAGE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*Constants*/
+
+#define IMAGE_MAGIC "SIMPIMAG"
+#define IMAGE_VERSION 1
+#define IMAGE_BYTE_ORDER 0x01020304
+#define IMAGE_DEPTH 4096                /*Words of the instruction memory and of the data memory*/
+#define IMAGE_SYMBOL_LEN 52             /*Bytes of the name of a symbol, a label of up to 50 characters padded with '\0'*/
+#define DISK_IMAGE_MAGIC "SIMPDISK"
+#define DISK_IMAGE_VERSION 1
+
+/*The binary image of a program written by asm -b, which sim loads in place of imemin.txt, dmemin.txt and the
+  symbol file. It is an ImageHeader, the instructions as 64 bit words holding the 12 hex digits of each line of
+  imemin.txt in their low 48 bits, then the data memory as runs of words that are not 0, each an ImageRun followed
+  by its words, then an ImageSymbol for each label. The last run always ends at the depth of the data memory, so
+  the image holds as many words as dmemin.txt would. Every section is naturally aligned, so a mapped image is used
+  in place, and numbers are in the byte order of the machine that wrote it, as in checkpoints.*/
+
+/*ImageHeader struct: the start of an image*/
+typedef struct ImageHeader
+{
+    char magic[8];                  /*IMAGE_MAGIC, without the terminating '\0'*/
+    uint32_t version;               /*IMAGE_VERSION*/
+    uint32_t byte_order;            /*IMAGE_BYTE_ORDER as written by the host that wrote the image*/
+    uint32_t checksum;              /*image_checksum of everything after the header*/
+    uint32_t instruction_count;     /*Number of instructions*/
+    uint32_t run_count;             /*Number of runs of the data memory*/
+    uint32_t data_words;            /*Number of words of all the runs*/
+    uint32_t symbol_count;          /*Number of symbols*/
+    uint32_t reserved;              /*Aligns the instructions, always 0*/
+} ImageHeader;
+
+/*ImageRun struct: the start of a run of words of the data memory*/
+typedef struct ImageRun
+{
+    uint32_t address;               /*Address of the first word*/
+    uint32_t count;                 /*Number of words that follow*/
+} ImageRun;
+
+/*ImageSymbol struct: a label of the program*/
+typedef struct ImageSymbol
+{
+    int32_t address;
+    char name[IMAGE_SYMBOL_LEN];
+} ImageSymbol;
+
+/*The binary image of a disk, which sim maps in place of diskin.txt and attaches as the base of the disk, so a run
+  starts in constant time whatever the size of the disk. It is a DiskImageHeader followed by every sector, one after
+  another, as 32 bit words in the byte order of the machine that wrote it. Unlike a program image it has no checksum:
+  checking it would read the whole disk, and the sectors a run wrote may be written back into it in place.*/
+
+/*DiskImageHeader struct: the start of a disk image*/
+typedef struct DiskImageHeader
+{
+    char magic[8];                  /*DISK_IMAGE_MAGIC, without the terminating '\0'*/
+    uint32_t version;               /*DISK_IMAGE_VERSION*/
+    uint32_t byte_order;            /*IMAGE_BYTE_ORDER as written by the host that wrote the image*/
+    uint32_t sectors;               /*Number of sectors*/
+    uint32_t sector_words;          /*Number of words of a sector*/
+    uint64_t reserved;              /*Aligns the sectors, always 0*/
+} DiskImageHeader;
+
+/*Functions that write and check images.*/
+
+uint32_t image_checksum(const void *data, size_t len);
+int image_write(FILE *fp, const uint64_t *instructions, int instruction_count, const int *data, int depth,
+                const ImageSymbol *symbols, int symbol_count);
+const ImageHeader *image_check(const void *image, size_t len);
+int image_is(const void *text, size_t len);
+const uint64_t *image_instructions(const ImageHeader *header);
+const ImageRun *image_runs(const ImageHeader *header);
+const ImageRun *image_next_run(const ImageRun *run);
+const ImageSymbol *image_symbols(const ImageHeader *header);
+
+/*Functions that write and check disk images.*/
+
+int disk_image_write_header(FILE *fp, int sectors, int sector_words);
+const DiskImageHeader *disk_image_check(const void *image, size_t len);
+int disk_image_is(const void *data, size_t len);
+const int32_t *disk_image_words(const DiskImageHeader *header);
+
+#endif
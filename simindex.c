@@ -0,0 +1,538 @@
+#define _CRT_SECURE_NO_WARNINGS
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#define _FILE_OFFSET_BITS 64
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "simindex.h"
+
+#ifdef _WIN32
+#define seek_file _fseeki64
+#define tell_file _ftelli64
+#else
+#define seek_file fseeko
+#define tell_file ftello
+#endif
+
+/*Constants*/
+
+#define TRUE 1
+#define FALSE 0
+#define INDEX_BUFFER (1 << 20)          /*Bytes of the trace read at a time when the index is rebuilt*/
+
+/*TraceIndex struct: the index of a trace that is being written, and the position of the trace it reached*/
+struct TraceIndex
+{
+    FILE *fp;                                /*The index file*/
+    int format;                              /*Format of the trace*/
+    int dense;                               /*TRUE (1) if record n of the trace is cycle n*/
+    int error;                               /*TRUE (1) if writing to the index file failed*/
+    SimSink sink;                            /*Receives the trace after it is indexed, NULL for none*/
+    void *user;
+    uint64_t position;                       /*Bytes of the trace indexed*/
+    uint64_t header_left;                    /*Bytes of the header of a binary trace that are still to come*/
+    uint64_t records;                        /*Records of the trace indexed*/
+    uint32_t registers[INDEX_REGISTERS];     /*Values of $v0 to $ra after the last record*/
+    IndexEntry block;                        /*The block being indexed, without records until its first one*/
+};
+
+/*Function Prototypes*/
+
+static int resume_index(TraceIndex *idx, const char *index_file, uint64_t position);
+static int rescan(TraceIndex *idx, const char *trace_file, uint64_t position);
+static size_t scan_records(TraceIndex *idx, const unsigned char *data, size_t len, uint64_t limit);
+static void add_record(TraceIndex *idx, int pc, size_t len);
+static unsigned int get_word(const unsigned char *p);
+static int hex_digit(int c);
+
+/**
+ * @brief Function that creates the index of a trace and opens the index file next to it.
+ * A run that resumes from a checkpoint keeps the blocks of the index before the position of the trace in the
+ * checkpoint, except the last one, which is indexed again from the trace file along with the rest of the trace up
+ * to the position. If there is no index to resume, the whole trace up to the position is indexed again.
+ *
+ * @param trace_file The name of the trace file.
+ * @param format The format of the trace.
+ * @param dense TRUE (1) if every cycle of the run writes one record, FALSE (0) if the trace is filtered.
+ * @param position The number of bytes of the trace already written, 0 for a run that starts, or UINT64_MAX to
+ * index the whole trace file.
+ * @param sink Receives the trace after it is indexed, NULL for none.
+ * @param user The user data of the sink.
+ * @return The index, or NULL if the index file cannot be written or the trace cannot be read.
+ */
+TraceIndex *index_create(const char *trace_file, int format, int dense, uint64_t position, SimSink sink, void *user)
+{
+    TraceIndex *idx = calloc(1, sizeof(TraceIndex));
+    char *index_file = index_file_name(trace_file);
+    IndexHeader header;
+
+    if (!idx || !index_file)
+    {
+        free(idx);
+        free(index_file);
+        return NULL;
+    }
+    idx->format = format;
+    idx->dense = dense;
+    idx->sink = sink;
+    idx->user = user;
+    if (position == 0 || resume_index(idx, index_file, position))
+    {
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+        header.version = INDEX_VERSION;
+        header.format = (uint32_t)format;
+        header.dense = (uint32_t)dense;
+        idx->fp = fopen(index_file, "wb");
+        if (idx->fp && fwrite(&header, sizeof(header), 1, idx->fp) != 1)
+        {
+            fclose(idx->fp);
+            idx->fp = NULL;
+        }
+    }
+    free(index_file);
+    if (!idx->fp || rescan(idx, trace_file, position))
+    {
+        if (idx->fp)
+        {
+            fclose(idx->fp);
+        }
+        free(idx);
+        return NULL;
+    }
+    return idx;
+}
+
+/**
+ * @brief Function that reopens the index of a run that resumes from a checkpoint, and cuts it before the
+ * last block that ends at or before the position of the trace. That block is indexed again from its start.
+ *
+ * @param idx The index.
+ * @param index_file The name of the index file.
+ * @param position The number of bytes of the trace already written.
+ * @return 0 on success, 1 if there is no index of the same trace to resume.
+ */
+static int resume_index(TraceIndex *idx, const char *index_file, uint64_t position)
+{
+    IndexHeader header;
+    IndexEntry entry;
+    uint64_t count, low = 0, high;
+
+    idx->fp = index_open(index_file, &header, &count);
+    if (!idx->fp)
+    {
+        return 1;
+    }
+    fclose(idx->fp);
+    idx->fp = fopen(index_file, "r+b");
+    if (!idx->fp || header.format != (uint32_t)idx->format || header.dense != (uint32_t)idx->dense)
+    {
+        if (idx->fp)
+        {
+            fclose(idx->fp);
+        }
+        idx->fp = NULL;
+        return 1;
+    }
+    /*The blocks are in the order of the trace, find the first one that ends after the position.*/
+    high = count;
+    while (low < high)
+    {
+        if (index_read(idx->fp, low + (high - low) / 2, &entry))
+        {
+            break;
+        }
+        if (entry.end_offset <= position)
+        {
+            low += (high - low) / 2 + 1;
+        }
+        else
+        {
+            high = low + (high - low) / 2;
+        }
+    }
+    if (low < high || (low > 0 && index_read(idx->fp, low - 1, &entry)))
+    {
+        fclose(idx->fp);
+        idx->fp = NULL;
+        return 1;
+    }
+    if (truncate_file(idx->fp, sizeof(IndexHeader) + (low > 0 ? low - 1 : 0) * sizeof(IndexEntry)))
+    {
+        fclose(idx->fp);
+        idx->fp = NULL;
+        return 1;
+    }
+    if (low > 0)
+    {
+        idx->position = entry.offset;
+        idx->records = entry.first_record;
+        memcpy(idx->registers, entry.registers, sizeof(idx->registers));
+        idx->block.first_cycle = entry.first_cycle;
+    }
+    return 0;
+}
+
+/**
+ * @brief Function that indexes the trace file from the position the index reached to the position of the trace.
+ * A compressed trace is read through its frames, and the positions are those of the stream.
+ * In a dense index the blocks end every INDEX_INTERVAL records, as they would have in the run.
+ *
+ * @param idx The index.
+ * @param trace_file The name of the trace file.
+ * @param position The number of bytes of the trace already written, UINT64_MAX for the whole file.
+ * @return 0 on success, 1 if the trace file cannot be read or ends inside a record.
+ */
+static int rescan(TraceIndex *idx, const char *trace_file, uint64_t position)
+{
+    Stream *s;
+    unsigned char *buf;
+    size_t len = 0, n, used;
+    uint64_t limit;
+    int result = 0;
+
+    if (idx->position >= position)
+    {
+        return 0;
+    }
+    s = stream_open(trace_file);
+    buf = malloc(INDEX_BUFFER);
+    if (!s || !buf)
+    {
+        stream_close(s);
+        free(buf);
+        return 1;
+    }
+    while (idx->position < position)
+    {
+        n = INDEX_BUFFER - len;
+        if (n > position - idx->position - len)
+        {
+            n = (size_t)(position - idx->position - len);
+        }
+        n = stream_read(s, idx->position + len, buf + len, n);
+        len += n;
+        limit = idx->dense ? (idx->records / INDEX_INTERVAL + 1) * INDEX_INTERVAL : UINT64_MAX;
+        used = scan_records(idx, buf, len, limit);
+        if (idx->dense && idx->records == limit)
+        {
+            result |= index_mark(idx, limit);
+        }
+        if (used == 0 && n == 0)
+        {
+            result = len > 0 || position != UINT64_MAX;
+            break;
+        }
+        memmove(buf, buf + used, len - used);
+        len -= used;
+    }
+    stream_close(s);
+    free(buf);
+    return result;
+}
+
+/**
+ * @brief Sink that indexes the records of the trace and passes them on to the sink of the index.
+ *
+ * @param user The index.
+ * @param text One or more complete records.
+ * @param len The length of the records.
+ */
+void write_to_index(void *user, const char *text, size_t len)
+{
+    TraceIndex *idx = user;
+    if (idx->sink)
+    {
+        idx->sink(idx->user, text, len);
+    }
+    scan_records(idx, (const unsigned char *)text, len, UINT64_MAX);
+}
+
+/**
+ * @brief Function that indexes the complete records at the start of some bytes of the trace.
+ * A binary trace starts with a header that is skipped.
+ *
+ * @param idx The index.
+ * @param data The bytes of the trace at the position the index reached.
+ * @param len The number of bytes.
+ * @param limit The number of records of the trace at which to stop.
+ * @return The number of bytes indexed, which ends at the first incomplete record.
+ */
+static size_t scan_records(TraceIndex *idx, const unsigned char *data, size_t len, uint64_t limit)
+{
+    const unsigned char *end;
+    unsigned int word, mask;
+    size_t pos = 0, size, n;
+    int i, high, middle, low;
+
+    while (pos < len && idx->records < limit)
+    {
+        if (idx->header_left)
+        {
+            n = len - pos < idx->header_left ? len - pos : (size_t)idx->header_left;
+            pos += n;
+            idx->position += n;
+            idx->header_left -= n;
+            continue;
+        }
+        if (idx->format == SIM_FORMAT_BINARY && idx->position == 0)
+        {
+            if (len - pos < TRACE_HEADER)
+            {
+                break;
+            }
+            idx->header_left = TRACE_HEADER + (uint64_t)get_word(data + pos + TRACE_HEADER - 4) * TRACE_INSTRUCTION;
+            continue;
+        }
+        if (idx->format == SIM_FORMAT_BINARY)
+        {
+            if (len - pos < 4)
+            {
+                break;
+            }
+            word = get_word(data + pos);
+            mask = word >> TRACE_MASK_SHIFT;
+            for (size = 4, n = mask; n; n &= n - 1)
+            {
+                size += 4;
+            }
+            if (len - pos < size)
+            {
+                break;
+            }
+            add_record(idx, (int)(word & 0xFFF), size);
+            for (i = 0, n = 4; i < INDEX_REGISTERS; i++)
+            {
+                if (mask & (1U << i))
+                {
+                    idx->registers[i] = get_word(data + pos + n);
+                    n += 4;
+                }
+            }
+        }
+        else
+        {
+            end = memchr(data + pos, '\n', len - pos);
+            if (!end)
+            {
+                break;
+            }
+            size = (size_t)(end - (data + pos)) + 1;
+            high = size > 3 ? hex_digit(data[pos]) : -1;
+            middle = size > 3 ? hex_digit(data[pos + 1]) : -1;
+            low = size > 3 ? hex_digit(data[pos + 2]) : -1;
+            add_record(idx, (high | middle | low) < 0 ? -1 : (high << 8) | (middle << 4) | low, size);
+        }
+        pos += size;
+    }
+    return pos;
+}
+
+/**
+ * @brief Function that adds a record to the block being indexed. The first record of a block places it in the trace.
+ *
+ * @param idx The index.
+ * @param pc The address of the instruction of the record, -1 if the record does not show it.
+ * @param len The length of the record.
+ */
+static void add_record(TraceIndex *idx, int pc, size_t len)
+{
+    IndexEntry *block = &idx->block;
+    if (block->records == 0)
+    {
+        block->offset = idx->position;
+        block->first_record = idx->records;
+        memcpy(block->registers, idx->registers, sizeof(block->registers));
+    }
+    if (pc >= 0 && pc < SIM_MEM_DEPTH)
+    {
+        block->pcs[pc >> 3] |= (uint8_t)(1 << (pc & 7));
+    }
+    block->records++;
+    idx->records++;
+    idx->position += len;
+}
+
+/**
+ * @brief Function that ends the block being indexed at a cycle of the run and starts the next one there.
+ * A block without records is not written, it goes on to the next mark.
+ *
+ * @param idx The index.
+ * @param cycle The cycle of the run, counted by sim_cycles_run.
+ * @return 0 on success, 1 if the index file cannot be written.
+ */
+int index_mark(TraceIndex *idx, uint64_t cycle)
+{
+    IndexEntry *block = &idx->block;
+    if (block->records == 0)
+    {
+        return idx->error;
+    }
+    block->end_cycle = cycle;
+    block->end_offset = idx->position;
+    if (fwrite(block, sizeof(IndexEntry), 1, idx->fp) != 1)
+    {
+        idx->error = TRUE;
+    }
+    memset(block, 0, sizeof(IndexEntry));
+    block->first_cycle = cycle;
+    return idx->error;
+}
+
+/**
+ * @brief Function that tells the number of records indexed.
+ *
+ * @param idx The index.
+ * @return The number of records of the trace indexed.
+ */
+uint64_t index_records(const TraceIndex *idx)
+{
+    return idx->records;
+}
+
+/**
+ * @brief Function that ends the last block of the index, closes the index file and frees the index.
+ *
+ * @param idx The index.
+ * @param cycle The cycle the run ended at, counted by sim_cycles_run.
+ * @return 0 on success, 1 if the index file cannot be written.
+ */
+int index_close(TraceIndex *idx, uint64_t cycle)
+{
+    int result = index_mark(idx, cycle);
+    result |= fclose(idx->fp) != 0;
+    free(idx);
+    return result;
+}
+
+/**
+ * @brief Function that names the index of a trace file.
+ *
+ * @param trace_file The name of the trace file.
+ * @return The name of the index file, to be freed by the caller, or NULL if there is not enough memory.
+ */
+char *index_file_name(const char *trace_file)
+{
+    size_t len = strlen(trace_file);
+    char *name = malloc(len + sizeof(INDEX_SUFFIX));
+    if (name)
+    {
+        memcpy(name, trace_file, len);
+        memcpy(name + len, INDEX_SUFFIX, sizeof(INDEX_SUFFIX));
+    }
+    return name;
+}
+
+/**
+ * @brief Function that opens an index file to read it.
+ *
+ * @param index_file The name of the index file.
+ * @param header The header of the index.
+ * @param count The number of blocks, not counting an entry cut short by a run that stopped while writing it.
+ * @return A pointer to the file, or NULL if it cannot be opened or is not an index of this version.
+ */
+FILE *index_open(const char *index_file, IndexHeader *header, uint64_t *count)
+{
+    FILE *fp = fopen(index_file, "rb");
+    long long size;
+    if (!fp)
+    {
+        return NULL;
+    }
+    if (fread(header, sizeof(IndexHeader), 1, fp) != 1 || memcmp(header->magic, INDEX_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != INDEX_VERSION || seek_file(fp, 0, SEEK_END) || (size = (long long)tell_file(fp)) < 0)
+    {
+        fclose(fp);
+        return NULL;
+    }
+    *count = ((uint64_t)size - sizeof(IndexHeader)) / sizeof(IndexEntry);
+    return fp;
+}
+
+/**
+ * @brief Function that reads a block of an index.
+ *
+ * @param fp The index file.
+ * @param i The number of the block.
+ * @param entry The block.
+ * @return 0 on success, 1 if the block cannot be read.
+ */
+int index_read(FILE *fp, uint64_t i, IndexEntry *entry)
+{
+    return read_at(fp, sizeof(IndexHeader) + i * sizeof(IndexEntry), entry, sizeof(IndexEntry));
+}
+
+/**
+ * @brief Function that reads the instructions from the header of a binary trace.txt, which its records show by their
+ * pc. An empty instruction follows them, for a pc past the end of the program.
+ *
+ * @param s The trace, whose records start at TRACE_HEADER + count * TRACE_INSTRUCTION.
+ * @param instructions The instructions, to be freed by the caller, NULL on failure.
+ * @param count The number of instructions.
+ * @return 0 on success, 1 if the header is not valid.
+ */
+int read_trace_header(Stream *s, TraceInstruction **instructions, int *count)
+{
+    unsigned char header[TRACE_HEADER], *entries;
+    size_t len;
+    int i;
+
+    *instructions = NULL;
+    if (stream_read(s, 0, header, sizeof(header)) != sizeof(header) || memcmp(header, SIM_BINARY_MAGIC, 8) != 0 ||
+        get_word(header + 8) != SIM_BINARY_VERSION || get_word(header + 12) != SIM_TRACE ||
+        get_word(header + 16) > SIM_MEM_DEPTH)
+    {
+        return 1;
+    }
+    *count = (int)get_word(header + 16);
+    len = (size_t)*count * TRACE_INSTRUCTION;
+    entries = malloc(len + 1);
+    *instructions = calloc((size_t)*count + 1, sizeof(TraceInstruction));
+    if (!entries || !*instructions || stream_read(s, TRACE_HEADER, entries, len) != len)
+    {
+        free(entries);
+        free(*instructions);
+        *instructions = NULL;
+        return 1;
+    }
+    for (i = 0; i < *count; i++)
+    {
+        memcpy((*instructions)[i].text, entries + (size_t)i * TRACE_INSTRUCTION, TRACE_INSTRUCTION_LEN);
+        (*instructions)[i].imm1 = (int)get_word(entries + (size_t)i * TRACE_INSTRUCTION + TRACE_INSTRUCTION_LEN);
+        (*instructions)[i].imm2 = (int)get_word(entries + (size_t)i * TRACE_INSTRUCTION + TRACE_INSTRUCTION_LEN + 4);
+    }
+    free(entries);
+    return 0;
+}
+
+/**
+ * @brief Function that reads a little-endian 32 bit word.
+ *
+ * @param p The bytes of the word.
+ * @return The word.
+ */
+static unsigned int get_word(const unsigned char *p)
+{
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+/**
+ * @brief Function that reads an uppercase hex digit.
+ *
+ * @param c The character.
+ * @return The value of the digit, or -1 if the character is not one.
+ */
+static int hex_digit(int c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
@@ -0,0 +1,81 @@
+#ifndef SIMINDEX_H
+#define SIMINDEX_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "libsimp.h"
+#include "simcompress.h"
+
+/*Constants*/
+
+#define INDEX_MAGIC "SIMPTIDX"
+#define INDEX_VERSION 1
+#define INDEX_SUFFIX ".idx"                        /*The index of trace.txt is trace.txt.idx*/
+#define INDEX_INTERVAL 65536                       /*Cycles of the run between two blocks*/
+#define INDEX_REGISTERS (SIM_CPU_REG_NUM - 3)      /*Registers $v0 to $ra, the ones a trace record shows*/
+#define TRACE_HEADER 20                            /*Bytes of the header of a binary trace.txt before its instructions*/
+#define TRACE_INSTRUCTION 20                       /*Bytes of each instruction in the header of a binary trace.txt*/
+#define TRACE_INSTRUCTION_LEN 12                   /*Characters of the text of an instruction*/
+#define TRACE_MASK_SHIFT 12                        /*A record starts with its pc and, above it, the registers it holds*/
+
+/*The index of a trace.txt splits the trace into blocks, about one every INDEX_INTERVAL cycles of the run, and holds
+  where each block is in the file, so that a query reads only the blocks it needs. It works for the text and the
+  binary format alike: a block starts at a record, and holds the values of the registers before it, which a binary
+  record only writes when they change. In a dense index every cycle writes one record, so record n is cycle n;
+  when the trace is filtered only the cycles of each block are known.
+  The index file is an IndexHeader followed by an IndexEntry per block, in the byte order of the machine.*/
+
+/*IndexHeader struct: the start of an index file*/
+typedef struct IndexHeader
+{
+    char magic[8];                  /*INDEX_MAGIC*/
+    uint32_t version;               /*INDEX_VERSION*/
+    uint32_t format;                /*Format of the trace, SIM_FORMAT_TEXT or SIM_FORMAT_BINARY*/
+    uint32_t dense;                 /*TRUE (1) if record n of the trace is cycle n*/
+    uint32_t reserved;              /*Aligns the entries, always 0*/
+} IndexHeader;
+
+/*IndexEntry struct: a block of the trace*/
+typedef struct IndexEntry
+{
+    uint64_t first_cycle;                   /*Cycle of the run the block starts at*/
+    uint64_t end_cycle;                     /*Cycle after the block*/
+    uint64_t offset;                        /*Position of the first record of the block in the trace*/
+    uint64_t end_offset;                    /*Position after the last record of the block*/
+    uint64_t first_record;                  /*Number of records before the block*/
+    uint64_t records;                       /*Number of records of the block*/
+    uint32_t registers[INDEX_REGISTERS];    /*Values of $v0 to $ra before the first record of the block*/
+    uint32_t reserved;                      /*Aligns pcs, always 0*/
+    uint8_t pcs[SIM_MEM_DEPTH / 8];         /*A bit for each address of the instructions of the block*/
+} IndexEntry;
+
+/*TraceInstruction struct: what the header of a binary trace.txt holds for each instruction*/
+typedef struct TraceInstruction
+{
+    char text[TRACE_INSTRUCTION_LEN + 1];
+    int imm1;
+    int imm2;
+} TraceInstruction;
+
+/*The index of a trace that is being written.*/
+typedef struct TraceIndex TraceIndex;
+
+/*Writing an index as the trace is written.*/
+
+TraceIndex *index_create(const char *trace_file, int format, int dense, uint64_t position, SimSink sink, void *user);
+void write_to_index(void *user, const char *text, size_t len);
+int index_mark(TraceIndex *idx, uint64_t cycle);
+int index_close(TraceIndex *idx, uint64_t cycle);
+uint64_t index_records(const TraceIndex *idx);
+
+/*Reading an index.*/
+
+char *index_file_name(const char *trace_file);
+FILE *index_open(const char *index_file, IndexHeader *header, uint64_t *count);
+int index_read(FILE *fp, uint64_t i, IndexEntry *entry);
+
+/*Reading the header of a binary trace.txt, for the tools that print its records.*/
+
+int read_trace_header(Stream *s, TraceInstruction **instructions, int *count);
+
+#endif
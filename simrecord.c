@@ -0,0 +1,364 @@
+#define _CRT_SECURE_NO_WARNINGS
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#define _FILE_OFFSET_BITS 64
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "simrecord.h"
+#include "simfiles.h"
+#include "simcompress.h"
+
+#ifdef _WIN32
+#define seek_file _fseeki64
+#define tell_file _ftelli64
+#else
+#define seek_file fseeko
+#define tell_file ftello
+#endif
+
+/*Constants*/
+
+#define TRUE 1
+#define FALSE 0
+
+/*Recorder struct: the log of a run that is being recorded*/
+struct Recorder
+{
+    FILE *fp;
+    unsigned int interval;       /*Cycles of the run between two checkpoints*/
+    char *checkpoint;            /*A checkpoint*/
+    size_t capacity;             /*Bytes checkpoint can hold*/
+    int error;                   /*TRUE (1) if writing to the log failed*/
+};
+
+/*RunLog struct: a log read back, and where its checkpoints are*/
+struct RunLog
+{
+    FILE *fp;
+    RecordHeader header;
+    uint64_t first_mark;         /*Position of the first checkpoint in the log*/
+    uint64_t count;              /*Number of complete checkpoints*/
+    uint64_t *marks;             /*Position of each of them*/
+    uint64_t cycles;             /*Number of cycles the run took, UINT64_MAX if it did not halt*/
+    char *checkpoint;            /*A checkpoint*/
+    size_t capacity;             /*Bytes checkpoint can hold*/
+};
+
+/*Loaders of the input files, in the order of the log*/
+static int (*const loaders[RECORD_IMAGES])(SimMachine *, const char *, size_t) = {sim_load_imem, sim_load_dmem,
+                                                                                  sim_load_disk, sim_load_irq2};
+
+/*Function Prototypes*/
+
+static int reserve(char **buf, size_t *capacity, size_t size);
+
+/**
+ * @brief Function that starts the log of a run: it writes the header and the four input files.
+ *
+ * @param m The simulated machine, with the input files loaded.
+ * @param log_file The name of the log.
+ * @param inputs The names of imemin.txt, dmemin.txt, diskin.txt and irq2in.txt.
+ * @param interval Cycles of the run between two checkpoints.
+ * @return The recorder, or NULL if an input file cannot be read or the log cannot be written.
+ */
+Recorder *recorder_create(const SimMachine *m, const char *log_file, char *inputs[], unsigned int interval)
+{
+    Recorder *r = calloc(1, sizeof(Recorder));
+    RecordHeader header;
+    char *images[RECORD_IMAGES] = {NULL};
+    size_t len;
+    int i, result = 0;
+
+    if (!r)
+    {
+        return NULL;
+    }
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, RECORD_MAGIC, sizeof(header.magic));
+    header.version = RECORD_VERSION;
+    header.interval = interval;
+    header.disk_sectors = (uint32_t)sim_disk_sectors(m);
+    header.sector_words = (uint32_t)sim_disk_sector_words(m);
+    for (i = 0; i < RECORD_IMAGES; i++)
+    {
+        images[i] = read_file(inputs[i], &len);
+        header.image_sizes[i] = len;
+        result |= !images[i];
+    }
+    r->interval = interval;
+    r->fp = result ? NULL : fopen(log_file, "wb");
+    if (r->fp)
+    {
+        result |= fwrite(&header, sizeof(header), 1, r->fp) != 1;
+        for (i = 0; i < RECORD_IMAGES; i++)
+        {
+            result |= fwrite(images[i], 1, (size_t)header.image_sizes[i], r->fp) != header.image_sizes[i];
+        }
+        result |= fflush(r->fp) != 0;
+    }
+    for (i = 0; i < RECORD_IMAGES; i++)
+    {
+        free(images[i]);
+    }
+    if (!r->fp || result)
+    {
+        if (r->fp)
+        {
+            fclose(r->fp);
+        }
+        free(r->checkpoint);
+        free(r);
+        return NULL;
+    }
+    return r;
+}
+
+/**
+ * @brief Function that appends a checkpoint of the run to the log. It is called on every multiple of the interval
+ * of sim_cycles_run, and the log is flushed, so the log of a run that crashes holds every checkpoint before the crash.
+ *
+ * @param r The recorder.
+ * @param m The simulated machine.
+ * @return 0 on success, 1 if the log cannot be written.
+ */
+int recorder_mark(Recorder *r, const SimMachine *m)
+{
+    RecordMark mark;
+    size_t size = sim_checkpoint_size(m);
+    memset(&mark, 0, sizeof(mark));
+    mark.cycle = sim_cycles_run(m);
+    mark.size = size;
+    if (reserve(&r->checkpoint, &r->capacity, size) || sim_save_checkpoint(m, r->checkpoint, size) ||
+        fwrite(&mark, sizeof(mark), 1, r->fp) != 1 || fwrite(r->checkpoint, 1, size, r->fp) != size ||
+        fflush(r->fp) != 0)
+    {
+        r->error = TRUE;
+    }
+    return r->error;
+}
+
+/**
+ * @brief Function that ends the log of a run with the number of cycles it took, and frees the recorder.
+ *
+ * @param r The recorder, or NULL.
+ * @param m The simulated machine, after the run.
+ * @return 0 on success, 1 if the log could not be written.
+ */
+int recorder_close(Recorder *r, const SimMachine *m)
+{
+    RecordEnd end;
+    int result;
+    if (!r)
+    {
+        return 0;
+    }
+    memset(&end, 0, sizeof(end));
+    memcpy(end.magic, RECORD_END_MAGIC, sizeof(end.magic));
+    end.cycles = sim_cycles_run(m);
+    result = r->error || fwrite(&end, sizeof(end), 1, r->fp) != 1;
+    result |= fclose(r->fp) != 0;
+    free(r->checkpoint);
+    free(r);
+    return result;
+}
+
+/**
+ * @brief Function that opens the log of a run to replay it.
+ *
+ * @param log_file The name of the log.
+ * @return The log, or NULL if it cannot be read or was recorded by another version of the simulator.
+ */
+RunLog *runlog_open(const char *log_file)
+{
+    RunLog *log = calloc(1, sizeof(RunLog));
+    RecordEnd end;
+    RecordMark mark;
+    uint64_t size, offset, capacity = 0, *grown;
+    int i;
+
+    if (!log || !(log->fp = fopen(log_file, "rb")))
+    {
+        runlog_close(log);
+        return NULL;
+    }
+    if (fread(&log->header, sizeof(RecordHeader), 1, log->fp) != 1 ||
+        memcmp(log->header.magic, RECORD_MAGIC, sizeof(log->header.magic)) != 0 ||
+        log->header.version != RECORD_VERSION || log->header.interval == 0 || seek_file(log->fp, 0, SEEK_END))
+    {
+        runlog_close(log);
+        return NULL;
+    }
+    size = (uint64_t)tell_file(log->fp);
+    log->first_mark = sizeof(RecordHeader);
+    for (i = 0; i < RECORD_IMAGES; i++)
+    {
+        log->first_mark += log->header.image_sizes[i];
+    }
+    if (size < log->first_mark)
+    {
+        runlog_close(log);
+        return NULL;
+    }
+    log->cycles = UINT64_MAX;
+    if (size - log->first_mark >= sizeof(RecordEnd) && !read_at(log->fp, size - sizeof(RecordEnd), &end, sizeof(end)) &&
+        memcmp(end.magic, RECORD_END_MAGIC, sizeof(end.magic)) == 0)
+    {
+        log->cycles = end.cycles;
+        size -= sizeof(RecordEnd);
+    }
+    /*The checkpoints are found by their marks. A checkpoint cut short by a run that stopped while writing it
+      is left out.*/
+    for (offset = log->first_mark; size - offset >= sizeof(RecordMark); offset += sizeof(RecordMark) + mark.size)
+    {
+        if (read_at(log->fp, offset, &mark, sizeof(mark)) || mark.size > size - offset - sizeof(RecordMark))
+        {
+            break;
+        }
+        if (log->count == capacity)
+        {
+            capacity = capacity ? 2 * capacity : 64;
+            grown = realloc(log->marks, (size_t)capacity * sizeof(uint64_t));
+            if (!grown)
+            {
+                runlog_close(log);
+                return NULL;
+            }
+            log->marks = grown;
+        }
+        log->marks[log->count++] = offset;
+    }
+    return log;
+}
+
+/**
+ * @brief Function that loads the input files of the log into a machine, which then starts the run.
+ *
+ * @param log The log.
+ * @param m The simulated machine.
+ * @return 0 on success, 1 if an input file cannot be read or loaded.
+ */
+int runlog_load(RunLog *log, SimMachine *m)
+{
+    uint64_t offset = sizeof(RecordHeader);
+    char *text;
+    int i, result = 0;
+
+    result = sim_set_disk_geometry(m, (int)log->header.disk_sectors, (int)log->header.sector_words);
+    for (i = 0; i < RECORD_IMAGES && !result; i++)
+    {
+        text = malloc((size_t)log->header.image_sizes[i] + 1);
+        result = !text || read_at(log->fp, offset, text, (size_t)log->header.image_sizes[i]) ||
+                 load_contents(m, loaders[i], text, (size_t)log->header.image_sizes[i], NULL);
+        offset += log->header.image_sizes[i];
+        free(text);
+    }
+    return result;
+}
+
+/**
+ * @brief Function that restores the last checkpoint of the log at or before a cycle of the run,
+ * on a machine loaded by runlog_load that has not run yet. Before the first checkpoint the machine is left as it is.
+ *
+ * @param log The log.
+ * @param m The simulated machine.
+ * @param cycle The cycle of the run.
+ * @return 0 on success, 1 if the checkpoint cannot be read or restored.
+ */
+int runlog_seek(RunLog *log, SimMachine *m, uint64_t cycle)
+{
+    uint64_t i = cycle / log->header.interval;
+    RecordMark mark;
+
+    if (i > log->count)
+    {
+        i = log->count;
+    }
+    if (i == 0)
+    {
+        return 0;
+    }
+    return read_at(log->fp, log->marks[i - 1], &mark, sizeof(mark)) || mark.cycle != i * log->header.interval ||
+           reserve(&log->checkpoint, &log->capacity, (size_t)mark.size) ||
+           read_at(log->fp, log->marks[i - 1] + sizeof(mark), log->checkpoint, (size_t)mark.size) ||
+           sim_restore_checkpoint(m, log->checkpoint, (size_t)mark.size);
+}
+
+/**
+ * @brief Function that returns the number of cycles the run of a log took.
+ *
+ * @param log The log.
+ * @return The number of cycles, UINT64_MAX if the run did not halt.
+ */
+uint64_t runlog_cycles(const RunLog *log)
+{
+    return log->cycles;
+}
+
+/**
+ * @brief Function that returns the number of cycles of the run between two checkpoints of a log.
+ *
+ * @param log The log.
+ * @return The number of cycles.
+ */
+unsigned int runlog_interval(const RunLog *log)
+{
+    return log->header.interval;
+}
+
+/**
+ * @brief Function that returns the number of checkpoints of a log, which are at every multiple of its interval.
+ *
+ * @param log The log.
+ * @return The number of checkpoints.
+ */
+uint64_t runlog_checkpoints(const RunLog *log)
+{
+    return log->count;
+}
+
+/**
+ * @brief Function that closes a log and frees it.
+ *
+ * @param log The log, or NULL.
+ */
+void runlog_close(RunLog *log)
+{
+    if (!log)
+    {
+        return;
+    }
+    if (log->fp)
+    {
+        fclose(log->fp);
+    }
+    free(log->checkpoint);
+    free(log->marks);
+    free(log);
+}
+
+/**
+ * @brief Function that grows the buffer of a checkpoint to hold a checkpoint of a size.
+ *
+ * @param buf The buffer, NULL or allocated with malloc.
+ * @param capacity The number of bytes the buffer holds.
+ * @param size The size of the checkpoint.
+ * @return 0 on success, 1 if there is not enough memory, in which case the buffer is kept.
+ */
+static int reserve(char **buf, size_t *capacity, size_t size)
+{
+    char *grown;
+    if (size <= *capacity)
+    {
+        return 0;
+    }
+    grown = realloc(*buf, size);
+    if (!grown)
+    {
+        return 1;
+    }
+    *buf = grown;
+    *capacity = size;
+    return 0;
+}
@@ -0,0 +1,72 @@
+#ifndef SIMRECORD_H
+#define SIMRECORD_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "libsimp.h"
+
+/*Constants*/
+
+#define RECORD_MAGIC "SIMPRLOG"
+#define RECORD_END_MAGIC "SIMPREND"
+#define RECORD_VERSION 2
+#define RECORD_INTERVAL (1U << 22)      /*Default number of cycles of the run between two checkpoints of the log*/
+#define RECORD_IMAGES 4                 /*imemin.txt, dmemin.txt, diskin.txt and irq2in.txt*/
+
+/*The execution log of a run. A run is fully determined by its instructions, data memory, disk and irq 2 schedule,
+  so the log holds those four input files and a checkpoint every interval cycles of the run, and nothing per cycle.
+  simreplay regenerates trace.txt and hwregtrace.txt for any range of cycles by restoring the checkpoint before the
+  range and running forward. Cycles are counted by sim_cycles_run, since the program may write the clock.
+  The log is a RecordHeader, the four input files, then a RecordMark and the checkpoint for each checkpoint,
+  and a RecordEnd once the run halted, in the byte order of the machine. Checkpoints grow with the sectors of the
+  disk the run wrote, so each mark gives the size of its checkpoint. A run that stopped leaves a log without its
+  end, which is still replayed.*/
+
+/*RecordHeader struct: the start of a log*/
+typedef struct RecordHeader
+{
+    char magic[8];                          /*RECORD_MAGIC*/
+    uint32_t version;                       /*RECORD_VERSION*/
+    uint32_t interval;                      /*Cycles of the run between two checkpoints*/
+    uint32_t disk_sectors;                  /*Geometry of the disk, which diskin.txt does not give*/
+    uint32_t sector_words;
+    uint64_t image_sizes[RECORD_IMAGES];    /*Bytes of each input file, which follow the header*/
+} RecordHeader;
+
+/*RecordMark struct: the start of a checkpoint of the log*/
+typedef struct RecordMark
+{
+    uint64_t cycle;                         /*Cycle of the run the checkpoint was saved at*/
+    uint64_t size;                          /*Bytes of the checkpoint that follows*/
+} RecordMark;
+
+/*RecordEnd struct: the end of the log of a run that halted*/
+typedef struct RecordEnd
+{
+    char magic[8];                          /*RECORD_END_MAGIC*/
+    uint64_t cycles;                        /*Number of cycles the run took*/
+} RecordEnd;
+
+/*The log of a run that is being recorded.*/
+typedef struct Recorder Recorder;
+
+/*A log read back to replay its run.*/
+typedef struct RunLog RunLog;
+
+/*Recording a run.*/
+
+Recorder *recorder_create(const SimMachine *m, const char *log_file, char *inputs[], unsigned int interval);
+int recorder_mark(Recorder *r, const SimMachine *m);
+int recorder_close(Recorder *r, const SimMachine *m);
+
+/*Replaying a run.*/
+
+RunLog *runlog_open(const char *log_file);
+int runlog_load(RunLog *log, SimMachine *m);
+int runlog_seek(RunLog *log, SimMachine *m, uint64_t cycle);
+uint64_t runlog_cycles(const RunLog *log);
+unsigned int runlog_interval(const RunLog *log);
+uint64_t runlog_checkpoints(const RunLog *log);
+void runlog_close(RunLog *log);
+
+#endif
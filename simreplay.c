@@ -0,0 +1,504 @@
+#define _CRT_SECURE_NO_WARNINGS
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libsimp.h"
+#include "simwriter.h"
+#include "simrecord.h"
+
+#ifndef _WIN32
+#define SIMREPLAY_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+/*Constants*/
+
+#define TRUE 1
+#define FALSE 0
+#define REPLAY_FILES 2                  /*trace.txt and hwregtrace.txt*/
+#define REPLAY_STEP (1U << 30)          /*Most cycles run in one call*/
+#define MAX_WORKERS 256
+#define CHUNK_BUFFER (1 << 20)          /*Bytes of the buffer of each chunk file, and of the copy into the output*/
+
+/*Replay struct: the options of a replay*/
+typedef struct Replay
+{
+    uint64_t first;                     /*First cycle of the run traced*/
+    uint64_t stop;                      /*Cycle after the last one traced, UINT64_MAX for the end of the run*/
+    int binary;                         /*TRUE (1) to write the binary format*/
+    int worker_count;                   /*Number of threads that regenerate the segments of the range*/
+} Replay;
+
+/*Segment struct: the cycles between two checkpoints of the log, regenerated by one worker into chunk files*/
+typedef struct Segment
+{
+    uint64_t start;                     /*First cycle of the segment*/
+    uint64_t stop;                      /*Cycle after the segment, UINT64_MAX for the end of the run*/
+    int status;                         /*0 if the chunk files of the segment were written, 1 otherwise*/
+} Segment;
+
+/*Pool struct: the segments of a parallel replay and the workers that take them in order*/
+typedef struct Pool
+{
+    const char *log_file;
+    char **outputs;                     /*The names of trace.txt and hwregtrace.txt*/
+    Segment *segments;
+    int count;                          /*Number of segments*/
+    int next;                           /*The next segment a worker takes*/
+#ifdef SIMREPLAY_THREADS
+    pthread_mutex_t lock;
+#endif
+} Pool;
+
+/*Function Prototypes*/
+
+int parse_replay(int argc, char *argv[], Replay *r);
+int default_worker_count(void);
+int replay(SimMachine *m, RunLog *log, const Replay *r, char *outputs[]);
+void run_range(SimMachine *m, uint64_t stop, uint64_t end);
+
+/*Functions that regenerate the segments of a range in parallel and join their chunks.*/
+
+int replay_parallel(RunLog *log, const Replay *r, const char *log_file, char *outputs[]);
+void *run_worker(void *arg);
+int replay_segment(Pool *pool, int i);
+char *chunk_name(const char *output, int i);
+void write_to_chunk(void *user, const char *text, size_t len);
+int append_chunk(FILE *out, const char *chunk_file, char *buf);
+
+int main(int argc, char *argv[])
+{
+    SimMachine *m;
+    RunLog *log;
+    Replay r;
+    int count, result;
+
+    count = parse_replay(argc, argv, &r);
+    if (count < 0 || argc - count != 4)
+    {
+        fprintf(stderr, "Usage: simreplay [--cycles FIRST-LAST] [--binary] [--threads N] run.log trace.txt hwregtrace.txt\n");
+        return 1;
+    }
+    argv += count;
+    log = runlog_open(argv[1]);
+    if (!log)
+    {
+        fprintf(stderr, "%s: not an execution log of this simulator\n", argv[1]);
+        return 1;
+    }
+
+    /*A binary record only holds the registers that changed since the record before, so one thread writes it.*/
+    if (r.worker_count > 1 && !r.binary)
+    {
+        result = replay_parallel(log, &r, argv[1], argv + 2);
+        runlog_close(log);
+        return result;
+    }
+    m = sim_create();
+    if (!m || runlog_load(log, m))
+    {
+        fprintf(stderr, "Cannot load the input files of %s\n", argv[1]);
+        sim_destroy(m);
+        runlog_close(log);
+        return 1;
+    }
+    result = replay(m, log, &r, argv + 2);
+    sim_destroy(m);
+    runlog_close(log);
+    return result;
+}
+
+/**
+ * @brief Function that parses the options of simreplay. --cycles FIRST-LAST regenerates the cycles of the run from
+ * FIRST to LAST, FIRST- to the end of the run, and --binary writes the binary format that simtrace2txt converts.
+ * --threads N regenerates the segments between the checkpoints of the log on N threads, the number of online
+ * processors by default.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv The command line arguments.
+ * @param r The options of the replay.
+ * @return The number of command line arguments taken by the options, or -1 for an invalid option.
+ */
+int parse_replay(int argc, char *argv[], Replay *r)
+{
+    char *end;
+    int i;
+
+    r->first = 0;
+    r->stop = UINT64_MAX;
+    r->binary = FALSE;
+    r->worker_count = default_worker_count();
+    for (i = 1; i < argc && strncmp(argv[i], "--", 2) == 0; i++)
+    {
+        if (strcmp(argv[i], "--binary") == 0)
+        {
+            r->binary = TRUE;
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            r->worker_count = atoi(argv[++i]);
+            if (r->worker_count < 1 || r->worker_count > MAX_WORKERS)
+            {
+                fprintf(stderr, "--threads: expected a number from 1 to %d\n", MAX_WORKERS);
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--cycles") == 0 && i + 1 < argc)
+        {
+            end = argv[++i];
+            r->first = strtoull(end, &end, 0);
+            if (end == argv[i] || *end != '-' ||
+                (end[1] != '\0' &&
+                 ((r->stop = strtoull(end + 1, &end, 0)) < r->first || *end != '\0' || r->stop++ == UINT64_MAX)))
+            {
+                fprintf(stderr, "--cycles: expected FIRST-LAST or FIRST-\n");
+                return -1;
+            }
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+#ifndef SIMREPLAY_THREADS
+    r->worker_count = 1;
+#endif
+    return i - 1;
+}
+
+/**
+ * @brief Function that returns the number of workers used when --threads is not given.
+ *
+ * @return The number of online processors, or 1 if it is not known or threads are not supported.
+ */
+int default_worker_count(void)
+{
+#ifdef SIMREPLAY_THREADS
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (count < 1)
+    {
+        return 1;
+    }
+    return count > MAX_WORKERS ? MAX_WORKERS : (int)count;
+#else
+    return 1;
+#endif
+}
+
+/**
+ * @brief Function that regenerates trace.txt and hwregtrace.txt for a range of cycles. The machine restores the last
+ * checkpoint of the log before the range, and runs with the trace limited to the range until the range ends or the
+ * program halts. The files are the same as those of the run with --trace-cycles, and those of the run itself for the
+ * whole range.
+ *
+ * @param m The simulated machine, with the input files of the log loaded.
+ * @param log The log.
+ * @param r The options of the replay.
+ * @param outputs The names of trace.txt and hwregtrace.txt.
+ * @return 0 on success, 1 on failure.
+ */
+int replay(SimMachine *m, RunLog *log, const Replay *r, char *outputs[])
+{
+    static const int streams[REPLAY_FILES] = {SIM_TRACE, SIM_HWREGTRACE};
+    FILE *fps[REPLAY_FILES];
+    Writer *writer;
+    int i;
+
+    if (runlog_seek(log, m, r->first))
+    {
+        fprintf(stderr, "Cannot restore the checkpoint before cycle %llu\n", (unsigned long long)r->first);
+        return 1;
+    }
+    for (i = 0; i < REPLAY_FILES; i++)
+    {
+        sim_set_format(m, streams[i], r->binary ? SIM_FORMAT_BINARY : SIM_FORMAT_TEXT);
+        fps[i] = fopen(outputs[i], r->binary ? "wb" : "w");
+        if (!fps[i])
+        {
+            fprintf(stderr, "Cannot open %s\n", outputs[i]);
+            while (i-- > 0)
+            {
+                fclose(fps[i]);
+            }
+            return 1;
+        }
+    }
+    writer = writer_create(fps, REPLAY_FILES);
+    if (!writer)
+    {
+        fprintf(stderr, "Cannot write %s\n", outputs[0]);
+        for (i = 0; i < REPLAY_FILES; i++)
+        {
+            fclose(fps[i]);
+        }
+        return 1;
+    }
+    for (i = 0; i < REPLAY_FILES; i++)
+    {
+        sim_set_sink(m, streams[i], write_to_writer, writer_file(writer, i));
+    }
+    sim_trace_cycles(m, r->first, r->stop);
+    run_range(m, r->stop, runlog_cycles(log));
+    if (writer_destroy(writer))
+    {
+        fprintf(stderr, "Cannot write %s\n", outputs[0]);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Function that runs the machine until a cycle of the run, or until the program halts.
+ *
+ * @param m The simulated machine.
+ * @param stop The cycle the run stops at, UINT64_MAX to run until the program halts.
+ * @param end The number of cycles of the recorded run, UINT64_MAX if it is not known.
+ */
+void run_range(SimMachine *m, uint64_t stop, uint64_t end)
+{
+    uint64_t left;
+    while (!sim_halted(m) && sim_cycles_run(m) < stop && sim_cycles_run(m) < end)
+    {
+        left = stop - sim_cycles_run(m);
+        if (sim_step(m, left < REPLAY_STEP ? (unsigned int)left : REPLAY_STEP) != SIM_RUNNING)
+        {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Function that regenerates trace.txt and hwregtrace.txt for a range of cycles on several threads.
+ * The range is cut at the checkpoints of the log, each worker takes the next segment, restores the checkpoint at its
+ * start on a machine of its own and writes the segment to chunk files next to the outputs, and the chunks are then
+ * appended to the outputs in order. The outputs are the same as those of replay.
+ *
+ * @param log The log.
+ * @param r The options of the replay.
+ * @param log_file The name of the log, which every worker opens for itself.
+ * @param outputs The names of trace.txt and hwregtrace.txt.
+ * @return 0 on success, 1 on failure.
+ */
+int replay_parallel(RunLog *log, const Replay *r, const char *log_file, char *outputs[])
+{
+    Pool pool;
+    uint64_t interval = runlog_interval(log), last = runlog_checkpoints(log) * interval, cycle;
+    FILE *out;
+    char *buf, *chunk;
+    int i, j, started = 1, result = 0;
+#ifdef SIMREPLAY_THREADS
+    pthread_t threads[MAX_WORKERS];
+#endif
+
+    /*A segment starts at the first cycle of the range and at every checkpoint inside it.*/
+    memset(&pool, 0, sizeof(pool));
+    pool.log_file = log_file;
+    pool.outputs = outputs;
+    cycle = r->first;
+    do
+    {
+        pool.count++;
+        cycle = (cycle / interval + 1) * interval;
+    } while (cycle <= last && cycle < r->stop && cycle < runlog_cycles(log));
+    pool.segments = calloc((size_t)pool.count, sizeof(Segment));
+    buf = malloc(CHUNK_BUFFER);
+    if (!pool.segments || !buf)
+    {
+        free(pool.segments);
+        free(buf);
+        return 1;
+    }
+    for (i = 0, cycle = r->first; i < pool.count; i++)
+    {
+        pool.segments[i].start = cycle;
+        cycle = (cycle / interval + 1) * interval;
+        pool.segments[i].stop = i + 1 < pool.count ? cycle : r->stop;
+    }
+
+#ifdef SIMREPLAY_THREADS
+    pthread_mutex_init(&pool.lock, NULL);
+    for (; started < r->worker_count && started < pool.count; started++)
+    {
+        if (pthread_create(&threads[started], NULL, run_worker, &pool))
+        {
+            break;
+        }
+    }
+    run_worker(&pool);
+    for (i = 1; i < started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&pool.lock);
+#else
+    run_worker(&pool);
+#endif
+
+    /*The chunks are appended in the order of the run, and removed whether or not the replay succeeded.*/
+    for (j = 0; j < REPLAY_FILES; j++)
+    {
+        out = fopen(outputs[j], "wb");
+        if (!out)
+        {
+            fprintf(stderr, "Cannot open %s\n", outputs[j]);
+            result = 1;
+        }
+        for (i = 0; i < pool.count; i++)
+        {
+            chunk = chunk_name(outputs[j], i);
+            result |= pool.segments[i].status || !chunk || (out && append_chunk(out, chunk, buf));
+            if (chunk)
+            {
+                remove(chunk);
+            }
+            free(chunk);
+        }
+        if (out && fclose(out))
+        {
+            result = 1;
+        }
+    }
+    if (result)
+    {
+        fprintf(stderr, "Cannot write %s\n", outputs[0]);
+    }
+    free(pool.segments);
+    free(buf);
+    return result;
+}
+
+/**
+ * @brief Function that regenerates segments on one worker until no segment is left.
+ *
+ * @param arg A pointer to the pool.
+ * @return NULL.
+ */
+void *run_worker(void *arg)
+{
+    Pool *pool = arg;
+    int i;
+    for (;;)
+    {
+#ifdef SIMREPLAY_THREADS
+        pthread_mutex_lock(&pool->lock);
+#endif
+        i = pool->next < pool->count ? pool->next++ : -1;
+#ifdef SIMREPLAY_THREADS
+        pthread_mutex_unlock(&pool->lock);
+#endif
+        if (i < 0)
+        {
+            return NULL;
+        }
+        pool->segments[i].status = replay_segment(pool, i);
+    }
+}
+
+/**
+ * @brief Function that regenerates one segment into its chunk files, on a machine that loads the input files of
+ * the log and restores the checkpoint at the start of the segment.
+ *
+ * @param pool The pool.
+ * @param i The index of the segment.
+ * @return 0 on success, 1 on failure.
+ */
+int replay_segment(Pool *pool, int i)
+{
+    static const int streams[REPLAY_FILES] = {SIM_TRACE, SIM_HWREGTRACE};
+    const Segment *segment = &pool->segments[i];
+    RunLog *log = runlog_open(pool->log_file);
+    SimMachine *m = sim_create();
+    FILE *fps[REPLAY_FILES] = {NULL};
+    char *chunk;
+    int j, result;
+
+    result = !log || !m || runlog_load(log, m) || runlog_seek(log, m, segment->start);
+    for (j = 0; j < REPLAY_FILES && !result; j++)
+    {
+        chunk = chunk_name(pool->outputs[j], i);
+        fps[j] = chunk ? fopen(chunk, "w") : NULL;
+        free(chunk);
+        result = !fps[j];
+        if (fps[j])
+        {
+            setvbuf(fps[j], NULL, _IOFBF, CHUNK_BUFFER);
+            sim_set_sink(m, streams[j], write_to_chunk, fps[j]);
+        }
+    }
+    if (!result)
+    {
+        sim_trace_cycles(m, segment->start, segment->stop);
+        run_range(m, segment->stop, runlog_cycles(log));
+    }
+    for (j = 0; j < REPLAY_FILES; j++)
+    {
+        if (fps[j])
+        {
+            result |= ferror(fps[j]) != 0;
+            result |= fclose(fps[j]) != 0;
+        }
+    }
+    sim_destroy(m);
+    runlog_close(log);
+    return result;
+}
+
+/**
+ * @brief Function that names the chunk file of a segment, the name of the output followed by the segment.
+ *
+ * @param output The name of the output file.
+ * @param i The index of the segment.
+ * @return The name, to be freed by the caller, or NULL if there is not enough memory.
+ */
+char *chunk_name(const char *output, int i)
+{
+    char *name = malloc(strlen(output) + 32);
+    if (name)
+    {
+        sprintf(name, "%s.part%d", output, i);
+    }
+    return name;
+}
+
+/**
+ * @brief Sink that writes an output stream of a segment to its chunk file.
+ *
+ * @param user The chunk file.
+ * @param text The text of the stream.
+ * @param len The length of the text.
+ */
+void write_to_chunk(void *user, const char *text, size_t len)
+{
+    fwrite(text, 1, len, (FILE *)user);
+}
+
+/**
+ * @brief Function that appends a chunk file to an output file.
+ *
+ * @param out The output file.
+ * @param chunk_file The name of the chunk file.
+ * @param buf A buffer of CHUNK_BUFFER bytes.
+ * @return 0 on success, 1 if the chunk cannot be read or the output cannot be written.
+ */
+int append_chunk(FILE *out, const char *chunk_file, char *buf)
+{
+    FILE *fp = fopen(chunk_file, "rb");
+    size_t n;
+    int result = 0;
+    if (!fp)
+    {
+        return 1;
+    }
+    while ((n = fread(buf, 1, CHUNK_BUFFER, fp)) > 0)
+    {
+        result |= fwrite(buf, 1, n, out) != n;
+    }
+    result |= ferror(fp) != 0;
+    fclose(fp);
+    return result;
+}
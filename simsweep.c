@@ -0,0 +1,574 @@
+#define _CRT_SECURE_NO_WARNINGS
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libsimp.h"
+#include "simfiles.h"
+
+#ifndef _WIN32
+#define SIMSWEEP_FORK
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
+
+/*Constants*/
+
+#define MAX_LINE 4096
+#define SWEEP_FIELDS 2
+#define PREFIX_DIR "sweep_prefix"
+#define COPY_BUFFER_SIZE (64 * 1024)
+
+/*Branch struct: one irq 2 schedule of the sweep and the result of its run*/
+typedef struct Branch
+{
+    char *irq2_file;         /*The irq2in.txt of the branch*/
+    char *outdir;            /*Directory of the output files*/
+    char *files[RUN_FILES];  /*File names indexed like the argv of sim*/
+    int status;              /*0 if the branch ran and wrote its output files, 1 otherwise*/
+    unsigned int cycles;     /*The number of cycles written to cycles.txt*/
+    double start;            /*Wall time at which the branch started*/
+    double seconds;          /*Wall time of the branch after the fork*/
+#ifdef SIMSWEEP_FORK
+    pid_t pid;               /*Process that runs the branch, 0 before it starts*/
+#endif
+} Branch;
+
+/*Sweep struct: the shared program and its branches*/
+typedef struct Sweep
+{
+    char *inputs[4];             /*imemin.txt, dmemin.txt and diskin.txt of every branch, and the irq2in.txt of the prefix*/
+    unsigned int fork_cycle;     /*Clock cycle at which the prefix forks*/
+    int process_count;           /*Maximum number of branches that run at the same time*/
+    int jit;                     /*Branches run with the jit if jit is TRUE (1)*/
+    int split;                   /*If TRUE (1) the output files of a branch do not repeat the prefix*/
+    const char *prefix_dir;      /*Directory of the output files of the prefix*/
+    char *prefix_files[RUN_FILES]; /*File names of the prefix*/
+    unsigned int prefix_cycles;  /*Clock at the end of the prefix, before fork_cycle if the program halted earlier*/
+    double prefix_seconds;       /*Wall time of the prefix*/
+    Branch *branches;
+    int branch_count;
+} Sweep;
+
+/*Function Prototypes*/
+
+/*Functions that read the command line and the sweep file.*/
+
+int parse_options(int argc, char *argv[], Sweep *sweep);
+int read_sweep(const char *sweep_file, Sweep *sweep);
+int add_branch(Sweep *sweep, char *fields[]);
+void free_sweep(Sweep *sweep);
+
+/*Functions that run the prefix and the branches.*/
+
+int run_prefix(SimMachine *m, Sweep *sweep);
+int run_branch(SimMachine *m, Sweep *sweep, Branch *branch);
+int copy_file(const char *file_name, FILE *to);
+int run_branches(SimMachine *m, Sweep *sweep);
+unsigned int read_cycles(const char *cycles_file);
+
+/*Function that writes the summary at the end of the sweep.*/
+
+int write_summary(Sweep *sweep, const char *summary_file, double seconds);
+
+int main(int argc, char *argv[])
+{
+    Sweep sweep;
+    SimMachine *m;
+    double start = now_seconds();
+    int count, failed, i;
+
+    memset(&sweep, 0, sizeof(sweep));
+    count = parse_options(argc, argv, &sweep);
+    if (count < 0)
+    {
+        return 1;
+    }
+    argc -= count;
+    argv += count;
+    if (argc != 7)
+    {
+        fprintf(stderr, "Usage: simsweep [--processes N] [--jit] [--split] [--prefix-dir DIR] "
+                        "imemin.txt dmemin.txt diskin.txt fork_cycle sweep.txt summary.txt\n");
+        return 1;
+    }
+    for (i = 1; i < argc; i++)
+    {
+        strip_newline(argv[i]);
+    }
+    sweep.fork_cycle = (unsigned int)strtoul(argv[4], NULL, 10);
+
+    /*Read the branches, the prefix runs with the schedule of the first one.*/
+    if (read_sweep(argv[5], &sweep) || sweep.branch_count == 0)
+    {
+        fprintf(stderr, "%s: no branches\n", argv[5]);
+        free_sweep(&sweep);
+        return 1;
+    }
+    sweep.inputs[0] = argv[1];
+    sweep.inputs[1] = argv[2];
+    sweep.inputs[2] = argv[3];
+    sweep.inputs[3] = sweep.branches[0].irq2_file;
+
+    /*Run the prefix once, then every branch from its end.*/
+    m = sim_create();
+    if (!m)
+    {
+        free_sweep(&sweep);
+        return 1;
+    }
+    if (sweep.jit)
+    {
+        sim_set_jit(m, TRUE);
+    }
+    if (run_prefix(m, &sweep) || run_branches(m, &sweep))
+    {
+        sim_destroy(m);
+        free_sweep(&sweep);
+        return 1;
+    }
+    failed = write_summary(&sweep, argv[6], now_seconds() - start);
+    for (i = 0; i < sweep.branch_count; i++)
+    {
+        failed |= sweep.branches[i].status;
+    }
+    sim_destroy(m);
+    free_sweep(&sweep);
+    return failed ? 1 : 0;
+}
+
+/**
+ * @brief Function that parses the options given before the file names.
+ * --processes N sets the number of branches that run at the same time, which is the number of processors by default,
+ * --jit runs with the jit, --split leaves the prefix out of the output files of the branches,
+ * and --prefix-dir sets the directory of the output files of the prefix.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv The command line arguments.
+ * @param sweep The sweep.
+ * @return The number of command line arguments taken by the options, or -1 for an invalid option.
+ */
+int parse_options(int argc, char *argv[], Sweep *sweep)
+{
+    int i;
+#ifdef SIMSWEEP_FORK
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    sweep->process_count = processors > 0 ? (int)processors : 1;
+#else
+    sweep->process_count = 1;
+#endif
+    sweep->prefix_dir = PREFIX_DIR;
+    for (i = 1; i < argc && strncmp(argv[i], "--", 2) == 0; i++)
+    {
+        if (strcmp(argv[i], "--jit") == 0)
+        {
+            sweep->jit = TRUE;
+        }
+        else if (strcmp(argv[i], "--split") == 0)
+        {
+            sweep->split = TRUE;
+        }
+        else if (strcmp(argv[i], "--processes") == 0 && i + 1 < argc)
+        {
+            sweep->process_count = atoi(argv[++i]);
+            if (sweep->process_count < 1)
+            {
+                fprintf(stderr, "--processes: expected a positive number\n");
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--prefix-dir") == 0 && i + 1 < argc)
+        {
+            sweep->prefix_dir = argv[++i];
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+    return i - 1;
+}
+
+/**
+ * @brief Function that reads the branches of the sweep file.
+ * Every line of the sweep file is a branch: irq2in.txt and the output directory, separated by white space.
+ * Empty lines and lines starting with # are skipped.
+ *
+ * @param sweep_file The name of the sweep file.
+ * @param sweep The sweep the branches are added to.
+ * @return 0 on success, 1 on failure.
+ */
+int read_sweep(const char *sweep_file, Sweep *sweep)
+{
+    FILE *fp = fopen(sweep_file, "r");
+    char line[MAX_LINE], *fields[SWEEP_FIELDS], *token;
+    int line_number = 0, count;
+    if (!fp)
+    {
+        return 1;
+    }
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        line_number++;
+        line[strcspn(line, "\r\n")] = '\0';
+        count = 0;
+        for (token = strtok(line, " \t"); token && count <= SWEEP_FIELDS; token = strtok(NULL, " \t"))
+        {
+            if (count < SWEEP_FIELDS)
+            {
+                fields[count] = token;
+            }
+            count++;
+        }
+        if (count == 0 || fields[0][0] == '#')
+        {
+            continue;
+        }
+        if (count != SWEEP_FIELDS)
+        {
+            fprintf(stderr, "%s:%d: expected irq2in outdir\n", sweep_file, line_number);
+            fclose(fp);
+            return 1;
+        }
+        if (add_branch(sweep, fields))
+        {
+            fclose(fp);
+            return 1;
+        }
+    }
+    fclose(fp);
+    return 0;
+}
+
+/**
+ * @brief Function that adds a branch to the sweep.
+ *
+ * @param sweep The sweep.
+ * @param fields The fields of the sweep line: irq2in.txt and the output directory.
+ * @return 0 on success, 1 on failure.
+ */
+int add_branch(Sweep *sweep, char *fields[])
+{
+    Branch *branches = realloc(sweep->branches, (sweep->branch_count + 1) * sizeof(Branch)), *branch;
+    if (!branches)
+    {
+        return 1;
+    }
+    sweep->branches = branches;
+    branch = &branches[sweep->branch_count++];
+    memset(branch, 0, sizeof(Branch));
+    branch->status = 1;
+    branch->irq2_file = join_path(fields[0], NULL);
+    branch->outdir = join_path(fields[1], NULL);
+    return (branch->irq2_file && branch->outdir) ? 0 : 1;
+}
+
+/**
+ * @brief Function that frees the branches and the file names of the sweep.
+ *
+ * @param sweep The sweep.
+ */
+void free_sweep(Sweep *sweep)
+{
+    int i;
+    for (i = 0; i < sweep->branch_count; i++)
+    {
+        free_run_files(sweep->branches[i].files);
+        free(sweep->branches[i].irq2_file);
+        free(sweep->branches[i].outdir);
+    }
+    free_run_files(sweep->prefix_files);
+    free(sweep->branches);
+    sweep->branches = NULL;
+    sweep->branch_count = 0;
+}
+
+/**
+ * @brief Function that runs the prefix shared by all the branches, up to the fork cycle.
+ * The prefix runs with the schedule of the first branch, and writes trace.txt, hwregtrace.txt, leds.txt
+ * and display7seg.txt up to the fork cycle to the prefix directory.
+ *
+ * @param m The simulated machine.
+ * @param sweep The sweep.
+ * @return 0 on success, 1 on failure.
+ */
+int run_prefix(SimMachine *m, Sweep *sweep)
+{
+    Writer *writer = NULL;
+    double start = now_seconds();
+    int i;
+
+    make_dir(sweep->prefix_dir);
+    if (init_run_files(sweep->prefix_files, sweep->inputs, sweep->prefix_dir) ||
+        first_init(m, RUN_FILES, sweep->prefix_files, &writer, NULL, COMPRESS_NONE, NULL))
+    {
+        fprintf(stderr, "Cannot start the prefix in %s\n", sweep->prefix_dir);
+        return 1;
+    }
+    sim_run_until(m, SIM_UNTIL_CYCLE, sweep->fork_cycle);
+    for (i = 0; i < OUTPUT_FILES; i++)
+    {
+        sim_set_sink(m, i, NULL, NULL);
+    }
+    if (writer_destroy(writer))
+    {
+        fprintf(stderr, "Cannot write the prefix in %s\n", sweep->prefix_dir);
+        return 1;
+    }
+    sweep->prefix_cycles = sim_get_cycles(m);
+    sweep->prefix_seconds = now_seconds() - start;
+    return 0;
+}
+
+/**
+ * @brief Function that runs one branch from the end of the prefix until it halts.
+ * The irq 2 schedule of the machine is replaced by the schedule of the branch, which must trigger the same
+ * entries as the prefix up to the fork cycle. Unless the sweep is split, the output files written during the run
+ * start with the output of the prefix, so they are the same as a run of sim with the schedule of the branch.
+ *
+ * @param m The simulated machine at the end of the prefix.
+ * @param sweep The sweep.
+ * @param branch The branch.
+ * @return 0 on success, 1 on failure.
+ */
+int run_branch(SimMachine *m, Sweep *sweep, Branch *branch)
+{
+    static const int files[OUTPUT_FILES] = {7, 8, 10, 11};
+    FILE *fps[OUTPUT_FILES];
+    Writer *writer;
+    size_t len;
+    char *text = read_file(branch->irq2_file, &len);
+    int result, i;
+
+    if (!text)
+    {
+        return 1;
+    }
+    result = sim_switch_irq2(m, text, len);
+    free(text);
+    if (result)
+    {
+        fprintf(stderr, "%s: differs from the prefix before cycle %u\n", branch->irq2_file, sweep->fork_cycle);
+        return 1;
+    }
+    make_dir(branch->outdir);
+    for (i = 0; i < OUTPUT_FILES; i++)
+    {
+        fps[i] = fopen(branch->files[files[i]], "w");
+        if (!fps[i] || (!sweep->split && copy_file(sweep->prefix_files[files[i]], fps[i])))
+        {
+            if (fps[i])
+            {
+                fclose(fps[i]);
+            }
+            while (i-- > 0)
+            {
+                fclose(fps[i]);
+            }
+            return 1;
+        }
+    }
+    writer = attach_writer(m, fps);
+    if (!writer)
+    {
+        return 1;
+    }
+    sim_run_until(m, SIM_UNTIL_HALT, 0);
+    branch->cycles = sim_get_cycles(m) + (unsigned int)sim_disk_cycles_left(m);
+    return end_of_run(m, branch->files, writer);
+}
+
+/**
+ * @brief Function that appends a file to an open file.
+ *
+ * @param file_name The name of the file to copy.
+ * @param to The file it is appended to.
+ * @return 0 on success, 1 on failure.
+ */
+int copy_file(const char *file_name, FILE *to)
+{
+    FILE *from = fopen(file_name, "r");
+    char *buf = malloc(COPY_BUFFER_SIZE);
+    size_t n;
+    int result = 0;
+    if (!from || !buf)
+    {
+        if (from)
+        {
+            fclose(from);
+        }
+        free(buf);
+        return 1;
+    }
+    while ((n = fread(buf, 1, COPY_BUFFER_SIZE, from)) > 0)
+    {
+        result |= fwrite(buf, 1, n, to) != n;
+    }
+    fclose(from);
+    free(buf);
+    return result;
+}
+
+/**
+ * @brief Function that runs all the branches from the end of the prefix.
+ * Every branch runs in a forked process, so it shares the memory, the disk and the monitor of the prefix
+ * copy-on-write and only copies the pages it changes. At most process_count branches run at the same time.
+ * Without fork the branches run one after another, each from a checkpoint of the end of the prefix.
+ *
+ * @param m The simulated machine at the end of the prefix.
+ * @param sweep The sweep.
+ * @return 0 on success, 1 if the branches cannot be started.
+ */
+int run_branches(SimMachine *m, Sweep *sweep)
+{
+    Branch *branch;
+    int i;
+#ifdef SIMSWEEP_FORK
+    int running = 0, next = 0, status;
+    pid_t pid;
+#else
+    size_t size = sim_checkpoint_size(m), len;
+    char *prefix_irq2 = read_file(sweep->inputs[3], &len);
+    void *checkpoint = malloc(size);
+#endif
+
+    for (i = 0; i < sweep->branch_count; i++)
+    {
+        branch = &sweep->branches[i];
+        if (init_run_files(branch->files, sweep->inputs, branch->outdir))
+        {
+            return 1;
+        }
+    }
+#ifdef SIMSWEEP_FORK
+    fflush(NULL);
+    while (next < sweep->branch_count || running > 0)
+    {
+        if (next < sweep->branch_count && running < sweep->process_count)
+        {
+            branch = &sweep->branches[next++];
+            branch->start = now_seconds();
+            pid = fork();
+            if (pid == 0)
+            {
+                _exit(run_branch(m, sweep, branch));
+            }
+            if (pid < 0)
+            {
+                /*Run the branch later, when another one has finished.*/
+                next--;
+                if (running == 0)
+                {
+                    return 1;
+                }
+            }
+            else
+            {
+                branch->pid = pid;
+                running++;
+                continue;
+            }
+        }
+        pid = wait(&status);
+        if (pid < 0)
+        {
+            return 1;
+        }
+        running--;
+        for (i = 0; i < sweep->branch_count; i++)
+        {
+            branch = &sweep->branches[i];
+            if (branch->pid == pid)
+            {
+                branch->seconds = now_seconds() - branch->start;
+                branch->status = !(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+                branch->cycles = branch->status ? 0 : read_cycles(branch->files[9]);
+            }
+        }
+    }
+    return 0;
+#else
+    if (!checkpoint || !prefix_irq2)
+    {
+        free(checkpoint);
+        free(prefix_irq2);
+        return 1;
+    }
+    sim_save_checkpoint(m, checkpoint, size);
+    for (i = 0; i < sweep->branch_count; i++)
+    {
+        branch = &sweep->branches[i];
+        branch->start = now_seconds();
+        if (i > 0)
+        {
+            sim_load_irq2(m, prefix_irq2, len);
+            sim_restore_checkpoint(m, checkpoint, size);
+        }
+        branch->status = run_branch(m, sweep, branch);
+        branch->seconds = now_seconds() - branch->start;
+    }
+    free(checkpoint);
+    free(prefix_irq2);
+    return 0;
+#endif
+}
+
+/**
+ * @brief Function that reads the number of cycles of a branch from its cycles.txt.
+ *
+ * @param cycles_file The name of cycles.txt.
+ * @return The number of cycles, or 0 if it cannot be read.
+ */
+unsigned int read_cycles(const char *cycles_file)
+{
+    FILE *fp = fopen(cycles_file, "r");
+    long cycles = 0;
+    if (!fp)
+    {
+        return 0;
+    }
+    if (fscanf(fp, "%ld", &cycles) != 1)
+    {
+        cycles = 0;
+    }
+    fclose(fp);
+    return (unsigned int)cycles;
+}
+
+/**
+ * @brief Function that writes the summary of the sweep.
+ * Every branch has a line with its index in the sweep file, its status, its cycles, its wall time in seconds
+ * after the fork and its output directory. The prefix and the totals follow as comments.
+ *
+ * @param sweep The sweep.
+ * @param summary_file The name of the summary file.
+ * @param seconds The wall time of the whole sweep.
+ * @return 0 on successful writing to file, 1 on failure.
+ */
+int write_summary(Sweep *sweep, const char *summary_file, double seconds)
+{
+    FILE *fp = fopen(summary_file, "w");
+    Branch *branch;
+    int i, failed = 0;
+    if (!fp)
+    {
+        return 1;
+    }
+    fprintf(fp, "# branch status cycles seconds outdir\n");
+    for (i = 0; i < sweep->branch_count; i++)
+    {
+        branch = &sweep->branches[i];
+        failed += branch->status;
+        fprintf(fp, "%d %s %u %.6f %s\n", i, branch->status ? "failed" : "ok", branch->cycles, branch->seconds,
+                branch->outdir);
+    }
+    fprintf(fp, "# prefix cycles %u seconds %.6f\n", sweep->prefix_cycles, sweep->prefix_seconds);
+    fprintf(fp, "# branches %d failed %d processes %d seconds %.6f\n", sweep->branch_count, failed,
+            sweep->process_count, seconds);
+    fclose(fp);
+    return 0;
+}
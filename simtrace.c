@@ -0,0 +1,339 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libsimp.h"
+#include "simindex.h"
+#include "simcompress.h"
+
+/*Constants*/
+
+#define TRUE 1
+#define FALSE 0
+#define OUTPUT_BUFFER (1 << 20)
+
+/*Query struct: the records a query prints*/
+typedef struct Query
+{
+    uint64_t first;       /*First cycle of the window*/
+    uint64_t last;        /*Last cycle of the window*/
+    int pc;               /*Address of the instructions printed, -1 for any*/
+} Query;
+
+/*Trace struct: an open trace.txt and what is needed to print its records*/
+typedef struct Trace
+{
+    Stream *s;                    /*The trace, which may be compressed*/
+    int format;
+    int dense;
+    TraceInstruction *instructions;    /*Instructions of a binary trace*/
+    int count;                    /*Number of instructions*/
+} Trace;
+
+/*Function Prototypes*/
+
+int query(int argc, char *argv[]);
+int parse_query(int argc, char *argv[], Query *q);
+int build_index(const char *trace_file);
+int print_block(Trace *t, const IndexEntry *e, const Query *q);
+void print_record(Trace *t, const unsigned char *record, const unsigned int *registers);
+unsigned int get_word(const unsigned char *p);
+
+int main(int argc, char *argv[])
+{
+    if (argc >= 3 && strcmp(argv[1], "query") == 0)
+    {
+        return query(argc - 2, argv + 2);
+    }
+    if (argc == 3 && strcmp(argv[1], "index") == 0)
+    {
+        return build_index(argv[2]);
+    }
+    fprintf(stderr, "Usage: simtrace query [--cycle N] [--window N] [--pc ADDRESS] trace.txt\n"
+                    "       simtrace index trace.txt\n");
+    return 1;
+}
+
+/**
+ * @brief Function that prints the lines of trace.txt around a cycle, or at an address, reading only the blocks of
+ * the trace that the index of the trace places there. A dense trace is printed from cycle N - window to N + window.
+ * A filtered trace has no cycle on its records, so every record of the blocks that overlap the window is printed.
+ * A binary trace is printed as text. A compressed trace is read through the frames that hold the blocks.
+ *
+ * @param argc Number of arguments after "query".
+ * @param argv The arguments after "query", the options and then trace.txt.
+ * @return 0 on success, 1 if the trace or its index cannot be read.
+ */
+int query(int argc, char *argv[])
+{
+    const char *trace_file = argv[argc - 1];
+    char *index_file = index_file_name(trace_file);
+    IndexHeader header;
+    IndexEntry e;
+    Trace t;
+    Query q;
+    uint64_t count, low = 0, high, i;
+    FILE *fp;
+    int result = 0;
+
+    if (!index_file || parse_query(argc - 1, argv, &q))
+    {
+        free(index_file);
+        return 1;
+    }
+    fp = index_open(index_file, &header, &count);
+    if (!fp)
+    {
+        fprintf(stderr, "Cannot read the index %s\n", index_file);
+        free(index_file);
+        return 1;
+    }
+    free(index_file);
+    memset(&t, 0, sizeof(t));
+    t.format = (int)header.format;
+    t.dense = (int)header.dense;
+    t.s = stream_open(trace_file);
+    if (!t.s || (t.format == SIM_FORMAT_BINARY && read_trace_header(t.s, &t.instructions, &t.count)))
+    {
+        fprintf(stderr, "Cannot read %s\n", trace_file);
+        stream_close(t.s);
+        free(t.instructions);
+        fclose(fp);
+        return 1;
+    }
+    setvbuf(stdout, NULL, _IOFBF, OUTPUT_BUFFER);
+
+    /*The blocks are in the order of the run, find the first one that ends after the window starts.*/
+    high = count;
+    while (low < high)
+    {
+        if (index_read(fp, low + (high - low) / 2, &e))
+        {
+            result = 1;
+            break;
+        }
+        if (e.end_cycle <= q.first)
+        {
+            low += (high - low) / 2 + 1;
+        }
+        else
+        {
+            high = low + (high - low) / 2;
+        }
+    }
+    for (i = low; !result && i < count; i++)
+    {
+        if (index_read(fp, i, &e))
+        {
+            result = 1;
+            break;
+        }
+        if (e.first_cycle > q.last)
+        {
+            break;
+        }
+        if (q.pc < 0 || (e.pcs[q.pc >> 3] & (1 << (q.pc & 7))))
+        {
+            result = print_block(&t, &e, &q);
+        }
+    }
+    if (result)
+    {
+        fprintf(stderr, "%s does not match its index\n", trace_file);
+    }
+    fflush(stdout);
+    stream_close(t.s);
+    fclose(fp);
+    free(t.instructions);
+    return result;
+}
+
+/**
+ * @brief Function that parses the options of a query. Without --cycle the window is the whole run,
+ * and --window is the number of cycles printed on each side of the cycle, 0 by default.
+ *
+ * @param argc Number of options.
+ * @param argv The options.
+ * @param q The query.
+ * @return 0 on success, 1 for an invalid option.
+ */
+int parse_query(int argc, char *argv[], Query *q)
+{
+    uint64_t cycle = 0, window = 0;
+    char *end;
+    int i, windowed = FALSE;
+    long pc;
+
+    q->pc = -1;
+    for (i = 0; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--cycle") == 0 && i + 1 < argc)
+        {
+            cycle = strtoull(argv[++i], &end, 0);
+            windowed = TRUE;
+        }
+        else if (strcmp(argv[i], "--window") == 0 && i + 1 < argc)
+        {
+            window = strtoull(argv[++i], &end, 0);
+        }
+        else if (strcmp(argv[i], "--pc") == 0 && i + 1 < argc)
+        {
+            pc = strtol(argv[++i], &end, 0);
+            q->pc = pc >= 0 && pc < SIM_MEM_DEPTH ? (int)pc : SIM_MEM_DEPTH;
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+        if (*end != '\0' || end == argv[i] || q->pc == SIM_MEM_DEPTH)
+        {
+            fprintf(stderr, "%s: expected a number\n", argv[i - 1]);
+            return 1;
+        }
+    }
+    if (!windowed && q->pc < 0)
+    {
+        fprintf(stderr, "query: expected --cycle or --pc\n");
+        return 1;
+    }
+    q->first = windowed && cycle > window ? cycle - window : 0;
+    q->last = windowed && cycle + window >= cycle ? cycle + window : UINT64_MAX;
+    return 0;
+}
+
+/**
+ * @brief Function that indexes a trace.txt written without an index, as if every cycle wrote one line,
+ * which is how sim writes it when the trace is not filtered.
+ *
+ * @param trace_file The name of trace.txt.
+ * @return 0 on success, 1 if the trace cannot be read or the index cannot be written.
+ */
+int build_index(const char *trace_file)
+{
+    char *index_file = index_file_name(trace_file), magic[8];
+    Stream *s = stream_open(trace_file);
+    TraceIndex *idx;
+    int format = SIM_FORMAT_TEXT;
+
+    if (!s || !index_file)
+    {
+        fprintf(stderr, "Cannot open %s\n", trace_file);
+        stream_close(s);
+        free(index_file);
+        return 1;
+    }
+    if (stream_read(s, 0, magic, sizeof(magic)) == sizeof(magic) && memcmp(magic, SIM_BINARY_MAGIC, sizeof(magic)) == 0)
+    {
+        format = SIM_FORMAT_BINARY;
+    }
+    stream_close(s);
+    remove(index_file);
+    free(index_file);
+    idx = index_create(trace_file, format, TRUE, UINT64_MAX, NULL, NULL);
+    if (!idx || index_close(idx, index_records(idx)))
+    {
+        fprintf(stderr, "Cannot index %s\n", trace_file);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Function that prints the records of a block of the trace that the query selects.
+ *
+ * @param t The trace.
+ * @param e The block.
+ * @param q The query.
+ * @return 0 on success, 1 if the block cannot be read.
+ */
+int print_block(Trace *t, const IndexEntry *e, const Query *q)
+{
+    size_t len = (size_t)(e->end_offset - e->offset), pos = 0, size;
+    unsigned char *data = malloc(len), *end;
+    unsigned int registers[INDEX_REGISTERS], mask;
+    char digits[4] = "";
+    uint64_t record = e->first_record;
+    int pc, i, n;
+
+    if (!data || stream_read(t->s, e->offset, data, len) != len)
+    {
+        free(data);
+        return 1;
+    }
+    memcpy(registers, e->registers, sizeof(registers));
+    for (; pos < len && (!t->dense || record <= q->last); record++, pos += size)
+    {
+        if (t->format == SIM_FORMAT_BINARY)
+        {
+            if (len - pos < 4)
+            {
+                break;
+            }
+            mask = get_word(data + pos) >> TRACE_MASK_SHIFT;
+            for (size = 4, i = 0, n = 4; i < INDEX_REGISTERS; i++)
+            {
+                if ((mask & (1U << i)) && pos + n + 4 <= len)
+                {
+                    registers[i] = get_word(data + pos + n);
+                    n += 4;
+                }
+            }
+            size = (size_t)n;
+            pc = (int)(get_word(data + pos) & 0xFFF);
+        }
+        else
+        {
+            end = memchr(data + pos, '\n', len - pos);
+            size = end ? (size_t)(end - (data + pos)) + 1 : len - pos;
+            memcpy(digits, data + pos, size < 3 ? size : 3);
+            pc = (int)strtol(digits, NULL, 16);
+        }
+        if ((t->dense && record < q->first) || (q->pc >= 0 && pc != q->pc))
+        {
+            continue;
+        }
+        if (t->format == SIM_FORMAT_BINARY)
+        {
+            print_record(t, data + pos, registers);
+        }
+        else
+        {
+            fwrite(data + pos, 1, size, stdout);
+        }
+    }
+    free(data);
+    return 0;
+}
+
+/**
+ * @brief Function that prints a record of a binary trace.txt as its line of the text trace.
+ *
+ * @param t The trace.
+ * @param record The record.
+ * @param registers The values of $v0 to $ra after the record.
+ */
+void print_record(Trace *t, const unsigned char *record, const unsigned int *registers)
+{
+    unsigned int pc = get_word(record) & 0xFFF;
+    const TraceInstruction *inst = &t->instructions[(int)pc < t->count ? pc : (unsigned int)t->count];
+    int i;
+
+    printf("%03X %s 00000000 %08X %08X ", pc, inst->text, inst->imm1 & 0xFFFFFFFF, inst->imm2 & 0xFFFFFFFF);
+    for (i = 0; i < INDEX_REGISTERS; i++)
+    {
+        printf("%08X ", registers[i]);
+    }
+    putchar('\n');
+}
+
+/**
+ * @brief Function that reads a little-endian 32 bit word.
+ *
+ * @param p The bytes of the word.
+ * @return The word.
+ */
+unsigned int get_word(const unsigned char *p)
+{
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
@@ -0,0 +1,283 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libsimp.h"
+#include "simindex.h"
+#include "simcompress.h"
+
+/*Constants*/
+
+#define TRUE 1
+#define FALSE 0
+#define BUFFER_SIZE (1 << 20)
+
+/*Names of the io registers in hwregtrace.txt, indexed by their number*/
+static const char *io_register_names[SIM_IO_REG_NUM] = {
+    "irq0enable", "irq1enable", "irq2enable", "irq0status", "irq1status", "irq2status", "irqhandler", "irqreturn",
+    "clks", "leds", "display7seg", "timerenable", "timercurrent", "timermax", "diskcmd", "disksector", "diskbuffer",
+    "diskstatus", "", "", "monitoraddr", "monitordata", "monitorcmd"};
+
+/*Reader struct: a binary stream that is read through a buffer, from a file that may be compressed*/
+typedef struct Reader
+{
+    Stream *s;
+    uint64_t offset;     /*Position in the stream of the byte after buf*/
+    unsigned char *buf;
+    size_t pos;          /*Position of the next byte in buf*/
+    size_t len;          /*Number of bytes in buf*/
+    int truncated;       /*TRUE (1) if the stream ended in the middle of a read*/
+} Reader;
+
+/*Function Prototypes*/
+
+int read_bytes(Reader *r, unsigned char *dst, size_t len);
+int copy_text(Reader *r, FILE *out);
+int read_word(Reader *r, unsigned int *value);
+int convert_trace(Reader *r, FILE *out);
+int convert_hwregtrace(Reader *r, FILE *out);
+int convert_leds_and_display(Reader *r, FILE *out);
+
+int main(int argc, char *argv[])
+{
+    Reader r;
+    FILE *out;
+    unsigned char magic[8];
+    unsigned int version, stream;
+    int result, empty, text;
+
+    if (argc != 3)
+    {
+        fprintf(stderr, "Usage: simtrace2txt binary_stream output.txt\n");
+        return 1;
+    }
+    memset(&r, 0, sizeof(r));
+    r.s = stream_open(argv[1]);
+    r.buf = malloc(BUFFER_SIZE);
+    if (!r.s || !r.buf)
+    {
+        fprintf(stderr, "Cannot open %s\n", argv[1]);
+        stream_close(r.s);
+        free(r.buf);
+        return 1;
+    }
+    /*A stream that was never written has no header, its text file is empty too.*/
+    empty = read_bytes(&r, magic, sizeof(magic)) && !r.truncated;
+
+    /*A compressed text stream is decompressed as it is.*/
+    text = !empty && stream_compressed(r.s) && (r.truncated || memcmp(magic, SIM_BINARY_MAGIC, sizeof(magic)) != 0);
+    if (!empty && !text &&
+        (r.truncated || memcmp(magic, SIM_BINARY_MAGIC, sizeof(magic)) != 0 || read_word(&r, &version) ||
+         version != SIM_BINARY_VERSION || read_word(&r, &stream) || stream >= SIM_STREAM_NUM))
+    {
+        fprintf(stderr, "%s: not a binary stream of this version\n", argv[1]);
+        stream_close(r.s);
+        free(r.buf);
+        return 1;
+    }
+    out = fopen(argv[2], "w");
+    if (!out)
+    {
+        fprintf(stderr, "Cannot open %s\n", argv[2]);
+        stream_close(r.s);
+        free(r.buf);
+        return 1;
+    }
+    setvbuf(out, NULL, _IOFBF, BUFFER_SIZE);
+
+    if (empty)
+    {
+        result = 0;
+    }
+    else if (text)
+    {
+        result = copy_text(&r, out);
+    }
+    else if (stream == SIM_TRACE)
+    {
+        result = convert_trace(&r, out);
+    }
+    else if (stream == SIM_HWREGTRACE)
+    {
+        result = convert_hwregtrace(&r, out);
+    }
+    else
+    {
+        result = convert_leds_and_display(&r, out);
+    }
+    if (result)
+    {
+        fprintf(stderr, "%s: truncated record\n", argv[1]);
+    }
+    result |= fclose(out) != 0;
+    stream_close(r.s);
+    free(r.buf);
+    return result;
+}
+
+/**
+ * @brief Function that reads bytes from a binary stream.
+ *
+ * @param r The stream.
+ * @param dst The buffer the bytes are read to.
+ * @param len The number of bytes.
+ * @return 0 on success, 1 if the stream ends first, which is truncated if some of the bytes were read.
+ */
+int read_bytes(Reader *r, unsigned char *dst, size_t len)
+{
+    size_t n, wanted = len;
+    while (len > 0)
+    {
+        if (r->pos == r->len)
+        {
+            r->len = stream_read(r->s, r->offset, r->buf, BUFFER_SIZE);
+            r->offset += r->len;
+            r->pos = 0;
+            if (r->len == 0)
+            {
+                r->truncated = len < wanted;
+                return 1;
+            }
+        }
+        n = r->len - r->pos < len ? r->len - r->pos : len;
+        memcpy(dst, r->buf + r->pos, n);
+        r->pos += n;
+        dst += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Function that writes a compressed text stream as it is, from its start.
+ *
+ * @param r The stream.
+ * @param out The output file.
+ * @return 0 on success, 1 if writing failed.
+ */
+int copy_text(Reader *r, FILE *out)
+{
+    int result = 0;
+    for (r->offset = 0; (r->len = stream_read(r->s, r->offset, r->buf, BUFFER_SIZE)) > 0; r->offset += r->len)
+    {
+        result |= fwrite(r->buf, 1, r->len, out) != r->len;
+    }
+    return result;
+}
+
+/**
+ * @brief Function that reads a little-endian 32 bit word from a binary stream.
+ *
+ * @param r The stream.
+ * @param value The word.
+ * @return 0 on success, 1 if the stream ends first.
+ */
+int read_word(Reader *r, unsigned int *value)
+{
+    unsigned char bytes[4];
+    if (r->len - r->pos >= 4)
+    {
+        memcpy(bytes, r->buf + r->pos, 4);
+        r->pos += 4;
+    }
+    else if (read_bytes(r, bytes, 4))
+    {
+        return 1;
+    }
+    *value = (unsigned int)bytes[0] | ((unsigned int)bytes[1] << 8) | ((unsigned int)bytes[2] << 16) |
+             ((unsigned int)bytes[3] << 24);
+    return 0;
+}
+
+/**
+ * @brief Function that converts the records of a binary trace.txt to its lines.
+ * Each record holds the pc and the registers that changed, the other registers keep their last values.
+ *
+ * @param r The stream, after the stream number of the header.
+ * @param out The text file.
+ * @return 0 on success, 1 if the header or the last record is not complete.
+ */
+int convert_trace(Reader *r, FILE *out)
+{
+    TraceInstruction *instructions, *inst;
+    unsigned int registers[SIM_CPU_REG_NUM], word, mask;
+    char line[256];
+    int count, len, i;
+
+    memset(registers, 0, sizeof(registers));
+    if (read_trace_header(r->s, &instructions, &count))
+    {
+        return 1;
+    }
+    /*The records follow the instructions.*/
+    r->offset = TRACE_HEADER + (uint64_t)count * TRACE_INSTRUCTION;
+    r->pos = 0;
+    r->len = 0;
+    while (!read_word(r, &word))
+    {
+        mask = word >> TRACE_MASK_SHIFT;
+        for (i = 3; i < SIM_CPU_REG_NUM; i++)
+        {
+            if ((mask & (1U << (i - 3))) && read_word(r, &registers[i]))
+            {
+                free(instructions);
+                return 1;
+            }
+        }
+        inst = &instructions[(int)(word & 0xFFF) < count ? word & 0xFFF : (unsigned int)count];
+        len = sprintf(line, "%03X %s 00000000 %08X %08X ", word & 0xFFF, inst->text, inst->imm1 & 0xFFFFFFFF,
+                      inst->imm2 & 0xFFFFFFFF);
+        for (i = 3; i < SIM_CPU_REG_NUM; i++)
+        {
+            len += sprintf(line + len, "%08X ", registers[i]);
+        }
+        line[len++] = '\n';
+        fwrite(line, 1, len, out);
+    }
+    free(instructions);
+    return r->truncated;
+}
+
+/**
+ * @brief Function that converts the records of a binary hwregtrace.txt to its lines.
+ *
+ * @param r The stream, after the stream number of the header.
+ * @param out The text file.
+ * @return 0 on success, 1 if the last record is not complete.
+ */
+int convert_hwregtrace(Reader *r, FILE *out)
+{
+    unsigned int cycle, data;
+    unsigned char reg;
+    while (!read_word(r, &cycle))
+    {
+        if (read_bytes(r, &reg, 1) || read_word(r, &data))
+        {
+            return 1;
+        }
+        fprintf(out, "%d %s %s %08X\n", (int)cycle, (reg & 0x80) ? "WRITE" : "READ",
+                (reg & 0x7F) < SIM_IO_REG_NUM ? io_register_names[reg & 0x7F] : "", data);
+    }
+    return r->truncated;
+}
+
+/**
+ * @brief Function that converts the records of a binary leds.txt or display7seg.txt to its lines.
+ *
+ * @param r The stream, after the stream number of the header.
+ * @param out The text file.
+ * @return 0 on success, 1 if the last record is not complete.
+ */
+int convert_leds_and_display(Reader *r, FILE *out)
+{
+    unsigned int cycle, status;
+    while (!read_word(r, &cycle))
+    {
+        if (read_word(r, &status))
+        {
+            return 1;
+        }
+        fprintf(out, "%d %08X\n", (int)cycle, status);
+    }
+    return r->truncated;
+}
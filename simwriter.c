@@ -0,0 +1,546 @@
+#define _CRT_SECURE_NO_WARNINGS
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#define _FILE_OFFSET_BITS 64
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "simwriter.h"
+#include "simcompress.h"
+
+#if !defined(_WIN32) && defined(__GNUC__)
+#define SIMWRITER_THREADS
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+/*Constants*/
+
+#define TRUE 1
+#define FALSE 0
+
+#ifdef _WIN32
+#define seek_file _fseeki64
+#else
+#define seek_file fseeko
+#endif
+
+#ifdef SIMWRITER_THREADS
+/*Fields shared by the simulation and the writer thread are read and written whole, in one order seen by both threads.*/
+#define load_shared(p) __atomic_load_n(p, __ATOMIC_SEQ_CST)
+#define store_shared(p, v) __atomic_store_n(p, v, __ATOMIC_SEQ_CST)
+#endif
+
+/*Ring struct: the text of one output file on its way from the simulation to the file*/
+typedef struct Ring
+{
+    Writer *writer;          /*The writer the ring belongs to*/
+    FILE *fp;                /*The output file*/
+    Compressor *compressor;  /*Compresses the text before it is written, NULL if the file is not compressed*/
+    char *data;              /*WRITER_RING_SIZE bytes, the byte at position p of the file is at p % WRITER_RING_SIZE*/
+    size_t head;             /*Number of bytes put in the ring, only stored by the simulation*/
+    size_t tail;             /*Number of bytes written to the file, only stored by the writer thread*/
+    int error;               /*TRUE (1) if writing to the file failed*/
+} Ring;
+
+/*Writer struct: the rings of the output files of a run and the thread that drains them*/
+struct Writer
+{
+    Ring *rings;
+    int count;
+#ifdef SIMWRITER_THREADS
+    int threaded;            /*TRUE (1) if the writer thread runs, FALSE (0) if the files are written as text arrives*/
+    pthread_t thread;
+    pthread_mutex_t lock;    /*Only taken to sleep and to wake the other thread*/
+    pthread_cond_t wake;     /*Wakes the writer thread*/
+    pthread_cond_t drained;  /*Wakes the simulation after the writer thread wrote*/
+    int sleeping;            /*TRUE (1) while the writer thread waits for a ring to fill*/
+    int waiting;             /*TRUE (1) while the simulation waits for a full ring or for every ring to drain*/
+    int stop;                /*TRUE (1) when the writer thread should write everything and exit*/
+#endif
+};
+
+/*Function Prototypes*/
+
+static void put_text(Ring *ring, const char *text, size_t len);
+static void write_output(void *user, const char *data, size_t len);
+
+#ifdef SIMWRITER_THREADS
+static void *run_writer(void *arg);
+static int drain(Writer *w, int force);
+static void write_all(Ring *ring, const char *data, size_t len);
+static size_t pending(Ring *ring);
+static int all_written(Writer *w);
+static int ready(Writer *w);
+static void wait_for_writer(Writer *w, Ring *ring);
+static void wake_writer(Writer *w);
+#endif
+
+/**
+ * @brief Function that creates the writer of the output files of a run and starts its thread.
+ * The files are flushed, after which they are only written through the writer until it is destroyed.
+ *
+ * @param fps The output files, open for writing at the position the run continues from.
+ * @param count The number of files.
+ * @return The writer, or NULL if there is not enough memory, in which case the files are left open.
+ */
+Writer *writer_create(FILE *fps[], int count)
+{
+    Writer *w = calloc(1, sizeof(Writer));
+    int i;
+    if (!w || !(w->rings = calloc((size_t)count, sizeof(Ring))))
+    {
+        free(w);
+        return NULL;
+    }
+    w->count = count;
+    for (i = 0; i < count; i++)
+    {
+        w->rings[i].writer = w;
+        w->rings[i].fp = fps[i];
+        fflush(fps[i]);
+    }
+#ifdef SIMWRITER_THREADS
+    w->threaded = TRUE;
+    for (i = 0; i < count; i++)
+    {
+        w->rings[i].data = malloc(WRITER_RING_SIZE);
+        w->threaded &= w->rings[i].data != NULL;
+    }
+    if (w->threaded)
+    {
+        pthread_mutex_init(&w->lock, NULL);
+        pthread_cond_init(&w->wake, NULL);
+        pthread_cond_init(&w->drained, NULL);
+        if (pthread_create(&w->thread, NULL, run_writer, w))
+        {
+            pthread_mutex_destroy(&w->lock);
+            pthread_cond_destroy(&w->wake);
+            pthread_cond_destroy(&w->drained);
+            w->threaded = FALSE;
+        }
+    }
+    /*Without the thread the files are written as text arrives.*/
+    for (i = 0; i < count && !w->threaded; i++)
+    {
+        free(w->rings[i].data);
+        w->rings[i].data = NULL;
+    }
+#endif
+    return w;
+}
+
+/**
+ * @brief Function that writes everything left in the rings, stops the writer thread and closes the files.
+ *
+ * @param w The writer, or NULL.
+ * @return 0 on success, 1 if writing to or closing a file failed.
+ */
+int writer_destroy(Writer *w)
+{
+    int i, result = 0;
+    if (!w)
+    {
+        return 0;
+    }
+#ifdef SIMWRITER_THREADS
+    if (w->threaded)
+    {
+        pthread_mutex_lock(&w->lock);
+        w->stop = TRUE;
+        pthread_cond_signal(&w->wake);
+        pthread_mutex_unlock(&w->lock);
+        pthread_join(w->thread, NULL);
+        pthread_mutex_destroy(&w->lock);
+        pthread_cond_destroy(&w->wake);
+        pthread_cond_destroy(&w->drained);
+    }
+#endif
+    for (i = 0; i < w->count; i++)
+    {
+        /*The writer thread has stopped, so the last frame and the seek table are written here.*/
+        compressor_close(w->rings[i].compressor);
+        result |= w->rings[i].error;
+        result |= fclose(w->rings[i].fp) != 0;
+        free(w->rings[i].data);
+    }
+    free(w->rings);
+    free(w);
+    return result;
+}
+
+/**
+ * @brief Function that compresses an output file from now on. It is called before anything is written to the file.
+ * A run that resumes cuts the file inside the frame that holds its position and writes that frame again at once,
+ * so the file holds the whole stream as it does after writer_flush.
+ *
+ * @param w The writer.
+ * @param index The index of the file in the files the writer was created with.
+ * @param method The compression method, COMPRESS_LZ or COMPRESS_ZLIB.
+ * @param position The number of bytes of the stream already written, 0 for a run that starts.
+ * @return 0 on success, 1 if there is not enough memory or the file does not hold the stream up to the position.
+ */
+int writer_compress(Writer *w, int index, int method, uint64_t position)
+{
+    Ring *ring = &w->rings[index];
+    ring->compressor = compressor_create(method, ring->fp, position, write_output, ring);
+    if (!ring->compressor)
+    {
+        return 1;
+    }
+#ifdef SIMWRITER_THREADS
+    /*The writer thread writes with write(), which needs the descriptor at the end the file was cut to.*/
+    if (w->threaded && lseek(fileno(ring->fp), 0, SEEK_END) < 0)
+    {
+        return 1;
+    }
+#endif
+    if (seek_file(ring->fp, 0, SEEK_END))
+    {
+        return 1;
+    }
+    compress_flush(ring->compressor);
+    return writer_flush(w);
+}
+
+/**
+ * @brief Function that returns the user pointer of the sink of an output file.
+ *
+ * @param w The writer.
+ * @param index The index of the file in the files the writer was created with.
+ * @return The pointer to pass to sim_set_sink with write_to_writer.
+ */
+void *writer_file(Writer *w, int index)
+{
+    return &w->rings[index];
+}
+
+/**
+ * @brief Function that receives the text of an output stream and puts it in the ring of its file.
+ * It only waits for the writer thread when the ring is full.
+ *
+ * @param user The pointer returned by writer_file.
+ * @param text The text of the stream.
+ * @param len The length of the text.
+ */
+void write_to_writer(void *user, const char *text, size_t len)
+{
+    Ring *ring = (Ring *)user;
+#ifdef SIMWRITER_THREADS
+    Writer *w = ring->writer;
+    size_t head = ring->head, space, offset, n, first;
+
+    if (w->threaded)
+    {
+        while (len > 0)
+        {
+            space = WRITER_RING_SIZE - (head - load_shared(&ring->tail));
+            if (space == 0)
+            {
+                wait_for_writer(w, ring);
+                continue;
+            }
+            n = len < space ? len : space;
+            offset = head % WRITER_RING_SIZE;
+            first = WRITER_RING_SIZE - offset < n ? WRITER_RING_SIZE - offset : n;
+            memcpy(ring->data + offset, text, first);
+            memcpy(ring->data, text + first, n - first);
+            head += n;
+            text += n;
+            len -= n;
+            store_shared(&ring->head, head);
+
+            /*A sleeping writer thread is only woken once there is enough for a large write.*/
+            if (head - load_shared(&ring->tail) >= WRITER_BATCH && load_shared(&w->sleeping))
+            {
+                wake_writer(w);
+            }
+        }
+        return;
+    }
+#endif
+    put_text(ring, text, len);
+}
+
+/**
+ * @brief Function that waits until everything put in the rings is in the files,
+ * so the files hold every byte counted by sim_stream_bytes.
+ *
+ * @param w The writer.
+ * @return 0 on success, 1 if writing to a file failed.
+ */
+int writer_flush(Writer *w)
+{
+    int i, result = 0;
+#ifdef SIMWRITER_THREADS
+    if (w->threaded)
+    {
+        wait_for_writer(w, NULL);
+
+        /*The rings are empty and only the simulation fills them, so the writer thread leaves the compressors alone.*/
+        for (i = 0; i < w->count; i++)
+        {
+            if (w->rings[i].compressor)
+            {
+                compress_flush(w->rings[i].compressor);
+            }
+            result |= load_shared(&w->rings[i].error);
+        }
+        return result;
+    }
+#endif
+    for (i = 0; i < w->count; i++)
+    {
+        if (w->rings[i].compressor)
+        {
+            compress_flush(w->rings[i].compressor);
+        }
+        result |= w->rings[i].error;
+        result |= fflush(w->rings[i].fp) != 0;
+    }
+    return result;
+}
+
+/**
+ * @brief Function that writes text of an output stream to its file, through its compressor if it has one.
+ *
+ * @param ring The ring of the file.
+ * @param text The text.
+ * @param len The length of the text.
+ */
+static void put_text(Ring *ring, const char *text, size_t len)
+{
+    if (ring->compressor)
+    {
+        compress_text(ring->compressor, text, len);
+        return;
+    }
+    write_output(ring, text, len);
+}
+
+/**
+ * @brief Sink that writes bytes to the file of a ring, from the writer thread if it runs.
+ *
+ * @param user The ring.
+ * @param data The bytes.
+ * @param len The number of bytes.
+ */
+static void write_output(void *user, const char *data, size_t len)
+{
+    Ring *ring = (Ring *)user;
+#ifdef SIMWRITER_THREADS
+    if (ring->writer->threaded)
+    {
+        write_all(ring, data, len);
+        return;
+    }
+#endif
+    ring->error |= fwrite(data, 1, len, ring->fp) != len;
+}
+
+#ifdef SIMWRITER_THREADS
+/**
+ * @brief Function run by the writer thread: it writes every ring that holds WRITER_BATCH bytes,
+ * and every ring that holds anything when the simulation waits, when the writer stops,
+ * or when nothing was written for WRITER_IDLE_MS.
+ *
+ * @param arg The writer.
+ * @return NULL.
+ */
+static void *run_writer(void *arg)
+{
+    Writer *w = (Writer *)arg;
+    struct timespec deadline;
+    int force = FALSE, stop = FALSE, wrote;
+
+    for (;;)
+    {
+        wrote = drain(w, force || stop || load_shared(&w->waiting));
+        if (wrote && load_shared(&w->waiting))
+        {
+            pthread_mutex_lock(&w->lock);
+            pthread_cond_signal(&w->drained);
+            pthread_mutex_unlock(&w->lock);
+        }
+        if (stop)
+        {
+            /*Nothing is put in the rings after the writer stops, so the last drain wrote everything.*/
+            return NULL;
+        }
+        force = FALSE;
+        if (wrote)
+        {
+            continue;
+        }
+
+        /*Sleep until a ring fills, the simulation waits or the writer stops.
+          sleeping is set before the rings are checked, so a ring that fills after the check wakes the thread.*/
+        pthread_mutex_lock(&w->lock);
+        store_shared(&w->sleeping, TRUE);
+        if (!w->stop && !load_shared(&w->waiting) && !ready(w))
+        {
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += (long)WRITER_IDLE_MS * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L)
+            {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            force = pthread_cond_timedwait(&w->wake, &w->lock, &deadline) == ETIMEDOUT;
+        }
+        store_shared(&w->sleeping, FALSE);
+        stop = w->stop;
+        pthread_mutex_unlock(&w->lock);
+    }
+}
+
+/**
+ * @brief Function that writes the rings to their files, compressing the ones that are compressed.
+ *
+ * @param w The writer.
+ * @param force TRUE (1) to write every ring that holds anything, FALSE (0) to only write rings that hold
+ * at least WRITER_BATCH bytes.
+ * @return TRUE (1) if anything was written, FALSE (0) otherwise.
+ */
+static int drain(Writer *w, int force)
+{
+    Ring *ring;
+    size_t len, offset;
+    int i, wrote = FALSE;
+
+    for (i = 0; i < w->count; i++)
+    {
+        ring = &w->rings[i];
+        len = pending(ring);
+        if (len == 0 || (!force && len < WRITER_BATCH))
+        {
+            continue;
+        }
+        /*The text may wrap around the end of the ring, in which case it takes two writes.*/
+        while (len > 0)
+        {
+            offset = ring->tail % WRITER_RING_SIZE;
+            if (len > WRITER_RING_SIZE - offset)
+            {
+                len = WRITER_RING_SIZE - offset;
+            }
+            put_text(ring, ring->data + offset, len);
+            store_shared(&ring->tail, ring->tail + len);
+            len = pending(ring);
+        }
+        wrote = TRUE;
+    }
+    return wrote;
+}
+
+/**
+ * @brief Function that writes text to the file of a ring.
+ * After a failed write the text of the ring is dropped, so the simulation never waits for a file that cannot be written.
+ *
+ * @param ring The ring.
+ * @param data The text.
+ * @param len The length of the text.
+ */
+static void write_all(Ring *ring, const char *data, size_t len)
+{
+    ssize_t n;
+    while (len > 0 && !ring->error)
+    {
+        n = write(fileno(ring->fp), data, len);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            store_shared(&ring->error, TRUE);
+            return;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+/**
+ * @brief Function that returns the number of bytes of a ring that are not yet in its file.
+ *
+ * @param ring The ring.
+ * @return The number of bytes.
+ */
+static size_t pending(Ring *ring)
+{
+    return load_shared(&ring->head) - load_shared(&ring->tail);
+}
+
+/**
+ * @brief Function that checks whether every ring was written to its file.
+ *
+ * @param w The writer.
+ * @return TRUE (1) if no ring holds anything, FALSE (0) otherwise.
+ */
+static int all_written(Writer *w)
+{
+    int i;
+    for (i = 0; i < w->count; i++)
+    {
+        if (pending(&w->rings[i]) > 0)
+        {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Function that checks whether a ring holds enough for a large write.
+ *
+ * @param w The writer.
+ * @return TRUE (1) if a ring holds at least WRITER_BATCH bytes, FALSE (0) otherwise.
+ */
+static int ready(Writer *w)
+{
+    int i;
+    for (i = 0; i < w->count; i++)
+    {
+        if (pending(&w->rings[i]) >= WRITER_BATCH)
+        {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/**
+ * @brief Function that makes the simulation wait for the writer thread.
+ *
+ * @param w The writer.
+ * @param ring A full ring to wait for room in, or NULL to wait until every ring is written.
+ */
+static void wait_for_writer(Writer *w, Ring *ring)
+{
+    pthread_mutex_lock(&w->lock);
+    store_shared(&w->waiting, TRUE);
+    pthread_cond_signal(&w->wake);
+    while (ring ? pending(ring) == WRITER_RING_SIZE : !all_written(w))
+    {
+        pthread_cond_wait(&w->drained, &w->lock);
+    }
+    store_shared(&w->waiting, FALSE);
+    pthread_mutex_unlock(&w->lock);
+}
+
+/**
+ * @brief Function that wakes the writer thread.
+ *
+ * @param w The writer.
+ */
+static void wake_writer(Writer *w)
+{
+    pthread_mutex_lock(&w->lock);
+    pthread_cond_signal(&w->wake);
+    pthread_mutex_unlock(&w->lock);
+}
+#endif
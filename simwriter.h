@@ -0,0 +1,34 @@
+#ifndef SIMWRITER_H
+#define SIMWRITER_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*Constants*/
+
+#define WRITER_RING_SIZE ((size_t)1 << 20)    /*Bytes of the ring of each file, a power of 2*/
+#define WRITER_BATCH (WRITER_RING_SIZE / 4)   /*Bytes a ring holds before the writer thread writes it to its file*/
+#define WRITER_IDLE_MS 100                    /*Time after which the writer thread writes a ring that holds less*/
+
+/*The writer of the output files of a run. The simulation copies the text of each stream into a ring
+  and returns at once, and a writer thread drains the rings to the files in large writes.
+  Each ring has one producer, the thread that runs the machine, and one consumer, the writer thread,
+  so neither takes a lock while data flows: a lock is only taken to sleep when a ring is full or empty.
+  Without threads, or if the thread cannot be started, the text is written to the files as it arrives.
+  A compressed file is compressed by the writer thread as it drains the ring, so the simulation never waits for it.*/
+typedef struct Writer Writer;
+
+/*Creating and destroying writers.*/
+
+Writer *writer_create(FILE *fps[], int count);
+int writer_destroy(Writer *w);
+
+/*Receiving the output streams during the run.*/
+
+int writer_compress(Writer *w, int index, int method, uint64_t position);
+void *writer_file(Writer *w, int index);
+void write_to_writer(void *user, const char *text, size_t len);
+int writer_flush(Writer *w);
+
+#endif
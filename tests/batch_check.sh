@@ -0,0 +1,47 @@
+#!/bin/sh
+# Runs every program of the corpus as a job of one simbatch manifest on three threads, with a job whose imemin.txt
+# does not exist among them, and compares the output files of each job with those of sim. summary.txt must list
+# the jobs in manifest order, the failed one as failed and the others as ok with the cycles of their cycles.txt.
+
+. "$(dirname "$0")/common.sh"
+
+manifest=$WORK/manifest.txt
+summary=$WORK/summary.txt
+echo "# The corpus, and a job that fails" > "$manifest"
+for name in $(programs); do
+    assemble "$name" || { echo "FAIL $name: cannot assemble"; failures=$((failures + 1)); continue; }
+    run_sim "$name" "$WORK/$name/sim" || { echo "FAIL $name: sim failed"; failures=$((failures + 1)); }
+    echo "$WORK/$name/imemin.txt $WORK/$name/dmemin.txt $PROGRAMS/disk.txt $(irq_file "$name") $WORK/$name/batch" \
+        >> "$manifest"
+done
+echo "$WORK/missing/imemin.txt $WORK/missing/dmemin.txt $PROGRAMS/disk.txt $WORK/empty.irq $WORK/missing" \
+    >> "$manifest"
+
+if "$BIN/simbatch" --threads 3 "$manifest" "$summary" 2> /dev/null; then
+    echo "FAIL simbatch: exit code 0 with a failed job"
+    failures=$((failures + 1))
+fi
+if [ "$(head -n 1 "$summary")" != "# job status cycles seconds worker outdir" ]; then
+    echo "FAIL simbatch: summary.txt does not start with its header"
+    failures=$((failures + 1))
+fi
+
+# check_job JOB STATUS CYCLES OUTDIR: checks the line of the job in summary.txt.
+check_job()
+{
+    set -- "$1" "$2" "$3" "$4" $(sed -n "$(($1 + 2))p" "$summary")
+    if [ "$5" != "$1" ] || [ "$6" != "$2" ] || [ "$7" != "$3" ] || [ "${10}" != "$4" ]; then
+        echo "FAIL job $1: expected $2 with $3 cycles in $4 in summary.txt"
+        failures=$((failures + 1))
+    fi
+}
+
+job=0
+for name in $(programs); do
+    compare "$name" "$WORK/$name/sim" "$WORK/$name/batch"
+    check_job "$job" ok "$(cat "$WORK/$name/sim/cycles.txt")" "$WORK/$name/batch"
+    job=$((job + 1))
+done
+check_job "$job" failed 0 "$WORK/missing"
+echo "batch_check: $failures failures"
+[ "$failures" -eq 0 ]
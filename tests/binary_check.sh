@@ -0,0 +1,22 @@
+#!/bin/sh
+# Runs every program of the corpus with --binary and converts its four streams back to text with simtrace2txt:
+# they must be the text files of a run without --binary, and the other output files must not change.
+
+. "$(dirname "$0")/common.sh"
+
+STREAMS="trace.txt hwregtrace.txt leds.txt display7seg.txt"
+for name in $(programs); do
+    assemble "$name" || { echo "FAIL $name: cannot assemble"; failures=$((failures + 1)); continue; }
+    run_sim "$name" "$WORK/$name/text" || { echo "FAIL $name: sim failed"; failures=$((failures + 1)); }
+    run_sim "$name" "$WORK/$name/binary" --binary || { echo "FAIL $name: sim --binary failed"; failures=$((failures + 1)); }
+    mkdir -p "$WORK/$name/converted"
+    for file in $STREAMS; do
+        "$BIN/simtrace2txt" "$WORK/$name/binary/$file" "$WORK/$name/converted/$file" ||
+            { echo "FAIL $name: simtrace2txt $file failed"; failures=$((failures + 1)); }
+    done
+    compare "$name" "$WORK/$name/text" "$WORK/$name/converted" "$STREAMS"
+    compare "$name" "$WORK/$name/text" "$WORK/$name/binary" \
+        "dmemout.txt regout.txt cycles.txt diskout.txt monitor.txt monitor.yuv"
+done
+echo "binary_check: $failures failures"
+[ "$failures" -eq 0 ]
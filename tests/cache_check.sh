@@ -0,0 +1,61 @@
+#!/bin/sh
+# Runs every program of the corpus twice with --program-cache: the first run must add an entry for its imemin.txt
+# and the second must load that entry without writing it again, with the output files of a run without the cache.
+# An entry whose words are overwritten or that is cut short must then be ignored and replaced by a valid one.
+
+. "$(dirname "$0")/common.sh"
+
+CACHE=$WORK/cache
+mkdir -p "$CACHE"
+
+# entries: the number of entries of the cache.
+entries()
+{
+    ls "$CACHE" | grep -c '\.simpc$'
+}
+
+# cached NAME RUN: runs NAME with the cache, its output files written to $WORK/NAME/RUN, which must be those of sim.
+cached()
+{
+    run_sim "$1" "$WORK/$1/$2" --program-cache "$CACHE" ||
+        { echo "FAIL $1: sim --program-cache failed on the $2 run"; failures=$((failures + 1)); }
+    compare "$1" "$WORK/$1/plain" "$WORK/$1/$2"
+}
+
+for name in $(programs); do
+    assemble "$name" || { echo "FAIL $name: cannot assemble"; failures=$((failures + 1)); continue; }
+    run_sim "$name" "$WORK/$name/plain" || { echo "FAIL $name: sim failed"; failures=$((failures + 1)); }
+    before=$(entries)
+    cached "$name" first
+    entry=$(ls -t "$CACHE"/*.simpc | head -n 1)
+    if [ "$(entries)" -ne $((before + 1)) ]; then
+        echo "FAIL $name: the first run did not add an entry"
+        failures=$((failures + 1))
+        continue
+    fi
+    cp "$entry" "$WORK/$name/entry.simpc"
+    inode=$(ls -i "$entry")
+    cached "$name" second
+    if [ "$(ls -i "$entry")" != "$inode" ] || [ "$(entries)" -ne $((before + 1)) ]; then
+        echo "FAIL $name: the second run wrote the entry again"
+        failures=$((failures + 1))
+    fi
+
+    size=$(wc -c < "$entry")
+    printf '\125\252\125\252\125\252\125\252' | dd of="$entry" bs=1 seek=$((size - 8)) conv=notrunc 2> /dev/null
+    head -c $((size / 2)) "$WORK/$name/entry.simpc" > "$WORK/$name/short.simpc"
+    for damage in overwritten short; do
+        [ "$damage" = short ] && cp "$WORK/$name/short.simpc" "$entry"
+        if cmp -s "$entry" "$WORK/$name/entry.simpc"; then
+            echo "FAIL $name: the entry was not damaged"
+            failures=$((failures + 1))
+        fi
+        cached "$name" "$damage"
+        if ! cmp -s "$entry" "$WORK/$name/entry.simpc"; then
+            echo "FAIL $name: the $damage entry was not replaced"
+            failures=$((failures + 1))
+        fi
+    done
+done
+echo "cache_check: $failures failures"
+[ "$failures" -eq 0 ]
@@ -0,0 +1,35 @@
+#!/bin/sh
+# Runs every program of the corpus with a checkpoint every 64 cycles, then resumes it from its last checkpoint over
+# its own output files, whose stream files are damaged past the checkpoint first. Both runs must write the output
+# files of a run without checkpoints, and a checkpoint must not restore on another program.
+
+. "$(dirname "$0")/common.sh"
+
+restored=0
+for name in $(programs); do
+    assemble "$name" || { echo "FAIL $name: cannot assemble"; failures=$((failures + 1)); continue; }
+    run_sim "$name" "$WORK/$name/sim" || { echo "FAIL $name: sim failed"; failures=$((failures + 1)); }
+    checkpoint=$WORK/$name/checkpoint.bin
+    run_sim "$name" "$WORK/$name/ck" --checkpoint-every 64 --checkpoint-file "$checkpoint" ||
+        { echo "FAIL $name: sim with checkpoints failed"; failures=$((failures + 1)); }
+    compare "$name" "$WORK/$name/sim" "$WORK/$name/ck"
+    if [ -f "$checkpoint" ]; then
+        # The streams are cut at the positions of the checkpoint, so what follows them must not matter.
+        echo garbage >> "$WORK/$name/ck/trace.txt"
+        echo garbage >> "$WORK/$name/ck/hwregtrace.txt"
+        run_sim "$name" "$WORK/$name/ck" --restore "$checkpoint" ||
+            { echo "FAIL $name: sim --restore failed"; failures=$((failures + 1)); }
+        compare "$name" "$WORK/$name/sim" "$WORK/$name/ck"
+        restored=$((restored + 1))
+    fi
+done
+if [ "$restored" -eq 0 ]; then
+    echo "FAIL: no program saved a checkpoint"
+    failures=$((failures + 1))
+fi
+if run_sim arith "$WORK/arith/other" --restore "$WORK/timer/checkpoint.bin" 2> /dev/null; then
+    echo "FAIL arith: restored the checkpoint of timer"
+    failures=$((failures + 1))
+fi
+echo "checkpoint_check: $failures failures"
+[ "$failures" -eq 0 ]
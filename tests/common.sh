@@ -0,0 +1,67 @@
+# Shared by the test scripts: the corpus of tests/programs, assembled and run through sim.
+# ASM and SIM name the assembler and the simulator, ./asm and ./sim built as in README.md by default.
+# The other tools, such as simbatch and simtrace2txt, are the ones in the directory of the simulator.
+
+TESTS=$(cd "$(dirname "$0")" && pwd)
+ROOT=$(dirname "$TESTS")
+ASM=${ASM:-$ROOT/asm}
+SIM=${SIM:-$ROOT/sim}
+BIN=$(dirname "$SIM")
+PROGRAMS=$TESTS/programs
+OUTPUTS="dmemout.txt regout.txt trace.txt hwregtrace.txt cycles.txt leds.txt display7seg.txt diskout.txt monitor.txt monitor.yuv"
+WORK=$(mktemp -d "${TMPDIR:-/tmp}/simtest.XXXXXX") || exit 1
+trap 'rm -rf "$WORK"' EXIT
+: > "$WORK/empty.irq"
+failures=0
+
+# assemble NAME: assembles tests/programs/NAME.asm into $WORK/NAME/imemin.txt and dmemin.txt.
+assemble()
+{
+    mkdir -p "$WORK/$1"
+    "$ASM" "$PROGRAMS/$1.asm" "$WORK/$1/imemin.txt" "$WORK/$1/dmemin.txt" > /dev/null
+}
+
+# irq_file NAME: the irq2in.txt of a program, NAME.irq if it has one and an empty schedule otherwise.
+irq_file()
+{
+    if [ -f "$PROGRAMS/$1.irq" ]; then echo "$PROGRAMS/$1.irq"; else echo "$WORK/empty.irq"; fi
+}
+
+# run_sim NAME DIR [OPTIONS...]: runs the assembled program with the options, its output files written to DIR.
+run_sim()
+{
+    name=$1
+    dir=$2
+    shift 2
+    run_schedule "$name" "$(irq_file "$name")" "$dir" "$@"
+}
+
+# run_schedule NAME IRQ DIR [OPTIONS...]: runs the assembled program like run_sim, with IRQ as its irq2in.txt.
+run_schedule()
+{
+    name=$1
+    irq=$2
+    dir=$3
+    shift 3
+    mkdir -p "$dir"
+    (cd "$dir" && "$SIM" "$@" "$WORK/$name/imemin.txt" "$WORK/$name/dmemin.txt" "$PROGRAMS/disk.txt" "$irq" \
+        dmemout.txt regout.txt trace.txt hwregtrace.txt cycles.txt leds.txt display7seg.txt diskout.txt monitor.txt \
+        monitor.yuv)
+}
+
+# compare NAME EXPECTED ACTUAL [FILES]: counts a failure for each of the output files that differ.
+compare()
+{
+    for file in ${4:-$OUTPUTS}; do
+        if ! cmp -s "$2/$file" "$3/$file"; then
+            echo "FAIL $1: $file differs"
+            failures=$((failures + 1))
+        fi
+    done
+}
+
+# programs: the names of the programs of the corpus.
+programs()
+{
+    for asm in "$PROGRAMS"/*.asm; do basename "$asm" .asm; done
+}
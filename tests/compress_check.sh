@@ -0,0 +1,66 @@
+#!/bin/sh
+# Runs every program of the corpus with --trace-compress lz, and zlib when sim was built with it, in text and in
+# binary: simtrace2txt must turn trace.txt and hwregtrace.txt back into the text files of an uncompressed run.
+# programs/bench/count.asm, whose trace spans many frames, must also give the same simtrace queries compressed, and
+# the same files when resumed from a checkpoint, which cuts the compressed file inside a frame.
+
+. "$(dirname "$0")/common.sh"
+
+# check_converted NAME EXPECTED DIR FILES: checks the output files of DIR against those of EXPECTED, converting
+# FILES, the compressed or binary ones, with simtrace2txt first.
+check_converted()
+{
+    mkdir -p "$3/text"
+    for file in $4; do
+        "$BIN/simtrace2txt" "$3/$file" "$3/text/$file" ||
+            { echo "FAIL $1: simtrace2txt $file failed"; failures=$((failures + 1)); }
+    done
+    compare "$1" "$2" "$3/text" "$4"
+    compare "$1" "$2" "$3" "dmemout.txt regout.txt cycles.txt diskout.txt monitor.txt"
+}
+
+methods=lz
+assemble arith || { echo "FAIL arith: cannot assemble"; exit 1; }
+if run_sim arith "$WORK/probe" --trace-compress zlib 2> /dev/null; then
+    methods="lz zlib"
+fi
+for name in $(programs) bench/count; do
+    assemble "$name" || { echo "FAIL $name: cannot assemble"; failures=$((failures + 1)); continue; }
+    run_sim "$name" "$WORK/$name/plain" --index || { echo "FAIL $name: sim failed"; failures=$((failures + 1)); }
+    for method in $methods; do
+        for format in text binary; do
+            dir=$WORK/$name/$method-$format
+            if [ "$format" = binary ]; then
+                run_sim "$name" "$dir" --index --trace-compress "$method" --binary ||
+                    { echo "FAIL $name: sim --trace-compress $method --binary failed"; failures=$((failures + 1)); }
+                check_converted "$name" "$WORK/$name/plain" "$dir" "trace.txt hwregtrace.txt leds.txt display7seg.txt"
+            else
+                run_sim "$name" "$dir" --index --trace-compress "$method" ||
+                    { echo "FAIL $name: sim --trace-compress $method failed"; failures=$((failures + 1)); }
+                check_converted "$name" "$WORK/$name/plain" "$dir" "trace.txt hwregtrace.txt"
+                compare "$name" "$WORK/$name/plain" "$dir" "leds.txt display7seg.txt"
+            fi
+        done
+    done
+done
+
+name=bench/count
+for method in $methods; do
+    for cycle in 0 70000 199990; do
+        "$BIN/simtrace" query --cycle "$cycle" --window 40 "$WORK/$name/plain/trace.txt" > "$WORK/expected.txt"
+        for format in text binary; do
+            if ! "$BIN/simtrace" query --cycle "$cycle" --window 40 "$WORK/$name/$method-$format/trace.txt" |
+                cmp -s - "$WORK/expected.txt"; then
+                echo "FAIL $name: simtrace query --cycle $cycle of the $method $format trace differs"
+                failures=$((failures + 1))
+            fi
+        done
+    done
+    dir=$WORK/$name/$method-restored
+    run_sim "$name" "$dir" --trace-compress "$method" --checkpoint-every 100003 --checkpoint-file "$dir.bin" &&
+        run_sim "$name" "$dir" --trace-compress "$method" --restore "$dir.bin" ||
+        { echo "FAIL $name: sim --trace-compress $method --restore failed"; failures=$((failures + 1)); }
+    check_converted "$name" "$WORK/$name/plain" "$dir" "trace.txt hwregtrace.txt"
+done
+echo "compress_check: $failures failures"
+[ "$failures" -eq 0 ]
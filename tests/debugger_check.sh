@@ -0,0 +1,37 @@
+#!/bin/sh
+# Moves simdbg forward and backward through irq2.asm, whose interrupts make the run depend on the irq 2 schedule,
+# with a snapshot every 16 cycles, and to a breakpoint. At every stop the cycle, the pc and the registers must be
+# those of the line of trace.txt for that cycle.
+
+. "$(dirname "$0")/common.sh"
+
+name=irq2
+assemble "$name" || { echo "FAIL $name: cannot assemble"; exit 1; }
+run_sim "$name" "$WORK/sim" || { echo "FAIL $name: sim failed"; exit 1; }
+trace=$WORK/sim/trace.txt
+
+# The breakpoint is the first instruction of the isr, and continue from cycle 0 stops at the first interrupt.
+address=008
+first=$(awk -v pc="$address" 'NR > 1 && $1 == pc { print NR - 1; exit }' "$trace")
+for cycle in 150 40 240 165 "$first"; do
+    sed -n "$((cycle + 1))p" "$trace" |
+        awk -v c="$cycle" '{ s = c " " $1; for (i = 6; i <= 18; i++) s = s " " $i; print s }'
+done > "$WORK/expected.txt"
+
+printf 'goto 150\nregs\ngoto 40\nregs\nstep 200\nregs\nreverse-step 75\nregs\n' > "$WORK/commands.txt"
+printf 'goto 0\nbreak 0x%s\ncontinue\nregs\nquit\n' "$address" >> "$WORK/commands.txt"
+"$BIN/simdbg" --interval 16 "$WORK/$name/imemin.txt" "$WORK/$name/dmemin.txt" "$PROGRAMS/disk.txt" "$(irq_file "$name")" \
+    < "$WORK/commands.txt" > "$WORK/simdbg.txt" || { echo "FAIL simdbg: exit code not 0"; failures=$((failures + 1)); }
+
+# Each stop prints "cycle N pc ADDRESS INSTRUCTION", and regs prints $zero to $ra, of which $v0 to $ra are kept.
+awk '{ sub(/^(\(simdbg\) )+/, "") }
+     $1 == "cycle" && $3 == "pc" { stop = $2 " " $4; n = 0 }
+     { for (i = 1; i < NF; i++) if ($i ~ /^\$/ && ++n > 3) stop = stop " " $(i + 1) }
+     n == 16 { print stop; n = 0 }' "$WORK/simdbg.txt" > "$WORK/stops.txt"
+if ! cmp -s "$WORK/expected.txt" "$WORK/stops.txt"; then
+    echo "FAIL simdbg: the stops differ from trace.txt"
+    diff "$WORK/expected.txt" "$WORK/stops.txt"
+    failures=$((failures + 1))
+fi
+echo "debugger_check: $failures failures"
+[ "$failures" -eq 0 ]
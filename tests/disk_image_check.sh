@@ -0,0 +1,64 @@
+#!/bin/sh
+# Converts tests/programs/disk.txt to disk images with simdisk, of the default geometry and of 64x256, and back to
+# text, which must be disk.txt again. Every program of the corpus then runs with each image as diskin.txt, writing
+# diskout.txt to another image and to the same image in place: the text of the image written must be diskout.txt of
+# the text run with the same geometry, but for the words of 0 that end the last sector written, which the text of an
+# image leaves out, and the other output files must not change.
+
+. "$(dirname "$0")/common.sh"
+
+# run_disk NAME DISKIN DISKOUT DIR [OPTIONS...]: runs NAME like run_sim, with the given diskin.txt and diskout.txt.
+run_disk()
+{
+    name=$1
+    diskin=$2
+    diskout=$3
+    dir=$4
+    shift 4
+    mkdir -p "$dir"
+    (cd "$dir" && "$SIM" "$@" "$WORK/$name/imemin.txt" "$WORK/$name/dmemin.txt" "$diskin" "$(irq_file "$name")" \
+        dmemout.txt regout.txt trace.txt hwregtrace.txt cycles.txt leds.txt display7seg.txt "$diskout" monitor.txt \
+        monitor.yuv)
+}
+
+# words FILE: the words of a diskout.txt up to the last one that is not 0.
+words()
+{
+    awk '$0 != "00000000" { while (zeros > 0) { print "00000000"; zeros-- } print; next } { zeros++ }' "$1"
+}
+
+for geometry in 128x128 64x256; do
+    "$BIN/simdisk" --geometry "$geometry" "$PROGRAMS/disk.txt" "$WORK/$geometry.img" &&
+        "$BIN/simdisk" --text "$WORK/$geometry.img" "$WORK/$geometry.txt" ||
+        { echo "FAIL $geometry: simdisk failed"; failures=$((failures + 1)); continue; }
+    if ! cmp -s "$PROGRAMS/disk.txt" "$WORK/$geometry.txt"; then
+        echo "FAIL $geometry: the text of the image is not disk.txt"
+        failures=$((failures + 1))
+    fi
+done
+
+for name in $(programs); do
+    assemble "$name" || { echo "FAIL $name: cannot assemble"; failures=$((failures + 1)); continue; }
+    for geometry in 128x128 64x256; do
+        runs=$WORK/$name/$geometry
+        run_sim "$name" "$runs/text" --disk-geometry "$geometry" ||
+            { echo "FAIL $name: sim --disk-geometry $geometry failed"; failures=$((failures + 1)); }
+        run_disk "$name" "$WORK/$geometry.img" diskout.img "$runs/image" ||
+            { echo "FAIL $name: sim failed on the $geometry image"; failures=$((failures + 1)); }
+        words "$runs/text/diskout.txt" > "$runs/text/words.txt"
+        mkdir -p "$runs/inplace"
+        cp "$WORK/$geometry.img" "$runs/inplace/disk.img"
+        run_disk "$name" disk.img disk.img "$runs/inplace" ||
+            { echo "FAIL $name: sim failed on the $geometry image in place"; failures=$((failures + 1)); }
+        for run in image inplace; do
+            image=$runs/$run/diskout.img
+            [ "$run" = inplace ] && image=$runs/$run/disk.img
+            "$BIN/simdisk" --text "$image" "$runs/$run/words.txt" ||
+                { echo "FAIL $name: simdisk --text failed on the $run $geometry image"; failures=$((failures + 1)); }
+            compare "$name" "$runs/text" "$runs/$run" "dmemout.txt regout.txt trace.txt hwregtrace.txt cycles.txt \
+                leds.txt display7seg.txt words.txt monitor.txt monitor.yuv"
+        done
+    done
+done
+echo "disk_image_check: $failures failures"
+[ "$failures" -eq 0 ]
@@ -0,0 +1,15 @@
+#!/bin/sh
+# Runs every program of tests/golden and compares its output files with the golden ones, which the first simulator,
+# formatting every line with printf, wrote. The hex formatting of the traces and dumps must not change a byte.
+# wrap.asm has no golden files: the first simulator wrote past the end of its arrays on it.
+
+. "$(dirname "$0")/common.sh"
+
+for golden in "$TESTS"/golden/*/; do
+    name=$(basename "$golden")
+    assemble "$name" || { echo "FAIL $name: cannot assemble"; failures=$((failures + 1)); continue; }
+    run_sim "$name" "$WORK/$name/out" || { echo "FAIL $name: sim failed"; failures=$((failures + 1)); }
+    compare "$name" "$golden" "$WORK/$name/out" "$(cd "$golden" && ls)"
+done
+echo "golden_check: $failures failures"
+[ "$failures" -eq 0 ]
@@ -0,0 +1,50 @@
+#!/bin/sh
+# Assembles every program of the corpus with asm -b and runs its image in place of imemin.txt and dmemin.txt, and of
+# the symbol file for a trace of its first label: the output files must be those of the text files, also when only
+# imemin.txt is replaced by the image.
+
+. "$(dirname "$0")/common.sh"
+
+# run_program NAME IMEM DMEM DIR [OPTIONS...]: runs NAME like run_sim, from the given imemin.txt and dmemin.txt.
+run_program()
+{
+    name=$1
+    imem=$2
+    dmem=$3
+    dir=$4
+    shift 4
+    mkdir -p "$dir"
+    (cd "$dir" && "$SIM" "$@" "$imem" "$dmem" "$PROGRAMS/disk.txt" "$(irq_file "$name")" dmemout.txt regout.txt \
+        trace.txt hwregtrace.txt cycles.txt leds.txt display7seg.txt diskout.txt monitor.txt monitor.yuv)
+}
+
+for name in $(programs); do
+    mkdir -p "$WORK/$name"
+    "$ASM" "$PROGRAMS/$name.asm" "$WORK/$name/imemin.txt" "$WORK/$name/dmemin.txt" "$WORK/$name/symbols.txt" \
+        > /dev/null && "$ASM" -b "$PROGRAMS/$name.asm" "$WORK/$name/program.simp" > /dev/null ||
+        { echo "FAIL $name: cannot assemble"; failures=$((failures + 1)); continue; }
+    text=$WORK/$name/imemin.txt
+    image=$WORK/$name/program.simp
+    run_program "$name" "$text" "$WORK/$name/dmemin.txt" "$WORK/$name/text" ||
+        { echo "FAIL $name: sim failed"; failures=$((failures + 1)); }
+    run_program "$name" "$image" "$image" "$WORK/$name/image" ||
+        { echo "FAIL $name: sim failed on the image"; failures=$((failures + 1)); }
+    compare "$name" "$WORK/$name/text" "$WORK/$name/image"
+    run_program "$name" "$image" "$WORK/$name/dmemin.txt" "$WORK/$name/mixed" ||
+        { echo "FAIL $name: sim failed on the image with dmemin.txt"; failures=$((failures + 1)); }
+    compare "$name" "$WORK/$name/text" "$WORK/$name/mixed"
+
+    label=$(sed -n 's/^\([A-Za-z_][A-Za-z0-9_]*\):.*/\1/p' "$PROGRAMS/$name.asm" | head -n 1)
+    [ -n "$label" ] || continue
+    run_program "$name" "$text" "$WORK/$name/dmemin.txt" "$WORK/$name/text-$label" --symbols "$WORK/$name/symbols.txt" \
+        --trace-pc "$label" || { echo "FAIL $name: sim --trace-pc $label failed"; failures=$((failures + 1)); }
+    run_program "$name" "$image" "$image" "$WORK/$name/image-$label" --symbols "$image" --trace-pc "$label" ||
+        { echo "FAIL $name: sim --trace-pc $label failed on the image"; failures=$((failures + 1)); }
+    compare "$name" "$WORK/$name/text-$label" "$WORK/$name/image-$label"
+    if [ ! -s "$WORK/$name/image-$label/trace.txt" ]; then
+        echo "FAIL $name: nothing traced at $label"
+        failures=$((failures + 1))
+    fi
+done
+echo "image_check: $failures failures"
+[ "$failures" -eq 0 ]
@@ -0,0 +1,48 @@
+#!/bin/sh
+# Runs programs/bench/count.asm, whose trace spans four blocks of the index, with --index, in text and in binary.
+# simtrace query must print the lines of trace.txt from cycle N - window to N + window, across the blocks and at
+# the ends of the trace, and the lines at an address, the same for both formats, and simtrace index must write the
+# index that --index wrote.
+
+. "$(dirname "$0")/common.sh"
+
+name=bench/count
+assemble "$name" || { echo "FAIL $name: cannot assemble"; exit 1; }
+run_sim "$name" "$WORK/text" --index || { echo "FAIL $name: sim --index failed"; failures=$((failures + 1)); }
+run_sim "$name" "$WORK/binary" --index --binary ||
+    { echo "FAIL $name: sim --index --binary failed"; failures=$((failures + 1)); }
+trace=$WORK/text/trace.txt
+last=$(($(wc -l < "$trace") - 1))
+
+# check_query EXPECTED OPTIONS...: checks the output of a query of both traces.
+check_query()
+{
+    expected=$1
+    shift
+    for format in text binary; do
+        if ! "$BIN/simtrace" query "$@" "$WORK/$format/trace.txt" | cmp -s - "$expected"; then
+            echo "FAIL $format: simtrace query $* differs from trace.txt"
+            failures=$((failures + 1))
+        fi
+    done
+}
+
+for cycle in 0 3 65535 65536 131070 150001 "$last"; do
+    first=$((cycle > 5 ? cycle - 5 : 0))
+    end=$((cycle + 5 < last ? cycle + 5 : last))
+    sed -n "$((first + 1)),$((end + 1))p" "$trace" > "$WORK/expected.txt"
+    check_query "$WORK/expected.txt" --cycle "$cycle" --window 5
+done
+grep '^002 ' "$trace" > "$WORK/expected.txt"
+check_query "$WORK/expected.txt" --pc 2
+sed -n '65531,65547p' "$trace" | grep '^005 ' > "$WORK/expected.txt"
+check_query "$WORK/expected.txt" --cycle 65538 --window 8 --pc 5
+
+mv "$trace.idx" "$WORK/text/index.idx"
+"$BIN/simtrace" index "$trace" || { echo "FAIL simtrace index failed"; failures=$((failures + 1)); }
+if ! cmp -s "$trace.idx" "$WORK/text/index.idx"; then
+    echo "FAIL simtrace index: the index differs from that of --index"
+    failures=$((failures + 1))
+fi
+echo "index_check: $failures failures"
+[ "$failures" -eq 0 ]
@@ -0,0 +1,69 @@
+#!/bin/sh
+# Checks the loading of imemin.txt, dmemin.txt and diskin.txt. Lines ending in CRLF, blank lines and words of fewer
+# than 8 hex digits must run as the plain files do, and a malformed line must stop sim with the name of the file,
+# the number of the line and what was expected, without any output file.
+
+. "$(dirname "$0")/common.sh"
+
+# run_inputs NAME DIR: runs the imemin.txt, dmemin.txt and diskin.txt of DIR with the irq2in.txt of NAME, in DIR,
+# its errors written to DIR/errors.txt.
+run_inputs()
+{
+    (cd "$2" && "$SIM" imemin.txt dmemin.txt diskin.txt "$(irq_file "$1")" dmemout.txt regout.txt trace.txt \
+        hwregtrace.txt cycles.txt leds.txt display7seg.txt diskout.txt monitor.txt monitor.yuv 2> errors.txt)
+}
+
+# variant NAME DIR SCRIPT [WORDS]: writes the three inputs of NAME to DIR edited by the sed SCRIPT, which edits
+# only dmemin.txt and diskin.txt when WORDS is given.
+variant()
+{
+    mkdir -p "$2"
+    if [ -n "$4" ]; then cp "$WORK/$1/imemin.txt" "$2"; else sed "$3" "$WORK/$1/imemin.txt" > "$2/imemin.txt"; fi
+    sed "$3" "$WORK/$1/dmemin.txt" > "$2/dmemin.txt"
+    sed "$3" "$PROGRAMS/disk.txt" > "$2/diskin.txt"
+}
+
+# accepted NAME KIND SCRIPT [WORDS]: the inputs of NAME edited as by variant must run as the plain inputs do.
+accepted()
+{
+    variant "$1" "$WORK/$1/$2" "$3" $4
+    run_inputs "$1" "$WORK/$1/$2" || { echo "FAIL $1: sim failed on $2 lines"; failures=$((failures + 1)); }
+    compare "$1" "$WORK/$1/plain" "$WORK/$1/$2"
+}
+
+# malformed NAME FILE LINE WORD ERROR: replaces line LINE of FILE with WORD, which must fail with ERROR.
+malformed()
+{
+    dir=$WORK/$1/malformed
+    variant "$1" "$dir" ""
+    sed "$3s/.*/$4/" "$dir/$2" > "$dir/edited.txt" && mv "$dir/edited.txt" "$dir/$2"
+    rm -f "$dir/trace.txt"
+    run_inputs "$1" "$dir"
+    status=$?
+    if [ "$status" -ne 1 ]; then
+        echo "FAIL $1: sim exited with $status on $4 at $2:$3"
+        failures=$((failures + 1))
+    elif [ "$(cat "$dir/errors.txt")" != "$2:$3: $5" ]; then
+        echo "FAIL $1: $4 at $2:$3 gave \"$(cat "$dir/errors.txt")\""
+        failures=$((failures + 1))
+    elif [ -e "$dir/trace.txt" ]; then
+        echo "FAIL $1: sim wrote output files for $4 at $2:$3"
+        failures=$((failures + 1))
+    fi
+}
+
+WORD="expected a word of 1 to 8 hex digits"
+for name in arith disk; do
+    assemble "$name" || { echo "FAIL $name: cannot assemble"; failures=$((failures + 1)); continue; }
+    variant "$name" "$WORK/$name/plain" ""
+    run_inputs "$name" "$WORK/$name/plain" || { echo "FAIL $name: sim failed"; failures=$((failures + 1)); }
+    accepted "$name" crlf 's/$/\r/'
+    accepted "$name" blank '3s/$/\n/;$s/$/\n\n/'
+    accepted "$name" short 's/^0*\(.\)/\1/' words
+done
+malformed arith dmemin.txt 12 12G45 "$WORD"
+malformed arith dmemin.txt 5 123456789 "$WORD"
+malformed arith diskin.txt 7 0x12 "$WORD"
+malformed arith imemin.txt 3 12345 "expected an instruction of 12 hex digits"
+echo "input_check: $failures failures"
+[ "$failures" -eq 0 ]
@@ -0,0 +1,45 @@
+#!/bin/sh
+# Checks the loading of irq2in.txt on the programs with an irq 2 schedule. The schedule read from standard input as
+# -, with every entry repeated, which must fire once, or followed by entries beyond 32 bits, which would be out of
+# order if they were cut to 32 bits, must run as the plain file does. Entries out of order must stop sim with the
+# number of the line, without any output file.
+
+. "$(dirname "$0")/common.sh"
+
+# schedule NAME IRQ: runs NAME with the schedule IRQ, its output files written to $WORK/NAME/IRQ, which must be those
+# of the plain schedule.
+schedule()
+{
+    run_schedule "$1" "$WORK/$1/$2.irq" "$WORK/$1/$2" ||
+        { echo "FAIL $1: sim failed on the $2 schedule"; failures=$((failures + 1)); }
+    compare "$1" "$WORK/$1/plain" "$WORK/$1/$2"
+}
+
+for name in $(programs); do
+    irq2in=$PROGRAMS/$name.irq
+    [ -f "$irq2in" ] || continue
+    assemble "$name" || { echo "FAIL $name: cannot assemble"; failures=$((failures + 1)); continue; }
+    run_sim "$name" "$WORK/$name/plain" || { echo "FAIL $name: sim failed"; failures=$((failures + 1)); }
+
+    run_schedule "$name" - "$WORK/$name/stdin" < "$irq2in" ||
+        { echo "FAIL $name: sim failed on standard input"; failures=$((failures + 1)); }
+    compare "$name" "$WORK/$name/plain" "$WORK/$name/stdin"
+    sed 'p' "$irq2in" > "$WORK/$name/repeated.irq"
+    schedule "$name" repeated
+    { cat "$irq2in"; echo 4294967296; echo 4294967397; echo 99999999999; } > "$WORK/$name/wide.irq"
+    schedule "$name" wide
+
+    { cat "$irq2in"; head -n 1 "$irq2in"; } > "$WORK/$name/unordered.irq"
+    error="$WORK/$name/unordered.irq:$(($(wc -l < "$irq2in") + 1)): irq 2 entries must be in increasing order"
+    run_schedule "$name" "$WORK/$name/unordered.irq" "$WORK/$name/unordered" 2> "$WORK/$name/errors.txt"
+    status=$?
+    if [ "$status" -ne 1 ] || [ "$(cat "$WORK/$name/errors.txt")" != "$error" ]; then
+        echo "FAIL $name: entries out of order exited with $status and \"$(cat "$WORK/$name/errors.txt")\""
+        failures=$((failures + 1))
+    elif [ -e "$WORK/$name/unordered/trace.txt" ]; then
+        echo "FAIL $name: sim wrote output files for entries out of order"
+        failures=$((failures + 1))
+    fi
+done
+echo "irq2_check: $failures failures"
+[ "$failures" -eq 0 ]
@@ -0,0 +1,48 @@
+#!/bin/sh
+# Runs every program of the corpus with the interpreter and with --jit. The jit only changes how hot blocks run, so
+# every output file, trace.txt, hwregtrace.txt, regout.txt and cycles.txt included, must be byte-identical.
+# It then times programs/bench/alu.asm, a hot loop of ALU instructions that --jit must run faster than the
+# interpreter. The trace only holds the instructions before the loop, so the loop runs without writing trace.txt.
+
+. "$(dirname "$0")/common.sh"
+
+for name in $(programs); do
+    assemble "$name" || { echo "FAIL $name: cannot assemble"; failures=$((failures + 1)); continue; }
+    run_sim "$name" "$WORK/$name/interpreter" || { echo "FAIL $name: sim failed"; failures=$((failures + 1)); }
+    run_sim "$name" "$WORK/$name/jit" --jit || { echo "FAIL $name: sim --jit failed"; failures=$((failures + 1)); }
+    compare "$name" "$WORK/$name/interpreter" "$WORK/$name/jit"
+done
+
+# fastest NAME DIR [OPTIONS...]: the milliseconds of the fastest of three runs of the program.
+fastest()
+{
+    best=
+    for run in 1 2 3; do
+        start=$(date +%s%N)
+        run_sim "$@" || return 1
+        elapsed=$((($(date +%s%N) - start) / 1000000))
+        if [ -z "$best" ] || [ "$elapsed" -lt "$best" ]; then best=$elapsed; fi
+    done
+    echo "$best"
+}
+
+bench=bench/alu
+if ! date +%N | grep -q '^[0-9][0-9]*$'; then
+    echo "jit_diff: date cannot print nanoseconds, $bench is not timed"
+elif ! assemble "$bench"; then
+    echo "FAIL $bench: cannot assemble"
+    failures=$((failures + 1))
+elif ! interpreter=$(fastest "$bench" "$WORK/$bench/interpreter" --trace-pc 0-2) ||
+    ! jit=$(fastest "$bench" "$WORK/$bench/jit" --jit --trace-pc 0-2); then
+    echo "FAIL $bench: sim failed"
+    failures=$((failures + 1))
+else
+    echo "jit_diff: $bench takes $interpreter ms with the interpreter and $jit ms with --jit"
+    compare "$bench" "$WORK/$bench/interpreter" "$WORK/$bench/jit"
+    if [ "$jit" -ge "$interpreter" ]; then
+        echo "FAIL $bench: --jit is not faster than the interpreter"
+        failures=$((failures + 1))
+    fi
+fi
+echo "jit_diff: $failures failures"
+[ "$failures" -eq 0 ]
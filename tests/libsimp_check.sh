@@ -0,0 +1,22 @@
+#!/bin/sh
+# Runs every program of the corpus through libsimp with tests/libsimp_driver.cpp, which uses the C++ wrapper and
+# runs the program in steps, and compares the output files it writes with those of sim.
+# CC and CXX name the compilers the driver is built with.
+
+. "$(dirname "$0")/common.sh"
+
+${CC:-cc} -O2 -c -o "$WORK/libsimp.o" "$ROOT/libsimp.c" &&
+    ${CXX:-c++} -O2 -std=c++11 -o "$WORK/libsimp_driver" "$TESTS/libsimp_driver.cpp" "$WORK/libsimp.o" ||
+    { echo "libsimp_check: cannot build the driver"; exit 1; }
+
+for name in $(programs); do
+    assemble "$name" || { echo "FAIL $name: cannot assemble"; failures=$((failures + 1)); continue; }
+    run_sim "$name" "$WORK/$name/sim" || { echo "FAIL $name: sim failed"; failures=$((failures + 1)); }
+    mkdir -p "$WORK/$name/libsimp"
+    "$WORK/libsimp_driver" "$WORK/$name/imemin.txt" "$WORK/$name/dmemin.txt" "$PROGRAMS/disk.txt" \
+        "$(irq_file "$name")" "$WORK/$name/libsimp" || { echo "FAIL $name: driver failed"; failures=$((failures + 1)); }
+    compare "$name" "$WORK/$name/sim" "$WORK/$name/libsimp" \
+        "trace.txt hwregtrace.txt leds.txt display7seg.txt regout.txt dmemout.txt cycles.txt"
+done
+echo "libsimp_check: $failures failures"
+[ "$failures" -eq 0 ]
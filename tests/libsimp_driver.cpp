@@ -0,0 +1,116 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "../libsimp.hpp"
+
+/*Constants*/
+
+#define STEP_CYCLES 997     /*Cycles of each step, not a divisor of anything so the steps cut the run anywhere*/
+
+/**
+ * @brief Function that reads a whole input file.
+ *
+ * @param file_name The name of the file.
+ * @param text The contents of the file.
+ * @return true on success, false if the file cannot be read.
+ */
+static bool read_file(const std::string &file_name, std::string &text)
+{
+    std::ifstream in(file_name.c_str(), std::ios::binary);
+    std::ostringstream contents;
+    contents << in.rdbuf();
+    text = contents.str();
+    return static_cast<bool>(in);
+}
+
+/**
+ * @brief Function that writes words as lines of 8 hex digits, as in regout.txt and dmemout.txt.
+ *
+ * @param file_name The name of the file.
+ * @param words The words.
+ * @param count The number of words.
+ * @return true on success, false on failure.
+ */
+static bool write_words(const std::string &file_name, const int *words, int count)
+{
+    std::ofstream out(file_name.c_str(), std::ios::binary);
+    char line[16];
+    for (int i = 0; i < count; i++)
+    {
+        std::snprintf(line, sizeof(line), "%08X\n", static_cast<unsigned int>(words[i]));
+        out << line;
+    }
+    return static_cast<bool>(out);
+}
+
+/*Runs a program through libsimp, by its C++ wrapper, and writes the output files sim writes for its streams,
+  registers, memory and cycles, so that they can be compared with those of sim.
+  Usage: libsimp_driver imemin.txt dmemin.txt diskin.txt irq2in.txt outdir*/
+int main(int argc, char *argv[])
+{
+    static const char *stream_files[SIM_STREAM_NUM] = {"trace.txt", "hwregtrace.txt", "leds.txt", "display7seg.txt"};
+    static const char *inputs[] = {"imemin.txt", "dmemin.txt", "diskin.txt"};
+    std::string text[3], outdir;
+    std::ofstream streams[SIM_STREAM_NUM];
+    int registers[SIM_CPU_REG_NUM], memory[SIM_MEM_DEPTH], status = SIM_RUNNING;
+
+    if (argc != 6)
+    {
+        std::cerr << "Usage: libsimp_driver imemin.txt dmemin.txt diskin.txt irq2in.txt outdir\n";
+        return 1;
+    }
+    outdir = std::string(argv[5]) + "/";
+    for (int i = 0; i < 3; i++)
+    {
+        if (!read_file(argv[i + 1], text[i]))
+        {
+            std::cerr << "Cannot read " << inputs[i] << " " << argv[i + 1] << "\n";
+            return 1;
+        }
+    }
+    std::ifstream irq2(argv[4], std::ios::binary);
+
+    simp::Machine m;
+    if (m.load_imem(text[0]) || m.load_dmem(text[1]) || m.load_disk(text[2]) || !irq2 || m.stream_irq2(irq2))
+    {
+        std::cerr << "Cannot load the program: " << m.load_error() << "\n";
+        return 1;
+    }
+    for (int i = 0; i < SIM_STREAM_NUM; i++)
+    {
+        streams[i].open((outdir + stream_files[i]).c_str(), std::ios::binary);
+        std::ofstream *out = &streams[i];
+        m.set_sink(i, [out](const char *data, std::size_t len) { out->write(data, static_cast<std::streamsize>(len)); });
+    }
+
+    /*Run in steps, which must produce the same output as sim running the program at once.*/
+    while (status == SIM_RUNNING)
+    {
+        status = m.step(STEP_CYCLES);
+    }
+    if (status == SIM_ERROR)
+    {
+        std::cerr << "The run failed at pc " << m.pc() << "\n";
+        return 1;
+    }
+
+    for (int i = 3; i < SIM_CPU_REG_NUM; i++)
+    {
+        registers[i - 3] = m.reg(i);
+    }
+    for (int i = 0; i < m.memory_depth(); i++)
+    {
+        memory[i] = m.read_memory(i);
+    }
+    std::ofstream cycles((outdir + "cycles.txt").c_str(), std::ios::binary);
+    cycles << static_cast<int>(m.cycles()) + m.disk_cycles_left();
+    cycles.close();
+    for (int i = 0; i < SIM_STREAM_NUM; i++)
+    {
+        streams[i].close();
+    }
+    return !write_words(outdir + "regout.txt", registers, SIM_CPU_REG_NUM - 3) ||
+           !write_words(outdir + "dmemout.txt", memory, m.memory_depth()) || !cycles;
+}
@@ -0,0 +1,33 @@
+#!/bin/sh
+# Records programs/bench/count.asm and irq2.asm with a checkpoint every few thousand cycles, and regenerates their
+# traces with simreplay on four threads, whole and for ranges that start and end between checkpoints: the traces
+# must be those of a single thread, which are those of sim, and no part file may be left next to them.
+
+. "$(dirname "$0")/common.sh"
+
+TRACES="trace.txt hwregtrace.txt"
+
+for name in bench/count irq2; do
+    assemble "$name" || { echo "FAIL $name: cannot assemble"; failures=$((failures + 1)); continue; }
+    every=$([ "$name" = irq2 ] && echo 100 || echo 20000)
+    run_sim "$name" "$WORK/$name/record" --record "$WORK/$name/run.log" --record-every "$every" ||
+        { echo "FAIL $name: sim --record failed"; failures=$((failures + 1)); continue; }
+    for cycles in "" 150-870 30001-170123; do
+        run_sim "$name" "$WORK/$name/sim$cycles" ${cycles:+--trace-cycles "$cycles"} ||
+            { echo "FAIL $name: sim failed"; failures=$((failures + 1)); }
+        for threads in 1 4; do
+            dir=$WORK/$name/threads$threads$cycles
+            mkdir -p "$dir"
+            "$BIN/simreplay" --threads "$threads" ${cycles:+--cycles "$cycles"} "$WORK/$name/run.log" \
+                "$dir/trace.txt" "$dir/hwregtrace.txt" ||
+                { echo "FAIL $name: simreplay --threads $threads $cycles failed"; failures=$((failures + 1)); }
+            compare "$name" "$WORK/$name/sim$cycles" "$dir" "$TRACES"
+            if ls "$dir" | grep -q part; then
+                echo "FAIL $name: simreplay --threads $threads $cycles left part files"
+                failures=$((failures + 1))
+            fi
+        done
+    done
+done
+echo "parallel_replay_check: $failures failures"
+[ "$failures" -eq 0 ]
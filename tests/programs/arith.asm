@@ -0,0 +1,43 @@
+# Arithmetic, shifts, branches, memory and a jal subroutine
+	add $sp, $zero, $imm1, $zero, 2048, 0
+	add $s0, $zero, $zero, $zero, 0, 0
+	add $s1, $zero, $zero, $zero, 0, 0
+loop:
+	mac $s1, $s0, $s0, $s1, 0, 0
+	sw $s1, $s0, $imm1, $zero, 1024, 0
+	add $s0, $s0, $imm1, $zero, 1, 0
+	blt $zero, $s0, $imm1, $imm2, 60, loop
+	add $a0, $zero, $imm1, $zero, 7, 0
+	jal $ra, $zero, $zero, $imm1, fact, 0
+	sll $t0, $v0, $imm1, $zero, 3, 0
+	sra $t1, $t0, $imm1, $zero, 2, 0
+	srl $t2, $imm1, $imm2, $zero, -16, 4
+	sra $t2, $imm1, $imm2, $zero, -16, 2
+	xor $s2, $t0, $t1, $t2, 0, 0
+	and $gp, $s2, $imm1, $zero, 0xFFF, 0
+	or $gp, $gp, $imm2, $zero, 0, 0x100
+	sub $a1, $gp, $t2, $imm1, 5, 0
+	lw $a2, $zero, $imm1, $imm2, 1030, 3
+	add $zero, $imm1, $zero, $zero, 5, 0
+	add $t0, $zero, $zero, $zero, 0, 0
+	add $imm1, $imm2, $zero, $zero, 5, 9
+	add $t1, $imm1, $zero, $zero, 3, 0
+	bge $zero, $t1, $imm1, $imm2, 3, skip
+	add $t1, $zero, $zero, $zero, 0, 0
+skip:
+	bne $zero, $t1, $t1, $imm1, 0, 0
+	ble $zero, $t1, $imm1, $imm2, 2, 0
+	bgt $zero, $t1, $imm1, $imm2, 100, 0
+	.word 2000 0x12345678
+	.word 2001 -7
+	lw $v0, $zero, $imm1, $zero, 2001, 0
+	halt $zero, $zero, $zero, $zero, 0, 0
+fact:
+	add $v0, $zero, $imm1, $zero, 1, 0
+floop:
+	ble $zero, $a0, $imm1, $imm2, 1, fend
+	mac $v0, $v0, $a0, $zero, 0, 0
+	sub $a0, $a0, $imm1, $zero, 1, 0
+	beq $zero, $zero, $zero, $imm1, floop, 0
+fend:
+	beq $zero, $zero, $zero, $ra, 0, 0
@@ -0,0 +1,49 @@
+# A hot loop of 40 ALU instructions that mixes four words a million times, run by jit_diff.sh to time --jit.
+# The jit keeps the words in host registers for the whole body, so it must beat the interpreter.
+	add $a3, $zero, $imm1, $zero, 1, 0
+	sll $a3, $a3, $imm1, $zero, 20, 0
+	add $s0, $zero, $imm1, $zero, 0x123, 0
+loop:
+	mac $t0, $s0, $imm1, $s1, 1469, 0
+	sll $t1, $t0, $imm1, $zero, 5, 0
+	srl $t2, $t0, $imm1, $zero, 11, 0
+	xor $s0, $t1, $t2, $s0, 0, 0
+	add $s1, $s1, $s0, $imm1, 249, 0
+	mac $t0, $s1, $imm1, $s2, 713, 0
+	sll $t1, $t0, $imm1, $zero, 6, 0
+	srl $t2, $t0, $imm1, $zero, 12, 0
+	xor $s1, $t1, $t2, $s1, 0, 0
+	add $s2, $s2, $s1, $imm1, 1235, 0
+	mac $t0, $s2, $imm1, $gp, 1955, 0
+	sll $t1, $t0, $imm1, $zero, 7, 0
+	srl $t2, $t0, $imm1, $zero, 13, 0
+	xor $s2, $t1, $t2, $s2, 0, 0
+	add $gp, $gp, $s2, $imm1, 951, 0
+	mac $t0, $gp, $imm1, $s0, 497, 0
+	sll $t1, $t0, $imm1, $zero, 5, 0
+	srl $t2, $t0, $imm1, $zero, 14, 0
+	xor $gp, $t1, $t2, $gp, 0, 0
+	add $s0, $s0, $gp, $imm1, 1765, 0
+	mac $t0, $s0, $imm1, $s1, 1765, 0
+	sll $t1, $t0, $imm1, $zero, 6, 0
+	srl $t2, $t0, $imm1, $zero, 15, 0
+	xor $s0, $t1, $t2, $s0, 0, 0
+	add $s1, $s1, $s0, $imm1, 497, 0
+	mac $t0, $s1, $imm1, $s2, 951, 0
+	sll $t1, $t0, $imm1, $zero, 7, 0
+	srl $t2, $t0, $imm1, $zero, 11, 0
+	xor $s1, $t1, $t2, $s1, 0, 0
+	add $s2, $s2, $s1, $imm1, 1955, 0
+	mac $t0, $s2, $imm1, $gp, 1235, 0
+	sll $t1, $t0, $imm1, $zero, 5, 0
+	srl $t2, $t0, $imm1, $zero, 12, 0
+	xor $s2, $t1, $t2, $s2, 0, 0
+	add $gp, $gp, $s2, $imm1, 713, 0
+	mac $t0, $gp, $imm1, $s0, 249, 0
+	sll $t1, $t0, $imm1, $zero, 6, 0
+	srl $t2, $t0, $imm1, $zero, 13, 0
+	xor $gp, $t1, $t2, $gp, 0, 0
+	add $s0, $s0, $gp, $imm1, 1469, 0
+	sub $a3, $a3, $imm1, $zero, 1, 0
+	bne $zero, $a3, $zero, $imm1, loop, 0
+	halt $zero, $zero, $zero, $zero, 0, 0
@@ -0,0 +1,10 @@
+# Counts to 50000 in a loop of four instructions, 200000 cycles in all, so the index of its trace has four blocks.
+	add $s0, $zero, $zero, $zero, 0, 0
+	add $s1, $zero, $imm1, $zero, 50, 0
+	mac $s1, $s1, $imm1, $zero, 1000, 0
+loop:
+	add $s0, $s0, $imm1, $zero, 1, 0
+	xor $s2, $s2, $s0, $zero, 0, 0
+	sll $t0, $s0, $imm1, $zero, 3, 0
+	blt $zero, $s0, $s1, $imm1, loop, 0
+	halt $zero, $zero, $zero, $zero, 0, 0
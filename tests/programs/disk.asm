@@ -0,0 +1,38 @@
+# Disk reads and writes with the disk interrupt, monitor pixels and the 7-segment display
+	out $zero, $zero, $imm2, $imm1, isr, 6
+	out $zero, $zero, $imm2, $imm1, 1, 1
+	out $zero, $zero, $imm2, $imm1, 3, 15
+	out $zero, $zero, $imm2, $imm1, 500, 16
+	out $zero, $zero, $imm2, $imm1, 1, 14
+poll:
+	in $t0, $zero, $imm1, $zero, 17, 0
+	bne $zero, $t0, $zero, $imm1, poll, 0
+	lw $t1, $zero, $imm1, $zero, 500, 0
+	add $t1, $t1, $imm1, $zero, 1, 0
+	sw $t1, $zero, $imm1, $zero, 500, 0
+	out $zero, $zero, $imm2, $imm1, 7, 15
+	out $zero, $zero, $imm2, $imm1, 2, 14
+idle:
+	lw $t2, $zero, $imm1, $zero, 600, 0
+	blt $zero, $t2, $imm1, $imm2, 2, idle
+	add $s0, $zero, $zero, $zero, 0, 0
+mloop:
+	out $zero, $zero, $imm2, $s0, 0, 20
+	out $zero, $zero, $imm2, $s0, 0, 21
+	out $zero, $zero, $imm2, $imm1, 1, 22
+	add $s0, $s0, $imm1, $zero, 257, 0
+	blt $zero, $s0, $imm1, $imm2, 3000, mloop
+	out $zero, $zero, $imm2, $imm1, 0x1234, 10
+	out $zero, $zero, $imm2, $imm1, 9, 15
+	out $zero, $zero, $imm2, $imm1, 1, 14
+	add $t0, $zero, $imm1, $zero, 40, 0
+sp:
+	sub $t0, $t0, $imm1, $zero, 1, 0
+	bne $zero, $t0, $zero, $imm1, sp, 0
+	halt $zero, $zero, $zero, $zero, 0, 0
+isr:
+	lw $t2, $zero, $imm1, $zero, 600, 0
+	add $t2, $t2, $imm1, $zero, 1, 0
+	sw $t2, $zero, $imm1, $zero, 600, 0
+	out $zero, $zero, $imm2, $zero, 0, 4
+	reti $zero, $zero, $zero, $zero, 0, 0
@@ -0,0 +1,23 @@
+# Random instructions with random irq 2 interrupts
+	out $zero, $zero, $imm2, $imm1, isr, 6
+	out $zero, $zero, $imm2, $imm1, 8, 12
+	out $zero, $zero, $imm2, $imm1, 1, 11
+	out $zero, $zero, $imm2, $imm1, 1, 2
+	out $zero, $zero, $imm2, $imm1, 1, 11
+	add $s2, $zero, $imm1, $zero, 131, 0
+loop:
+	sub $a1, $s0, $sp, $a1, -993, -33
+	in $t0, $zero, $imm1, $zero, 22, 0
+	xor $a0, $imm1, $a2, $t0, 122, -39
+	sub $s2, $s2, $imm1, $zero, 1, 0
+	bgt $zero, $s2, $zero, $imm1, loop, 0
+	halt $zero, $zero, $zero, $zero, 0, 0
+isr:
+	sw $t2, $zero, $imm1, $zero, 261, 0
+	xor $t2, $t2, $imm1, $zero, 23, 0
+	in $t1, $zero, $imm1, $zero, 4, 0
+	xor $t2, $t2, $imm1, $zero, 26, 0
+	out $zero, $zero, $imm2, $zero, 0, 3
+	out $zero, $zero, $imm2, $zero, 0, 4
+	out $zero, $zero, $imm2, $zero, 0, 5
+	reti $zero, $zero, $zero, $zero, 0, 0
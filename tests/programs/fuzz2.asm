@@ -0,0 +1,19 @@
+# Random instructions with random irq 2 interrupts
+	out $zero, $zero, $imm2, $imm1, isr, 6
+	out $zero, $zero, $imm2, $imm1, 0, 2
+	out $zero, $zero, $imm2, $imm1, 23, 1
+	add $s2, $zero, $imm1, $zero, 129, 0
+loop:
+	sll $a0, $a2, $a0, $s1, 1429, -33
+	out $zero, $zero, $imm2, $imm1, 0, 1
+	sw $v0, $zero, $imm1, $gp, 249, 1
+	and $v0, $s1, $imm1, $a1, 324, 13
+	sub $s2, $s2, $imm1, $zero, 1, 0
+	bgt $zero, $s2, $zero, $imm1, loop, 0
+	halt $zero, $zero, $zero, $zero, 0, 0
+isr:
+	out $zero, $zero, $imm2, $t2, 0, 9
+	out $zero, $zero, $imm2, $zero, 0, 3
+	out $zero, $zero, $imm2, $zero, 0, 4
+	out $zero, $zero, $imm2, $zero, 0, 5
+	reti $zero, $zero, $zero, $zero, 0, 0
@@ -0,0 +1,48 @@
+# Random instructions with random irq 2 interrupts
+	out $zero, $zero, $imm2, $imm1, isr, 6
+	out $zero, $zero, $imm2, $imm1, 1, 13
+	out $zero, $zero, $imm2, $imm1, 1, 3
+	out $zero, $zero, $imm2, $imm1, 1885, 13
+	add $s2, $zero, $imm1, $zero, 136, 0
+loop:
+	mac $s0, $t1, $a1, $t1, -326, -33
+	sw $a2, $zero, $imm1, $a0, 231, 5
+	out $zero, $zero, $imm2, $imm1, 22, 15
+	srl $a2, $a0, $t2, $s0, -1127, 14
+	ble $zero, $t1, $imm2, $imm1, f1, 1
+	add $a1, $ra, $imm1, $zero, -8, 0
+	add $s1, $a1, $imm1, $zero, 7, 0
+f1:
+	out $zero, $zero, $imm2, $imm1, 107, 15
+	lw $gp, $zero, $imm1, $t2, 238, -5
+	sw $a0, $zero, $imm1, $a2, 269, -1
+	xor $ra, $t2, $sp, $t0, -1116, -8
+	xor $t1, $s1, $gp, $zero, -579, -37
+	sll $v0, $s1, $v0, $a2, 1451, -35
+	sub $zero, $s1, $a2, $a1, -1410, -5
+	or $s0, $t1, $gp, $sp, -1622, 25
+	lw $a2, $zero, $imm1, $t1, 172, 2
+	lw $s0, $zero, $imm1, $a2, 142, 2
+	blt $zero, $a1, $a2, $imm1, f2, 3
+	add $a2, $gp, $imm1, $zero, -9, 0
+	add $t0, $t1, $imm1, $zero, -4, 0
+f2:
+	add $s1, $v0, $a2, $gp, -1098, 6
+	ble $zero, $a1, $v0, $imm1, f3, -1
+	add $t0, $sp, $imm1, $zero, -6, 0
+	add $a2, $s1, $imm1, $zero, 7, 0
+f3:
+	lw $sp, $zero, $imm1, $t1, 167, 5
+	bge $zero, $a1, $s0, $imm1, f4, -1
+	add $v0, $t0, $imm1, $zero, 1, 0
+	add $s1, $sp, $imm1, $zero, 5, 0
+f4:
+	sub $s2, $s2, $imm1, $zero, 1, 0
+	bgt $zero, $s2, $zero, $imm1, loop, 0
+	halt $zero, $zero, $zero, $zero, 0, 0
+isr:
+	sw $t2, $zero, $imm1, $zero, 233, 0
+	out $zero, $zero, $imm2, $zero, 0, 3
+	out $zero, $zero, $imm2, $zero, 0, 4
+	out $zero, $zero, $imm2, $zero, 0, 5
+	reti $zero, $zero, $zero, $zero, 0, 0
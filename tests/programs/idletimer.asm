@@ -0,0 +1,12 @@
+# Irq 2 interrupts while the timer is never started, so --trace-trigger irq0 never fires
+	out $zero, $zero, $imm2, $imm1, isr, 6
+	out $zero, $zero, $imm2, $imm1, 1, 2
+	add $s0, $zero, $imm1, $zero, 200, 0
+loop:
+	sub $s0, $s0, $imm1, $zero, 1, 0
+	bne $zero, $s0, $zero, $imm1, loop, 0
+	halt $zero, $zero, $zero, $zero, 0, 0
+isr:
+	out $zero, $zero, $imm2, $zero, 0, 5
+	out $zero, $zero, $imm2, $s0, 0, 9
+	reti $zero, $zero, $zero, $zero, 0, 0
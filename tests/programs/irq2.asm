@@ -0,0 +1,17 @@
+# A hot loop interrupted by the irq 2 schedule of irq2.irq, with leds written by the isr
+	out $zero, $zero, $imm2, $imm1, isr, 6
+	out $zero, $zero, $imm2, $imm1, 1, 2
+	add $s0, $zero, $zero, $zero, 0, 0
+loop:
+	mac $s1, $s0, $imm1, $s1, 3, 0
+	add $s0, $s0, $imm1, $zero, 1, 0
+	blt $zero, $s0, $imm1, $imm2, 300, loop
+	in $v0, $zero, $imm1, $zero, 5, 0
+	halt $zero, $zero, $zero, $zero, 0, 0
+isr:
+	lw $t2, $zero, $imm1, $zero, 50, 0
+	add $t2, $t2, $imm1, $zero, 1, 0
+	sw $t2, $zero, $imm1, $zero, 50, 0
+	out $zero, $zero, $imm2, $t2, 0, 10
+	out $zero, $zero, $imm2, $zero, 0, 5
+	reti $zero, $zero, $zero, $zero, 0, 0
@@ -0,0 +1,22 @@
+# Polling diskstatus and reading timer and monitor registers in loops
+	out $zero, $zero, $imm2, $imm1, 5, 15
+	out $zero, $zero, $imm2, $imm1, 200, 16
+	out $zero, $zero, $imm2, $imm1, 1, 14
+poll:
+	in $t0, $zero, $imm1, $zero, 17, 0
+	lw $t1, $zero, $imm1, $zero, 50, 0
+	bne $zero, $t0, $zero, $imm1, poll, 0
+	lw $s0, $zero, $imm1, $zero, 201, 0
+	out $zero, $zero, $imm2, $imm1, 9, 15
+	out $zero, $zero, $imm2, $imm1, 200, 16
+	out $zero, $zero, $imm2, $imm1, 2, 14
+poll2:
+	in $zero, $zero, $imm1, $zero, 17, 0
+	bne $zero, $zero, $zero, $imm1, poll2, 0
+	add $a0, $zero, $imm1, $zero, 3, 0
+w:
+	in $t2, $zero, $imm1, $zero, 12, 0
+	in $t1, $zero, $imm1, $zero, 22, 0
+	sub $a0, $a0, $imm1, $zero, 1, 0
+	bgt $zero, $a0, $zero, $imm1, w, 0
+	halt $zero, $zero, $zero, $zero, 0, 0
@@ -0,0 +1,17 @@
+# A self-branch that spins until the timer interrupt, fast-forwarded by the simulator
+	out $zero, $zero, $imm2, $imm1, 200, 13
+	out $zero, $zero, $imm2, $imm1, 1, 11
+	out $zero, $zero, $imm2, $zero, 0, 3
+	out $zero, $zero, $imm2, $imm1, isr, 6
+	out $zero, $zero, $imm2, $imm1, 1, 0
+	add $s0, $zero, $imm1, $zero, 3, 0
+spin:
+	beq $zero, $zero, $zero, $imm1, spin, 0
+isr:
+	out $zero, $zero, $imm2, $zero, 0, 3
+	sub $s0, $s0, $imm1, $zero, 1, 0
+	out $zero, $zero, $imm2, $s0, 0, 9
+	beq $zero, $s0, $zero, $imm1, done, 0
+	reti $zero, $zero, $zero, $zero, 0, 0
+done:
+	halt $zero, $zero, $zero, $zero, 0, 0
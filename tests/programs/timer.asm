@@ -0,0 +1,34 @@
+# Timer interrupts counted by an isr that ends the run through irqreturn
+	out $zero, $zero, $imm2, $imm1, isr, 6
+	out $zero, $zero, $imm2, $imm1, 37, 13
+	out $zero, $zero, $imm2, $imm1, 1, 0
+	out $zero, $zero, $imm2, $imm1, 1, 11
+idle:
+	beq $zero, $zero, $zero, $imm1, idle, 0
+done:
+	out $zero, $zero, $imm2, $imm1, 0, 11
+	add $t1, $zero, $imm1, $zero, 50, 0
+spin2:
+	sub $t1, $t1, $imm1, $zero, 1, 0
+	bgt $zero, $t1, $zero, $imm1, spin2, 0
+	in $v0, $zero, $imm1, $zero, 12, 0
+	in $a0, $zero, $imm1, $zero, 8, 0
+	in $a1, $zero, $imm1, $zero, 3, 0
+	out $zero, $zero, $imm2, $imm1, 5, 13
+	out $zero, $zero, $imm2, $zero, 0, 12
+	out $zero, $zero, $imm2, $imm1, 1, 11
+	add $t1, $zero, $imm1, $zero, 30, 0
+wait2:
+	lw $t0, $zero, $imm1, $zero, 100, 0
+	blt $zero, $t0, $imm1, $imm2, 9, wait2
+	halt $zero, $zero, $zero, $zero, 0, 0
+isr:
+	lw $t2, $zero, $imm1, $zero, 100, 0
+	add $t2, $t2, $imm1, $zero, 1, 0
+	sw $t2, $zero, $imm1, $zero, 100, 0
+	out $zero, $zero, $imm2, $t2, 0, 9
+	out $zero, $zero, $imm2, $zero, 0, 3
+	bne $zero, $t2, $imm1, $imm2, 6, iret
+	out $zero, $zero, $imm2, $imm1, done, 7
+iret:
+	reti $zero, $zero, $zero, $zero, 0, 0
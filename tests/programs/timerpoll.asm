@@ -0,0 +1,12 @@
+# Polling irq0status while the timer runs, then an interrupt enable without a handler
+	out $zero, $zero, $imm2, $imm1, 100, 13
+	out $zero, $zero, $imm2, $imm1, 1, 11
+	add $t0, $zero, $imm1, $zero, 100, 0
+l:
+	sub $t0, $t0, $imm1, $zero, 1, 0
+	in $t1, $zero, $imm1, $zero, 3, 0
+	bne $zero, $t0, $zero, $imm1, l, 0
+	out $zero, $zero, $imm2, $imm1, 1, 0
+	out $zero, $zero, $imm2, $imm1, 300, 6
+	add $t0, $zero, $imm1, $zero, 5, 0
+	halt $zero, $zero, $zero, $zero, 0, 0
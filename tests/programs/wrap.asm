@@ -0,0 +1,21 @@
+# lw and sw addresses past the end of memory and a monitor address past the end of the monitor
+	sll $t1, $imm1, $imm2, $zero, 1, 12
+	add $t0, $zero, $imm1, $zero, 77, 0
+	sw $t0, $t1, $zero, $zero, 0, 0
+	lw $t2, $t1, $imm1, $zero, 1, 0
+	add $s0, $zero, $zero, $zero, 0, 0
+loop:
+	sw $s0, $t1, $s0, $zero, 0, 0
+	lw $s1, $t1, $s0, $zero, 0, 0
+	sub $s2, $zero, $s0, $zero, 0, 0
+	sw $s0, $s2, $imm1, $zero, -5, 0
+	add $s0, $s0, $imm1, $zero, 1, 0
+	blt $zero, $s0, $imm1, $imm2, 100, loop
+	sll $a0, $imm1, $imm2, $zero, 1, 20
+	out $zero, $imm1, $zero, $a0, 20, 0
+	out $zero, $imm1, $zero, $imm2, 21, 200
+	out $zero, $imm1, $zero, $imm2, 22, 1
+	add $a1, $zero, $imm1, $zero, -1, 0
+	out $zero, $imm1, $zero, $a1, 20, 0
+	out $zero, $imm1, $zero, $imm2, 22, 1
+	halt $zero, $zero, $zero, $zero, 0, 0
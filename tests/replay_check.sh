@@ -0,0 +1,45 @@
+#!/bin/sh
+# Records every program of the corpus with a checkpoint every 64 cycles, and regenerates its traces with simreplay:
+# the whole traces must be those of a run without --record, in text and in binary, and the traces of a range of
+# cycles those of a run with --trace-cycles over the same range.
+
+. "$(dirname "$0")/common.sh"
+
+TRACES="trace.txt hwregtrace.txt"
+
+# replay NAME DIR [OPTIONS...]: regenerates the traces of the recorded run of a program into DIR.
+replay()
+{
+    name=$1
+    dir=$2
+    shift 2
+    mkdir -p "$dir"
+    "$BIN/simreplay" --threads 1 "$@" "$WORK/$name/record/run.log" "$dir/trace.txt" "$dir/hwregtrace.txt" ||
+        { echo "FAIL $name: simreplay $* failed"; failures=$((failures + 1)); }
+}
+
+for name in $(programs); do
+    assemble "$name" || { echo "FAIL $name: cannot assemble"; failures=$((failures + 1)); continue; }
+    run_sim "$name" "$WORK/$name/sim" || { echo "FAIL $name: sim failed"; failures=$((failures + 1)); }
+    run_sim "$name" "$WORK/$name/record" --record "$WORK/$name/record/run.log" --record-every 64 ||
+        { echo "FAIL $name: sim --record failed"; failures=$((failures + 1)); }
+    if [ -s "$WORK/$name/record/trace.txt" ]; then
+        echo "FAIL $name: the recorded run wrote trace.txt"
+        failures=$((failures + 1))
+    fi
+    compare "$name" "$WORK/$name/sim" "$WORK/$name/record" \
+        "dmemout.txt regout.txt cycles.txt leds.txt display7seg.txt diskout.txt monitor.txt"
+    replay "$name" "$WORK/$name/replay"
+    compare "$name" "$WORK/$name/sim" "$WORK/$name/replay" "$TRACES"
+
+    run_sim "$name" "$WORK/$name/binary" --binary || { echo "FAIL $name: sim --binary failed"; failures=$((failures + 1)); }
+    replay "$name" "$WORK/$name/replay_binary" --binary
+    compare "$name" "$WORK/$name/binary" "$WORK/$name/replay_binary" "$TRACES"
+
+    run_sim "$name" "$WORK/$name/window" --trace-cycles 100-260 ||
+        { echo "FAIL $name: sim --trace-cycles failed"; failures=$((failures + 1)); }
+    replay "$name" "$WORK/$name/replay_window" --cycles 100-260
+    compare "$name" "$WORK/$name/window" "$WORK/$name/replay_window" "$TRACES"
+done
+echo "replay_check: $failures failures"
+[ "$failures" -eq 0 ]
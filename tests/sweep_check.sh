@@ -0,0 +1,67 @@
+#!/bin/sh
+# Sweeps irq2.asm over schedules that agree with irq2.irq up to cycle 100, and one that does not. Each branch must
+# write the output files of a standalone run of its schedule, the one that disagrees must be reported as failed,
+# and with --split the prefix file followed by the file of a branch must be its whole stream.
+
+. "$(dirname "$0")/common.sh"
+
+STREAMS="trace.txt hwregtrace.txt leds.txt display7seg.txt"
+name=irq2
+assemble "$name" || { echo "FAIL $name: cannot assemble"; exit 1; }
+cp "$PROGRAMS/irq2.irq" "$WORK/s0.irq"
+printf '10\n50\n51\n400\n' > "$WORK/s1.irq"
+printf '10\n50\n51\n' > "$WORK/s2.irq"
+printf '10\n60\n200\n' > "$WORK/bad.irq"
+for sweep in full split; do
+    mkdir -p "$WORK/$sweep"
+    : > "$WORK/$sweep.txt"
+    for s in s0 s1 s2 bad; do
+        echo "$WORK/$s.irq $WORK/$sweep/$s" >> "$WORK/$sweep.txt"
+    done
+done
+
+# summary_line BRANCH: the fields of the line of a branch in summary.txt.
+summary_line()
+{
+    sed -n "$(($1 + 2))p" "$WORK/summary.txt"
+}
+
+if (cd "$WORK" && "$BIN/simsweep" --processes 2 "$WORK/$name/imemin.txt" "$WORK/$name/dmemin.txt" "$PROGRAMS/disk.txt" \
+    100 full.txt summary.txt 2> /dev/null); then
+    echo "FAIL simsweep: exit code 0 with a failed branch"
+    failures=$((failures + 1))
+fi
+if [ "$(head -n 1 "$WORK/summary.txt")" != "# branch status cycles seconds outdir" ]; then
+    echo "FAIL simsweep: summary.txt does not start with its header"
+    failures=$((failures + 1))
+fi
+branch=0
+for s in s0 s1 s2; do
+    run_schedule "$name" "$WORK/$s.irq" "$WORK/sim/$s" || { echo "FAIL $s: sim failed"; failures=$((failures + 1)); }
+    compare "$s" "$WORK/sim/$s" "$WORK/full/$s"
+    set -- $(summary_line "$branch")
+    if [ "$1" != "$branch" ] || [ "$2" != ok ] || [ "$3" != "$(cat "$WORK/sim/$s/cycles.txt")" ]; then
+        echo "FAIL $s: expected ok with the cycles of sim in summary.txt"
+        failures=$((failures + 1))
+    fi
+    branch=$((branch + 1))
+done
+set -- $(summary_line "$branch")
+if [ "$2" != failed ]; then
+    echo "FAIL bad: a schedule that disagrees before the fork was not reported as failed"
+    failures=$((failures + 1))
+fi
+
+(cd "$WORK" && "$BIN/simsweep" --split --prefix-dir prefix "$WORK/$name/imemin.txt" "$WORK/$name/dmemin.txt" \
+    "$PROGRAMS/disk.txt" 100 split.txt split_summary.txt 2> /dev/null)
+for s in s0 s1 s2; do
+    for file in $STREAMS; do
+        if ! cat "$WORK/prefix/$file" "$WORK/split/$s/$file" | cmp -s - "$WORK/sim/$s/$file"; then
+            echo "FAIL $s: the prefix and the split $file are not the whole stream"
+            failures=$((failures + 1))
+        fi
+    done
+    compare "$s" "$WORK/sim/$s" "$WORK/split/$s" "dmemout.txt regout.txt cycles.txt diskout.txt monitor.txt"
+done
+echo "sweep_check: $failures failures"
+[ "$failures" -eq 0 ]
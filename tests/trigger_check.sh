@@ -0,0 +1,26 @@
+#!/bin/sh
+# Checks --trace-trigger irq0. idletimer.asm never starts the timer, whose irq0status is still set from reset on,
+# so the trigger must never fire and trace.txt and hwregtrace.txt stay empty. timer.asm starts the timer, so its
+# triggered trace must be a proper tail of the full trace, starting at the first timer interrupt.
+
+. "$(dirname "$0")/common.sh"
+
+for name in idletimer timer; do
+    assemble "$name" || { echo "FAIL $name: cannot assemble"; failures=$((failures + 1)); continue; }
+    run_sim "$name" "$WORK/$name/full" || { echo "FAIL $name: sim failed"; failures=$((failures + 1)); }
+    run_sim "$name" "$WORK/$name/irq0" --trace-trigger irq0 || { echo "FAIL $name: sim failed"; failures=$((failures + 1)); }
+done
+
+if [ -s "$WORK/idletimer/irq0/trace.txt" ] || [ -s "$WORK/idletimer/irq0/hwregtrace.txt" ]; then
+    echo "FAIL idletimer: the irq0 trigger fired without a running timer"
+    failures=$((failures + 1))
+fi
+full=$(wc -l < "$WORK/timer/full/trace.txt")
+triggered=$(wc -l < "$WORK/timer/irq0/trace.txt")
+if [ "$triggered" -eq 0 ] || [ "$triggered" -ge "$full" ] ||
+    ! tail -n "$triggered" "$WORK/timer/full/trace.txt" | cmp -s - "$WORK/timer/irq0/trace.txt"; then
+    echo "FAIL timer: the irq0 trace is not the tail of the full trace from the first timer interrupt"
+    failures=$((failures + 1))
+fi
+echo "trigger_check: $failures failures"
+[ "$failures" -eq 0 ]